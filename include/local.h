@@ -366,6 +366,8 @@ static inline int snd_open_device(const char *filename, int fmode)
 	snd1_dlobj_cache_put
 #define snd_dlobj_cache_cleanup \
 	snd1_dlobj_cache_cleanup
+#define snd_pcm_hw_refine_cache_free \
+	snd1_pcm_hw_refine_cache_free
 #define snd_config_set_hop \
 	snd1_config_set_hop
 #define snd_config_check_hop \
@@ -378,6 +380,9 @@ void *snd_dlobj_cache_get(const char *lib, const char *name, const char *version
 void *snd_dlobj_cache_get2(const char *lib, const char *name, const char *version, int verbose);
 int snd_dlobj_cache_put(void *open_func);
 void snd_dlobj_cache_cleanup(void);
+#ifdef BUILD_PCM
+void snd_pcm_hw_refine_cache_free(void);
+#endif
 
 /* for recursive checks */
 void snd_config_set_hop(snd_config_t *conf, int hop);
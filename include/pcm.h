@@ -1316,6 +1316,101 @@ int16_t *snd_pcm_scope_s16_get_channel_buffer(snd_pcm_scope_t *scope,
 
 /** \} */
 
+/**
+ * \defgroup PCM_DirectStats Direct Plugin Statistics
+ * \ingroup PCM
+ * Statistics of the dmix, dsnoop and dshare plugins.
+ * See the \ref pcm page for more details.
+ * \{
+ */
+
+/** Maximum number of clients in #snd_pcm_direct_stats_t */
+#define SND_PCM_DIRECT_STATS_CLIENTS	32
+/** Number of the commit duration histogram buckets */
+#define SND_PCM_DIRECT_STATS_HIST	16
+
+/** Statistics of one direct plugin client */
+typedef struct _snd_pcm_direct_client_stats {
+	/** client process id in the PID namespace of the client,
+	 * 0 = unused entry */
+	int pid;
+	/** xruns seen by the client */
+	unsigned int xruns;
+	/** number of transfers between the client and the slave buffer */
+	unsigned long long commits;
+	/** transferred frames */
+	unsigned long long frames;
+	/** transfer (mix or copy) duration histogram (with stats_timing),
+	 * bucket 0 counts < 1 usec, bucket n counts 2^(n-1) .. 2^n - 1 usec
+	 * and the last bucket also counts the longer ones */
+	unsigned long long commit_hist[SND_PCM_DIRECT_STATS_HIST];
+	/** number of the semaphore waits in the transfer path */
+	unsigned long long sem_waits;
+	/** total semaphore wait time in nsec (with stats_timing) */
+	unsigned long long sem_wait_ns;
+	/** longest semaphore wait time in nsec (with stats_timing) */
+	unsigned long long sem_wait_max_ns;
+	/** number of the poll wakeups */
+	unsigned long long wakeups;
+	/** avail frames at the last wakeup (in the slave buffer for
+	 * playback, in the client buffer for capture) */
+	unsigned long long avail_last;
+	/** lowest avail frames at a wakeup */
+	unsigned long long avail_min;
+	/** highest avail frames at a wakeup, close to the buffer size
+	 * means the client was almost late */
+	unsigned long long avail_max;
+} snd_pcm_direct_client_stats_t;
+
+/** Statistics of a direct plugin instance, shared by all its clients */
+typedef struct _snd_pcm_direct_stats {
+	/** recovered slave xruns */
+	unsigned int xruns;
+	/** folds of the dmix staging slots which found staged frames
+	 * already passed by the hw pointer (the frames are lost) */
+	unsigned int staging_xruns;
+	/** per-client statistics */
+	snd_pcm_direct_client_stats_t client[SND_PCM_DIRECT_STATS_CLIENTS];
+} snd_pcm_direct_stats_t;
+
+int snd_pcm_direct_stats(snd_pcm_t *pcm, snd_pcm_direct_stats_t *stats);
+
+/** \} */
+
+/**
+ * \defgroup PCM_Ring Transfer Ring
+ * \ingroup PCM
+ * Read and write requests of many PCMs completed in batches (io_uring).
+ * See the \ref pcm page for more details.
+ * \{
+ */
+
+/** PCM transfer ring handle */
+typedef struct _snd_pcm_ring snd_pcm_ring_t;
+
+/** Completion of a transfer ring request */
+typedef struct _snd_pcm_ring_event {
+	/** PCM handle of the request */
+	snd_pcm_t *pcm;
+	/** private data given with the request */
+	void *private_data;
+	/** transferred frames or a negative error code */
+	snd_pcm_sframes_t result;
+} snd_pcm_ring_event_t;
+
+int snd_pcm_ring_open(snd_pcm_ring_t **ringp, unsigned int entries);
+int snd_pcm_ring_close(snd_pcm_ring_t *ring);
+int snd_pcm_ring_poll_descriptors_count(snd_pcm_ring_t *ring);
+int snd_pcm_ring_poll_descriptors(snd_pcm_ring_t *ring, struct pollfd *pfds, unsigned int space);
+int snd_pcm_ring_writei(snd_pcm_ring_t *ring, snd_pcm_t *pcm, const void *buffer, snd_pcm_uframes_t size, void *private_data);
+int snd_pcm_ring_writen(snd_pcm_ring_t *ring, snd_pcm_t *pcm, void **bufs, snd_pcm_uframes_t size, void *private_data);
+int snd_pcm_ring_readi(snd_pcm_ring_t *ring, snd_pcm_t *pcm, void *buffer, snd_pcm_uframes_t size, void *private_data);
+int snd_pcm_ring_readn(snd_pcm_ring_t *ring, snd_pcm_t *pcm, void **bufs, snd_pcm_uframes_t size, void *private_data);
+int snd_pcm_ring_submit(snd_pcm_ring_t *ring);
+int snd_pcm_ring_wait(snd_pcm_ring_t *ring, snd_pcm_ring_event_t *events, unsigned int space, int timeout);
+
+/** \} */
+
 /**
  * \defgroup PCM_Simple Simple setup functions
  * \ingroup PCM
@@ -176,6 +176,9 @@ int snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 int _snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 		       snd_config_t *root, snd_config_t *conf,
 		       snd_pcm_stream_t stream, int mode);
+int snd_pcm_rate_set_drift(snd_pcm_t *pcm, long ppb);
+int snd_pcm_rate_set_drift_target(snd_pcm_t *pcm, snd_pcm_uframes_t frames);
+int snd_pcm_rate_get_drift(snd_pcm_t *pcm, long *ppb);
 
 /*
  *  Hooks plugin
@@ -42,7 +42,7 @@ extern "C" {
 /**
  * Protocol version
  */
-#define SND_PCM_RATE_PLUGIN_VERSION	0x010003
+#define SND_PCM_RATE_PLUGIN_VERSION	0x010004
 
 /** hw_params information for a single side */
 typedef struct snd_pcm_rate_side_info {
@@ -130,6 +130,18 @@ typedef struct snd_pcm_rate_ops {
 	int (*get_supported_formats)(void *obj, uint64_t *in_formats,
 				     uint64_t *out_formats,
 				     unsigned int *flags);
+	/**
+	 * convert an s32 interleaved-data array; exclusive with convert;
+	 * new ops since version 0x010004
+	 */
+	void (*convert_s32)(void *obj, int32_t *dst, unsigned int dst_frames,
+			    const int32_t *src, unsigned int src_frames);
+	/**
+	 * convert a float interleaved-data array; exclusive with convert;
+	 * new ops since version 0x010004
+	 */
+	void (*convert_float)(void *obj, float *dst, unsigned int dst_frames,
+			      const float *src, unsigned int src_frames);
 } snd_pcm_rate_ops_t;
 
 /** open function type */
@@ -185,6 +197,31 @@ typedef struct snd_pcm_rate_v2_ops {
 				   unsigned int *rate_max);
 	void (*dump)(void *obj, snd_output_t *out);
 } snd_pcm_rate_v2_ops_t;
+
+/* old rate_ops for protocol version 0x010003 */
+typedef struct snd_pcm_rate_v3_ops {
+	void (*close)(void *obj);
+	int (*init)(void *obj, snd_pcm_rate_info_t *info);
+	void (*free)(void *obj);
+	void (*reset)(void *obj);
+	int (*adjust_pitch)(void *obj, snd_pcm_rate_info_t *info);
+	void (*convert)(void *obj,
+			const snd_pcm_channel_area_t *dst_areas,
+			snd_pcm_uframes_t dst_offset, unsigned int dst_frames,
+			const snd_pcm_channel_area_t *src_areas,
+			snd_pcm_uframes_t src_offset, unsigned int src_frames);
+	void (*convert_s16)(void *obj, int16_t *dst, unsigned int dst_frames,
+			    const int16_t *src, unsigned int src_frames);
+	snd_pcm_uframes_t (*input_frames)(void *obj, snd_pcm_uframes_t frames);
+	snd_pcm_uframes_t (*output_frames)(void *obj, snd_pcm_uframes_t frames);
+	unsigned int version;
+	int (*get_supported_rates)(void *obj, unsigned int *rate_min,
+				   unsigned int *rate_max);
+	void (*dump)(void *obj, snd_output_t *out);
+	int (*get_supported_formats)(void *obj, uint64_t *in_formats,
+				     uint64_t *out_formats,
+				     unsigned int *flags);
+} snd_pcm_rate_v3_ops_t;
 #endif
 
 #ifdef __cplusplus
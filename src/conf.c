@@ -4790,6 +4790,9 @@ int snd_config_update_free_global(void)
 	snd_config_unlock();
 	/* FIXME: better to place this in another place... */
 	snd_dlobj_cache_cleanup();
+#ifdef BUILD_PCM
+	snd_pcm_hw_refine_cache_free();
+#endif
 
 	return 0;
 }
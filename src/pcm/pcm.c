@@ -121,6 +121,18 @@ data in the signal handler. For further details see the sigaction function
 this extension. The implemented transfer routines can be found in the
 \ref alsa_transfers section.
 
+\subsection pcm_transfer_ring Transfer ring
+
+The transfer ring (\ref snd_pcm_ring_open) queues the read and write
+requests of many streams to one Linux io_uring instance, so one thread
+can drive many devices and get the completions in batches with
+\ref snd_pcm_ring_wait. The requests of a hw device with the
+#SND_PCM_ACCESS_RW_NONINTERLEAVED access are transferred by the kernel
+after the device is ready. The requests of the other streams only wait
+in the kernel, the library transfers the available frames when the
+completion is reaped. A completed request may have transferred less
+frames than requested, the application queues the rest again.
+
 \section pcm_open_behaviour Blocked and non-blocked open
 
 The ALSA PCM API uses a different behaviour when the device is opened
@@ -516,6 +528,16 @@ LIBASOUND_THREAD_SAFE=0 aplay foo.wav
 \endcode
 for making the debugging easier.
 
+Passing 2 to LIBASOUND_THREAD_SAFE keeps the locking and additionally lets
+the status queries #snd_pcm_avail_update(), #snd_pcm_avail(),
+#snd_pcm_avail_delay(), #snd_pcm_delay() and #snd_pcm_htimestamp() called
+from other threads than the one transferring the data return the values
+last published by that thread (or by an earlier query) without taking the
+lock, as long as these values are not older than one period.  A thread only
+monitoring the stream then never holds the lock the transferring thread
+waits for.  The values may be up to one period old; when they are older,
+for example while the stream is idle, the query takes the lock as usual.
+
 \section pcm_dev_names PCM naming conventions
 
 The ALSA library uses a generic string representation for names of devices.
@@ -1043,6 +1065,221 @@ int snd_pcm_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t *params)
 	return 0;
 }
 
+#ifndef DOC_HIDDEN
+#ifdef THREAD_SAFE_API
+/*
+ * Status snapshot ($LIBASOUND_THREAD_SAFE=2)
+ *
+ * The thread doing the transfers publishes the avail after each transfer
+ * and the status queries publish their results, always with the PCM lock
+ * held.  The status queries of the other threads return the published
+ * values not older than a period without taking the lock.  The calls
+ * moving appl_ptr or changing the state drop the published values.
+ */
+static inline snd_pcm_snapshot_t *snapshot_of(snd_pcm_t *pcm)
+{
+	return &pcm->fast_op_arg->snapshot;
+}
+
+static inline int snapshot_enabled(snd_pcm_t *pcm)
+{
+	snd_pcm_t *op = pcm->fast_op_arg;
+
+	return op->lock_snapshot && op->lock_enabled && op->need_lock;
+}
+
+static uint64_t snapshot_now(void)
+{
+	snd_htimestamp_t ts;
+
+	gettimestamp(&ts, SND_PCM_TSTAMP_TYPE_MONOTONIC);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void snapshot_write_begin(snd_pcm_snapshot_t *s)
+{
+	__atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void snapshot_write_end(snd_pcm_snapshot_t *s)
+{
+	__atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* forget the published values, the position has changed */
+void snd_pcm_snapshot_reset(snd_pcm_t *pcm)
+{
+	snd_pcm_snapshot_t *s;
+
+	if (!snapshot_enabled(pcm))
+		return;
+	s = snapshot_of(pcm);
+	snapshot_write_begin(s);
+	s->avail_time = 0;
+	s->delay_time = 0;
+	s->tstamp_time = 0;
+	s->delay_follows = 0;
+	snapshot_write_end(s);
+}
+
+static void snd_pcm_snapshot_avail(snd_pcm_t *pcm, snd_pcm_sframes_t avail,
+				   int writer)
+{
+	snd_pcm_snapshot_t *s;
+	uint64_t now;
+
+	if (!snapshot_enabled(pcm) || avail < 0)
+		return;
+	s = snapshot_of(pcm);
+	now = snapshot_now();
+	snapshot_write_begin(s);
+	if (writer) {
+		s->writer = pthread_self();
+		s->writer_valid = 1;
+	}
+	/* the delay moves with the avail while the latency stays the same */
+	if (s->delay_follows && s->avail_time) {
+		if (pcm->stream == SND_PCM_STREAM_PLAYBACK)
+			s->delay += s->avail - avail;
+		else
+			s->delay += avail - s->avail;
+		s->delay_time = now;
+	}
+	s->avail = avail;
+	s->avail_time = now;
+	snapshot_write_end(s);
+}
+
+/* avail is negative when only the delay is known */
+static void snd_pcm_snapshot_delay(snd_pcm_t *pcm, snd_pcm_sframes_t avail,
+				   snd_pcm_sframes_t delay)
+{
+	snd_pcm_snapshot_t *s;
+	uint64_t now;
+
+	if (!snapshot_enabled(pcm))
+		return;
+	s = snapshot_of(pcm);
+	now = snapshot_now();
+	snapshot_write_begin(s);
+	s->delay = delay;
+	s->delay_time = now;
+	s->delay_follows = avail >= 0;
+	if (avail >= 0) {
+		s->avail = avail;
+		s->avail_time = now;
+	}
+	snapshot_write_end(s);
+}
+
+static void snd_pcm_snapshot_tstamp(snd_pcm_t *pcm, snd_pcm_uframes_t avail,
+				    const snd_htimestamp_t *tstamp)
+{
+	snd_pcm_snapshot_t *s;
+	uint64_t now;
+
+	if (!snapshot_enabled(pcm))
+		return;
+	s = snapshot_of(pcm);
+	now = snapshot_now();
+	snapshot_write_begin(s);
+	s->tstamp_avail = avail;
+	s->tstamp = *tstamp;
+	s->tstamp_time = now;
+	snapshot_write_end(s);
+}
+
+/*
+ * read the snapshot for a status query of another thread than the
+ * transferring one, returns 0 when the query has to take the lock
+ */
+static int snapshot_read(snd_pcm_t *pcm, snd_pcm_snapshot_t *snap,
+			 uint64_t *max_time)
+{
+	snd_pcm_snapshot_t *s;
+	unsigned int seq;
+
+	if (!snapshot_enabled(pcm) || !pcm->rate)
+		return 0;
+	s = snapshot_of(pcm);
+	for (;;) {
+		seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+			continue;
+		*snap = *s;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == seq)
+			break;
+	}
+	if (!snap->writer_valid || pthread_equal(snap->writer, pthread_self()))
+		return 0;
+	/* the values older than a period are stale */
+	*max_time = (uint64_t)pcm->period_size * 1000000000ULL / pcm->rate;
+	*max_time = snapshot_now() - *max_time;
+	return 1;
+}
+
+static inline int snapshot_fresh(uint64_t time, uint64_t max_time)
+{
+	return time && time >= max_time;
+}
+
+static int snd_pcm_snapshot_query_avail(snd_pcm_t *pcm, snd_pcm_sframes_t *availp)
+{
+	snd_pcm_snapshot_t snap;
+	uint64_t max_time;
+
+	if (!snapshot_read(pcm, &snap, &max_time) ||
+	    !snapshot_fresh(snap.avail_time, max_time))
+		return 0;
+	*availp = snap.avail;
+	return 1;
+}
+
+static int snd_pcm_snapshot_query_delay(snd_pcm_t *pcm, snd_pcm_sframes_t *availp,
+					snd_pcm_sframes_t *delayp)
+{
+	snd_pcm_snapshot_t snap;
+	uint64_t max_time;
+
+	if (!snapshot_read(pcm, &snap, &max_time) ||
+	    !snapshot_fresh(snap.delay_time, max_time))
+		return 0;
+	if (availp) {
+		/* the pair must be in sync */
+		if (!snap.delay_follows ||
+		    !snapshot_fresh(snap.avail_time, max_time))
+			return 0;
+		*availp = snap.avail;
+	}
+	*delayp = snap.delay;
+	return 1;
+}
+
+static int snd_pcm_snapshot_query_tstamp(snd_pcm_t *pcm, snd_pcm_uframes_t *availp,
+					 snd_htimestamp_t *tstamp)
+{
+	snd_pcm_snapshot_t snap;
+	uint64_t max_time;
+
+	if (!snapshot_read(pcm, &snap, &max_time) ||
+	    !snapshot_fresh(snap.tstamp_time, max_time))
+		return 0;
+	*availp = snap.tstamp_avail;
+	*tstamp = snap.tstamp;
+	return 1;
+}
+#else /* THREAD_SAFE_API */
+#define snd_pcm_snapshot_avail(pcm, avail, writer)	do {} while (0)
+#define snd_pcm_snapshot_delay(pcm, avail, delay)	do {} while (0)
+#define snd_pcm_snapshot_tstamp(pcm, avail, tstamp)	do {} while (0)
+#define snd_pcm_snapshot_query_avail(pcm, availp)	0
+#define snd_pcm_snapshot_query_delay(pcm, availp, delayp) 0
+#define snd_pcm_snapshot_query_tstamp(pcm, availp, tstamp) 0
+#endif /* THREAD_SAFE_API */
+#endif /* DOC_HIDDEN */
+
 /**
  * \brief Obtain status (runtime) information for PCM handle
  * \param pcm PCM handle
@@ -1158,8 +1395,12 @@ int snd_pcm_delay(snd_pcm_t *pcm, snd_pcm_sframes_t *delayp)
 		SNDMSG("PCM not set up");
 		return -EIO;
 	}
+	if (snd_pcm_snapshot_query_delay(pcm, NULL, delayp))
+		return 0;
 	snd_pcm_lock(pcm->fast_op_arg);
 	err = __snd_pcm_delay(pcm, delayp);
+	if (err >= 0)
+		snd_pcm_snapshot_delay(pcm, -1, *delayp);
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return err;
 }
@@ -1192,6 +1433,9 @@ int snd_pcm_resume(snd_pcm_t *pcm)
 		err = pcm->fast_ops->resume(pcm->fast_op_arg);
 	else
 		err = -ENOSYS;
+	snd_pcm_lock(pcm->fast_op_arg);
+	snd_pcm_snapshot_reset(pcm);
+	snd_pcm_unlock(pcm->fast_op_arg);
 	return err;
 }
 
@@ -1216,11 +1460,15 @@ int snd_pcm_htimestamp(snd_pcm_t *pcm, snd_pcm_uframes_t *avail, snd_htimestamp_
 		SNDMSG("PCM not set up");
 		return -EIO;
 	}
+	if (snd_pcm_snapshot_query_tstamp(pcm, avail, tstamp))
+		return 0;
 	snd_pcm_lock(pcm->fast_op_arg);
 	if (pcm->fast_ops->htimestamp)
 		err = pcm->fast_ops->htimestamp(pcm->fast_op_arg, avail, tstamp);
 	else
 		err = -ENOSYS;
+	if (err >= 0)
+		snd_pcm_snapshot_tstamp(pcm, *avail, tstamp);
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return err;
 }
@@ -1249,6 +1497,7 @@ int snd_pcm_prepare(snd_pcm_t *pcm)
 		err = pcm->fast_ops->prepare(pcm->fast_op_arg);
 	else
 		err = -ENOSYS;
+	snd_pcm_snapshot_reset(pcm);
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return err;
 }
@@ -1276,6 +1525,7 @@ int snd_pcm_reset(snd_pcm_t *pcm)
 		err = pcm->fast_ops->reset(pcm->fast_op_arg);
 	else
 		err = -ENOSYS;
+	snd_pcm_snapshot_reset(pcm);
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return err;
 }
@@ -1301,6 +1551,7 @@ int snd_pcm_start(snd_pcm_t *pcm)
 		return err;
 	snd_pcm_lock(pcm->fast_op_arg);
 	err = __snd_pcm_start(pcm);
+	snd_pcm_snapshot_reset(pcm);
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return err;
 }
@@ -1336,6 +1587,7 @@ int snd_pcm_drop(snd_pcm_t *pcm)
 		err = pcm->fast_ops->drop(pcm->fast_op_arg);
 	else
 		err = -ENOSYS;
+	snd_pcm_snapshot_reset(pcm);
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return err;
 }
@@ -1369,11 +1621,18 @@ int snd_pcm_drain(snd_pcm_t *pcm)
 		return err;
 	if (err == 1)
 		return 0;
+	/* the state changes on the way in and out */
+	snd_pcm_lock(pcm->fast_op_arg);
+	snd_pcm_snapshot_reset(pcm);
+	snd_pcm_unlock(pcm->fast_op_arg);
 	/* lock handled in the callback */
 	if (pcm->fast_ops->drain)
 		err = pcm->fast_ops->drain(pcm->fast_op_arg);
 	else
 		err = -ENOSYS;
+	snd_pcm_lock(pcm->fast_op_arg);
+	snd_pcm_snapshot_reset(pcm);
+	snd_pcm_unlock(pcm->fast_op_arg);
 	return err;
 }
 
@@ -1406,6 +1665,7 @@ int snd_pcm_pause(snd_pcm_t *pcm, int enable)
 		err = pcm->fast_ops->pause(pcm->fast_op_arg, enable);
 	else
 		err = -ENOSYS;
+	snd_pcm_snapshot_reset(pcm);
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return err;
 }
@@ -1472,6 +1732,7 @@ snd_pcm_sframes_t snd_pcm_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t frames)
 		result = pcm->fast_ops->rewind(pcm->fast_op_arg, frames);
 	else
 		result = -ENOSYS;
+	snd_pcm_snapshot_reset(pcm);
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return result;
 }
@@ -1542,6 +1803,7 @@ snd_pcm_sframes_t snd_pcm_forward(snd_pcm_t *pcm, snd_pcm_uframes_t frames)
 		result = pcm->fast_ops->forward(pcm->fast_op_arg, frames);
 	else
 		result = -ENOSYS;
+	snd_pcm_snapshot_reset(pcm);
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return result;
 }
@@ -2843,12 +3105,16 @@ int snd_pcm_new(snd_pcm_t **pcmp, snd_pcm_type_t type, const char *name,
 		/* set lock_enabled field depending on $LIBASOUND_THREAD_SAFE */
 		static int do_lock_enable = -1; /* uninitialized */
 
+		static int do_lock_snapshot;
+
 		/* evaluate env var only once at the first open for consistency */
 		if (do_lock_enable == -1) {
 			char *p = getenv("LIBASOUND_THREAD_SAFE");
 			do_lock_enable = !p || *p != '0';
+			do_lock_snapshot = p && *p == '2';
 		}
 		pcm->lock_enabled = do_lock_enable;
+		pcm->lock_snapshot = do_lock_snapshot;
 	}
 #endif
 	*pcmp = pcm;
@@ -3051,8 +3317,11 @@ snd_pcm_sframes_t snd_pcm_avail_update(snd_pcm_t *pcm)
 {
 	snd_pcm_sframes_t result;
 
+	if (snd_pcm_snapshot_query_avail(pcm, &result))
+		return result;
 	snd_pcm_lock(pcm->fast_op_arg);
 	result = __snd_pcm_avail_update(pcm);
+	snd_pcm_snapshot_avail(pcm, result, 0);
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return result;
 }
@@ -3081,12 +3350,15 @@ snd_pcm_sframes_t snd_pcm_avail(snd_pcm_t *pcm)
 		SNDMSG("PCM not set up");
 		return -EIO;
 	}
+	if (snd_pcm_snapshot_query_avail(pcm, &result))
+		return result;
 	snd_pcm_lock(pcm->fast_op_arg);
 	err = __snd_pcm_hwsync(pcm);
 	if (err < 0)
 		result = err;
 	else
 		result = __snd_pcm_avail_update(pcm);
+	snd_pcm_snapshot_avail(pcm, result, 0);
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return result;
 }
@@ -3114,6 +3386,8 @@ int snd_pcm_avail_delay(snd_pcm_t *pcm,
 		SNDMSG("PCM not set up");
 		return -EIO;
 	}
+	if (snd_pcm_snapshot_query_delay(pcm, availp, delayp))
+		return 0;
 	snd_pcm_lock(pcm->fast_op_arg);
 	err = __snd_pcm_hwsync(pcm);
 	if (err < 0)
@@ -3127,6 +3401,7 @@ int snd_pcm_avail_delay(snd_pcm_t *pcm,
 	if (err < 0)
 		goto unlock;
 	*availp = sf;
+	snd_pcm_snapshot_delay(pcm, sf, *delayp);
 	err = 0;
  unlock:
 	snd_pcm_unlock(pcm->fast_op_arg);
@@ -3154,6 +3429,15 @@ int snd_pcm_area_silence(const snd_pcm_channel_area_t *dst_area, snd_pcm_uframes
 	dst = snd_pcm_channel_area_addr(dst_area, dst_offset);
 	width = snd_pcm_format_physical_width(format);
 	silence = snd_pcm_format_silence_64(format);
+	/*
+	 * Zero silence of contiguous samples, at any alignment and also
+	 * for the 3-byte formats.
+	 */
+	if (dst_area->step == (unsigned int) width &&
+	    width % 8 == 0 && silence == 0) {
+		memset(dst, 0, samples * width / 8);
+		return 0;
+	}
         /*
          * Iterate copying silent sample for sample data aligned to 64 bit.
          * This is a fast path.
@@ -3443,6 +3727,11 @@ int snd_pcm_areas_copy(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_
 		SNDMSG("invalid frames %ld", frames);
 		return -EINVAL;
 	}
+	/* interleave or deinterleave of the whole buffer */
+	if (channels > 1 &&
+	    snd_pcm_simd_areas_copy(dst_areas, dst_offset, src_areas, src_offset,
+				    channels, frames, width) == 0)
+		return 0;
 	while (channels > 0) {
 		unsigned int step = src_areas->step;
 		void *src_addr = src_areas->addr;
@@ -7544,6 +7833,8 @@ snd_pcm_sframes_t snd_pcm_mmap_commit(snd_pcm_t *pcm,
 		return err;
 	snd_pcm_lock(pcm->fast_op_arg);
 	result = __snd_pcm_mmap_commit(pcm, offset, frames);
+	if (result >= 0)
+		snd_pcm_snapshot_avail(pcm, snd_pcm_mmap_avail(pcm), 1);
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return result;
 }
@@ -7674,6 +7965,7 @@ snd_pcm_sframes_t snd_pcm_read_areas(snd_pcm_t *pcm, const snd_pcm_channel_area_
 		if (err < 0)
 			break;
 		frames = err;
+		snd_pcm_snapshot_avail(pcm, avail - frames, 1);
 		offset += frames;
 		size -= frames;
 		xfer += frames;
@@ -7751,6 +8043,7 @@ snd_pcm_sframes_t snd_pcm_write_areas(snd_pcm_t *pcm, const snd_pcm_channel_area
 		if (err < 0)
 			break;
 		frames = err;
+		snd_pcm_snapshot_avail(pcm, avail - frames, 1);
 		if (state == SND_PCM_STATE_PREPARED) {
 			snd_pcm_sframes_t hw_avail = pcm->buffer_size - avail;
 			hw_avail += frames;
@@ -56,10 +56,204 @@ union semun {
 };
 #endif
  
+#ifdef DIRECT_IPC_POSIX
 /*
- * FIXME:
- *  add possibility to use futexes here
+ *  POSIX shm backend
+ *
+ *  The segments are named after the IPC key. Each client keeps an OFD
+ *  read lock on the first byte of its segment fd, the creator holds the
+ *  write lock until the segment is initialized. The client which gets
+ *  the write lock when closing is the last user and unlinks the segment.
+ *  The following bytes are locked by the owners of the stats entries.
+ *  The locks are released by the kernel when a client dies, like
+ *  SEM_UNDO, and they don't depend on the PID namespace of the client.
+ */
+
+#define DIRECT_IPC_POSIX_MAGIC	0xa15ad3f0
+
+static void posix_shm_name(snd_pcm_direct_t *dmix, const char *suffix,
+			   char *name, size_t size)
+{
+	snprintf(name, size, "/alsa-direct-%x%s", (unsigned int)dmix->ipc_key, suffix);
+}
+
+static int posix_shm_lock_byte(int fd, off_t offset, short type, int wait)
+{
+	struct flock lock;
+
+	memset(&lock, 0, sizeof(lock));
+	lock.l_type = type;
+	lock.l_whence = SEEK_SET;
+	lock.l_start = offset;
+	lock.l_len = 1;
+	if (fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &lock) < 0)
+		return -errno;
+	return 0;
+}
+
+static inline int posix_shm_lock(int fd, short type, int wait)
+{
+	return posix_shm_lock_byte(fd, 0, type, wait);
+}
+
+/* the lock of a stats entry, held by its owner while registered */
+static inline int posix_stats_lock(int fd, int entry, short type)
+{
+	return posix_shm_lock_byte(fd, 1 + entry, type, 0);
+}
+
+/* the name still refers to the segment opened as fd */
+static int posix_shm_linked(const char *name, int fd)
+{
+	struct stat st1, st2;
+	int fd2, ret;
+
+	fd2 = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+	if (fd2 < 0)
+		return 0;
+	ret = fstat(fd, &st1) == 0 && fstat(fd2, &st2) == 0 &&
+	      st1.st_dev == st2.st_dev && st1.st_ino == st2.st_ino;
+	close(fd2);
+	return ret;
+}
+
+/*
+ * open and map a segment, returns the fd
+ * when *first is set, the caller initializes the segment and
+ * calls snd_pcm_direct_posix_shm_ready()
  */
+int snd_pcm_direct_posix_shm_open(snd_pcm_direct_t *dmix, const char *suffix,
+				  size_t size, void **ptr, int *first)
+{
+	char name[32];
+	struct stat st;
+	void *addr;
+	int fd, err;
+
+	posix_shm_name(dmix, suffix, name, sizeof(name));
+ __retry:
+	*first = 0;
+	fd = shm_open(name, O_RDWR | O_CREAT | O_CLOEXEC, dmix->ipc_perm);
+	if (fd < 0)
+		return -errno;
+	if (posix_shm_lock(fd, F_WRLCK, 0) == 0) {
+		/* no other user, (re)initialize the segment */
+		if (!posix_shm_linked(name, fd)) {
+			close(fd);
+			goto __retry;
+		}
+		*first = 1;
+		if (ftruncate(fd, 0) < 0 || ftruncate(fd, size) < 0 ||
+		    fchmod(fd, dmix->ipc_perm) < 0)
+			goto __error;
+		if (dmix->ipc_gid >= 0 && fchown(fd, -1, dmix->ipc_gid) < 0)
+			goto __error;
+	} else {
+		/* wait until the creator has initialized the segment */
+		err = posix_shm_lock(fd, F_RDLCK, 1);
+		if (err < 0) {
+			close(fd);
+			return err;
+		}
+		if (!posix_shm_linked(name, fd)) {	/* unlinked by the last user */
+			close(fd);
+			goto __retry;
+		}
+		if (fstat(fd, &st) < 0)
+			goto __error;
+		if ((size_t)st.st_size != size) {
+			close(fd);
+			return -EINVAL;
+		}
+	}
+	addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED)
+		goto __error;
+	*ptr = addr;
+	return fd;
+
+ __error:
+	err = -errno;
+	close(fd);
+	return err;
+}
+
+/* the segment is initialized, let the other clients in */
+int snd_pcm_direct_posix_shm_ready(int fd)
+{
+	return posix_shm_lock(fd, F_RDLCK, 0);
+}
+
+/* unmap and close a segment, returns 1 when it was the last user */
+int snd_pcm_direct_posix_shm_close(snd_pcm_direct_t *dmix, const char *suffix,
+				   int fd, void *ptr)
+{
+	char name[32];
+	struct stat st;
+	int ret = 0;
+
+	if (ptr && ptr != (void *) -1 && fstat(fd, &st) == 0)
+		munmap(ptr, st.st_size);
+	if (posix_shm_lock(fd, F_WRLCK, 0) == 0) {
+		posix_shm_name(dmix, suffix, name, sizeof(name));
+		if (posix_shm_linked(name, fd) && shm_unlink(name) == 0)
+			ret = 1;
+	}
+	close(fd);
+	return ret;
+}
+
+/*
+ * the semaphore segment holds robust process-shared mutexes,
+ * the uncontended lock and unlock don't enter the kernel
+ */
+static int posix_semaphore_create_or_connect(snd_pcm_direct_t *dmix)
+{
+	pthread_mutexattr_t attr;
+	void *ptr;
+	int i, fd, first;
+
+	fd = snd_pcm_direct_posix_shm_open(dmix, ".sem",
+					   sizeof(snd_pcm_direct_ipc_sem_t),
+					   &ptr, &first);
+	if (fd < 0)
+		return fd;
+	dmix->semid = fd;
+	dmix->semptr = ptr;
+	if (first) {
+		pthread_mutexattr_init(&attr);
+		pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+		for (i = 0; i < DIRECT_IPC_SEMS; i++)
+			pthread_mutex_init(&dmix->semptr->lock[i], &attr);
+		pthread_mutexattr_destroy(&attr);
+		dmix->semptr->magic = DIRECT_IPC_POSIX_MAGIC;
+		snd_pcm_direct_posix_shm_ready(fd);
+	} else if (dmix->semptr->magic != DIRECT_IPC_POSIX_MAGIC) {
+		snd_pcm_direct_posix_sem_discard(dmix);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+/* release the held locks and the semaphore segment of this client */
+int snd_pcm_direct_posix_sem_discard(snd_pcm_direct_t *dmix)
+{
+	int i;
+
+	if (dmix->semid < 0)
+		return 0;
+	for (i = 0; i < DIRECT_IPC_SEMS; i++) {
+		while (dmix->locked[i] > 0)
+			if (snd_pcm_direct_semaphore_up(dmix, i) < 0)
+				break;
+	}
+	snd_pcm_direct_posix_shm_close(dmix, ".sem", dmix->semid, dmix->semptr);
+	dmix->semid = -1;
+	dmix->semptr = NULL;
+	return 0;
+}
+#endif /* DIRECT_IPC_POSIX */
 
 int snd_pcm_direct_semaphore_create_or_connect(snd_pcm_direct_t *dmix)
 {
@@ -67,6 +261,10 @@ int snd_pcm_direct_semaphore_create_or_connect(snd_pcm_direct_t *dmix)
 	struct semid_ds buf;
 	int i;
 
+#ifdef DIRECT_IPC_POSIX
+	if (dmix->ipc_posix)
+		return posix_semaphore_create_or_connect(dmix);
+#endif
 	dmix->semid = semget(dmix->ipc_key, DIRECT_IPC_SEMS,
 			     IPC_CREAT | dmix->ipc_perm);
 	if (dmix->semid < 0)
@@ -99,11 +297,172 @@ static unsigned int snd_pcm_direct_magic(snd_pcm_direct_t *dmix)
  *  global shared memory area 
  */
 
+/*
+ * take a free entry in the shared stats, the semaphore is held
+ */
+static void snd_pcm_direct_stats_register(snd_pcm_direct_t *dmix)
+{
+	snd_pcm_direct_client_stats_t *client = dmix->shmptr->stats.client;
+	int i;
+
+	dmix->stats = NULL;
+	for (i = 0; i < SND_PCM_DIRECT_STATS_CLIENTS; i++) {
+#ifdef DIRECT_IPC_POSIX
+		/* the entry of a crashed client is free with its lock */
+		if (dmix->ipc_posix) {
+			if (posix_stats_lock(dmix->shmid, i, F_WRLCK) == 0)
+				break;
+			continue;
+		}
+#endif
+		/* the SysV entries are freed only by the unregister */
+		if (client[i].pid == 0)
+			break;
+	}
+	if (i >= SND_PCM_DIRECT_STATS_CLIENTS)
+		return;		/* no stats for this client */
+	memset(&client[i], 0, sizeof(client[i]));
+	client[i].pid = getpid();
+	dmix->stats = &client[i];
+}
+
+static void snd_pcm_direct_stats_unregister(snd_pcm_direct_t *dmix)
+{
+	if (dmix->stats) {
+		dmix->stats->pid = 0;
+#ifdef DIRECT_IPC_POSIX
+		if (dmix->ipc_posix)
+			posix_stats_lock(dmix->shmid,
+					 dmix->stats - dmix->shmptr->stats.client,
+					 F_UNLCK);
+#endif
+		dmix->stats = NULL;
+	}
+}
+
+/*
+ * the stats entry is written only by its owner without any lock
+ */
+void snd_pcm_direct_stats_commit(snd_pcm_direct_t *dmix,
+				 snd_pcm_uframes_t frames,
+				 unsigned long long start)
+{
+	snd_pcm_direct_client_stats_t *stats = dmix->stats;
+	unsigned long long usec;
+	unsigned int bucket = 0;
+
+	if (!stats)
+		return;
+	stats->commits++;
+	stats->frames += frames;
+	if (!start)
+		return;		/* no timing */
+	usec = (snd_pcm_direct_stats_now(dmix) - start) / 1000;
+	while (usec && bucket < SND_PCM_DIRECT_STATS_HIST - 1) {
+		usec >>= 1;
+		bucket++;
+	}
+	stats->commit_hist[bucket]++;
+}
+
+void snd_pcm_direct_stats_sem_wait(snd_pcm_direct_t *dmix,
+				   unsigned long long start)
+{
+	snd_pcm_direct_client_stats_t *stats = dmix->stats;
+	unsigned long long nsec;
+
+	if (!stats)
+		return;
+	stats->sem_waits++;
+	if (!start)
+		return;		/* no timing */
+	nsec = snd_pcm_direct_stats_now(dmix) - start;
+	stats->sem_wait_ns += nsec;
+	if (nsec > stats->sem_wait_max_ns)
+		stats->sem_wait_max_ns = nsec;
+}
+
+void snd_pcm_direct_stats_wakeup(snd_pcm_direct_t *dmix, snd_pcm_t *pcm)
+{
+	snd_pcm_direct_client_stats_t *stats = dmix->stats;
+	snd_pcm_uframes_t avail;
+
+	if (!stats)
+		return;
+	if (pcm->stream == SND_PCM_STREAM_PLAYBACK) {
+		avail = pcm_frame_diff(dmix->slave_appl_ptr, dmix->slave_hw_ptr,
+				       dmix->slave_boundary);
+		avail = avail < dmix->slave_buffer_size ?
+			dmix->slave_buffer_size - avail : 0;
+	} else {
+		avail = snd_pcm_mmap_capture_avail(pcm);
+	}
+	stats->avail_last = avail;
+	if (!stats->wakeups++ || avail < stats->avail_min)
+		stats->avail_min = avail;
+	if (avail > stats->avail_max)
+		stats->avail_max = avail;
+}
+
+/**
+ * \brief Get the statistics of a direct plugin (dmix, dsnoop or dshare)
+ * \param pcm PCM handle of the direct plugin
+ * \param stats Returned statistics
+ * \return 0 on success otherwise a negative error code
+ *
+ * The statistics are shared by all clients of the plugin instance
+ * and updated by each client without locking, so the returned values
+ * are a snapshot which may be slightly inconsistent.
+ */
+int snd_pcm_direct_stats(snd_pcm_t *pcm, snd_pcm_direct_stats_t *stats)
+{
+	snd_pcm_direct_t *dmix;
+
+	assert(pcm && stats);
+	switch (pcm->type) {
+	case SND_PCM_TYPE_DMIX:
+	case SND_PCM_TYPE_DSNOOP:
+	case SND_PCM_TYPE_DSHARE:
+		break;
+	default:
+		return -EINVAL;
+	}
+	dmix = pcm->private_data;
+	memcpy(stats, &dmix->shmptr->stats, sizeof(*stats));
+	return 0;
+}
+
 int snd_pcm_direct_shm_create_or_connect(snd_pcm_direct_t *dmix)
 {
 	struct shmid_ds buf;
 	int tmpid, err, first_instance = 0;
-	
+
+#ifdef DIRECT_IPC_POSIX
+	if (dmix->ipc_posix) {
+		void *ptr;
+
+		err = snd_pcm_direct_posix_shm_open(dmix, "",
+						    sizeof(snd_pcm_direct_share_t),
+						    &ptr, &first_instance);
+		if (err < 0)
+			return err;
+		dmix->shmid = err;
+		dmix->shmptr = ptr;
+		mlock(dmix->shmptr, sizeof(snd_pcm_direct_share_t));
+		if (first_instance) {	/* the segment is zeroed when created */
+			dmix->shmptr->magic = snd_pcm_direct_magic(dmix);
+			snd_pcm_direct_posix_shm_ready(dmix->shmid);
+			snd_pcm_direct_stats_register(dmix);
+			return 1;
+		}
+		if (dmix->shmptr->magic != snd_pcm_direct_magic(dmix)) {
+			snd_pcm_direct_shm_discard(dmix);
+			return -EINVAL;
+		}
+		snd_pcm_direct_stats_register(dmix);
+		return 0;
+	}
+#endif
 retryget:
 	dmix->shmid = shmget(dmix->ipc_key, sizeof(snd_pcm_direct_share_t),
 			     dmix->ipc_perm);
@@ -144,6 +503,7 @@ retryget:
 			shmctl(dmix->shmid, IPC_SET, &buf);
 		}
 		dmix->shmptr->magic = snd_pcm_direct_magic(dmix);
+		snd_pcm_direct_stats_register(dmix);
 		return 1;
 	} else {
 		if (dmix->shmptr->magic != snd_pcm_direct_magic(dmix)) {
@@ -151,6 +511,7 @@ retryget:
 			return -EINVAL;
 		}
 	}
+	snd_pcm_direct_stats_register(dmix);
 	return 0;
 }
 
@@ -168,6 +529,15 @@ static int _snd_pcm_direct_shm_discard(snd_pcm_direct_t *dmix)
 
 	if (dmix->shmid < 0)
 		return -EINVAL;
+#ifdef DIRECT_IPC_POSIX
+	if (dmix->ipc_posix) {
+		ret = snd_pcm_direct_posix_shm_close(dmix, "", dmix->shmid,
+						     dmix->shmptr);
+		dmix->shmptr = (void *) -1;
+		dmix->shmid = -1;
+		return ret;
+	}
+#endif
 	if (dmix->shmptr != (void *) -1 && shmdt(dmix->shmptr) < 0)
 		return -errno;
 	dmix->shmptr = (void *) -1;
@@ -185,6 +555,7 @@ static int _snd_pcm_direct_shm_discard(snd_pcm_direct_t *dmix)
 /* ... and an exported version */
 int snd_pcm_direct_shm_discard(snd_pcm_direct_t *dmix)
 {
+	snd_pcm_direct_stats_unregister(dmix);
 	return _snd_pcm_direct_shm_discard(dmix);
 }
 
@@ -428,6 +799,14 @@ int snd_pcm_direct_server_create(snd_pcm_direct_t *dmix)
 
 	dmix->server_fd = -1;
 
+#ifdef DIRECT_IPC_POSIX
+	/* the server watches the attach count of the SysV segment */
+	if (dmix->ipc_posix) {
+		SNDERR("The server mode is not supported with ipc_backend posix");
+		return -ENOSYS;
+	}
+#endif
+
 	ret = get_tmp_name(dmix->shmptr->socket_name, sizeof(dmix->shmptr->socket_name));
 	if (ret < 0)
 		return ret;
@@ -601,6 +980,7 @@ int snd_pcm_direct_slave_recover(snd_pcm_direct_t *direct)
 		return 0;
 	}
 
+	direct->shmptr->stats.xruns++;
 	recoveries = direct->shmptr->s.recoveries;
 	recoveries = (recoveries + 1) & RECOVERIES_MASK;
 	if (state == SND_PCM_STATE_SUSPENDED)
@@ -701,6 +1081,7 @@ int snd_pcm_direct_check_xrun(snd_pcm_direct_t *direct, snd_pcm_t *pcm)
 			return -ESTRPIPE;
 		} else {
 			direct->state = SND_PCM_STATE_XRUN;
+			snd_pcm_direct_stats_xrun(direct);
 			return -EPIPE;
 		}
 	}
@@ -761,6 +1142,7 @@ timer_changed:
 	if (events & POLLIN) {
 		snd_pcm_uframes_t avail;
 		__snd_pcm_avail_update(pcm);
+		snd_pcm_direct_stats_wakeup(dmix, pcm);
 		if (pcm->stream == SND_PCM_STREAM_PLAYBACK) {
 			events |= POLLOUT;
 			events &= ~POLLIN;
@@ -921,8 +1303,20 @@ int snd_pcm_direct_hw_refine(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 			SNDERR("dshare format mask empty?");
 			return -EINVAL;
 		}
-		if (snd_mask_refine_set(hw_param_mask(params, SND_PCM_HW_PARAM_FORMAT),
-					dshare->shmptr->hw.format))
+		if (dshare->type == SND_PCM_TYPE_DMIX &&
+		    dshare->shmptr->u.dmix.float_sum &&
+		    !dshare->shmptr->u.dmix.staging_slots) {
+			/* the float mixing accepts also FLOAT clients */
+			snd_mask_t format;
+
+			snd_mask_none(&format);
+			snd_mask_set(&format, dshare->shmptr->hw.format);
+			snd_mask_set(&format, SND_PCM_FORMAT_FLOAT);
+			if (snd_mask_refine(hw_param_mask(params, SND_PCM_HW_PARAM_FORMAT),
+					    &format))
+				params->cmask |= 1<<SND_PCM_HW_PARAM_FORMAT;
+		} else if (snd_mask_refine_set(hw_param_mask(params, SND_PCM_HW_PARAM_FORMAT),
+					       dshare->shmptr->hw.format))
 			params->cmask |= 1<<SND_PCM_HW_PARAM_FORMAT;
 	}
 	//snd_mask_none(hw_param_mask(params, SND_PCM_HW_PARAM_SUBFORMAT));
@@ -1048,9 +1442,34 @@ int snd_pcm_direct_hw_free(snd_pcm_t *pcm ATTRIBUTE_UNUSED)
 
 int snd_pcm_direct_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t *params)
 {
+	snd_pcm_direct_t *dmix = pcm->private_data;
+	unsigned int ticks;
+	int err;
+
 	if (params->tstamp_type != pcm->tstamp_type)
 		return -EINVAL;
 
+	/* program the slave timer to the client avail_min */
+	if (dmix->timer_avail_min && dmix->timer && dmix->slave_period_size) {
+		if (sw_get_period_event(params) || !params->avail_min)
+			ticks = pcm->period_size / dmix->slave_period_size;
+		else
+			ticks = params->avail_min / dmix->slave_period_size;
+		if (!ticks)
+			ticks = 1;
+		/* timer_ticks follows hw_refine, compare with the timer */
+		dmix->timer_avail_ticks = ticks;
+		if (ticks != dmix->timer_ticks_set) {
+			err = snd_pcm_direct_set_timer_params(dmix);
+			if (err < 0)
+				return err;
+			/* setting the parameters stops the timer */
+			if (dmix->state == SND_PCM_STATE_RUNNING ||
+			    dmix->state == SND_PCM_STATE_DRAINING)
+				snd_timer_start(dmix->timer);
+		}
+	}
+
 	/* values are cached in the pcm structure */
 	return 0;
 }
@@ -1652,13 +2071,14 @@ int snd_pcm_direct_initialize_secondary_slave(snd_pcm_direct_t *dmix,
 int snd_pcm_direct_set_timer_params(snd_pcm_direct_t *dmix)
 {
 	snd_timer_params_t params = {0};
-	unsigned int filter;
+	unsigned int filter, ticks;
 	int ret;
 
+	ticks = dmix->timer_avail_ticks ? dmix->timer_avail_ticks : dmix->timer_ticks;
 	snd_timer_params_set_auto_start(&params, 1);
 	if (dmix->type != SND_PCM_TYPE_DSNOOP)
 		snd_timer_params_set_early_event(&params, 1);
-	snd_timer_params_set_ticks(&params, dmix->timer_ticks);
+	snd_timer_params_set_ticks(&params, ticks);
 	if (dmix->tread) {
 		filter = (1<<SND_TIMER_EVENT_TICK) |
 			 dmix->timer_events;
@@ -1669,6 +2089,7 @@ int snd_pcm_direct_set_timer_params(snd_pcm_direct_t *dmix)
 		SNDERR("unable to set timer parameters");
 		return ret;
 	}
+	dmix->timer_ticks_set = ticks;
 	return 0;
 }
 
@@ -1939,6 +2360,12 @@ int snd_pcm_direct_parse_open_conf(snd_config_t *root, snd_config_t *conf,
 #endif
 	rec->hw_ptr_alignment = SND_PCM_HW_PTR_ALIGNMENT_AUTO;
 	rec->tstamp_type = -1;
+	rec->staging_slots = 0;
+	rec->float_sum = 0;
+	rec->ipc_posix = 0;
+	rec->timer_avail_min = 0;
+	rec->stats_timing = 0;
+	rec->zero_copy = 0;
 
 	/* read defaults */
 	if (snd_config_search(root, "defaults.pcm.dmix_max_periods", &n) >= 0) {
@@ -2057,6 +2484,28 @@ int snd_pcm_direct_parse_open_conf(snd_config_t *root, snd_config_t *conf,
 			free(group);
 			continue;
 		}
+		if (strcmp(id, "ipc_backend") == 0) {
+			const char *str;
+			err = snd_config_get_string(n, &str);
+			if (err < 0) {
+				SNDERR("The field ipc_backend must be a string");
+				return err;
+			}
+			if (strcmp(str, "sysv") == 0) {
+				rec->ipc_posix = 0;
+			} else if (strcmp(str, "posix") == 0) {
+#ifdef DIRECT_IPC_POSIX
+				rec->ipc_posix = 1;
+#else
+				SNDERR("The posix IPC backend is not supported on this system");
+				return -EINVAL;
+#endif
+			} else {
+				SNDERR("The field ipc_backend must be sysv or posix");
+				return -EINVAL;
+			}
+			continue;
+		}
 		if (strcmp(id, "ipc_key_add_uid") == 0) {
 			if ((err = snd_config_get_bool(n)) < 0) {
 				SNDERR("The field ipc_key_add_uid must be a boolean type");
@@ -2102,6 +2551,46 @@ int snd_pcm_direct_parse_open_conf(snd_config_t *root, snd_config_t *conf,
 			rec->direct_memory_access = err;
 			continue;
 		}
+		if (strcmp(id, "timer_avail_min") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0)
+				return err;
+			rec->timer_avail_min = err;
+			continue;
+		}
+		if (strcmp(id, "stats_timing") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0)
+				return err;
+			rec->stats_timing = err;
+			continue;
+		}
+		if (strcmp(id, "zero_copy") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0)
+				return err;
+			rec->zero_copy = err;
+			continue;
+		}
+		if (strcmp(id, "staging_slots") == 0) {
+			long val;
+			err = snd_config_get_integer(n, &val);
+			if (err < 0)
+				return err;
+			if (val < 0 || val > DMIX_STAGING_MAX_SLOTS) {
+				SNDERR("The field staging_slots must be 0..%d", DMIX_STAGING_MAX_SLOTS);
+				return -EINVAL;
+			}
+			rec->staging_slots = val;
+			continue;
+		}
+		if (strcmp(id, "float_sum") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0)
+				return err;
+			rec->float_sum = err;
+			continue;
+		}
 		SNDERR("Unknown field %s", id);
 		return -EINVAL;
 	}
@@ -2162,6 +2651,9 @@ int _snd_pcm_direct_new(snd_pcm_t **pcmp, snd_pcm_direct_t **_dmix, int type,
 	dmix->ipc_key = opts->ipc_key;
 	dmix->ipc_perm = opts->ipc_perm;
 	dmix->ipc_gid = opts->ipc_gid;
+	dmix->ipc_posix = opts->ipc_posix;
+	dmix->timer_avail_min = opts->timer_avail_min;
+	dmix->stats_timing = opts->stats_timing;
 	dmix->tstamp_type = opts->tstamp_type;
 	dmix->semid = -1;
 	dmix->shmid = -1;
@@ -2191,7 +2683,7 @@ int _snd_pcm_direct_new(snd_pcm_t **pcmp, snd_pcm_direct_t **_dmix, int type,
 	ret = snd_pcm_direct_shm_create_or_connect(dmix);
 	if (ret < 0) {
 		SNDERR("unable to create IPC shm instance");
-		snd_pcm_direct_semaphore_up(dmix, DIRECT_IPC_SEM_CLIENT);
+		snd_pcm_direct_semaphore_final(dmix, DIRECT_IPC_SEM_CLIENT);
 		goto _err_nosem_free;
 	} else {
 		*_dmix = dmix;
@@ -21,9 +21,18 @@
 
 #include "pcm_local.h"  
 #include "../timer/timer_local.h"
+#include "pcm_dmix_staging.h"
+#include <fcntl.h>
 
 #define DIRECT_IPC_SEMS         1
 #define DIRECT_IPC_SEM_CLIENT   0
+
+/* POSIX shm segments with robust process-shared mutexes (ipc_backend posix) */
+#if defined(__linux__) && defined(HAVE_LIBPTHREAD) && defined(HAVE_LIBRT) && \
+    defined(F_OFD_SETLK)
+#include <pthread.h>
+#define DIRECT_IPC_POSIX        1
+#endif
 /* Seconds representing in Milli seconds */
 #define SEC_TO_MS               1000
 /* slave_period time for low latency requirements in ms */
@@ -55,6 +64,11 @@ typedef void (mix_areas_u8_t)(unsigned int size,
 			      volatile signed int *sum, size_t dst_step,
 			      size_t src_step, size_t sum_step);
 
+typedef void (mix_areas_float_t)(unsigned int size,
+				 volatile float *dst, float *src,
+				 volatile float *sum, size_t dst_step,
+				 size_t src_step, size_t sum_step);
+
 typedef enum snd_pcm_direct_hw_ptr_alignment {
 	SND_PCM_HW_PTR_ALIGNMENT_NO = 0,	/* use the hw_ptr as is and do no rounding */
 	SND_PCM_HW_PTR_ALIGNMENT_ROUNDUP = 1,	/* round the slave_appl_ptr up to slave_period */
@@ -124,9 +138,23 @@ typedef struct {
 		struct {
 			unsigned long long chn_mask;
 		} dshare;
+		struct {
+			unsigned int staging_slots;
+			unsigned int float_sum;		/* the sum buffer holds floats */
+		} dmix;
 	} u;
+	snd_pcm_direct_stats_t stats;		/* read by snd_pcm_direct_stats() */
 } snd_pcm_direct_share_t;
 
+
+#ifdef DIRECT_IPC_POSIX
+/* the semaphore segment of the posix backend */
+typedef struct {
+	unsigned int magic;
+	pthread_mutex_t lock[DIRECT_IPC_SEMS];
+} snd_pcm_direct_ipc_sem_t;
+#endif
+
 typedef struct snd_pcm_direct snd_pcm_direct_t;
 
 struct snd_pcm_direct {
@@ -134,8 +162,12 @@ struct snd_pcm_direct {
 	key_t ipc_key;			/* IPC key for semaphore and memory */
 	mode_t ipc_perm;		/* IPC socket permissions */
 	int ipc_gid;			/* IPC socket gid */
+	int ipc_posix;			/* POSIX shm backend, the ids below are fds */
 	int semid;			/* IPC global semaphore identification */
 	int locked[DIRECT_IPC_SEMS];	/* local lock counter */
+#ifdef DIRECT_IPC_POSIX
+	snd_pcm_direct_ipc_sem_t *semptr;	/* mapped semaphore segment (posix) */
+#endif
 	int shmid;			/* IPC global shared memory identification */
 	snd_pcm_direct_share_t *shmptr;	/* pointer to shared memory area */
 	snd_pcm_t *spcm; 		/* slave PCM handle */
@@ -161,6 +193,11 @@ struct snd_pcm_direct {
 	int timer_need_poll: 1;
 	unsigned int timer_events;
 	unsigned int timer_ticks;
+	unsigned int timer_avail_ticks;	/* ticks for the avail_min, 0 = period */
+	unsigned int timer_ticks_set;	/* ticks the timer was programmed with */
+	int timer_avail_min;		/* timer ticks follow the client avail_min */
+	int stats_timing;		/* time the transfers and semaphore waits */
+	int zero_copy;			/* dsnoop: map the slave buffer if possible */
 	int server_fd;
 	pid_t server_pid;
 	snd_timer_t *timer; 		/* timer used as poll_fd */
@@ -171,6 +208,7 @@ struct snd_pcm_direct {
 	unsigned int channels;		/* client's channels */
 	unsigned int *bindings;
 	unsigned int recoveries;	/* mirror of executed recoveries on slave */
+	snd_pcm_direct_client_stats_t *stats;	/* own entry in the shared stats, may be NULL */
 	int direct_memory_access;	/* use arch-optimized buffer RW */
 	snd_pcm_direct_hw_ptr_alignment_t hw_ptr_alignment;
 	int tstamp_type;		/* cached from conf, can be -1(default) on top of real types */
@@ -186,10 +224,17 @@ struct snd_pcm_direct {
 			mix_areas_32_t *remix_areas_32;
 			mix_areas_24_t *remix_areas_24;
 			mix_areas_u8_t *remix_areas_u8;
+			mix_areas_float_t *mix_areas_float;	/* FLOAT client to slave */
+			mix_areas_float_t *remix_areas_float;
 			unsigned int use_sem;
+			unsigned int float_client;	/* client format is FLOAT */
+			snd_pcm_dmix_staging_t *staging;	/* shared staging slots, NULL = not used */
+			int staging_slot;		/* own staging slot */
+			snd_pcm_channel_area_t *staging_areas;	/* own staging slot areas */
 		} dmix;
 		struct {
 			unsigned long long chn_mask;
+			int run_first;		/* first slave channel of the client run, -1 = none */
 		} dshare;
 	} u;
 	void (*server_free)(snd_pcm_direct_t *direct);
@@ -270,11 +315,38 @@ struct snd_pcm_direct {
 	snd1_pcm_direct_check_xrun
 #define snd_pcm_direct_slave_recover \
 	snd1_pcm_direct_slave_recover
+#define snd_pcm_direct_stats_commit \
+	snd1_pcm_direct_stats_commit
+#define snd_pcm_direct_stats_sem_wait \
+	snd1_pcm_direct_stats_sem_wait
+#define snd_pcm_direct_stats_wakeup \
+	snd1_pcm_direct_stats_wakeup
+#define snd_pcm_direct_posix_shm_open \
+	snd1_pcm_direct_posix_shm_open
+#define snd_pcm_direct_posix_shm_ready \
+	snd1_pcm_direct_posix_shm_ready
+#define snd_pcm_direct_posix_shm_close \
+	snd1_pcm_direct_posix_shm_close
+#define snd_pcm_direct_posix_sem_discard \
+	snd1_pcm_direct_posix_sem_discard
 
 int snd_pcm_direct_semaphore_create_or_connect(snd_pcm_direct_t *dmix);
 
+#ifdef DIRECT_IPC_POSIX
+int snd_pcm_direct_posix_shm_open(snd_pcm_direct_t *dmix, const char *suffix,
+				  size_t size, void **ptr, int *first);
+int snd_pcm_direct_posix_shm_ready(int fd);
+int snd_pcm_direct_posix_shm_close(snd_pcm_direct_t *dmix, const char *suffix,
+				   int fd, void *ptr);
+int snd_pcm_direct_posix_sem_discard(snd_pcm_direct_t *dmix);
+#endif
+
 static inline int snd_pcm_direct_semaphore_discard(snd_pcm_direct_t *dmix)
 {
+#ifdef DIRECT_IPC_POSIX
+	if (dmix->ipc_posix)
+		return snd_pcm_direct_posix_sem_discard(dmix);
+#endif
 	if (dmix->semid >= 0) {
 		if (semctl(dmix->semid, 0, IPC_RMID, NULL) < 0)
 			return -errno;
@@ -286,7 +358,21 @@ static inline int snd_pcm_direct_semaphore_discard(snd_pcm_direct_t *dmix)
 static inline int snd_pcm_direct_semaphore_down(snd_pcm_direct_t *dmix, int sem_num)
 {
 	struct sembuf op[2] = { { sem_num, 0, 0 }, { sem_num, 1, SEM_UNDO } };
-	int err = semop(dmix->semid, op, 2);
+	int err;
+
+#ifdef DIRECT_IPC_POSIX
+	if (dmix->ipc_posix) {
+		err = pthread_mutex_lock(&dmix->semptr->lock[sem_num]);
+		/* the previous owner died, the lock is ours like with SEM_UNDO */
+		if (err == EOWNERDEAD)
+			err = pthread_mutex_consistent(&dmix->semptr->lock[sem_num]);
+		if (err)
+			return -err;
+		dmix->locked[sem_num]++;
+		return 0;
+	}
+#endif
+	err = semop(dmix->semid, op, 2);
 	if (err == 0)
 		dmix->locked[sem_num]++;
 	else if (err == -1)
@@ -297,7 +383,18 @@ static inline int snd_pcm_direct_semaphore_down(snd_pcm_direct_t *dmix, int sem_
 static inline int snd_pcm_direct_semaphore_up(snd_pcm_direct_t *dmix, int sem_num)
 {
 	struct sembuf op = { sem_num, -1, SEM_UNDO | IPC_NOWAIT };
-	int err = semop(dmix->semid, &op, 1);
+	int err;
+
+#ifdef DIRECT_IPC_POSIX
+	if (dmix->ipc_posix) {
+		err = pthread_mutex_unlock(&dmix->semptr->lock[sem_num]);
+		if (err)
+			return -err;
+		dmix->locked[sem_num]--;
+		return 0;
+	}
+#endif
+	err = semop(dmix->semid, &op, 1);
 	if (err == 0)
 		dmix->locked[sem_num]--;
 	else if (err == -1)
@@ -311,6 +408,11 @@ static inline int snd_pcm_direct_semaphore_final(snd_pcm_direct_t *dmix, int sem
 		SNDMSG("invalid semaphore count to finalize %d: %d", sem_num, dmix->locked[sem_num]);
 		return -EBUSY;
 	}
+#ifdef DIRECT_IPC_POSIX
+	/* the posix semaphore segment is mapped per client, release it, too */
+	if (dmix->ipc_posix)
+		return snd_pcm_direct_posix_sem_discard(dmix);
+#endif
 	return snd_pcm_direct_semaphore_up(dmix, sem_num);
 }
 
@@ -355,6 +457,28 @@ int snd_pcm_direct_check_xrun(snd_pcm_direct_t *direct, snd_pcm_t *pcm);
 int snd_timer_async(snd_timer_t *timer, int sig, pid_t pid);
 struct timespec snd_pcm_hw_fast_tstamp(snd_pcm_t *pcm);
 void snd_pcm_direct_reset_slave_ptr(snd_pcm_t *pcm, snd_pcm_direct_t *dmix, snd_pcm_uframes_t hw_ptr);
+void snd_pcm_direct_stats_commit(snd_pcm_direct_t *dmix, snd_pcm_uframes_t frames, unsigned long long start);
+void snd_pcm_direct_stats_sem_wait(snd_pcm_direct_t *dmix, unsigned long long start);
+void snd_pcm_direct_stats_wakeup(snd_pcm_direct_t *dmix, snd_pcm_t *pcm);
+
+/* monotonic time in nsec for the stats, 0 if the client has no stats entry
+ * or the timing is disabled
+ */
+static inline unsigned long long snd_pcm_direct_stats_now(snd_pcm_direct_t *dmix)
+{
+	snd_htimestamp_t ts;
+
+	if (!dmix->stats || !dmix->stats_timing)
+		return 0;
+	gettimestamp(&ts, SND_PCM_TSTAMP_TYPE_MONOTONIC);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void snd_pcm_direct_stats_xrun(snd_pcm_direct_t *dmix)
+{
+	if (dmix->stats)
+		dmix->stats->xruns++;
+}
 
 struct snd_pcm_direct_open_conf {
 	key_t ipc_key;
@@ -366,6 +490,12 @@ struct snd_pcm_direct_open_conf {
 	int direct_memory_access;
 	snd_pcm_direct_hw_ptr_alignment_t hw_ptr_alignment;
 	int tstamp_type;
+	int staging_slots;
+	int float_sum;
+	int ipc_posix;
+	int timer_avail_min;
+	int stats_timing;
+	int zero_copy;
 	snd_config_t *slave;
 	snd_config_t *bindings;
 };
@@ -54,6 +54,8 @@ const char *_snd_module_pcm_dmix = "";
 #ifndef DOC_HIDDEN
 /* start is pending - this state happens when rate plugin does a delayed commit */
 #define STATE_RUN_PENDING	1024
+/* bytes of the sum buffer remixed per block for all channels */
+#define DMIX_REMIX_BLOCK_BYTES	16384
 #endif
 
 /*
@@ -62,6 +64,108 @@ const char *_snd_module_pcm_dmix = "";
 
 static int shm_sum_discard(snd_pcm_direct_t *dmix);
 
+/*
+ *  staging slots
+ *
+ *  Each client copies its frames to a private slot in the slave buffer
+ *  layout and publishes the staged range without any lock (seqcount per
+ *  slot). One client at a time is elected to fold the staged frames of
+ *  all slots to the hardware buffer shortly before the hardware pointer
+ *  reaches them, the others don't wait.  The folder takes the semaphore
+ *  only against the rewinds.
+ *
+ *  The slots are placed behind the sum ring buffer in the same
+ *  shared memory segment.
+ */
+static size_t staging_hdr_bytes(void)
+{
+	return (sizeof(snd_pcm_dmix_staging_t) + 63) & ~(size_t)63;
+}
+
+static int staging_init_areas(snd_pcm_direct_t *dmix, size_t *slot_bytes)
+{
+	const snd_pcm_channel_area_t *areas = snd_pcm_mmap_areas(dmix->spcm);
+	unsigned int chn, channels = dmix->shmptr->s.channels;
+	unsigned int width = snd_pcm_format_physical_width(dmix->shmptr->s.format);
+	char *base = areas[0].addr;
+	size_t bytes = 0, end;
+
+	dmix->u.dmix.staging_areas = calloc(channels, sizeof(snd_pcm_channel_area_t));
+	if (dmix->u.dmix.staging_areas == NULL)
+		return -ENOMEM;
+	/* the slot has the same layout as the slave buffer */
+	for (chn = 1; chn < channels; chn++) {
+		if ((char *)areas[chn].addr < base)
+			base = areas[chn].addr;
+	}
+	for (chn = 0; chn < channels; chn++) {
+		end = ((char *)areas[chn].addr - base) +
+		      (areas[chn].first + (size_t)areas[chn].step *
+		       (dmix->slave_buffer_size - 1) + width) / 8;
+		if (end > bytes)
+			bytes = end;
+		/* keep the offset, the slot address is added later */
+		dmix->u.dmix.staging_areas[chn] = areas[chn];
+		dmix->u.dmix.staging_areas[chn].addr =
+			(void *)((char *)areas[chn].addr - base);
+	}
+	*slot_bytes = (bytes + 63) & ~(size_t)63;
+	return 0;
+}
+
+static int staging_slot_get(snd_pcm_direct_t *dmix, int first_instance)
+{
+	snd_pcm_dmix_staging_t *staging = dmix->u.dmix.staging;
+	unsigned int chn, channels = dmix->shmptr->s.channels;
+	char *data;
+	int slot;
+
+	/* the semaphore is held here */
+	if (first_instance) {
+		staging->slots = dmix->shmptr->u.dmix.staging_slots;
+		staging->folder = 0;
+		staging->fold_ptr = 0;
+		staging->requests = 0;
+		for (slot = 0; slot < DMIX_STAGING_MAX_SLOTS; slot++)
+			staging->slot[slot].pid = 0;
+	}
+	for (slot = 0; slot < (int)staging->slots; slot++) {
+		if (staging->slot[slot].pid == 0)
+			break;
+		/* reclaim the slot of a crashed client */
+		if (kill(staging->slot[slot].pid, 0) < 0 && errno == ESRCH)
+			break;
+	}
+	if (slot >= (int)staging->slots)
+		return -EBUSY;
+	staging->slot[slot].pid = getpid();
+	staging->slot[slot].active = 0;
+	/* a crashed owner may have left an odd seq */
+	staging->slot[slot].seq = 0;
+	staging->slot[slot].run = 0;
+	staging->slot[slot].folded_run = ~0U;
+	dmix->u.dmix.staging_slot = slot;
+	data = (char *)staging + staging_hdr_bytes() + staging->slot_bytes * slot;
+	for (chn = 0; chn < channels; chn++)
+		dmix->u.dmix.staging_areas[chn].addr =
+			data + (size_t)dmix->u.dmix.staging_areas[chn].addr;
+	/* the slave channels not used by this client stay silent */
+	snd_pcm_areas_silence(dmix->u.dmix.staging_areas, 0, channels,
+			      dmix->slave_buffer_size, dmix->shmptr->s.format);
+	return 0;
+}
+
+static void staging_slot_put(snd_pcm_direct_t *dmix)
+{
+	snd_pcm_dmix_staging_t *staging = dmix->u.dmix.staging;
+
+	if (staging == NULL || dmix->u.dmix.staging_slot < 0)
+		return;
+	staging->slot[dmix->u.dmix.staging_slot].active = 0;
+	staging->slot[dmix->u.dmix.staging_slot].pid = 0;
+	dmix->u.dmix.staging_slot = -1;
+}
+
 /*
  *  sum ring buffer shared memory area 
  */
@@ -69,11 +173,34 @@ static int shm_sum_create_or_connect(snd_pcm_direct_t *dmix)
 {
 	struct shmid_ds buf;
 	int tmpid, err;
-	size_t size;
+	size_t size, staging_ofs = 0, slot_bytes = 0;
 
 	size = dmix->shmptr->s.channels *
 	       dmix->shmptr->s.buffer_size *
 	       sizeof(signed int);	
+	if (dmix->shmptr->u.dmix.staging_slots && dmix->spcm) {
+		err = staging_init_areas(dmix, &slot_bytes);
+		if (err < 0)
+			return err;
+		staging_ofs = (size + 63) & ~(size_t)63;
+		size = staging_ofs + staging_hdr_bytes() +
+		       slot_bytes * dmix->shmptr->u.dmix.staging_slots;
+	}
+#ifdef DIRECT_IPC_POSIX
+	if (dmix->ipc_posix) {
+		void *ptr;
+		int first;
+
+		err = snd_pcm_direct_posix_shm_open(dmix, ".sum", size, &ptr, &first);
+		if (err < 0)
+			return err;
+		dmix->u.dmix.shmid_sum = err;
+		dmix->u.dmix.sum_buffer = ptr;
+		if (first)
+			snd_pcm_direct_posix_shm_ready(dmix->u.dmix.shmid_sum);
+		goto __attached;
+	}
+#endif
 retryshm:
 	dmix->u.dmix.shmid_sum = shmget(dmix->ipc_key + 1, size,
 					IPC_CREAT | dmix->ipc_perm);
@@ -103,7 +230,15 @@ retryshm:
 		shm_sum_discard(dmix);
 		return err;
 	}
+#ifdef DIRECT_IPC_POSIX
+ __attached:
+#endif
 	mlock(dmix->u.dmix.sum_buffer, size);
+	if (staging_ofs) {
+		dmix->u.dmix.staging = (snd_pcm_dmix_staging_t *)
+			((char *)dmix->u.dmix.sum_buffer + staging_ofs);
+		dmix->u.dmix.staging->slot_bytes = slot_bytes;
+	}
 	return 0;
 }
 
@@ -112,11 +247,25 @@ static int shm_sum_discard(snd_pcm_direct_t *dmix)
 	struct shmid_ds buf;
 	int ret = 0;
 
+	free(dmix->u.dmix.staging_areas);
+	dmix->u.dmix.staging_areas = NULL;
 	if (dmix->u.dmix.shmid_sum < 0)
 		return -EINVAL;
+#ifdef DIRECT_IPC_POSIX
+	if (dmix->ipc_posix) {
+		ret = snd_pcm_direct_posix_shm_close(dmix, ".sum",
+						     dmix->u.dmix.shmid_sum,
+						     dmix->u.dmix.sum_buffer);
+		dmix->u.dmix.sum_buffer = (void *) -1;
+		dmix->u.dmix.staging = NULL;
+		dmix->u.dmix.shmid_sum = -1;
+		return ret;
+	}
+#endif
 	if (dmix->u.dmix.sum_buffer != (void *) -1 && shmdt(dmix->u.dmix.sum_buffer) < 0)
 		return -errno;
 	dmix->u.dmix.sum_buffer = (void *) -1;
+	dmix->u.dmix.staging = NULL;
 	if (shmctl(dmix->u.dmix.shmid_sum, IPC_STAT, &buf) < 0)
 		return -errno;
 	if (buf.shm_nattch == 0) {	/* we're the last user, destroy the segment */
@@ -145,6 +294,8 @@ static void dmix_server_free(snd_pcm_direct_t *dmix)
 #include "pcm_dmix_i386.c"
 #elif defined(__x86_64__)
 #include "pcm_dmix_x86_64.c"
+#elif defined(__aarch64__)
+#include "pcm_dmix_aarch64.c"
 #else
 #ifndef DOC_HIDDEN
 #define mix_select_callbacks(x)	generic_mix_select_callbacks(x)
@@ -162,9 +313,11 @@ static void mix_areas(snd_pcm_direct_t *dmix,
 	unsigned int src_step, dst_step;
 	unsigned int chn, dchn, channels, sample_size;
 	mix_areas_t *do_mix_areas;
+	snd_pcm_format_t format;
 	
 	channels = dmix->channels;
-	switch (dmix->shmptr->s.format) {
+	format = dmix->u.dmix.float_client ? SND_PCM_FORMAT_FLOAT : dmix->shmptr->s.format;
+	switch (format) {
 	case SND_PCM_FORMAT_S16_LE:
 	case SND_PCM_FORMAT_S16_BE:
 		sample_size = 2;
@@ -187,6 +340,10 @@ static void mix_areas(snd_pcm_direct_t *dmix,
 		sample_size = 1;
 		do_mix_areas = (mix_areas_t *)dmix->u.dmix.mix_areas_u8;
 		break;
+	case SND_PCM_FORMAT_FLOAT:
+		sample_size = 4;
+		do_mix_areas = (mix_areas_t *)dmix->u.dmix.mix_areas_float;
+		break;
 	default:
 		return;
 	}
@@ -229,10 +386,13 @@ static void remix_areas(snd_pcm_direct_t *dmix,
 {
 	unsigned int src_step, dst_step;
 	unsigned int chn, dchn, channels, sample_size;
+	snd_pcm_uframes_t ofs, frames, block;
 	mix_areas_t *do_remix_areas;
+	snd_pcm_format_t format;
 	
 	channels = dmix->channels;
-	switch (dmix->shmptr->s.format) {
+	format = dmix->u.dmix.float_client ? SND_PCM_FORMAT_FLOAT : dmix->shmptr->s.format;
+	switch (format) {
 	case SND_PCM_FORMAT_S16_LE:
 	case SND_PCM_FORMAT_S16_BE:
 		sample_size = 2;
@@ -255,6 +415,10 @@ static void remix_areas(snd_pcm_direct_t *dmix,
 		sample_size = 1;
 		do_remix_areas = (mix_areas_t *)dmix->u.dmix.remix_areas_u8;
 		break;
+	case SND_PCM_FORMAT_FLOAT:
+		sample_size = 4;
+		do_remix_areas = (mix_areas_t *)dmix->u.dmix.remix_areas_float;
+		break;
 	default:
 		return;
 	}
@@ -272,19 +436,66 @@ static void remix_areas(snd_pcm_direct_t *dmix,
 			       sizeof(signed int));
 		return;
 	}
-	for (chn = 0; chn < channels; chn++) {
-		dchn = dmix->bindings ? dmix->bindings[chn] : chn;
-		if (dchn >= dmix->shmptr->s.channels)
-			continue;
-		src_step = src_areas[chn].step / 8;
-		dst_step = dst_areas[dchn].step / 8;
-		do_remix_areas(size,
-			       ((unsigned char *)dst_areas[dchn].addr + dst_areas[dchn].first / 8) + dst_ofs * dst_step,
-			       ((unsigned char *)src_areas[chn].addr + src_areas[chn].first / 8) + src_ofs * src_step,
-			       dmix->u.dmix.sum_buffer + dmix->shmptr->s.channels * dst_ofs + dchn,
-			       dst_step,
-			       src_step,
-			       dmix->shmptr->s.channels * sizeof(signed int));
+	/*
+	 * a rewind covers up to the whole buffer, so go through the channels
+	 * block by block to keep the sum and slave frames in the cache
+	 * between the channel passes instead of walking the range per channel
+	 */
+	block = DMIX_REMIX_BLOCK_BYTES /
+		(dmix->shmptr->s.channels * sizeof(signed int));
+	if (!block)
+		block = 1;
+	for (ofs = 0; ofs < size; ofs += frames) {
+		frames = size - ofs < block ? size - ofs : block;
+		for (chn = 0; chn < channels; chn++) {
+			dchn = dmix->bindings ? dmix->bindings[chn] : chn;
+			if (dchn >= dmix->shmptr->s.channels)
+				continue;
+			src_step = src_areas[chn].step / 8;
+			dst_step = dst_areas[dchn].step / 8;
+			do_remix_areas(frames,
+				       ((unsigned char *)dst_areas[dchn].addr + dst_areas[dchn].first / 8) + (dst_ofs + ofs) * dst_step,
+				       ((unsigned char *)src_areas[chn].addr + src_areas[chn].first / 8) + (src_ofs + ofs) * src_step,
+				       dmix->u.dmix.sum_buffer + dmix->shmptr->s.channels * (dst_ofs + ofs) + dchn,
+				       dst_step,
+				       src_step,
+				       dmix->shmptr->s.channels * sizeof(signed int));
+		}
+	}
+}
+
+/*
+ * remove the client contribution of a range from the slave buffer
+ * in one go; the caller holds the semaphore for the whole range and
+ * the range is split only at the ends of the client and slave buffers
+ */
+static void remix_range(snd_pcm_t *pcm,
+			snd_pcm_uframes_t appl_ptr,
+			snd_pcm_uframes_t slave_appl_ptr,
+			snd_pcm_uframes_t size)
+{
+	snd_pcm_direct_t *dmix = pcm->private_data;
+	const snd_pcm_channel_area_t *src_areas, *dst_areas;
+	snd_pcm_uframes_t transfer;
+
+	src_areas = snd_pcm_mmap_areas(pcm);
+	dst_areas = snd_pcm_mmap_areas(dmix->spcm);
+	appl_ptr %= pcm->buffer_size;
+	slave_appl_ptr %= dmix->slave_buffer_size;
+	while (size > 0) {
+		transfer = size;
+		if (appl_ptr + transfer > pcm->buffer_size)
+			transfer = pcm->buffer_size - appl_ptr;
+		if (slave_appl_ptr + transfer > dmix->slave_buffer_size)
+			transfer = dmix->slave_buffer_size - slave_appl_ptr;
+		remix_areas(dmix, src_areas, dst_areas, appl_ptr, slave_appl_ptr, transfer);
+		size -= transfer;
+		slave_appl_ptr += transfer;
+		if (slave_appl_ptr == dmix->slave_buffer_size)
+			slave_appl_ptr = 0;
+		appl_ptr += transfer;
+		if (appl_ptr == pcm->buffer_size)
+			appl_ptr = 0;
 	}
 }
 
@@ -295,17 +506,326 @@ static void remix_areas(snd_pcm_direct_t *dmix,
 #ifndef DOC_HIDDEN
 static void dmix_down_sem(snd_pcm_direct_t *dmix)
 {
-	if (dmix->u.dmix.use_sem)
+	unsigned long long start;
+
+	if (dmix->u.dmix.use_sem || dmix->u.dmix.staging) {
+		start = snd_pcm_direct_stats_now(dmix);
 		snd_pcm_direct_semaphore_down(dmix, DIRECT_IPC_SEM_CLIENT);
+		snd_pcm_direct_stats_sem_wait(dmix, start);
+	}
 }
 
 static void dmix_up_sem(snd_pcm_direct_t *dmix)
 {
-	if (dmix->u.dmix.use_sem)
+	if (dmix->u.dmix.use_sem || dmix->u.dmix.staging)
 		snd_pcm_direct_semaphore_up(dmix, DIRECT_IPC_SEM_CLIENT);
 }
 #endif
 
+/*
+ *  mix the frames of a staging slot (slave layout) to the slave buffer
+ */
+static void fold_areas(snd_pcm_direct_t *dmix,
+		       const snd_pcm_channel_area_t *src_areas,
+		       const snd_pcm_channel_area_t *dst_areas,
+		       ptrdiff_t src_shift,
+		       snd_pcm_uframes_t ofs,
+		       snd_pcm_uframes_t size)
+{
+	unsigned int src_step, dst_step;
+	unsigned int chn, channels, bits, sample_size;
+	mix_areas_t *do_mix_areas;
+
+	channels = dmix->shmptr->s.channels;
+	bits = snd_pcm_format_physical_width(dmix->shmptr->s.format);
+	sample_size = bits / 8;
+	switch (dmix->shmptr->s.format) {
+	case SND_PCM_FORMAT_S16_LE:
+	case SND_PCM_FORMAT_S16_BE:
+		do_mix_areas = (mix_areas_t *)dmix->u.dmix.mix_areas_16;
+		break;
+	case SND_PCM_FORMAT_S32_LE:
+	case SND_PCM_FORMAT_S32_BE:
+		do_mix_areas = (mix_areas_t *)dmix->u.dmix.mix_areas_32;
+		break;
+	case SND_PCM_FORMAT_S24_LE:
+	case SND_PCM_FORMAT_S24_3LE:
+		do_mix_areas = (mix_areas_t *)dmix->u.dmix.mix_areas_24;
+		break;
+	case SND_PCM_FORMAT_U8:
+		do_mix_areas = (mix_areas_t *)dmix->u.dmix.mix_areas_u8;
+		break;
+	case SND_PCM_FORMAT_FLOAT:
+		do_mix_areas = (mix_areas_t *)dmix->u.dmix.mix_areas_float;
+		break;
+	default:
+		return;
+	}
+	for (chn = 0; chn < channels; chn++) {
+		if (dst_areas[chn].addr != dst_areas[0].addr ||
+		    dst_areas[chn].first != chn * bits ||
+		    dst_areas[chn].step != channels * bits)
+			break;
+	}
+	if (chn == channels) {
+		/* interleaved slave, process all channels in one loop */
+		do_mix_areas(size * channels,
+			     (unsigned char *)dst_areas[0].addr + sample_size * ofs * channels,
+			     (unsigned char *)src_areas[0].addr + src_shift + sample_size * ofs * channels,
+			     dmix->u.dmix.sum_buffer + ofs * channels,
+			     sample_size,
+			     sample_size,
+			     sizeof(signed int));
+		return;
+	}
+	for (chn = 0; chn < channels; chn++) {
+		src_step = src_areas[chn].step / 8;
+		dst_step = dst_areas[chn].step / 8;
+		do_mix_areas(size,
+			     ((unsigned char *)dst_areas[chn].addr + dst_areas[chn].first / 8) + ofs * dst_step,
+			     ((unsigned char *)src_areas[chn].addr + src_shift + src_areas[chn].first / 8) + ofs * src_step,
+			     dmix->u.dmix.sum_buffer + channels * ofs + chn,
+			     dst_step,
+			     src_step,
+			     channels * sizeof(signed int));
+	}
+}
+
+/*
+ *  the staged frames are folded one wakeup interval of the slowest client
+ *  (at least two slave periods) ahead of the hw_ptr
+ */
+static void staging_fold_target(snd_pcm_direct_t *dmix,
+				snd_pcm_uframes_t *hw, snd_pcm_uframes_t *target)
+{
+	volatile snd_pcm_dmix_staging_t *staging = dmix->u.dmix.staging;
+	snd_pcm_uframes_t window = 0;
+	unsigned int slot;
+
+	for (slot = 0; slot < staging->slots; slot++) {
+		if (staging->slot[slot].active && staging->slot[slot].wakeup > window)
+			window = staging->slot[slot].wakeup;
+	}
+	window += dmix->slave_period_size;
+	if (window < dmix->slave_period_size * 2)
+		window = dmix->slave_period_size * 2;
+	if (window > dmix->slave_buffer_size)
+		window = dmix->slave_buffer_size;
+	*hw = dmix->slave_hw_ptr - dmix->slave_hw_ptr % dmix->slave_period_size;
+	*target = (*hw + window) % dmix->slave_boundary;
+}
+
+/* frames of the sum buffer folded at once, about 4kB */
+#define STAGING_FOLD_BLOCK	(4096 / sizeof(signed int))
+
+/*
+ *  mix the staged frames of all slots up to the fold target to the slave
+ *  buffer, the caller must hold the semaphore
+ *
+ *  The window is processed in blocks, so the sum buffer and the slave
+ *  buffer are streamed once for all slots.  The staged frames which were
+ *  already passed by the hw_ptr are lost, this is counted as an xrun.
+ */
+static void staging_fold_locked(snd_pcm_direct_t *dmix)
+{
+	snd_pcm_dmix_staging_t *staging = dmix->u.dmix.staging;
+	const snd_pcm_channel_area_t *dst_areas;
+	snd_pcm_uframes_t hw, target, window, block, pos, transfer;
+	snd_pcm_uframes_t start, from[DMIX_STAGING_MAX_SLOTS];
+	snd_pcm_uframes_t to[DMIX_STAGING_MAX_SLOTS];
+	snd_pcm_uframes_t boundary = dmix->slave_boundary;
+	snd_pcm_uframes_t ofs, end, len;
+	unsigned int slot;
+
+	staging_fold_target(dmix, &hw, &target);
+	window = pcm_frame_diff(target, hw, boundary);
+	if (staging_fold_ranges(staging, hw, window, dmix->slave_buffer_size,
+				boundary, from, to))
+		dmix->shmptr->stats.staging_xruns++;
+
+	dst_areas = snd_pcm_mmap_areas(dmix->spcm);
+	block = STAGING_FOLD_BLOCK / dmix->shmptr->s.channels;
+	if (block == 0)
+		block = 1;
+	for (ofs = 0; ofs < window; ofs += len) {
+		len = window - ofs;
+		if (len > block)
+			len = block;
+		pos = (hw + ofs) % dmix->slave_buffer_size;
+		if (pos + len > dmix->slave_buffer_size)
+			len = dmix->slave_buffer_size - pos;
+		for (slot = 0; slot < staging->slots; slot++) {
+			if (to[slot] <= ofs || from[slot] >= ofs + len)
+				continue;
+			start = from[slot] > ofs ? from[slot] : ofs;
+			end = to[slot] < ofs + len ? to[slot] : ofs + len;
+			transfer = end - start;
+			fold_areas(dmix, dmix->u.dmix.staging_areas, dst_areas,
+				   ((ptrdiff_t)slot - dmix->u.dmix.staging_slot) *
+				   (ptrdiff_t)staging->slot_bytes,
+				   pos + (start - ofs), transfer);
+		}
+	}
+	__atomic_store_n(&staging->fold_ptr, target, __ATOMIC_RELAXED);
+}
+
+/*
+ *  take the folder role, a dead folder is replaced
+ */
+static int staging_elect(snd_pcm_direct_t *dmix)
+{
+	snd_pcm_dmix_staging_t *staging = dmix->u.dmix.staging;
+	int pid = staging->slot[dmix->u.dmix.staging_slot].pid;
+	int folder = 0;
+
+	if (__atomic_compare_exchange_n(&staging->folder, &folder, pid, 0,
+					__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+		return 1;
+	if (kill(folder, 0) < 0 && errno == ESRCH)
+		return __atomic_compare_exchange_n(&staging->folder, &folder, pid, 0,
+						   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+/*
+ *  fold the staged frames if the window moved or own frames are due,
+ *  only one client folds, the others return without waiting
+ */
+static void staging_fold(snd_pcm_direct_t *dmix, int due)
+{
+	snd_pcm_dmix_staging_t *staging = dmix->u.dmix.staging;
+	snd_pcm_uframes_t hw, target;
+	unsigned long long requests;
+
+	if (!due) {
+		staging_fold_target(dmix, &hw, &target);
+		/* another client was faster */
+		if (__atomic_load_n(&staging->fold_ptr, __ATOMIC_RELAXED) == target)
+			return;
+	}
+	/* the elected folder repeats the fold for this request */
+	__atomic_fetch_add(&staging->requests, 1, __ATOMIC_SEQ_CST);
+	while (staging_elect(dmix)) {
+		requests = __atomic_load_n(&staging->requests, __ATOMIC_SEQ_CST);
+		dmix_down_sem(dmix);
+		staging_fold_locked(dmix);
+		dmix_up_sem(dmix);
+		__atomic_store_n(&staging->folder, 0, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&staging->requests, __ATOMIC_SEQ_CST) == requests)
+			break;
+	}
+}
+
+/*
+ *  remove the rewound frames which were not folded yet from own slot,
+ *  returns the number of removed frames, the semaphore must be held
+ */
+static snd_pcm_uframes_t staging_unstage(snd_pcm_direct_t *dmix,
+					 snd_pcm_uframes_t slave_pos,
+					 snd_pcm_uframes_t size)
+{
+	return staging_unstage_slot(dmix->u.dmix.staging,
+				    dmix->u.dmix.staging_slot, slave_pos, size,
+				    dmix->slave_boundary);
+}
+
+/*
+ *  mix the client frames directly to the slave buffer
+ */
+static void dmix_mix_frames(snd_pcm_t *pcm,
+			    snd_pcm_uframes_t appl_ptr,
+			    snd_pcm_uframes_t slave_appl_ptr,
+			    snd_pcm_uframes_t size)
+{
+	snd_pcm_direct_t *dmix = pcm->private_data;
+	const snd_pcm_channel_area_t *src_areas, *dst_areas;
+	snd_pcm_uframes_t transfer;
+
+	src_areas = snd_pcm_mmap_areas(pcm);
+	dst_areas = snd_pcm_mmap_areas(dmix->spcm);
+	while (size > 0) {
+		transfer = size;
+		if (appl_ptr + transfer > pcm->buffer_size)
+			transfer = pcm->buffer_size - appl_ptr;
+		if (slave_appl_ptr + transfer > dmix->slave_buffer_size)
+			transfer = dmix->slave_buffer_size - slave_appl_ptr;
+		mix_areas(dmix, src_areas, dst_areas, appl_ptr, slave_appl_ptr, transfer);
+		size -= transfer;
+		slave_appl_ptr += transfer;
+		slave_appl_ptr %= dmix->slave_buffer_size;
+		appl_ptr += transfer;
+		appl_ptr %= pcm->buffer_size;
+	}
+}
+
+/*
+ *  the longest time the owner may sleep in slave frames
+ */
+static unsigned int dmix_staging_wakeup(snd_pcm_t *pcm)
+{
+	snd_pcm_direct_t *dmix = pcm->private_data;
+	snd_pcm_uframes_t wakeup;
+
+	wakeup = dmix->timer_ticks_set * dmix->slave_period_size;
+	if (pcm->avail_min > wakeup)
+		wakeup = pcm->avail_min;
+	if (wakeup > dmix->slave_buffer_size)
+		wakeup = dmix->slave_buffer_size;
+	return wakeup;
+}
+
+/*
+ *  copy the client frames to own staging slot, fold and publish them
+ */
+static void dmix_stage_frames(snd_pcm_t *pcm,
+			      snd_pcm_uframes_t appl_ptr,
+			      snd_pcm_uframes_t slave_pos,
+			      snd_pcm_uframes_t size)
+{
+	snd_pcm_direct_t *dmix = pcm->private_data;
+	snd_pcm_dmix_staging_t *staging = dmix->u.dmix.staging;
+	const snd_pcm_channel_area_t *src_areas, *dst_areas;
+	snd_pcm_uframes_t ofs, slave_ofs, len, transfer, hw, target;
+	unsigned int chn, dchn;
+	int slot = dmix->u.dmix.staging_slot;
+
+	/* no lock is required for own slot */
+	src_areas = snd_pcm_mmap_areas(pcm);
+	dst_areas = dmix->u.dmix.staging_areas;
+	ofs = appl_ptr;
+	slave_ofs = slave_pos % dmix->slave_buffer_size;
+	for (len = size; len > 0; len -= transfer) {
+		transfer = len;
+		if (ofs + transfer > pcm->buffer_size)
+			transfer = pcm->buffer_size - ofs;
+		if (slave_ofs + transfer > dmix->slave_buffer_size)
+			transfer = dmix->slave_buffer_size - slave_ofs;
+		if (dmix->interleaved) {
+			snd_pcm_areas_copy(dst_areas, slave_ofs, src_areas, ofs,
+					   dmix->channels, transfer, pcm->format);
+		} else {
+			for (chn = 0; chn < dmix->channels; chn++) {
+				dchn = dmix->bindings ? dmix->bindings[chn] : chn;
+				if (dchn >= dmix->shmptr->s.channels)
+					continue;
+				snd_pcm_area_copy(&dst_areas[dchn], slave_ofs,
+						  &src_areas[chn], ofs,
+						  transfer, pcm->format);
+			}
+		}
+		ofs = (ofs + transfer) % pcm->buffer_size;
+		slave_ofs = (slave_ofs + transfer) % dmix->slave_buffer_size;
+	}
+
+	/* publish without a lock and fold when the frames are due */
+	staging->slot[slot].wakeup = dmix_staging_wakeup(pcm);
+	staging_stage(staging, slot, slave_pos, size, dmix->slave_buffer_size,
+		      dmix->slave_boundary);
+	staging_fold_target(dmix, &hw, &target);
+	staging_fold(dmix, pcm_frame_diff(slave_pos, hw, dmix->slave_boundary) <
+			   pcm_frame_diff(target, hw, dmix->slave_boundary));
+}
+
 /*
  *  synchronize shm ring buffer with hardware
  */
@@ -314,7 +834,7 @@ static void snd_pcm_dmix_sync_area(snd_pcm_t *pcm)
 	snd_pcm_direct_t *dmix = pcm->private_data;
 	snd_pcm_uframes_t slave_hw_ptr, slave_appl_ptr, slave_size;
 	snd_pcm_uframes_t appl_ptr, size, transfer;
-	const snd_pcm_channel_area_t *src_areas, *dst_areas;
+	unsigned long long start;
 	
 	/* calculate the size to transfer */
 	/* check the available size in the local buffer
@@ -356,31 +876,21 @@ static void snd_pcm_dmix_sync_area(snd_pcm_t *pcm)
 		return;
 
 	/* add sample areas here */
-	src_areas = snd_pcm_mmap_areas(pcm);
-	dst_areas = snd_pcm_mmap_areas(dmix->spcm);
 	appl_ptr = dmix->last_appl_ptr % pcm->buffer_size;
 	dmix->last_appl_ptr += size;
 	dmix->last_appl_ptr %= pcm->boundary;
-	slave_appl_ptr = dmix->slave_appl_ptr % dmix->slave_buffer_size;
+	slave_appl_ptr = dmix->slave_appl_ptr;
 	dmix->slave_appl_ptr += size;
 	dmix->slave_appl_ptr %= dmix->slave_boundary;
-	dmix_down_sem(dmix);
-	for (;;) {
-		transfer = size;
-		if (appl_ptr + transfer > pcm->buffer_size)
-			transfer = pcm->buffer_size - appl_ptr;
-		if (slave_appl_ptr + transfer > dmix->slave_buffer_size)
-			transfer = dmix->slave_buffer_size - slave_appl_ptr;
-		mix_areas(dmix, src_areas, dst_areas, appl_ptr, slave_appl_ptr, transfer);
-		size -= transfer;
-		if (! size)
-			break;
-		slave_appl_ptr += transfer;
-		slave_appl_ptr %= dmix->slave_buffer_size;
-		appl_ptr += transfer;
-		appl_ptr %= pcm->buffer_size;
+	start = snd_pcm_direct_stats_now(dmix);
+	if (dmix->u.dmix.staging) {
+		dmix_stage_frames(pcm, appl_ptr, slave_appl_ptr, size);
+	} else {
+		dmix_down_sem(dmix);
+		dmix_mix_frames(pcm, appl_ptr, slave_appl_ptr % dmix->slave_buffer_size, size);
+		dmix_up_sem(dmix);
 	}
-	dmix_up_sem(dmix);
+	snd_pcm_direct_stats_commit(dmix, size, start);
 }
 
 /*
@@ -413,6 +923,7 @@ static int snd_pcm_dmix_sync_ptr0(snd_pcm_t *pcm, snd_pcm_uframes_t slave_hw_ptr
 		gettimestamp(&dmix->trigger_tstamp, pcm->tstamp_type);
 		if (dmix->state == SND_PCM_STATE_RUNNING) {
 			dmix->state = SND_PCM_STATE_XRUN;
+			snd_pcm_direct_stats_xrun(dmix);
 			return -EPIPE;
 		}
 		dmix->state = SND_PCM_STATE_SETUP;
@@ -435,7 +946,12 @@ static int snd_pcm_dmix_sync_ptr(snd_pcm_t *pcm)
 	if (err < 0)
 		return err;
 
-	return snd_pcm_dmix_sync_ptr0(pcm, slave_hw_ptr);
+	err = snd_pcm_dmix_sync_ptr0(pcm, slave_hw_ptr);
+	if (err < 0)
+		return err;
+	if (dmix->u.dmix.staging)
+		staging_fold(dmix, 0);
+	return 0;
 }
 
 /*
@@ -578,6 +1094,17 @@ static int snd_pcm_dmix_drop(snd_pcm_t *pcm)
 		return -EBADFD;
 	dmix->state = SND_PCM_STATE_SETUP;
 	snd_pcm_direct_timer_stop(dmix);
+	if (dmix->u.dmix.staging) {
+		/* drop the frames not folded yet */
+		snd_pcm_dmix_staging_t *staging = dmix->u.dmix.staging;
+		int slot = dmix->u.dmix.staging_slot;
+
+		snd_pcm_direct_semaphore_down(dmix, DIRECT_IPC_SEM_CLIENT);
+		staging_publish(staging, slot, 0, staging->slot[slot].run,
+				staging->slot[slot].start,
+				staging->slot[slot].appl_ptr);
+		snd_pcm_direct_semaphore_up(dmix, DIRECT_IPC_SEM_CLIENT);
+	}
 	return 0;
 }
 
@@ -671,10 +1198,9 @@ static snd_pcm_sframes_t snd_pcm_dmix_rewindable(snd_pcm_t *pcm)
 static snd_pcm_sframes_t snd_pcm_dmix_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t frames)
 {
 	snd_pcm_direct_t *dmix = pcm->private_data;
-	snd_pcm_uframes_t slave_appl_ptr, slave_size;
-	snd_pcm_uframes_t appl_ptr, size, transfer, result, frames_to_remix;
+	snd_pcm_uframes_t slave_size;
+	snd_pcm_uframes_t size, result, frames_to_remix;
 	int err;
-	const snd_pcm_channel_area_t *src_areas, *dst_areas;
 
 	if (dmix->state == SND_PCM_STATE_RUNNING ||
 	    dmix->state == SND_PCM_STATE_DRAINING) {
@@ -714,31 +1240,15 @@ static snd_pcm_sframes_t snd_pcm_dmix_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t f
 	 */
 	frames_to_remix = size;
 
-	/* add sample areas here */
-	src_areas = snd_pcm_mmap_areas(pcm);
-	dst_areas = snd_pcm_mmap_areas(dmix->spcm);
 	dmix->last_appl_ptr -= size;
 	dmix->last_appl_ptr %= pcm->boundary;
-	appl_ptr = dmix->last_appl_ptr % pcm->buffer_size;
 	dmix->slave_appl_ptr -= size;
 	dmix->slave_appl_ptr %= dmix->slave_boundary;
-	slave_appl_ptr = dmix->slave_appl_ptr % dmix->slave_buffer_size;
 	dmix_down_sem(dmix);
-	for (;;) {
-		transfer = size;
-		if (appl_ptr + transfer > pcm->buffer_size)
-			transfer = pcm->buffer_size - appl_ptr;
-		if (slave_appl_ptr + transfer > dmix->slave_buffer_size)
-			transfer = dmix->slave_buffer_size - slave_appl_ptr;
-		remix_areas(dmix, src_areas, dst_areas, appl_ptr, slave_appl_ptr, transfer);
-		size -= transfer;
-		if (! size)
-			break;
-		slave_appl_ptr += transfer;
-		slave_appl_ptr %= dmix->slave_buffer_size;
-		appl_ptr += transfer;
-		appl_ptr %= pcm->buffer_size;
-	}
+	/* the frames not folded yet are just dropped from the slot */
+	if (dmix->u.dmix.staging)
+		size -= staging_unstage(dmix, dmix->slave_appl_ptr, size);
+	remix_range(pcm, dmix->last_appl_ptr, dmix->slave_appl_ptr, size);
 	dmix_up_sem(dmix);
 
 	snd_pcm_mmap_appl_backward(pcm, frames_to_remix);
@@ -776,6 +1286,20 @@ static snd_pcm_sframes_t snd_pcm_dmix_readn(snd_pcm_t *pcm ATTRIBUTE_UNUSED, voi
 	return -ENODEV;
 }
 
+static int snd_pcm_dmix_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
+{
+	snd_pcm_direct_t *dmix = pcm->private_data;
+	snd_pcm_format_t format;
+	int err;
+
+	err = INTERNAL(snd_pcm_hw_params_get_format)(params, &format);
+	if (err < 0)
+		return err;
+	/* FLOAT clients of a S32 slave in the float_sum mode */
+	dmix->u.dmix.float_client = format == SND_PCM_FORMAT_FLOAT;
+	return snd_pcm_direct_hw_params(pcm, params);
+}
+
 static int snd_pcm_dmix_close(snd_pcm_t *pcm)
 {
 	snd_pcm_direct_t *dmix = pcm->private_data;
@@ -788,6 +1312,7 @@ static int snd_pcm_dmix_close(snd_pcm_t *pcm)
  		snd_pcm_direct_server_discard(dmix);
  	if (dmix->client)
  		snd_pcm_direct_client_discard(dmix);
+	staging_slot_put(dmix);
  	shm_sum_discard(dmix);
 	if (snd_pcm_direct_shm_discard(dmix)) {
 		if (snd_pcm_direct_semaphore_discard(dmix))
@@ -897,7 +1422,7 @@ static const snd_pcm_ops_t snd_pcm_dmix_ops = {
 	.close = snd_pcm_dmix_close,
 	.info = snd_pcm_direct_info,
 	.hw_refine = snd_pcm_direct_hw_refine,
-	.hw_params = snd_pcm_direct_hw_params,
+	.hw_params = snd_pcm_dmix_hw_params,
 	.hw_free = snd_pcm_direct_hw_free,
 	.sw_params = snd_pcm_direct_sw_params,
 	.channel_info = snd_pcm_direct_channel_info,
@@ -965,7 +1490,7 @@ int snd_pcm_dmix_open(snd_pcm_t **pcmp, const char *name,
 {
 	snd_pcm_t *pcm, *spcm = NULL;
 	snd_pcm_direct_t *dmix;
-	int ret, first_instance;
+	int ret, first_instance, float_sum;
 
 	assert(pcmp);
 
@@ -989,6 +1514,7 @@ int snd_pcm_dmix_open(snd_pcm_t **pcmp, const char *name,
 	dmix->hw_ptr_alignment = opts->hw_ptr_alignment;
 	dmix->sync_ptr = snd_pcm_dmix_sync_ptr;
 	dmix->direct_memory_access = opts->direct_memory_access;
+	dmix->u.dmix.staging_slot = -1;
 
  retry:
 	if (first_instance) {
@@ -1073,12 +1599,45 @@ int snd_pcm_dmix_open(snd_pcm_t **pcmp, const char *name,
 		dmix->spcm = spcm;
 	}
 
+	/* a FLOAT slave is always mixed in float */
+	float_sum = opts->float_sum ||
+		dmix->shmptr->s.format == SND_PCM_FORMAT_FLOAT;
+	if (float_sum &&
+	    dmix->shmptr->s.format != SND_PCM_FORMAT_FLOAT &&
+	    dmix->shmptr->s.format != SND_PCM_FORMAT_S32) {
+		SNDERR("float_sum requires a S32 or FLOAT slave in the CPU endian");
+		ret = -EINVAL;
+		goto _err;
+	}
+	if (first_instance) {
+		dmix->shmptr->u.dmix.staging_slots = opts->staging_slots;
+		dmix->shmptr->u.dmix.float_sum = float_sum;
+	} else if (dmix->shmptr->u.dmix.staging_slots != (unsigned int)opts->staging_slots) {
+		SNDERR("staging_slots doesn't match the running dmix instance");
+		ret = -EINVAL;
+		goto _err;
+	} else if (dmix->shmptr->u.dmix.float_sum != (unsigned int)float_sum) {
+		SNDERR("float_sum doesn't match the running dmix instance");
+		ret = -EINVAL;
+		goto _err;
+	}
+
 	ret = shm_sum_create_or_connect(dmix);
 	if (ret < 0) {
 		SNDERR("unable to initialize sum ring buffer");
 		goto _err;
 	}
 
+	if (dmix->u.dmix.staging) {
+		ret = staging_slot_get(dmix, first_instance);
+		if (ret < 0) {
+			SNDERR("no free staging slot");
+			goto _err;
+		}
+		/* the fold is serialized anyway */
+		dmix->direct_memory_access = 0;
+	}
+
 	ret = snd_pcm_direct_initialize_poll_fd(dmix);
 	if (ret < 0) {
 		SNDERR("unable to initialize poll_fd");
@@ -1086,6 +1645,7 @@ int snd_pcm_dmix_open(snd_pcm_t **pcmp, const char *name,
 	}
 
 	mix_select_callbacks(dmix);
+	generic_float_select_callbacks(dmix);
 		
 	pcm->poll_fd = dmix->poll_fd;
 	pcm->poll_events = POLLIN;	/* it's different than other plugins */
@@ -1111,13 +1671,15 @@ int snd_pcm_dmix_open(snd_pcm_t **pcmp, const char *name,
 		snd_pcm_direct_client_discard(dmix);
 	if (spcm)
 		snd_pcm_close(spcm);
-	if (dmix->u.dmix.shmid_sum >= 0)
+	if (dmix->u.dmix.shmid_sum >= 0) {
+		staging_slot_put(dmix);
 		shm_sum_discard(dmix);
+	}
 	if ((dmix->shmid >= 0) && (snd_pcm_direct_shm_discard(dmix))) {
 		if (snd_pcm_direct_semaphore_discard(dmix))
 			snd_pcm_direct_semaphore_final(dmix, DIRECT_IPC_SEM_CLIENT);
 	} else
-		snd_pcm_direct_semaphore_up(dmix, DIRECT_IPC_SEM_CLIENT);
+		snd_pcm_direct_semaphore_final(dmix, DIRECT_IPC_SEM_CLIENT);
  _err_nosem:
 	free(dmix->bindings);
 	free(dmix);
@@ -1139,6 +1701,7 @@ pcm.name {
 	ipc_key INT		# unique IPC key
 	ipc_key_add_uid BOOL	# add current uid to unique IPC key
 	ipc_perm INT		# IPC permissions (octal, default 0600)
+	ipc_backend STR		# IPC backend: sysv (default) or posix
 	hw_ptr_alignment STR	# Slave application and hw pointer alignment type
 				# STR can be one of the below strings :
 				# no (or off)
@@ -1169,6 +1732,11 @@ pcm.name {
 		N INT		# maps slave channel to client channel N
 	}
 	slowptr BOOL		# slow but more precise pointer updates
+	timer_avail_min BOOL	# wake up at the client avail_min, not each period
+	stats_timing BOOL	# time the transfers for snd_pcm_direct_stats()
+	direct_memory_access BOOL # lock-free mixing with atomic operations
+	staging_slots INT	# number of staging slots (0 = disabled)
+	float_sum BOOL		# mix in float, accept FLOAT clients
 }
 \endcode
 
@@ -1180,6 +1748,58 @@ added to the value set in <code>ipc_key</code>.  This will
 avoid the confliction of the same IPC key with different users
 concurrently.
 
+<code>ipc_backend</code> selects the shared memory and the locking
+between the clients. The default <code>sysv</code> uses the SysV
+semaphores and shared memory. <code>posix</code> (Linux only) uses
+the POSIX shared memory segments named after the IPC key and robust
+process-shared mutexes, which don't enter the kernel when the lock is
+not contended. All clients of the instance must use the same backend,
+the clients of the other ABI (32-bit and 64-bit) are refused with
+<code>posix</code>, and the old server mode is not supported.
+
+When <code>direct_memory_access</code> is set, the clients mix their
+samples into the slave buffer with per-sample atomic operations where
+the architecture provides them. Otherwise, the mixing is serialized with
+a semaphore. On x86-64, the serialized path uses SSE2, SSSE3 or AVX2
+vector routines for interleaved S16_LE, S24_LE, S24_3LE and S32_LE
+buffers, on AArch64 NEON routines, which is usually faster for many
+channels. On AArch64, the atomic operations use the LSE instructions
+when the CPU supports them.
+
+When <code>staging_slots</code> is set (up to 64), each client copies
+its samples to a private staging slot in the shared memory and publishes
+the staged range without any lock. One client at a time is elected to fold
+the staged frames of all clients into the slave buffer in one blocked pass
+shortly before the hw pointer reaches them (one wakeup interval of the
+slowest client ahead); the other writers don't wait for it. A fold runs
+when the window moves (once per slave period) or when a client writes
+frames already inside the window. Staged frames which the hw pointer
+passes before they are folded are lost and counted in the staging_xruns
+field of snd_pcm_direct_stats().
+The value must be the same for all clients of the dmix instance, and
+<code>direct_memory_access</code> is ignored when the staging is enabled.
+
+When <code>float_sum</code> is set, the sum ring buffer holds float
+samples and the clients may use the FLOAT format (in the CPU endian) in
+addition to the slave format, so the applications producing float
+samples don't need a conversion in front of dmix. It requires a S32 slave
+format in the CPU endian. A FLOAT slave format is always mixed in float.
+The float mixing is serialized with a semaphore, and with
+<code>staging_slots</code> the clients must use the slave format.
+
+The transfer counts, the semaphore waits, the xruns and the avail at
+the wakeups of all clients are kept in the shared memory and can be
+read with snd_pcm_direct_stats(). The transfer durations and the
+semaphore wait times need a clock read per transfer and are recorded
+only when <code>stats_timing</code> is set (it is off by default, the
+setting applies to each client on its own).
+
+By default, the slave timer wakes each client once per client period.
+When <code>timer_avail_min</code> is set, the timer of each client is
+programmed to its own avail_min (in slave periods, at least one), so
+a client with a large avail_min is not woken up at the slave period
+rate. The per-period wakeups are kept when period_event is set.
+
 <code>hw_ptr_alignment</code> specifies slave application and hw
 pointer alignment type. By default hw_ptr_alignment is auto. Below are
 the possible configurations:
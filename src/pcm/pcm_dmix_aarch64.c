@@ -0,0 +1,140 @@
+/*
+ * optimized mixing code for aarch64
+ */
+
+#include <sys/auxv.h>
+#include <arm_neon.h>
+
+#if defined(__ARM_FEATURE_ATOMICS)
+#define LSE_ATTR
+#elif defined(__clang__)
+#define LSE_ATTR __attribute__((target("lse")))
+#else
+#define LSE_ATTR __attribute__((target("+lse")))
+#endif
+
+#define MIX_AREAS_16 mix_areas_16
+#define MIX_AREAS_32 mix_areas_32
+#define ATOMIC_ATTR
+#define XADD(a, b) ((a) + (b))
+#include "pcm_dmix_aarch64.h"
+#undef MIX_AREAS_16
+#undef MIX_AREAS_32
+#undef ATOMIC_ATTR
+#undef XADD
+
+#define MIX_AREAS_16 remix_areas_16
+#define MIX_AREAS_32 remix_areas_32
+#define ATOMIC_ATTR
+#define XADD(a, b) ((a) - (b))
+#include "pcm_dmix_aarch64.h"
+#undef MIX_AREAS_16
+#undef MIX_AREAS_32
+#undef ATOMIC_ATTR
+#undef XADD
+
+#define MIX_AREAS_16 mix_areas_16_lse
+#define MIX_AREAS_32 mix_areas_32_lse
+#define ATOMIC_ATTR LSE_ATTR
+#define XADD(a, b) ((a) + (b))
+#include "pcm_dmix_aarch64.h"
+#undef MIX_AREAS_16
+#undef MIX_AREAS_32
+#undef ATOMIC_ATTR
+#undef XADD
+
+#define MIX_AREAS_16 remix_areas_16_lse
+#define MIX_AREAS_32 remix_areas_32_lse
+#define ATOMIC_ATTR LSE_ATTR
+#define XADD(a, b) ((a) - (b))
+#include "pcm_dmix_aarch64.h"
+#undef MIX_AREAS_16
+#undef MIX_AREAS_32
+#undef ATOMIC_ATTR
+#undef XADD
+
+#define MIX_AREAS_16_NEON mix_areas_16_neon
+#define MIX_AREAS_32_NEON mix_areas_32_neon
+#define MIX_AREAS_24_NEON mix_areas_24_neon
+#define GENERIC_AREAS_16 generic_mix_areas_16_native
+#define GENERIC_AREAS_32 generic_mix_areas_32_native
+#define GENERIC_AREAS_24 generic_mix_areas_24
+#define VOPQ vaddq_s32
+#include "pcm_dmix_aarch64_neon.h"
+#undef MIX_AREAS_16_NEON
+#undef MIX_AREAS_32_NEON
+#undef MIX_AREAS_24_NEON
+#undef GENERIC_AREAS_16
+#undef GENERIC_AREAS_32
+#undef GENERIC_AREAS_24
+#undef VOPQ
+
+#define MIX_AREAS_16_NEON remix_areas_16_neon
+#define MIX_AREAS_32_NEON remix_areas_32_neon
+#define MIX_AREAS_24_NEON remix_areas_24_neon
+#define GENERIC_AREAS_16 generic_remix_areas_16_native
+#define GENERIC_AREAS_32 generic_remix_areas_32_native
+#define GENERIC_AREAS_24 generic_remix_areas_24
+#define VOPQ vsubq_s32
+#include "pcm_dmix_aarch64_neon.h"
+#undef MIX_AREAS_16_NEON
+#undef MIX_AREAS_32_NEON
+#undef MIX_AREAS_24_NEON
+#undef GENERIC_AREAS_16
+#undef GENERIC_AREAS_32
+#undef GENERIC_AREAS_24
+#undef VOPQ
+
+/* the unaligned 3-byte samples can't be accessed atomically */
+#define aarch64_dmix_supported_format \
+	((1ULL << SND_PCM_FORMAT_S16_LE) |\
+	 (1ULL << SND_PCM_FORMAT_S32_LE))
+
+#define aarch64_neon_dmix_supported_format \
+	((1ULL << SND_PCM_FORMAT_S16_LE) |\
+	 (1ULL << SND_PCM_FORMAT_S32_LE) |\
+	 (1ULL << SND_PCM_FORMAT_S24_LE) |\
+	 (1ULL << SND_PCM_FORMAT_S24_3LE))
+
+#define dmix_supported_format \
+	(aarch64_neon_dmix_supported_format | generic_dmix_supported_format)
+
+static void mix_select_callbacks(snd_pcm_direct_t *dmix)
+{
+	static int lse = -1;
+
+	if (lse < 0) {
+#ifdef HWCAP_ATOMICS
+		lse = (getauxval(AT_HWCAP) & HWCAP_ATOMICS) != 0;
+#else
+		lse = 0;
+#endif
+	}
+
+	if (!dmix->direct_memory_access) {
+		generic_mix_select_callbacks(dmix);
+		/* the mixing is serialized by the semaphore here,
+		 * so the non-atomic vector routines can be used
+		 */
+		if (!((1ULL<< dmix->shmptr->s.format) & aarch64_neon_dmix_supported_format))
+			return;
+		dmix->u.dmix.mix_areas_16 = mix_areas_16_neon;
+		dmix->u.dmix.remix_areas_16 = remix_areas_16_neon;
+		dmix->u.dmix.mix_areas_32 = mix_areas_32_neon;
+		dmix->u.dmix.remix_areas_32 = remix_areas_32_neon;
+		dmix->u.dmix.mix_areas_24 = mix_areas_24_neon;
+		dmix->u.dmix.remix_areas_24 = remix_areas_24_neon;
+		return;
+	}
+
+	if (!((1ULL<< dmix->shmptr->s.format) & aarch64_dmix_supported_format)) {
+		generic_mix_select_callbacks(dmix);
+		return;
+	}
+
+	dmix->u.dmix.mix_areas_16 = lse ? mix_areas_16_lse : mix_areas_16;
+	dmix->u.dmix.remix_areas_16 = lse ? remix_areas_16_lse : remix_areas_16;
+	dmix->u.dmix.mix_areas_32 = lse ? mix_areas_32_lse : mix_areas_32;
+	dmix->u.dmix.remix_areas_32 = lse ? remix_areas_32_lse : remix_areas_32;
+	dmix->u.dmix.use_sem = 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * \file pcm/pcm_dmix_aarch64.h
+ * \ingroup PCM_Plugins
+ * \brief PCM Direct Stream Mixing (dmix) Plugin Interface - AArch64 atomic code
+ */
+/*
+ *  PCM - Direct Stream Mixing
+ *
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * The same algorithm as the x86 assembler code, the sequentially
+ * consistent atomics are compiled to CAS/LDADD with ATOMIC_ATTR
+ * set to the LSE target and to exclusive load/store loops otherwise.
+ */
+
+/*
+ *  16-bit version
+ */
+ATOMIC_ATTR
+static void MIX_AREAS_16(unsigned int size,
+			 volatile signed short *dst, signed short *src,
+			 volatile signed int *sum, size_t dst_step,
+			 size_t src_step, size_t sum_step)
+{
+	signed int sample, old_sample;
+	signed short zero;
+
+	while (size-- > 0) {
+		/*
+		 *   sample = *src;
+		 *   sum_sample = *sum;
+		 *   if (cmpxchg(*dst, 0, 1) == 0)
+		 *     sample -= sum_sample;
+		 *   xadd(*sum, sample);
+		 */
+		sample = XADD(0, *src);
+		old_sample = __atomic_load_n(sum, __ATOMIC_RELAXED);
+		zero = 0;
+		if (__atomic_compare_exchange_n(dst, &zero, 1, 0,
+						__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+			sample -= old_sample;
+		__atomic_fetch_add(sum, sample, __ATOMIC_SEQ_CST);
+		/*
+		 *   do {
+		 *     sample = old_sample = *sum;
+		 *     saturate(v);
+		 *     *dst = sample;
+		 *   } while (v != *sum);
+		 */
+		do {
+			old_sample = __atomic_load_n(sum, __ATOMIC_SEQ_CST);
+			if (old_sample > 0x7fff)
+				sample = 0x7fff;
+			else if (old_sample < -0x8000)
+				sample = -0x8000;
+			else
+				sample = old_sample;
+			__atomic_store_n(dst, sample, __ATOMIC_SEQ_CST);
+		} while (__atomic_load_n(sum, __ATOMIC_SEQ_CST) != old_sample);
+		src = (signed short *) ((char *)src + src_step);
+		dst = (signed short *) ((char *)dst + dst_step);
+		sum = (signed int *)   ((char *)sum + sum_step);
+	}
+}
+
+/*
+ *  32-bit version (24-bit resolution)
+ */
+ATOMIC_ATTR
+static void MIX_AREAS_32(unsigned int size,
+			 volatile signed int *dst, signed int *src,
+			 volatile signed int *sum, size_t dst_step,
+			 size_t src_step, size_t sum_step)
+{
+	signed int sample, old_sample;
+	signed int zero;
+
+	while (size-- > 0) {
+		sample = XADD(0, *src >> 8);
+		old_sample = __atomic_load_n(sum, __ATOMIC_RELAXED);
+		zero = 0;
+		if (__atomic_compare_exchange_n(dst, &zero, 1, 0,
+						__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+			sample -= old_sample;
+		__atomic_fetch_add(sum, sample, __ATOMIC_SEQ_CST);
+		do {
+			old_sample = __atomic_load_n(sum, __ATOMIC_SEQ_CST);
+			if (old_sample > 0x7fffff)
+				sample = 0x7fffffff;
+			else if (old_sample < -0x800000)
+				sample = -0x7fffffff - 1;
+			else
+				sample = old_sample * 256;
+			__atomic_store_n(dst, sample, __ATOMIC_SEQ_CST);
+		} while (__atomic_load_n(sum, __ATOMIC_SEQ_CST) != old_sample);
+		src = (signed int *) ((char *)src + src_step);
+		dst = (signed int *) ((char *)dst + dst_step);
+		sum = (signed int *) ((char *)sum + sum_step);
+	}
+}
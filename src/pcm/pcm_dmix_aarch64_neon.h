@@ -0,0 +1,194 @@
+/**
+ * \file pcm/pcm_dmix_aarch64_neon.h
+ * \ingroup PCM_Plugins
+ * \brief PCM Direct Stream Mixing (dmix) Plugin Interface - AArch64 NEON code
+ */
+/*
+ *  PCM - Direct Stream Mixing
+ *
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * These routines are not atomic. They are used only when the mixing
+ * is serialized by the DIRECT_IPC_SEM_CLIENT semaphore (use_sem = 1).
+ * Only packed buffers are vectorized, the rest goes to the generic code.
+ */
+
+/*
+ *  16-bit version
+ */
+static void MIX_AREAS_16_NEON(unsigned int size,
+			      volatile signed short *dst, signed short *src,
+			      volatile signed int *sum, size_t dst_step,
+			      size_t src_step, size_t sum_step)
+{
+	unsigned int i = 0;
+
+	if (dst_step == 2 && src_step == 2 && sum_step == 4) {
+		const int16x8_t zero = vdupq_n_s16(0);
+
+		for (; i + 8 <= size; i += 8) {
+			signed int *s32 = (signed int *)(sum + i);
+			int16x8_t d = vld1q_s16((const signed short *)(dst + i));
+			int16x8_t s = vld1q_s16(src + i);
+			int16x8_t m = vreinterpretq_s16_u16(vceqq_s16(d, zero));
+			int32x4_t a0, a1;
+
+			a0 = vbicq_s32(vld1q_s32(s32), vmovl_s16(vget_low_s16(m)));
+			a1 = vbicq_s32(vld1q_s32(s32 + 4), vmovl_high_s16(m));
+			a0 = VOPQ(a0, vmovl_s16(vget_low_s16(s)));
+			a1 = VOPQ(a1, vmovl_high_s16(s));
+			vst1q_s32(s32, a0);
+			vst1q_s32(s32 + 4, a1);
+			vst1q_s16((signed short *)(dst + i),
+				  vcombine_s16(vqmovn_s32(a0), vqmovn_s32(a1)));
+		}
+		if (i == size)
+			return;
+	}
+	GENERIC_AREAS_16(size - i, dst + i, src + i, sum + i,
+			 dst_step, src_step, sum_step);
+}
+
+/*
+ *  32-bit version (24-bit resolution)
+ */
+static void MIX_AREAS_32_NEON(unsigned int size,
+			      volatile signed int *dst, signed int *src,
+			      volatile signed int *sum, size_t dst_step,
+			      size_t src_step, size_t sum_step)
+{
+	unsigned int i = 0;
+
+	if (dst_step == 4 && src_step == 4 && sum_step == 4) {
+		const int32x4_t zero = vdupq_n_s32(0);
+
+		for (; i + 4 <= size; i += 4) {
+			signed int *s32 = (signed int *)(sum + i);
+			int32x4_t d = vld1q_s32((const signed int *)(dst + i));
+			int32x4_t s = vld1q_s32(src + i);
+			uint32x4_t m = vceqq_s32(d, zero);
+			int32x4_t a;
+
+			a = vbicq_s32(vld1q_s32(s32), vreinterpretq_s32_u32(m));
+			a = VOPQ(a, vshrq_n_s32(s, 8));
+			vst1q_s32(s32, a);
+			/* the saturating shift clips to 0x80000000..0x7fffffff,
+			 * the first writer stores the full 32-bit sample
+			 */
+			vst1q_s32((signed int *)(dst + i),
+				  vbslq_s32(m, VOPQ(zero, s), vqshlq_n_s32(a, 8)));
+		}
+		if (i == size)
+			return;
+	}
+	GENERIC_AREAS_32(size - i, dst + i, src + i, sum + i,
+			 dst_step, src_step, sum_step);
+}
+
+/*
+ *  24-bit version (S24_LE and S24_3LE)
+ */
+static void MIX_AREAS_24_NEON(unsigned int size,
+			      volatile unsigned char *dst, unsigned char *src,
+			      volatile signed int *sum, size_t dst_step,
+			      size_t src_step, size_t sum_step)
+{
+	const int32x4_t zero = vdupq_n_s32(0);
+	const int32x4_t max = vdupq_n_s32(0x7fffff);
+	const int32x4_t min = vdupq_n_s32(-0x800000);
+	unsigned int i = 0;
+
+	if (dst_step == 4 && src_step == 4 && sum_step == 4) {
+		const uint32x4_t low = vdupq_n_u32(0x00ffffff);
+
+		for (; i + 4 <= size; i += 4) {
+			signed int *s32 = (signed int *)(sum + i);
+			int32x4_t d = vld1q_s32((const signed int *)(dst + i * 4));
+			int32x4_t s = vld1q_s32((const signed int *)(src + i * 4));
+			uint32x4_t m = vceqq_s32(vandq_s32(d, vreinterpretq_s32_u32(low)), zero);
+			int32x4_t a;
+
+			a = vbicq_s32(vld1q_s32(s32), vreinterpretq_s32_u32(m));
+			a = VOPQ(a, vshrq_n_s32(vshlq_n_s32(s, 8), 8));
+			vst1q_s32(s32, a);
+			/* keep the unused MSB of the 32-bit container */
+			vst1q_s32((signed int *)(dst + i * 4),
+				  vbslq_s32(low, vminq_s32(vmaxq_s32(a, min), max), d));
+		}
+	} else if (dst_step == 3 && src_step == 3 && sum_step == 4) {
+		for (; i + 16 <= size; i += 16) {
+			signed int *s32 = (signed int *)(sum + i);
+			unsigned char *d3 = (unsigned char *)(dst + i * 3);
+			uint8x16x3_t d = vld3q_u8(d3);
+			uint8x16x3_t s = vld3q_u8(src + i * 3);
+			uint16x8_t dl0, dl1, dh0, dh1, sl0, sl1, sh0, sh1, lo0, lo1, hi0, hi1;
+			int32x4_t a[4];
+			int k;
+
+			/* b0 | b1 << 8 | (signed)b2 << 16 */
+			dl0 = vreinterpretq_u16_u8(vzip1q_u8(d.val[0], d.val[1]));
+			dl1 = vreinterpretq_u16_u8(vzip2q_u8(d.val[0], d.val[1]));
+			dh0 = vreinterpretq_u16_s16(vmovl_s8(vget_low_s8(vreinterpretq_s8_u8(d.val[2]))));
+			dh1 = vreinterpretq_u16_s16(vmovl_high_s8(vreinterpretq_s8_u8(d.val[2])));
+			sl0 = vreinterpretq_u16_u8(vzip1q_u8(s.val[0], s.val[1]));
+			sl1 = vreinterpretq_u16_u8(vzip2q_u8(s.val[0], s.val[1]));
+			sh0 = vreinterpretq_u16_s16(vmovl_s8(vget_low_s8(vreinterpretq_s8_u8(s.val[2]))));
+			sh1 = vreinterpretq_u16_s16(vmovl_high_s8(vreinterpretq_s8_u8(s.val[2])));
+			{
+				const int32x4_t dv[4] = {
+					vreinterpretq_s32_u16(vzip1q_u16(dl0, dh0)),
+					vreinterpretq_s32_u16(vzip2q_u16(dl0, dh0)),
+					vreinterpretq_s32_u16(vzip1q_u16(dl1, dh1)),
+					vreinterpretq_s32_u16(vzip2q_u16(dl1, dh1)),
+				};
+				const int32x4_t sv[4] = {
+					vreinterpretq_s32_u16(vzip1q_u16(sl0, sh0)),
+					vreinterpretq_s32_u16(vzip2q_u16(sl0, sh0)),
+					vreinterpretq_s32_u16(vzip1q_u16(sl1, sh1)),
+					vreinterpretq_s32_u16(vzip2q_u16(sl1, sh1)),
+				};
+				for (k = 0; k < 4; k++) {
+					uint32x4_t m = vceqq_s32(dv[k], zero);
+
+					a[k] = vbicq_s32(vld1q_s32(s32 + k * 4),
+							 vreinterpretq_s32_u32(m));
+					a[k] = VOPQ(a[k], sv[k]);
+					vst1q_s32(s32 + k * 4, a[k]);
+					a[k] = vminq_s32(vmaxq_s32(a[k], min), max);
+				}
+			}
+			lo0 = vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(a[0])),
+					   vmovn_u32(vreinterpretq_u32_s32(a[1])));
+			lo1 = vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(a[2])),
+					   vmovn_u32(vreinterpretq_u32_s32(a[3])));
+			hi0 = vcombine_u16(vshrn_n_u32(vreinterpretq_u32_s32(a[0]), 16),
+					   vshrn_n_u32(vreinterpretq_u32_s32(a[1]), 16));
+			hi1 = vcombine_u16(vshrn_n_u32(vreinterpretq_u32_s32(a[2]), 16),
+					   vshrn_n_u32(vreinterpretq_u32_s32(a[3]), 16));
+			d.val[0] = vcombine_u8(vmovn_u16(lo0), vmovn_u16(lo1));
+			d.val[1] = vcombine_u8(vshrn_n_u16(lo0, 8), vshrn_n_u16(lo1, 8));
+			d.val[2] = vcombine_u8(vmovn_u16(hi0), vmovn_u16(hi1));
+			vst3q_u8(d3, d);
+		}
+	}
+	if (i == size)
+		return;
+	GENERIC_AREAS_24(size - i, dst + i * dst_step, src + i * src_step,
+			 sum + i, dst_step, src_step, sum_step);
+}
@@ -122,7 +122,7 @@ static void mix_select_callbacks(snd_pcm_direct_t *dmix)
 	((1ULL << SND_PCM_FORMAT_S16_LE) | (1ULL << SND_PCM_FORMAT_S32_LE) |\
 	 (1ULL << SND_PCM_FORMAT_S16_BE) | (1ULL << SND_PCM_FORMAT_S32_BE) |\
 	 (1ULL << SND_PCM_FORMAT_S24_LE) | (1ULL << SND_PCM_FORMAT_S24_3LE) | \
-	 (1ULL << SND_PCM_FORMAT_U8))
+	 (1ULL << SND_PCM_FORMAT_U8) | (1ULL << SND_PCM_FORMAT_FLOAT))
 
 #include "bswap.h"
 
@@ -512,6 +512,194 @@ static void generic_remix_areas_u8(unsigned int size,
 }
 
 
+/*
+ * float sum buffer (float_sum mode), the samples are in -1.0 .. 1.0,
+ * only the CPU endian S32 and FLOAT slaves are supported
+ */
+static inline float generic_float_clip(float sample)
+{
+	if (sample > 1.0f)
+		return 1.0f;
+	if (sample < -1.0f)
+		return -1.0f;
+	return sample;
+}
+
+static inline signed int generic_float_to_s32(float sample)
+{
+	if (sample >= 1.0f)
+		return 0x7fffffff;
+	if (sample > -1.0f)
+		return (signed int)(sample * 2147483648.0f);
+	return -0x7fffffff - 1;		/* also NaN */
+}
+
+static void generic_mix_areas_float(unsigned int size,
+				    volatile float *dst,
+				    float *src,
+				    volatile float *sum,
+				    size_t dst_step,
+				    size_t src_step,
+				    size_t sum_step)
+{
+	register float sample;
+
+	for (;;) {
+		sample = *src;
+		if (! *dst) {
+			*sum = sample;
+		} else {
+			sample += *sum;
+			*sum = sample;
+		}
+		*dst = generic_float_clip(sample);
+		if (!--size)
+			return;
+		src = (float *) ((char *)src + src_step);
+		dst = (float *) ((char *)dst + dst_step);
+		sum = (float *) ((char *)sum + sum_step);
+	}
+}
+
+static void generic_remix_areas_float(unsigned int size,
+				      volatile float *dst,
+				      float *src,
+				      volatile float *sum,
+				      size_t dst_step,
+				      size_t src_step,
+				      size_t sum_step)
+{
+	register float sample;
+
+	for (;;) {
+		sample = *src;
+		if (! *dst) {
+			sample = -sample;
+			*sum = sample;
+		} else {
+			*sum = sample = *sum - sample;
+		}
+		*dst = generic_float_clip(sample);
+		if (!--size)
+			return;
+		src = (float *) ((char *)src + src_step);
+		dst = (float *) ((char *)dst + dst_step);
+		sum = (float *) ((char *)sum + sum_step);
+	}
+}
+
+/* FLOAT client to S32 slave */
+static void generic_mix_areas_float_s32(unsigned int size,
+					volatile signed int *dst,
+					float *src,
+					volatile float *sum,
+					size_t dst_step,
+					size_t src_step,
+					size_t sum_step)
+{
+	register float sample;
+
+	for (;;) {
+		sample = *src;
+		if (! *dst) {
+			*sum = sample;
+		} else {
+			sample += *sum;
+			*sum = sample;
+		}
+		*dst = generic_float_to_s32(sample);
+		if (!--size)
+			return;
+		src = (float *) ((char *)src + src_step);
+		dst = (signed int *) ((char *)dst + dst_step);
+		sum = (float *) ((char *)sum + sum_step);
+	}
+}
+
+static void generic_remix_areas_float_s32(unsigned int size,
+					  volatile signed int *dst,
+					  float *src,
+					  volatile float *sum,
+					  size_t dst_step,
+					  size_t src_step,
+					  size_t sum_step)
+{
+	register float sample;
+
+	for (;;) {
+		sample = *src;
+		if (! *dst) {
+			sample = -sample;
+			*sum = sample;
+		} else {
+			*sum = sample = *sum - sample;
+		}
+		*dst = generic_float_to_s32(sample);
+		if (!--size)
+			return;
+		src = (float *) ((char *)src + src_step);
+		dst = (signed int *) ((char *)dst + dst_step);
+		sum = (float *) ((char *)sum + sum_step);
+	}
+}
+
+/* S32 client to S32 slave with the float sum */
+static void generic_mix_areas_32_float(unsigned int size,
+				       volatile signed int *dst,
+				       signed int *src,
+				       volatile float *sum,
+				       size_t dst_step,
+				       size_t src_step,
+				       size_t sum_step)
+{
+	register float sample;
+
+	for (;;) {
+		sample = *src * (1.0f / 2147483648.0f);
+		if (! *dst) {
+			*sum = sample;
+			*dst = *src;
+		} else {
+			sample += *sum;
+			*sum = sample;
+			*dst = generic_float_to_s32(sample);
+		}
+		if (!--size)
+			return;
+		src = (signed int *) ((char *)src + src_step);
+		dst = (signed int *) ((char *)dst + dst_step);
+		sum = (float *) ((char *)sum + sum_step);
+	}
+}
+
+static void generic_remix_areas_32_float(unsigned int size,
+					 volatile signed int *dst,
+					 signed int *src,
+					 volatile float *sum,
+					 size_t dst_step,
+					 size_t src_step,
+					 size_t sum_step)
+{
+	register float sample;
+
+	for (;;) {
+		sample = *src * (1.0f / 2147483648.0f);
+		if (! *dst) {
+			/* negate in float, -INT_MIN saturates */
+			*sum = sample = -sample;
+			*dst = generic_float_to_s32(sample);
+		} else {
+			*sum = sample = *sum - sample;
+			*dst = generic_float_to_s32(sample);
+		}
+		if (!--size)
+			return;
+		src = (signed int *) ((char *)src + src_step);
+		dst = (signed int *) ((char *)dst + dst_step);
+		sum = (float *) ((char *)sum + sum_step);
+	}
+}
+
 static void generic_mix_select_callbacks(snd_pcm_direct_t *dmix)
 {
 	if (snd_pcm_format_cpu_endian(dmix->shmptr->s.format)) {
@@ -532,4 +720,28 @@ static void generic_mix_select_callbacks(snd_pcm_direct_t *dmix)
 	dmix->u.dmix.use_sem = 1;
 }
 
+/*
+ * called after mix_select_callbacks(), overrides the S32 routines
+ * with the float sum versions; no atomic version is provided
+ */
+static void generic_float_select_callbacks(snd_pcm_direct_t *dmix)
+{
+	if (!dmix->shmptr->u.dmix.float_sum)
+		return;
+	if (dmix->shmptr->s.format == SND_PCM_FORMAT_FLOAT) {
+		dmix->u.dmix.mix_areas_float = generic_mix_areas_float;
+		dmix->u.dmix.remix_areas_float = generic_remix_areas_float;
+	} else {
+		dmix->u.dmix.mix_areas_float =
+			(mix_areas_float_t *)generic_mix_areas_float_s32;
+		dmix->u.dmix.remix_areas_float =
+			(mix_areas_float_t *)generic_remix_areas_float_s32;
+		dmix->u.dmix.mix_areas_32 =
+			(mix_areas_32_t *)generic_mix_areas_32_float;
+		dmix->u.dmix.remix_areas_32 =
+			(mix_areas_32_t *)generic_remix_areas_32_float;
+	}
+	dmix->u.dmix.use_sem = 1;
+}
+
 #endif
@@ -0,0 +1,235 @@
+/**
+ * \file pcm/pcm_dmix_staging.h
+ * \ingroup PCM_Plugins
+ * \brief PCM Direct Stream Mixing (dmix) Plugin Interface - staging slots
+ */
+/*
+ *  PCM - Direct Stream Mixing
+ *
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ *  The bookkeeping of the staged ranges, it depends on nothing else than
+ *  the shared slot header, so test/lsb/pcm_dmix_staging.c runs it without
+ *  a sound card.
+ */
+
+#ifndef __PCM_DMIX_STAGING_H
+#define __PCM_DMIX_STAGING_H
+
+#define DMIX_STAGING_MAX_SLOTS	64
+
+/* dmix staging slots, shared among clients - 32/64bit compatible */
+typedef struct {
+	unsigned int slots;			/* number of slots */
+	int folder;				/* pid of the elected folder, 0 = none */
+	unsigned long long slot_bytes;		/* size of one slot data area */
+	unsigned long long fold_ptr;		/* end of the last fold window */
+	unsigned long long requests;		/* fold requests, bumped after a publish */
+	struct {
+		int pid;			/* owner, 0 = free */
+		unsigned int active;		/* start/appl_ptr are valid */
+		unsigned int wakeup;		/* max frames between owner wakeups */
+		unsigned int seq;		/* odd while the owner updates the range */
+		unsigned int run;		/* bumped by the owner at a discontinuity */
+		unsigned int folded_run;	/* run of folded */
+		unsigned long long start;	/* first staged slave position */
+		unsigned long long appl_ptr;	/* last staged slave position + 1 */
+		unsigned long long folded;	/* folded up to, written by the folder */
+	} slot[DMIX_STAGING_MAX_SLOTS];
+} snd_pcm_dmix_staging_t;
+
+static inline snd_pcm_uframes_t staging_diff(snd_pcm_uframes_t ptr1,
+					     snd_pcm_uframes_t ptr2,
+					     snd_pcm_uframes_t boundary)
+{
+	if (ptr1 < ptr2)
+		return ptr1 + (boundary - ptr2);
+	return ptr1 - ptr2;
+}
+
+/*
+ *  publish the staged range of own slot, the folder skips a slot which
+ *  changes while it is read
+ */
+static inline void staging_publish(snd_pcm_dmix_staging_t *staging, int slot,
+				   unsigned int active, unsigned int run,
+				   snd_pcm_uframes_t start,
+				   snd_pcm_uframes_t appl_ptr)
+{
+	unsigned int seq = staging->slot[slot].seq;
+
+	__atomic_store_n(&staging->slot[slot].seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&staging->slot[slot].start, start, __ATOMIC_RELAXED);
+	__atomic_store_n(&staging->slot[slot].appl_ptr, appl_ptr, __ATOMIC_RELAXED);
+	__atomic_store_n(&staging->slot[slot].active, active, __ATOMIC_RELAXED);
+	__atomic_store_n(&staging->slot[slot].run, run, __ATOMIC_RELAXED);
+	/* the staged frames are visible with the even seq */
+	__atomic_store_n(&staging->slot[slot].seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/*
+ *  read a consistent staged range of a slot, returns 0 when the slot is
+ *  inactive or being updated (the owner requests another fold then)
+ */
+static inline int staging_read(snd_pcm_dmix_staging_t *staging,
+			       unsigned int slot,
+			       snd_pcm_uframes_t *start,
+			       snd_pcm_uframes_t *appl_ptr,
+			       unsigned int *run)
+{
+	unsigned int seq, active;
+
+	seq = __atomic_load_n(&staging->slot[slot].seq, __ATOMIC_ACQUIRE);
+	if (seq & 1)
+		return 0;
+	*start = __atomic_load_n(&staging->slot[slot].start, __ATOMIC_RELAXED);
+	*appl_ptr = __atomic_load_n(&staging->slot[slot].appl_ptr, __ATOMIC_RELAXED);
+	active = __atomic_load_n(&staging->slot[slot].active, __ATOMIC_RELAXED);
+	*run = __atomic_load_n(&staging->slot[slot].run, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&staging->slot[slot].seq, __ATOMIC_RELAXED) != seq)
+		return 0;
+	return active;
+}
+
+/*
+ *  publish size frames staged at slave_pos in own slot
+ *
+ *  A discontinuity starts a new run, the fold position of the old one is
+ *  void.  The start of a long run follows one buffer behind, the frames
+ *  before were folded or passed by the hw_ptr, so the staged range never
+ *  wraps the boundary.
+ */
+static inline void staging_stage(snd_pcm_dmix_staging_t *staging, int slot,
+				 snd_pcm_uframes_t slave_pos,
+				 snd_pcm_uframes_t size,
+				 snd_pcm_uframes_t buffer_size,
+				 snd_pcm_uframes_t boundary)
+{
+	snd_pcm_uframes_t start = staging->slot[slot].start;
+	unsigned int run = staging->slot[slot].run;
+
+	if (!staging->slot[slot].active ||
+	    staging->slot[slot].appl_ptr != slave_pos) {
+		start = slave_pos;
+		run++;
+	} else if (staging_diff(slave_pos, start, boundary) > buffer_size) {
+		start = (slave_pos + boundary - buffer_size) % boundary;
+	}
+	staging_publish(staging, slot, 1, run, start,
+			(slave_pos + size) % boundary);
+}
+
+/*
+ *  the range of each slot to fold in [hw, hw + window) as offsets from hw
+ *  in from/to, the fold positions are advanced past them
+ *
+ *  Returns 1 when staged frames were already passed by the hw_ptr, they
+ *  are dropped.
+ */
+static inline int staging_fold_ranges(snd_pcm_dmix_staging_t *staging,
+				      snd_pcm_uframes_t hw,
+				      snd_pcm_uframes_t window,
+				      snd_pcm_uframes_t buffer_size,
+				      snd_pcm_uframes_t boundary,
+				      snd_pcm_uframes_t *from,
+				      snd_pcm_uframes_t *to)
+{
+	snd_pcm_uframes_t start, appl, ofs, end, len;
+	unsigned int slot, run;
+	int lost = 0;
+
+	for (slot = 0; slot < staging->slots; slot++) {
+		from[slot] = to[slot] = 0;
+		if (!staging_read(staging, slot, &start, &appl, &run))
+			continue;
+		/* a fold position of an earlier run is ignored */
+		if (staging->slot[slot].folded_run != run) {
+			staging->slot[slot].folded = start;
+			staging->slot[slot].folded_run = run;
+		}
+		len = staging_diff(appl, start, boundary);
+		ofs = staging_diff(staging->slot[slot].folded, start, boundary);
+		if (ofs < len)
+			start = staging->slot[slot].folded;
+		else if (ofs == len)
+			continue;	/* everything folded */
+		ofs = staging_diff(start, hw, boundary);
+		end = staging_diff(appl, hw, boundary);
+		if (ofs > buffer_size) {
+			/* behind the hw_ptr, nobody folded in time */
+			lost = 1;
+			if (end > buffer_size || end == 0) {
+				staging->slot[slot].folded = appl;
+				continue;
+			}
+			ofs = 0;
+		}
+		if (end > window)
+			end = window;
+		if (ofs >= end)
+			continue;
+		from[slot] = ofs;
+		to[slot] = end;
+		staging->slot[slot].folded = (hw + end) % boundary;
+	}
+	return lost;
+}
+
+/*
+ *  remove the rewound frames after slave_pos which were not folded yet
+ *  from a slot, returns the number of removed frames (at most size)
+ *
+ *  [slave_pos, folded) was mixed already and is remixed by the caller.
+ */
+static inline snd_pcm_uframes_t staging_unstage_slot(snd_pcm_dmix_staging_t *staging,
+						     int slot,
+						     snd_pcm_uframes_t slave_pos,
+						     snd_pcm_uframes_t size,
+						     snd_pcm_uframes_t boundary)
+{
+	snd_pcm_uframes_t start, appl, folded, staged;
+	unsigned int run = staging->slot[slot].run;
+
+	if (!staging->slot[slot].active)
+		return 0;
+	start = staging->slot[slot].start;
+	appl = staging->slot[slot].appl_ptr;
+	folded = staging->slot[slot].folded;
+	if (staging->slot[slot].folded_run != run ||
+	    staging_diff(folded, start, boundary) >
+	    staging_diff(appl, start, boundary))
+		folded = start;
+	staged = staging_diff(appl, folded, boundary);
+	if (staged > size)
+		staged = size;
+	if (staging_diff(slave_pos, start, boundary) >
+	    staging_diff(appl, start, boundary))
+		start = folded = slave_pos;
+	else if (staging_diff(slave_pos, start, boundary) <
+		 staging_diff(folded, start, boundary))
+		folded = slave_pos;
+	staging->slot[slot].folded = folded;
+	staging->slot[slot].folded_run = run;
+	staging_publish(staging, slot, 1, run, start, slave_pos);
+	return staged;
+}
+
+#endif /* __PCM_DMIX_STAGING_H */
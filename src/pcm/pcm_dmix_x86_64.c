@@ -57,7 +57,70 @@
 #undef LOCK_PREFIX
 #undef XADD
 #undef XSUB
- 
+
+#if defined(__clang__) || \
+    (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define DMIX_X86_64_SIMD
+#endif
+
+#ifdef DMIX_X86_64_SIMD
+#include <immintrin.h>
+
+#define MIX_AREAS_16_SSE2 mix_areas_16_sse2
+#define MIX_AREAS_32_SSE2 mix_areas_32_sse2
+#define MIX_AREAS_24_SSSE3 mix_areas_24_ssse3
+#define MIX_AREAS_16_AVX2 mix_areas_16_avx2
+#define MIX_AREAS_32_AVX2 mix_areas_32_avx2
+#define MIX_AREAS_24_AVX2 mix_areas_24_avx2
+#define GENERIC_AREAS_16 generic_mix_areas_16_native
+#define GENERIC_AREAS_32 generic_mix_areas_32_native
+#define GENERIC_AREAS_24 generic_mix_areas_24
+#define VOP128 _mm_add_epi32
+#define VOP256 _mm256_add_epi32
+#include "pcm_dmix_x86_64_simd.h"
+#undef MIX_AREAS_16_SSE2
+#undef MIX_AREAS_32_SSE2
+#undef MIX_AREAS_24_SSSE3
+#undef MIX_AREAS_16_AVX2
+#undef MIX_AREAS_32_AVX2
+#undef MIX_AREAS_24_AVX2
+#undef GENERIC_AREAS_16
+#undef GENERIC_AREAS_32
+#undef GENERIC_AREAS_24
+#undef VOP128
+#undef VOP256
+
+#define MIX_AREAS_16_SSE2 remix_areas_16_sse2
+#define MIX_AREAS_32_SSE2 remix_areas_32_sse2
+#define MIX_AREAS_24_SSSE3 remix_areas_24_ssse3
+#define MIX_AREAS_16_AVX2 remix_areas_16_avx2
+#define MIX_AREAS_32_AVX2 remix_areas_32_avx2
+#define MIX_AREAS_24_AVX2 remix_areas_24_avx2
+#define GENERIC_AREAS_16 generic_remix_areas_16_native
+#define GENERIC_AREAS_32 generic_remix_areas_32_native
+#define GENERIC_AREAS_24 generic_remix_areas_24
+#define VOP128 _mm_sub_epi32
+#define VOP256 _mm256_sub_epi32
+#include "pcm_dmix_x86_64_simd.h"
+#undef MIX_AREAS_16_SSE2
+#undef MIX_AREAS_32_SSE2
+#undef MIX_AREAS_24_SSSE3
+#undef MIX_AREAS_16_AVX2
+#undef MIX_AREAS_32_AVX2
+#undef MIX_AREAS_24_AVX2
+#undef GENERIC_AREAS_16
+#undef GENERIC_AREAS_32
+#undef GENERIC_AREAS_24
+#undef VOP128
+#undef VOP256
+
+#define x86_64_simd_dmix_supported_format \
+	((1ULL << SND_PCM_FORMAT_S16_LE) |\
+	 (1ULL << SND_PCM_FORMAT_S32_LE) |\
+	 (1ULL << SND_PCM_FORMAT_S24_LE) |\
+	 (1ULL << SND_PCM_FORMAT_S24_3LE))
+#endif /* DMIX_X86_64_SIMD */
+
 #define x86_64_dmix_supported_format \
 	((1ULL << SND_PCM_FORMAT_S16_LE) |\
 	 (1ULL << SND_PCM_FORMAT_S32_LE) |\
@@ -66,12 +129,64 @@
 #define dmix_supported_format \
 	(x86_64_dmix_supported_format | generic_dmix_supported_format)
 
+static int mix_cpu_smp;
+#ifdef DMIX_X86_64_SIMD
+static int mix_cpu_ssse3, mix_cpu_avx2;
+#endif
+
+static void mix_cpu_detect(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_CONF);
+
+	mix_cpu_smp = cpus > 0 ? cpus : 1;
+#ifdef DMIX_X86_64_SIMD
+	/* cpuid, the AVX2 check includes the OS support of the YMM state */
+	__builtin_cpu_init();
+	mix_cpu_ssse3 = __builtin_cpu_supports("ssse3");
+	mix_cpu_avx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_once_t mix_cpu_once = PTHREAD_ONCE_INIT;
+#endif
+
 static void mix_select_callbacks(snd_pcm_direct_t *dmix)
 {
-	static int smp = 0;
-	
+#ifdef HAVE_LIBPTHREAD
+	pthread_once(&mix_cpu_once, mix_cpu_detect);
+#else
+	/* without threads there is no race */
+	if (!mix_cpu_smp)
+		mix_cpu_detect();
+#endif
+
 	if (!dmix->direct_memory_access) {
 		generic_mix_select_callbacks(dmix);
+#ifdef DMIX_X86_64_SIMD
+		/* the mixing is serialized by the semaphore here,
+		 * so the non-atomic vector routines can be used
+		 */
+		if (!((1ULL<< dmix->shmptr->s.format) & x86_64_simd_dmix_supported_format))
+			return;
+		if (mix_cpu_avx2) {
+			dmix->u.dmix.mix_areas_16 = mix_areas_16_avx2;
+			dmix->u.dmix.remix_areas_16 = remix_areas_16_avx2;
+			dmix->u.dmix.mix_areas_32 = mix_areas_32_avx2;
+			dmix->u.dmix.remix_areas_32 = remix_areas_32_avx2;
+			dmix->u.dmix.mix_areas_24 = mix_areas_24_avx2;
+			dmix->u.dmix.remix_areas_24 = remix_areas_24_avx2;
+		} else {
+			dmix->u.dmix.mix_areas_16 = mix_areas_16_sse2;
+			dmix->u.dmix.remix_areas_16 = remix_areas_16_sse2;
+			dmix->u.dmix.mix_areas_32 = mix_areas_32_sse2;
+			dmix->u.dmix.remix_areas_32 = remix_areas_32_sse2;
+			if (mix_cpu_ssse3) {
+				dmix->u.dmix.mix_areas_24 = mix_areas_24_ssse3;
+				dmix->u.dmix.remix_areas_24 = remix_areas_24_ssse3;
+			}
+		}
+#endif
 		return;
 	}
 
@@ -80,26 +195,11 @@ static void mix_select_callbacks(snd_pcm_direct_t *dmix)
 		return;
 	}
 
-	if (!smp) {
-		FILE *in;
-		char line[255];
-
-		/* try to determine, if we have SMP */
-		in = fopen("/proc/cpuinfo", "r");
-		if (in) {
-			while (!feof(in) && (fgets(line, sizeof(line), in) != NULL)) {
-				if (!strncmp(line, "processor", 9))
-					smp++;
-			}
-			fclose(in);
-		}
-	}
-	// printf("SMP: %i\n", smp);
-	dmix->u.dmix.mix_areas_16 = smp > 1 ? mix_areas_16_smp : mix_areas_16;
-	dmix->u.dmix.remix_areas_16 = smp > 1 ? remix_areas_16_smp : remix_areas_16;
-	dmix->u.dmix.mix_areas_32 = smp > 1 ? mix_areas_32_smp : mix_areas_32;
-	dmix->u.dmix.remix_areas_32 = smp > 1 ? remix_areas_32_smp : remix_areas_32;
-	dmix->u.dmix.mix_areas_24 = smp > 1 ? mix_areas_24_smp : mix_areas_24;
-	dmix->u.dmix.remix_areas_24 = smp > 1 ? remix_areas_24_smp : remix_areas_24;
+	dmix->u.dmix.mix_areas_16 = mix_cpu_smp > 1 ? mix_areas_16_smp : mix_areas_16;
+	dmix->u.dmix.remix_areas_16 = mix_cpu_smp > 1 ? remix_areas_16_smp : remix_areas_16;
+	dmix->u.dmix.mix_areas_32 = mix_cpu_smp > 1 ? mix_areas_32_smp : mix_areas_32;
+	dmix->u.dmix.remix_areas_32 = mix_cpu_smp > 1 ? remix_areas_32_smp : remix_areas_32;
+	dmix->u.dmix.mix_areas_24 = mix_cpu_smp > 1 ? mix_areas_24_smp : mix_areas_24;
+	dmix->u.dmix.remix_areas_24 = mix_cpu_smp > 1 ? remix_areas_24_smp : remix_areas_24;
 	dmix->u.dmix.use_sem = 0;
 }
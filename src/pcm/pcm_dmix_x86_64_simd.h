@@ -0,0 +1,352 @@
+/**
+ * \file pcm/pcm_dmix_x86_64_simd.h
+ * \ingroup PCM_Plugins
+ * \brief PCM Direct Stream Mixing (dmix) Plugin Interface - X86-64 vector code
+ */
+/*
+ *  PCM - Direct Stream Mixing
+ *
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * These routines are not atomic. They are used only when the mixing
+ * is serialized by the DIRECT_IPC_SEM_CLIENT semaphore (use_sem = 1).
+ *
+ * The vector loops are taken only for packed buffers (the interleaved
+ * case in mix_areas()), everything else and the remaining tail samples
+ * are passed to the generic C routines with the same semantics:
+ *
+ *   if (*dst == 0)
+ *     *sum = 0;
+ *   *sum = *sum XADD sample;
+ *   *dst = saturate(*sum);
+ */
+
+/*
+ *  16-bit version (SSE2)
+ */
+static void MIX_AREAS_16_SSE2(unsigned int size,
+			      volatile signed short *dst, signed short *src,
+			      volatile signed int *sum, size_t dst_step,
+			      size_t src_step, size_t sum_step)
+{
+	unsigned int i = 0;
+
+	if (dst_step == 2 && src_step == 2 && sum_step == 4) {
+		const __m128i zero = _mm_setzero_si128();
+
+		for (; i + 8 <= size; i += 8) {
+			__m128i *s32 = (__m128i *)(sum + i);
+			__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+			__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+			__m128i m = _mm_cmpeq_epi16(d, zero);
+			__m128i s0 = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+			__m128i s1 = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+			__m128i a0, a1;
+
+			a0 = _mm_andnot_si128(_mm_unpacklo_epi16(m, m),
+					      _mm_loadu_si128(s32));
+			a1 = _mm_andnot_si128(_mm_unpackhi_epi16(m, m),
+					      _mm_loadu_si128(s32 + 1));
+			a0 = VOP128(a0, s0);
+			a1 = VOP128(a1, s1);
+			_mm_storeu_si128(s32, a0);
+			_mm_storeu_si128(s32 + 1, a1);
+			_mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(a0, a1));
+		}
+		if (i == size)
+			return;
+	}
+	GENERIC_AREAS_16(size - i, dst + i, src + i, sum + i,
+			 dst_step, src_step, sum_step);
+}
+
+/*
+ *  32-bit version (24-bit resolution, SSE2)
+ */
+static void MIX_AREAS_32_SSE2(unsigned int size,
+			      volatile signed int *dst, signed int *src,
+			      volatile signed int *sum, size_t dst_step,
+			      size_t src_step, size_t sum_step)
+{
+	unsigned int i = 0;
+
+	if (dst_step == 4 && src_step == 4 && sum_step == 4) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i max = _mm_set1_epi32(0x7fffff);
+		const __m128i min = _mm_set1_epi32(-0x800000);
+		const __m128i max32 = _mm_set1_epi32(0x7fffffff);
+		const __m128i min32 = _mm_set1_epi32(-0x7fffffff - 1);
+
+		for (; i + 4 <= size; i += 4) {
+			__m128i *s32 = (__m128i *)(sum + i);
+			__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+			__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+			__m128i m = _mm_cmpeq_epi32(d, zero);
+			__m128i a, hi, lo, r;
+
+			a = VOP128(_mm_andnot_si128(m, _mm_loadu_si128(s32)),
+				   _mm_srai_epi32(s, 8));
+			_mm_storeu_si128(s32, a);
+			hi = _mm_cmpgt_epi32(a, max);
+			lo = _mm_cmpgt_epi32(min, a);
+			r = _mm_andnot_si128(_mm_or_si128(hi, lo), _mm_slli_epi32(a, 8));
+			r = _mm_or_si128(r, _mm_and_si128(hi, max32));
+			r = _mm_or_si128(r, _mm_and_si128(lo, min32));
+			/* the first writer stores the full 32-bit sample */
+			r = _mm_or_si128(_mm_andnot_si128(m, r),
+					 _mm_and_si128(m, VOP128(zero, s)));
+			_mm_storeu_si128((__m128i *)(dst + i), r);
+		}
+		if (i == size)
+			return;
+	}
+	GENERIC_AREAS_32(size - i, dst + i, src + i, sum + i,
+			 dst_step, src_step, sum_step);
+}
+
+/*
+ *  24-bit version (S24_LE and S24_3LE, SSSE3)
+ */
+__attribute__((target("ssse3")))
+static void MIX_AREAS_24_SSSE3(unsigned int size,
+			       volatile unsigned char *dst, unsigned char *src,
+			       volatile signed int *sum, size_t dst_step,
+			       size_t src_step, size_t sum_step)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i max = _mm_set1_epi32(0x7fffff);
+	const __m128i min = _mm_set1_epi32(-0x800000);
+	unsigned int i = 0;
+
+	if (dst_step == 4 && src_step == 4 && sum_step == 4) {
+		const __m128i low = _mm_set1_epi32(0x00ffffff);
+
+		for (; i + 4 <= size; i += 4) {
+			__m128i *s32 = (__m128i *)(sum + i);
+			__m128i d = _mm_loadu_si128((const __m128i *)(dst + i * 4));
+			__m128i s = _mm_loadu_si128((const __m128i *)(src + i * 4));
+			__m128i m = _mm_cmpeq_epi32(_mm_and_si128(d, low), zero);
+			__m128i a, hi, lo, c;
+
+			a = VOP128(_mm_andnot_si128(m, _mm_loadu_si128(s32)),
+				   _mm_srai_epi32(_mm_slli_epi32(s, 8), 8));
+			_mm_storeu_si128(s32, a);
+			hi = _mm_cmpgt_epi32(a, max);
+			lo = _mm_cmpgt_epi32(min, a);
+			c = _mm_andnot_si128(_mm_or_si128(hi, lo), a);
+			c = _mm_or_si128(c, _mm_and_si128(hi, max));
+			c = _mm_or_si128(c, _mm_and_si128(lo, min));
+			/* keep the unused MSB of the 32-bit container */
+			c = _mm_or_si128(_mm_and_si128(c, low),
+					 _mm_andnot_si128(low, d));
+			_mm_storeu_si128((__m128i *)(dst + i * 4), c);
+		}
+	} else if (dst_step == 3 && src_step == 3 && sum_step == 4) {
+		const __m128i expand = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+						     -1, 6, 7, 8, -1, 9, 10, 11);
+		const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+						   10, 12, 13, 14, -1, -1, -1, -1);
+
+		/* 16 bytes are loaded for 4 samples, don't read over the end */
+		for (; i + 6 <= size; i += 4) {
+			__m128i *s32 = (__m128i *)(sum + i);
+			unsigned char *d3 = (unsigned char *)(dst + i * 3);
+			__m128i d = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)d3), expand);
+			__m128i s = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + i * 3)), expand);
+			__m128i m = _mm_cmpeq_epi32(d, zero);
+			__m128i a, hi, lo, c;
+			int tail;
+
+			a = VOP128(_mm_andnot_si128(m, _mm_loadu_si128(s32)),
+				   _mm_srai_epi32(s, 8));
+			_mm_storeu_si128(s32, a);
+			hi = _mm_cmpgt_epi32(a, max);
+			lo = _mm_cmpgt_epi32(min, a);
+			c = _mm_andnot_si128(_mm_or_si128(hi, lo), a);
+			c = _mm_or_si128(c, _mm_and_si128(hi, max));
+			c = _mm_or_si128(c, _mm_and_si128(lo, min));
+			c = _mm_shuffle_epi8(c, pack);
+			_mm_storel_epi64((__m128i *)d3, c);
+			tail = _mm_cvtsi128_si32(_mm_srli_si128(c, 8));
+			memcpy(d3 + 8, &tail, 4);
+		}
+	}
+	if (i == size)
+		return;
+	GENERIC_AREAS_24(size - i, dst + i * dst_step, src + i * src_step,
+			 sum + i, dst_step, src_step, sum_step);
+}
+
+/*
+ *  16-bit version (AVX2)
+ */
+__attribute__((target("avx2")))
+static void MIX_AREAS_16_AVX2(unsigned int size,
+			      volatile signed short *dst, signed short *src,
+			      volatile signed int *sum, size_t dst_step,
+			      size_t src_step, size_t sum_step)
+{
+	unsigned int i = 0;
+
+	if (dst_step == 2 && src_step == 2 && sum_step == 4) {
+		const __m256i zero = _mm256_setzero_si256();
+
+		for (; i + 16 <= size; i += 16) {
+			__m256i *s32 = (__m256i *)(sum + i);
+			__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+			__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+			__m256i m = _mm256_cmpeq_epi16(d, zero);
+			__m256i a0, a1;
+
+			a0 = _mm256_andnot_si256(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(m)),
+						 _mm256_loadu_si256(s32));
+			a1 = _mm256_andnot_si256(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(m, 1)),
+						 _mm256_loadu_si256(s32 + 1));
+			a0 = VOP256(a0, _mm256_cvtepi16_epi32(_mm256_castsi256_si128(s)));
+			a1 = VOP256(a1, _mm256_cvtepi16_epi32(_mm256_extracti128_si256(s, 1)));
+			_mm256_storeu_si256(s32, a0);
+			_mm256_storeu_si256(s32 + 1, a1);
+			/* packs works per 128-bit lane, restore the sample order */
+			_mm256_storeu_si256((__m256i *)(dst + i),
+					    _mm256_permute4x64_epi64(_mm256_packs_epi32(a0, a1), 0xd8));
+		}
+		if (i == size)
+			return;
+	}
+	MIX_AREAS_16_SSE2(size - i, dst + i, src + i, sum + i,
+			  dst_step, src_step, sum_step);
+}
+
+/*
+ *  32-bit version (24-bit resolution, AVX2)
+ */
+__attribute__((target("avx2")))
+static void MIX_AREAS_32_AVX2(unsigned int size,
+			      volatile signed int *dst, signed int *src,
+			      volatile signed int *sum, size_t dst_step,
+			      size_t src_step, size_t sum_step)
+{
+	unsigned int i = 0;
+
+	if (dst_step == 4 && src_step == 4 && sum_step == 4) {
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i max = _mm256_set1_epi32(0x7fffff);
+		const __m256i min = _mm256_set1_epi32(-0x800000);
+		const __m256i lsb = _mm256_set1_epi32(0xff);
+
+		for (; i + 8 <= size; i += 8) {
+			__m256i *s32 = (__m256i *)(sum + i);
+			__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+			__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+			__m256i m = _mm256_cmpeq_epi32(d, zero);
+			__m256i a, r;
+
+			a = VOP256(_mm256_andnot_si256(m, _mm256_loadu_si256(s32)),
+				   _mm256_srai_epi32(s, 8));
+			_mm256_storeu_si256(s32, a);
+			r = _mm256_slli_epi32(_mm256_min_epi32(_mm256_max_epi32(a, min), max), 8);
+			/* positive saturation is 0x7fffffff */
+			r = _mm256_or_si256(r, _mm256_and_si256(_mm256_cmpgt_epi32(a, max), lsb));
+			r = _mm256_blendv_epi8(r, VOP256(zero, s), m);
+			_mm256_storeu_si256((__m256i *)(dst + i), r);
+		}
+		if (i == size)
+			return;
+	}
+	MIX_AREAS_32_SSE2(size - i, dst + i, src + i, sum + i,
+			  dst_step, src_step, sum_step);
+}
+
+/*
+ *  24-bit version (S24_LE and S24_3LE, AVX2)
+ */
+__attribute__((target("avx2")))
+static void MIX_AREAS_24_AVX2(unsigned int size,
+			      volatile unsigned char *dst, unsigned char *src,
+			      volatile signed int *sum, size_t dst_step,
+			      size_t src_step, size_t sum_step)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i max = _mm256_set1_epi32(0x7fffff);
+	const __m256i min = _mm256_set1_epi32(-0x800000);
+	unsigned int i = 0;
+
+	if (dst_step == 4 && src_step == 4 && sum_step == 4) {
+		const __m256i low = _mm256_set1_epi32(0x00ffffff);
+
+		for (; i + 8 <= size; i += 8) {
+			__m256i *s32 = (__m256i *)(sum + i);
+			__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i * 4));
+			__m256i s = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+			__m256i m = _mm256_cmpeq_epi32(_mm256_and_si256(d, low), zero);
+			__m256i a, c;
+
+			a = VOP256(_mm256_andnot_si256(m, _mm256_loadu_si256(s32)),
+				   _mm256_srai_epi32(_mm256_slli_epi32(s, 8), 8));
+			_mm256_storeu_si256(s32, a);
+			c = _mm256_min_epi32(_mm256_max_epi32(a, min), max);
+			c = _mm256_blendv_epi8(d, c, low);
+			_mm256_storeu_si256((__m256i *)(dst + i * 4), c);
+		}
+	} else if (dst_step == 3 && src_step == 3 && sum_step == 4) {
+		const __m256i expand = _mm256_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+							-1, 6, 7, 8, -1, 9, 10, 11,
+							-1, 0, 1, 2, -1, 3, 4, 5,
+							-1, 6, 7, 8, -1, 9, 10, 11);
+		const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+						      10, 12, 13, 14, -1, -1, -1, -1,
+						      0, 1, 2, 4, 5, 6, 8, 9,
+						      10, 12, 13, 14, -1, -1, -1, -1);
+
+		/* two 16-byte loads per 8 samples, don't read over the end */
+		for (; i + 10 <= size; i += 8) {
+			__m256i *s32 = (__m256i *)(sum + i);
+			unsigned char *d3 = (unsigned char *)(dst + i * 3);
+			unsigned char *s3 = src + i * 3;
+			__m256i d, s, m, a, c;
+			__m128i h;
+			int tail;
+
+			d = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)d3)),
+						    _mm_loadu_si128((const __m128i *)(d3 + 12)), 1);
+			s = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)s3)),
+						    _mm_loadu_si128((const __m128i *)(s3 + 12)), 1);
+			d = _mm256_shuffle_epi8(d, expand);
+			s = _mm256_shuffle_epi8(s, expand);
+			m = _mm256_cmpeq_epi32(d, zero);
+			a = VOP256(_mm256_andnot_si256(m, _mm256_loadu_si256(s32)),
+				   _mm256_srai_epi32(s, 8));
+			_mm256_storeu_si256(s32, a);
+			c = _mm256_min_epi32(_mm256_max_epi32(a, min), max);
+			c = _mm256_shuffle_epi8(c, pack);
+			h = _mm256_castsi256_si128(c);
+			_mm_storel_epi64((__m128i *)d3, h);
+			tail = _mm_cvtsi128_si32(_mm_srli_si128(h, 8));
+			memcpy(d3 + 8, &tail, 4);
+			h = _mm256_extracti128_si256(c, 1);
+			_mm_storel_epi64((__m128i *)(d3 + 12), h);
+			tail = _mm_cvtsi128_si32(_mm_srli_si128(h, 8));
+			memcpy(d3 + 20, &tail, 4);
+		}
+	}
+	if (i == size)
+		return;
+	MIX_AREAS_24_SSSE3(size - i, dst + i * dst_step, src + i * src_step,
+			   sum + i, dst_step, src_step, sum_step);
+}
@@ -74,6 +74,92 @@ static void do_silence(snd_pcm_t *pcm)
 	}
 }
 
+/*
+ * check whether the client channels are a contiguous run of the
+ * interleaved slave channels, both buffers interleaved
+ */
+static void share_check_run(snd_pcm_t *pcm)
+{
+	snd_pcm_direct_t *dshare = pcm->private_data;
+	const snd_pcm_channel_area_t *dst_areas, *src_areas;
+	unsigned int chn, channels, schannels, first;
+	int bits;
+
+	dshare->u.dshare.run_first = -1;
+	if (dshare->interleaved)
+		return;
+	bits = snd_pcm_format_physical_width(pcm->format);
+	if ((bits % 8) != 0)
+		return;
+	channels = dshare->channels;
+	schannels = dshare->spcm->channels;
+	first = dshare->bindings ? dshare->bindings[0] : 0;
+	if (first >= schannels || first + channels > schannels)
+		return;
+	dst_areas = snd_pcm_mmap_areas(dshare->spcm);
+	src_areas = snd_pcm_mmap_areas(pcm);
+	for (chn = 0; chn < schannels; chn++) {
+		if (dst_areas[chn].addr != dst_areas[0].addr ||
+		    dst_areas[chn].first != chn * bits ||
+		    dst_areas[chn].step != schannels * bits)
+			return;
+	}
+	for (chn = 0; chn < channels; chn++) {
+		if (dshare->bindings && dshare->bindings[chn] != first + chn)
+			return;
+		if (src_areas[chn].addr != src_areas[0].addr ||
+		    src_areas[chn].first != chn * bits ||
+		    src_areas[chn].step != channels * bits)
+			return;
+	}
+	dshare->u.dshare.run_first = first;
+}
+
+#define SHARE_COPY_RUN(bytes) \
+	for (; size > 0; size--, src += src_step, dst += dst_step) \
+		memcpy(dst, src, bytes)
+
+/*
+ * copy the client frames to a contiguous channel run of the slave
+ * frames; the common run sizes are copied with constant size moves
+ */
+static void share_areas_run(snd_pcm_direct_t *dshare,
+			    const snd_pcm_channel_area_t *src_areas,
+			    const snd_pcm_channel_area_t *dst_areas,
+			    snd_pcm_uframes_t src_ofs,
+			    snd_pcm_uframes_t dst_ofs,
+			    snd_pcm_uframes_t size)
+{
+	unsigned int fbytes = snd_pcm_format_physical_width(dshare->shmptr->s.format) / 8;
+	size_t run = dshare->channels * fbytes;
+	size_t src_step = src_areas[0].step / 8;
+	size_t dst_step = dst_areas[0].step / 8;
+	const char *src = (const char *)src_areas[0].addr + src_ofs * src_step;
+	char *dst = (char *)dst_areas[0].addr + dst_ofs * dst_step +
+		    dshare->u.dshare.run_first * fbytes;
+
+	switch (run) {
+	case 4:
+		SHARE_COPY_RUN(4);
+		break;
+	case 8:
+		SHARE_COPY_RUN(8);
+		break;
+	case 16:
+		SHARE_COPY_RUN(16);
+		break;
+	case 32:
+		SHARE_COPY_RUN(32);
+		break;
+	case 64:
+		SHARE_COPY_RUN(64);
+		break;
+	default:
+		SHARE_COPY_RUN(run);
+		break;
+	}
+}
+
 static void share_areas(snd_pcm_direct_t *dshare,
 		      const snd_pcm_channel_area_t *src_areas,
 		      const snd_pcm_channel_area_t *dst_areas,
@@ -91,6 +177,8 @@ static void share_areas(snd_pcm_direct_t *dshare,
 		memcpy(((char *)dst_areas[0].addr) + (dst_ofs * channels * fbytes),
 		       ((char *)src_areas[0].addr) + (src_ofs * channels * fbytes),
 		       size * channels * fbytes);
+	} else if (dshare->u.dshare.run_first >= 0) {
+		share_areas_run(dshare, src_areas, dst_areas, src_ofs, dst_ofs, size);
 	} else {
 		for (chn = 0; chn < channels; chn++) {
 			dchn = dshare->bindings ? dshare->bindings[chn] : chn;
@@ -109,8 +197,9 @@ static void snd_pcm_dshare_sync_area(snd_pcm_t *pcm)
 {
 	snd_pcm_direct_t *dshare = pcm->private_data;
 	snd_pcm_uframes_t slave_hw_ptr, slave_appl_ptr, slave_size;
-	snd_pcm_uframes_t appl_ptr, size;
+	snd_pcm_uframes_t appl_ptr, size, frames;
 	const snd_pcm_channel_area_t *src_areas, *dst_areas;
+	unsigned long long start;
 	
 	/* calculate the size to transfer */
 	size = pcm_frame_diff(dshare->appl_ptr, dshare->last_appl_ptr, pcm->boundary);
@@ -131,6 +220,8 @@ static void snd_pcm_dshare_sync_area(snd_pcm_t *pcm)
 		return;
 
 	/* add sample areas here */
+	start = snd_pcm_direct_stats_now(dshare);
+	frames = size;
 	src_areas = snd_pcm_mmap_areas(pcm);
 	dst_areas = snd_pcm_mmap_areas(dshare->spcm);
 	appl_ptr = dshare->last_appl_ptr % pcm->buffer_size;
@@ -154,6 +245,7 @@ static void snd_pcm_dshare_sync_area(snd_pcm_t *pcm)
 		appl_ptr += transfer;
 		appl_ptr %= pcm->buffer_size;
 	}
+	snd_pcm_direct_stats_commit(dshare, frames, start);
 }
 
 /*
@@ -188,6 +280,7 @@ static int snd_pcm_dshare_sync_ptr0(snd_pcm_t *pcm, snd_pcm_uframes_t slave_hw_p
 		gettimestamp(&dshare->trigger_tstamp, pcm->tstamp_type);
 		if (dshare->state == SND_PCM_STATE_RUNNING) {
 			dshare->state = SND_PCM_STATE_XRUN;
+			snd_pcm_direct_stats_xrun(dshare);
 			return -EPIPE;
 		}
 		dshare->state = SND_PCM_STATE_SETUP;
@@ -571,6 +664,15 @@ static int snd_pcm_dshare_htimestamp(snd_pcm_t *pcm,
 	return 0;
 }
 
+static int snd_pcm_dshare_prepare(snd_pcm_t *pcm)
+{
+	int err;
+
+	err = snd_pcm_direct_prepare(pcm);
+	share_check_run(pcm);
+	return err;
+}
+
 static void snd_pcm_dshare_dump(snd_pcm_t *pcm, snd_output_t *out)
 {
 	snd_pcm_direct_t *dshare = pcm->private_data;
@@ -612,7 +714,7 @@ static const snd_pcm_fast_ops_t snd_pcm_dshare_fast_ops = {
 	.state = snd_pcm_dshare_state,
 	.hwsync = snd_pcm_dshare_hwsync,
 	.delay = snd_pcm_dshare_delay,
-	.prepare = snd_pcm_direct_prepare,
+	.prepare = snd_pcm_dshare_prepare,
 	.reset = snd_pcm_dshare_reset,
 	.start = snd_pcm_dshare_start,
 	.drop = snd_pcm_dshare_drop,
@@ -690,6 +792,7 @@ int snd_pcm_dshare_open(snd_pcm_t **pcmp, const char *name,
 	dshare->var_periodsize = opts->var_periodsize;
 	dshare->hw_ptr_alignment = opts->hw_ptr_alignment;
 	dshare->sync_ptr = snd_pcm_dshare_sync_ptr;
+	dshare->u.dshare.run_first = -1;
 
  retry:
 	if (first_instance) {
@@ -818,7 +921,7 @@ int snd_pcm_dshare_open(snd_pcm_t **pcmp, const char *name,
 		if (snd_pcm_direct_semaphore_discard(dshare))
 			snd_pcm_direct_semaphore_final(dshare, DIRECT_IPC_SEM_CLIENT);
 	} else
-		snd_pcm_direct_semaphore_up(dshare, DIRECT_IPC_SEM_CLIENT);
+		snd_pcm_direct_semaphore_final(dshare, DIRECT_IPC_SEM_CLIENT);
  _err_nosem:
 	free(dshare->bindings);
 	free(dshare);
@@ -843,6 +946,7 @@ pcm.name {
 	ipc_key INT		# unique IPC key
 	ipc_key_add_uid BOOL	# add current uid to unique IPC key
 	ipc_perm INT		# IPC permissions (octal, default 0600)
+	ipc_backend STR		# IPC backend: sysv (default) or posix
 	hw_ptr_alignment STR	# Slave application and hw pointer alignment type
 		# STR can be one of the below strings :
 		# no (or off)
@@ -873,6 +977,8 @@ pcm.name {
 		N INT		# maps slave channel to client channel N
 	}
 	slowptr BOOL		# slow but more precise pointer updates
+	timer_avail_min BOOL	# wake up at the client avail_min, not each period
+	stats_timing BOOL	# time the transfers for snd_pcm_direct_stats()
 }
 \endcode
 
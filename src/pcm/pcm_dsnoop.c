@@ -104,9 +104,15 @@ static void snd_pcm_dsnoop_sync_area(snd_pcm_t *pcm, snd_pcm_uframes_t slave_hw_
 {
 	snd_pcm_direct_t *dsnoop = pcm->private_data;
 	snd_pcm_uframes_t hw_ptr = dsnoop->hw_ptr;
-	snd_pcm_uframes_t transfer;
+	snd_pcm_uframes_t transfer, frames = size;
 	const snd_pcm_channel_area_t *src_areas, *dst_areas;
+	unsigned long long start = snd_pcm_direct_stats_now(dsnoop);
 	
+	/* zero-copy, the client reads the slave buffer directly */
+	if (pcm->mmap_shadow) {
+		snd_pcm_direct_stats_commit(dsnoop, frames, start);
+		return;
+	}
 	/* add sample areas here */
 	dst_areas = snd_pcm_mmap_areas(pcm);
 	src_areas = snd_pcm_mmap_areas(dsnoop->spcm);
@@ -123,6 +129,7 @@ static void snd_pcm_dsnoop_sync_area(snd_pcm_t *pcm, snd_pcm_uframes_t slave_hw_
 		hw_ptr += transfer;
 		hw_ptr %= pcm->buffer_size;
 	}
+	snd_pcm_direct_stats_commit(dsnoop, frames, start);
 }
 
 /*
@@ -155,6 +162,7 @@ static int snd_pcm_dsnoop_sync_ptr(snd_pcm_t *pcm)
 	if ((avail = snd_pcm_mmap_capture_avail(pcm)) >= pcm->stop_threshold) {
 		gettimestamp(&dsnoop->trigger_tstamp, pcm->tstamp_type);
 		dsnoop->state = SND_PCM_STATE_XRUN;
+		snd_pcm_direct_stats_xrun(dsnoop);
 		dsnoop->avail_max = avail;
 		return -EPIPE;
 	}
@@ -247,12 +255,42 @@ static int snd_pcm_dsnoop_hwsync(snd_pcm_t *pcm)
 	}
 }
 
+/*
+ * in the zero-copy mode the client buffer is the slave buffer,
+ * so the client pointers must keep the slave buffer position
+ */
+static void snoop_zero_copy_align(snd_pcm_t *pcm)
+{
+	snd_pcm_direct_t *dsnoop = pcm->private_data;
+
+	if (!pcm->mmap_shadow)
+		return;
+	dsnoop->hw_ptr = dsnoop->slave_hw_ptr % pcm->buffer_size;
+	dsnoop->appl_ptr = dsnoop->hw_ptr;
+}
+
+static int snd_pcm_dsnoop_prepare(snd_pcm_t *pcm)
+{
+	int err;
+
+	/* this recovers the slave after an xrun, too */
+	err = snd_pcm_direct_prepare(pcm);
+	if (err < 0)
+		return err;
+	if (pcm->mmap_shadow) {
+		snoop_timestamp(pcm);
+		snoop_zero_copy_align(pcm);
+	}
+	return 0;
+}
+
 static int snd_pcm_dsnoop_reset(snd_pcm_t *pcm)
 {
 	snd_pcm_direct_t *dsnoop = pcm->private_data;
 	dsnoop->hw_ptr %= pcm->period_size;
 	dsnoop->appl_ptr = dsnoop->hw_ptr;
 	snd_pcm_direct_reset_slave_ptr(pcm, dsnoop, dsnoop->slave_hw_ptr);
+	snoop_zero_copy_align(pcm);
 	return 0;
 }
 
@@ -266,6 +304,7 @@ static int snd_pcm_dsnoop_start(snd_pcm_t *pcm)
 	snd_pcm_hwsync(dsnoop->spcm);
 	snoop_timestamp(pcm);
 	snd_pcm_direct_reset_slave_ptr(pcm, dsnoop, dsnoop->slave_hw_ptr);
+	snoop_zero_copy_align(pcm);
 	err = snd_timer_start(dsnoop->timer);
 	if (err < 0)
 		return err;
@@ -281,6 +320,11 @@ static int snd_pcm_dsnoop_drop(snd_pcm_t *pcm)
 		return -EBADFD;
 	dsnoop->state = SND_PCM_STATE_SETUP;
 	snd_timer_stop(dsnoop->timer);
+	/* called for each slave xrun recovery, the slave restarted */
+	if (pcm->mmap_shadow) {
+		snoop_timestamp(pcm);
+		snoop_zero_copy_align(pcm);
+	}
 	return 0;
 }
 
@@ -448,6 +492,167 @@ static int snd_pcm_dsnoop_htimestamp(snd_pcm_t *pcm,
 	return 0;
 }
 
+/*
+ * the zero-copy mode is possible when the client buffer has the same
+ * layout and size as the slave buffer
+ */
+static int snoop_zero_copy_possible(snd_pcm_direct_t *dsnoop,
+				    snd_pcm_hw_params_t *params)
+{
+	snd_pcm_t *spcm = dsnoop->spcm;
+	snd_pcm_access_t access;
+	snd_pcm_format_t format;
+	snd_pcm_uframes_t buffer_size;
+	unsigned int chn, channels;
+	int interleaved, slave_interleaved;
+
+	if (INTERNAL(snd_pcm_hw_params_get_access)(params, &access) < 0 ||
+	    INTERNAL(snd_pcm_hw_params_get_format)(params, &format) < 0 ||
+	    INTERNAL(snd_pcm_hw_params_get_channels)(params, &channels) < 0 ||
+	    INTERNAL(snd_pcm_hw_params_get_buffer_size)(params, &buffer_size) < 0)
+		return 0;
+	if (!spcm->running_areas || format != spcm->format ||
+	    channels != spcm->channels || buffer_size != spcm->buffer_size)
+		return 0;
+	/* mmap access may modify the frames in place (plugins like softvol) */
+	if (access != SND_PCM_ACCESS_RW_INTERLEAVED &&
+	    access != SND_PCM_ACCESS_RW_NONINTERLEAVED)
+		return 0;
+	/* the client gets a read-only mapping of the device buffer */
+	for (chn = 0; chn < channels; chn++)
+		if (spcm->mmap_channels[chn].type != SND_PCM_AREA_MMAP)
+			return 0;
+	interleaved = access == SND_PCM_ACCESS_MMAP_INTERLEAVED ||
+		      access == SND_PCM_ACCESS_RW_INTERLEAVED;
+	slave_interleaved = spcm->access == SND_PCM_ACCESS_MMAP_INTERLEAVED ||
+			    spcm->access == SND_PCM_ACCESS_RW_INTERLEAVED;
+	if (interleaved != slave_interleaved)
+		return 0;
+	if (dsnoop->bindings) {
+		for (chn = 0; chn < channels; chn++)
+			if (dsnoop->bindings[chn] != chn)
+				return 0;
+	}
+	return 1;
+}
+
+static int snd_pcm_dsnoop_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
+{
+	snd_pcm_direct_t *dsnoop = pcm->private_data;
+
+	/* the previous setup is already unmapped here */
+	pcm->mmap_shadow = dsnoop->zero_copy &&
+			   snoop_zero_copy_possible(dsnoop, params);
+	return snd_pcm_direct_hw_params(pcm, params);
+}
+
+static int snd_pcm_dsnoop_channel_info(snd_pcm_t *pcm, snd_pcm_channel_info_t *info)
+{
+	snd_pcm_direct_t *dsnoop = pcm->private_data;
+
+	if (pcm->mmap_shadow)
+		return snd_pcm_channel_info(dsnoop->spcm, info);
+	return snd_pcm_direct_channel_info(pcm, info);
+}
+
+/* the mapped size of the channels sharing the mapping of channel c */
+static size_t snoop_zero_copy_size(snd_pcm_t *pcm, unsigned int c)
+{
+	snd_pcm_channel_info_t *i = &pcm->mmap_channels[c], *i1;
+	size_t size = 0, s;
+	unsigned int c1;
+
+	for (c1 = c; c1 < pcm->channels; c1++) {
+		i1 = &pcm->mmap_channels[c1];
+		if (i1->u.mmap.fd != i->u.mmap.fd ||
+		    i1->u.mmap.offset != i->u.mmap.offset)
+			continue;
+		s = i1->first + i1->step * (pcm->buffer_size - 1) + pcm->sample_bits;
+		if (s > size)
+			size = s;
+	}
+	return (size + 7) / 8;
+}
+
+static int snd_pcm_dsnoop_munmap(snd_pcm_t *pcm)
+{
+	unsigned int c, c1;
+
+	if (!pcm->mmap_shadow || !pcm->mmap_channels)
+		return 0;
+	for (c = 0; c < pcm->channels; c++) {
+		void *addr = pcm->mmap_channels[c].addr;
+
+		if (!addr)
+			continue;
+		if (munmap(addr, snoop_zero_copy_size(pcm, c)) < 0)
+			SYSERR("munmap failed");
+		for (c1 = c; c1 < pcm->channels; c1++)
+			if (pcm->mmap_channels[c1].addr == addr)
+				pcm->mmap_channels[c1].addr = NULL;
+	}
+	free(pcm->mmap_channels);
+	free(pcm->running_areas);
+	pcm->mmap_channels = NULL;
+	pcm->running_areas = NULL;
+	return 0;
+}
+
+/*
+ * map the slave buffer once more read-only for the zero-copy client,
+ * the other clients capture from the same buffer
+ */
+static int snd_pcm_dsnoop_mmap(snd_pcm_t *pcm)
+{
+	snd_pcm_direct_t *dsnoop = pcm->private_data;
+	snd_pcm_channel_info_t *i;
+	unsigned int c, c1;
+	void *ptr;
+	int err;
+
+	if (!pcm->mmap_shadow)
+		return 0;
+	pcm->mmap_channels = calloc(pcm->channels, sizeof(pcm->mmap_channels[0]));
+	pcm->running_areas = calloc(pcm->channels, sizeof(pcm->running_areas[0]));
+	if (!pcm->mmap_channels || !pcm->running_areas) {
+		err = -ENOMEM;
+		goto __error;
+	}
+	for (c = 0; c < pcm->channels; c++) {
+		i = &pcm->mmap_channels[c];
+		*i = dsnoop->spcm->mmap_channels[c];
+		i->addr = NULL;
+	}
+	for (c = 0; c < pcm->channels; c++) {
+		i = &pcm->mmap_channels[c];
+		if (!i->addr) {
+			ptr = mmap(NULL, snoop_zero_copy_size(pcm, c), PROT_READ,
+				   MAP_FILE|MAP_SHARED, i->u.mmap.fd,
+				   i->u.mmap.offset);
+			if (ptr == MAP_FAILED) {
+				SYSERR("mmap failed");
+				err = -errno;
+				goto __error;
+			}
+			for (c1 = c; c1 < pcm->channels; c1++)
+				if (pcm->mmap_channels[c1].u.mmap.fd == i->u.mmap.fd &&
+				    pcm->mmap_channels[c1].u.mmap.offset == i->u.mmap.offset)
+					pcm->mmap_channels[c1].addr = ptr;
+		}
+		pcm->running_areas[c].addr = i->addr;
+		pcm->running_areas[c].first = i->first;
+		pcm->running_areas[c].step = i->step;
+	}
+	return 0;
+
+ __error:
+	if (pcm->mmap_channels)
+		snd_pcm_dsnoop_munmap(pcm);
+	free(pcm->running_areas);
+	pcm->running_areas = NULL;
+	return err;
+}
+
 static void snd_pcm_dsnoop_dump(snd_pcm_t *pcm, snd_output_t *out)
 {
 	snd_pcm_direct_t *dsnoop = pcm->private_data;
@@ -465,15 +670,15 @@ static const snd_pcm_ops_t snd_pcm_dsnoop_ops = {
 	.close = snd_pcm_dsnoop_close,
 	.info = snd_pcm_direct_info,
 	.hw_refine = snd_pcm_direct_hw_refine,
-	.hw_params = snd_pcm_direct_hw_params,
+	.hw_params = snd_pcm_dsnoop_hw_params,
 	.hw_free = snd_pcm_direct_hw_free,
 	.sw_params = snd_pcm_direct_sw_params,
-	.channel_info = snd_pcm_direct_channel_info,
+	.channel_info = snd_pcm_dsnoop_channel_info,
 	.dump = snd_pcm_dsnoop_dump,
 	.nonblock = snd_pcm_direct_nonblock,
 	.async = snd_pcm_direct_async,
-	.mmap = snd_pcm_direct_mmap,
-	.munmap = snd_pcm_direct_munmap,
+	.mmap = snd_pcm_dsnoop_mmap,
+	.munmap = snd_pcm_dsnoop_munmap,
 	.query_chmaps = snd_pcm_direct_query_chmaps,
 	.get_chmap = snd_pcm_direct_get_chmap,
 	.set_chmap = snd_pcm_direct_set_chmap,
@@ -484,7 +689,7 @@ static const snd_pcm_fast_ops_t snd_pcm_dsnoop_fast_ops = {
 	.state = snd_pcm_dsnoop_state,
 	.hwsync = snd_pcm_dsnoop_hwsync,
 	.delay = snd_pcm_dsnoop_delay,
-	.prepare = snd_pcm_direct_prepare,
+	.prepare = snd_pcm_dsnoop_prepare,
 	.reset = snd_pcm_dsnoop_reset,
 	.start = snd_pcm_dsnoop_start,
 	.drop = snd_pcm_dsnoop_drop,
@@ -556,6 +761,7 @@ int snd_pcm_dsnoop_open(snd_pcm_t **pcmp, const char *name,
 	dsnoop->var_periodsize = opts->var_periodsize;
 	dsnoop->sync_ptr = snd_pcm_dsnoop_sync_ptr;
 	dsnoop->hw_ptr_alignment = opts->hw_ptr_alignment;
+	dsnoop->zero_copy = opts->zero_copy;
 
  retry:
 	if (first_instance) {
@@ -672,7 +878,7 @@ int snd_pcm_dsnoop_open(snd_pcm_t **pcmp, const char *name,
 		if (snd_pcm_direct_semaphore_discard(dsnoop))
 			snd_pcm_direct_semaphore_final(dsnoop, DIRECT_IPC_SEM_CLIENT);
 	} else
-		snd_pcm_direct_semaphore_up(dsnoop, DIRECT_IPC_SEM_CLIENT);
+		snd_pcm_direct_semaphore_final(dsnoop, DIRECT_IPC_SEM_CLIENT);
 
  _err_nosem:
 	free(dsnoop->bindings);
@@ -697,6 +903,7 @@ pcm.name {
 	ipc_key INT		# unique IPC key
 	ipc_key_add_uid BOOL	# add current uid to unique IPC key
 	ipc_perm INT		# IPC permissions (octal, default 0600)
+	ipc_backend STR		# IPC backend: sysv (default) or posix
 	hw_ptr_alignment STR	# Slave application and hw pointer alignment type
 		# STR can be one of the below strings :
 		# no (or off)
@@ -727,9 +934,24 @@ pcm.name {
 		N INT		# maps slave channel to client channel N
 	}
 	slowptr BOOL		# slow but more precise pointer updates
+	timer_avail_min BOOL	# wake up at the client avail_min, not each period
+	stats_timing BOOL	# time the transfers for snd_pcm_direct_stats()
+	zero_copy BOOL		# read the slave buffer directly when possible
 }
 \endcode
 
+When <code>zero_copy</code> is set, a client which reads with the RW
+access and uses the slave format, channels, buffer size and the same
+interleaving (with no or identity bindings) reads the captured samples
+straight from the slave buffer. Its mmap areas are a read-only mapping
+of the slave buffer, only the client pointers are kept privately, so no
+copy is done per client. Clients with the mmap access, which includes
+the plugins stacked on dsnoop, may modify the frames in place and use
+the copy. The samples are overwritten by the hardware after one
+buffer, so the client must not use a stop threshold above the buffer
+size. The client pointers follow the slave position again after each
+slave xrun recovery. Other clients use the copy as usual.
+
 <code>hw_ptr_alignment</code> specifies slave application and hw
 pointer alignment type. By default hw_ptr_alignment is auto. Below are
 the possible configurations:
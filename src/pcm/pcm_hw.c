@@ -97,6 +97,11 @@ typedef struct {
 	bool mmap_status_fallbacked;
 	bool mmap_control_fallbacked;
 	struct snd_pcm_sync_ptr *sync_ptr;
+	bool sync_ptr_defer;		/* appl_ptr update goes with the next SYNC_PTR */
+	bool appl_ptr_pending;		/* appl_ptr not yet passed to the driver */
+	/* SYNC_PTR statistics */
+	unsigned long sync_ptr_ioctls;
+	unsigned long sync_ptr_merged;	/* appl_ptr updates carried by other requests */
 
 	bool prepare_reset_sw_params;
 	bool perfect_drain;
@@ -142,12 +147,20 @@ struct timespec snd_pcm_hw_fast_tstamp(snd_pcm_t *pcm)
 static int sync_ptr1(snd_pcm_hw_t *hw, unsigned int flags)
 {
 	int err;
+	/* pass the deferred appl_ptr instead of reading it back */
+	if (hw->appl_ptr_pending && (flags & SNDRV_PCM_SYNC_PTR_APPL)) {
+		flags &= ~SNDRV_PCM_SYNC_PTR_APPL;
+		hw->sync_ptr_merged++;
+	}
 	hw->sync_ptr->flags = flags;
+	hw->sync_ptr_ioctls++;
 	if (ioctl(hw->fd, SNDRV_PCM_IOCTL_SYNC_PTR, hw->sync_ptr) < 0) {
 		err = -errno;
 		SYSMSG("SNDRV_PCM_IOCTL_SYNC_PTR failed (%i)", err);
 		return err;
 	}
+	if (!(flags & SNDRV_PCM_SYNC_PTR_APPL))
+		hw->appl_ptr_pending = false;
 	return 0;
 }
 
@@ -169,6 +182,14 @@ static int issue_applptr(snd_pcm_hw_t *hw)
 	return sync_ptr1(hw, SNDRV_PCM_SYNC_PTR_AVAIL_MIN);
 }
 
+/* pass the appl_ptr deferred by mmap_commit */
+static int flush_applptr(snd_pcm_hw_t *hw)
+{
+	if (!hw->appl_ptr_pending)
+		return 0;
+	return issue_applptr(hw);
+}
+
 static int request_hwsync(snd_pcm_hw_t *hw)
 {
 	if (!hw->mmap_status_fallbacked)
@@ -606,6 +627,10 @@ static int snd_pcm_hw_status(snd_pcm_t *pcm, snd_pcm_status_t * status)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
 	int fd = hw->fd, err;
+
+	err = flush_applptr(hw);
+	if (err < 0)
+		return err;
 	if (SNDRV_PROTOCOL_VERSION(2, 0, 13) > hw->version) {
 		if (ioctl(fd, SNDRV_PCM_IOCTL_STATUS, status) < 0) {
 			err = -errno;
@@ -640,6 +665,10 @@ static int snd_pcm_hw_delay(snd_pcm_t *pcm, snd_pcm_sframes_t *delayp)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
 	int fd = hw->fd, err;
+
+	err = flush_applptr(hw);
+	if (err < 0)
+		return err;
 	if (ioctl(fd, SNDRV_PCM_IOCTL_DELAY, delayp) < 0) {
 		err = -errno;
 		SYSMSG("SNDRV_PCM_IOCTL_DELAY failed (%i)", err);
@@ -695,6 +724,7 @@ static int snd_pcm_hw_prepare(snd_pcm_t *pcm)
 		}
 		hw->prepare_reset_sw_params = false;
 	}
+	hw->appl_ptr_pending = false;
 	if (ioctl(fd, SNDRV_PCM_IOCTL_PREPARE) < 0) {
 		err = -errno;
 		SYSMSG("SNDRV_PCM_IOCTL_PREPARE failed (%i)", err);
@@ -707,6 +737,7 @@ static int snd_pcm_hw_reset(snd_pcm_t *pcm)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
 	int fd = hw->fd, err;
+	hw->appl_ptr_pending = false;
 	if (ioctl(fd, SNDRV_PCM_IOCTL_RESET) < 0) {
 		err = -errno;
 		SYSMSG("SNDRV_PCM_IOCTL_RESET failed (%i)", err);
@@ -740,6 +771,7 @@ static int snd_pcm_hw_drop(snd_pcm_t *pcm)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
 	int err;
+	hw->appl_ptr_pending = false;
 	if (ioctl(hw->fd, SNDRV_PCM_IOCTL_DROP) < 0) {
 		err = -errno;
 		SYSMSG("SNDRV_PCM_IOCTL_DROP failed (%i)", err);
@@ -798,6 +830,9 @@ __manual_silence:
 		hw->prepare_reset_sw_params = true;
 	}
 __skip_silence:
+	err = flush_applptr(hw);
+	if (err < 0)
+		return err;
 	if (ioctl(hw->fd, SNDRV_PCM_IOCTL_DRAIN) < 0) {
 		err = -errno;
 		SYSMSG("SNDRV_PCM_IOCTL_DRAIN failed (%i)", err);
@@ -810,6 +845,9 @@ static int snd_pcm_hw_pause(snd_pcm_t *pcm, int enable)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
 	int err;
+	err = flush_applptr(hw);
+	if (err < 0)
+		return err;
 	if (ioctl(hw->fd, SNDRV_PCM_IOCTL_PAUSE, enable) < 0) {
 		err = -errno;
 		SYSMSG("SNDRV_PCM_IOCTL_PAUSE failed (%i)", err);
@@ -827,6 +865,9 @@ static snd_pcm_sframes_t snd_pcm_hw_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t fra
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
 	int err;
+	err = flush_applptr(hw);
+	if (err < 0)
+		return err;
 	if (ioctl(hw->fd, SNDRV_PCM_IOCTL_REWIND, &frames) < 0) {
 		err = -errno;
 		SYSMSG("SNDRV_PCM_IOCTL_REWIND failed (%i)", err);
@@ -847,6 +888,9 @@ static snd_pcm_sframes_t snd_pcm_hw_forward(snd_pcm_t *pcm, snd_pcm_uframes_t fr
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
 	int err;
+	err = flush_applptr(hw);
+	if (err < 0)
+		return err;
 	if (SNDRV_PROTOCOL_VERSION(2, 0, 4) <= hw->version) {
 		if (ioctl(hw->fd, SNDRV_PCM_IOCTL_FORWARD, &frames) < 0) {
 			err = -errno;
@@ -943,6 +987,9 @@ static snd_pcm_sframes_t snd_pcm_hw_writei(snd_pcm_t *pcm, const void *buffer, s
 	xferi.buf = (char*) buffer;
 	xferi.frames = size;
 	xferi.result = 0; /* make valgrind happy */
+	err = flush_applptr(hw);
+	if (err < 0)
+		return err;
 	if (ioctl(fd, SNDRV_PCM_IOCTL_WRITEI_FRAMES, &xferi) < 0)
 		err = -errno;
 	else
@@ -964,6 +1011,9 @@ static snd_pcm_sframes_t snd_pcm_hw_writen(snd_pcm_t *pcm, void **bufs, snd_pcm_
 	memset(&xfern, 0, sizeof(xfern)); /* make valgrind happy */
 	xfern.bufs = bufs;
 	xfern.frames = size;
+	err = flush_applptr(hw);
+	if (err < 0)
+		return err;
 	if (ioctl(fd, SNDRV_PCM_IOCTL_WRITEN_FRAMES, &xfern) < 0)
 		err = -errno;
 	else
@@ -985,6 +1035,9 @@ static snd_pcm_sframes_t snd_pcm_hw_readi(snd_pcm_t *pcm, void *buffer, snd_pcm_
 	xferi.buf = buffer;
 	xferi.frames = size;
 	xferi.result = 0; /* make valgrind happy */
+	err = flush_applptr(hw);
+	if (err < 0)
+		return err;
 	if (ioctl(fd, SNDRV_PCM_IOCTL_READI_FRAMES, &xferi) < 0)
 		err = -errno;
 	else
@@ -1006,6 +1059,9 @@ static snd_pcm_sframes_t snd_pcm_hw_readn(snd_pcm_t *pcm, void **bufs, snd_pcm_u
 	memset(&xfern, 0, sizeof(xfern)); /* make valgrind happy */
 	xfern.bufs = bufs;
 	xfern.frames = size;
+	err = flush_applptr(hw);
+	if (err < 0)
+		return err;
 	if (ioctl(fd, SNDRV_PCM_IOCTL_READN_FRAMES, &xfern) < 0)
 		err = -errno;
 	else
@@ -1018,6 +1074,49 @@ static snd_pcm_sframes_t snd_pcm_hw_readn(snd_pcm_t *pcm, void **bufs, snd_pcm_u
 	return xfern.result;
 }
 
+#ifndef DOC_HIDDEN
+/*
+ * transfer ring (pcm_uring.c): the hw PCM file for a READV/WRITEV done
+ * by the kernel, -EINVAL when the ring has to transfer in user space.
+ * A blocking READV/WRITEV would sleep in an io-wq worker, so only the
+ * nonblocking PCMs are transferred by the kernel.
+ */
+int snd_pcm_hw_ring_fd(snd_pcm_t *pcm)
+{
+	snd_pcm_hw_t *hw;
+	int err;
+
+	if (pcm->type != SND_PCM_TYPE_HW ||
+	    pcm->access != SND_PCM_ACCESS_RW_NONINTERLEAVED ||
+	    !(pcm->mode & SND_PCM_NONBLOCK))
+		return -EINVAL;
+	hw = pcm->private_data;
+	/* the linked poll needs the period wakeups on the PCM file */
+	if (hw->period_event)
+		return -EINVAL;
+	err = flush_applptr(hw);
+	if (err < 0)
+		return err;
+	return hw->fd;
+}
+
+/* transfer ring: frames from the READV/WRITEV result */
+snd_pcm_sframes_t snd_pcm_hw_ring_result(snd_pcm_t *pcm, snd_pcm_sframes_t result)
+{
+	snd_pcm_hw_t *hw = pcm->private_data;
+	int err;
+
+	/* the kernel moved the pointers behind the back of the library */
+	snd_pcm_lock(pcm);
+	snd_pcm_snapshot_reset(pcm);
+	err = result < 0 ? (int)result : query_status_and_control_data(hw);
+	snd_pcm_unlock(pcm);
+	if (err < 0)
+		return snd_pcm_check_error(pcm, err);
+	return snd_pcm_bytes_to_frames(pcm, result);
+}
+#endif
+
 static bool map_status_data(snd_pcm_hw_t *hw, struct snd_pcm_sync_ptr *sync_ptr,
 			    bool force_fallback)
 {
@@ -1188,7 +1287,10 @@ static snd_pcm_sframes_t snd_pcm_hw_mmap_commit(snd_pcm_t *pcm,
 	snd_pcm_hw_t *hw = pcm->private_data;
 
 	snd_pcm_mmap_appl_forward(pcm, size);
-	issue_applptr(hw);
+	if (hw->sync_ptr_defer && hw->mmap_control_fallbacked)
+		hw->appl_ptr_pending = true;
+	else
+		issue_applptr(hw);
 #ifdef DEBUG_MMAP
 	fprintf(stderr, "appl_forward: hw_ptr = %li, appl_ptr = %li, size = %li\n", *pcm->hw.ptr, *pcm->appl.ptr, size);
 #endif
@@ -1242,6 +1344,16 @@ static int snd_pcm_hw_htimestamp(snd_pcm_t *pcm, snd_pcm_uframes_t *avail,
 	return 0;
 }
 
+static int snd_pcm_hw_may_wait_for_avail_min(snd_pcm_t *pcm,
+					     snd_pcm_uframes_t avail ATTRIBUTE_UNUSED)
+{
+	snd_pcm_hw_t *hw = pcm->private_data;
+
+	/* the driver has to see the appl_ptr before the wait */
+	flush_applptr(hw);
+	return 1;
+}
+
 static void __fill_chmap_ctl_id(snd_ctl_elem_id_t *id, int dev, int subdev,
 				int stream)
 {
@@ -1518,6 +1630,10 @@ static void snd_pcm_hw_dump(snd_pcm_t *pcm, snd_output_t *out)
 		snd_output_printf(out, "  appl_ptr     : %li\n", hw->mmap_control->appl_ptr);
 		snd_output_printf(out, "  hw_ptr       : %li\n", hw->mmap_status->hw_ptr);
 	}
+	if (hw->sync_ptr) {
+		snd_output_printf(out, "  sync_ptr     : %lu ioctls, %lu appl_ptr merged\n",
+				  hw->sync_ptr_ioctls, hw->sync_ptr_merged);
+	}
 }
 
 static const snd_pcm_ops_t snd_pcm_hw_ops = {
@@ -1564,6 +1680,7 @@ static const snd_pcm_fast_ops_t snd_pcm_hw_fast_ops = {
 	.avail_update = snd_pcm_hw_avail_update,
 	.mmap_commit = snd_pcm_hw_mmap_commit,
 	.htimestamp = snd_pcm_hw_htimestamp,
+	.may_wait_for_avail_min = snd_pcm_hw_may_wait_for_avail_min,
 	.poll_descriptors = NULL,
 	.poll_descriptors_count = NULL,
 	.poll_revents = NULL,
@@ -1595,6 +1712,7 @@ static const snd_pcm_fast_ops_t snd_pcm_hw_fast_ops_timer = {
 	.avail_update = snd_pcm_hw_avail_update,
 	.mmap_commit = snd_pcm_hw_mmap_commit,
 	.htimestamp = snd_pcm_hw_htimestamp,
+	.may_wait_for_avail_min = snd_pcm_hw_may_wait_for_avail_min,
 	.poll_descriptors = snd_pcm_hw_poll_descriptors,
 	.poll_descriptors_count = snd_pcm_hw_poll_descriptors_count,
 	.poll_revents = snd_pcm_hw_poll_revents,
@@ -1837,6 +1955,18 @@ changed by this option.  This influences only on the blocking behavior at
 opening the device.  If you would like to keep the compatibility with the
 older ALSA stuff, turn this option off.
 
+When the control structures are accessed through the SYNC_PTR ioctl (the
+sync_ptr_ioctl option, or the kernel cannot mmap them, e.g. 32-bit compat
+on some architectures), each pointer update is an ioctl of its own.  The
+sync_ptr_defer option keeps the appl_ptr update of mmap_commit until the
+next SYNC_PTR request (e.g. the hwsync of the next avail update) carries
+it, which saves a request per mmap transfer loop iteration.  The pointer is
+always passed before the library waits for the device and before the
+other operations depending on it, but an application polling the
+descriptors on its own has to call #snd_pcm_avail_update() (or
+#snd_pcm_wait()) after the last commit.  The request counts are shown
+in the PCM dump.
+
 \code
 pcm.name {
 	type hw			# Kernel PCM
@@ -1844,6 +1974,7 @@ pcm.name {
 	[device INT]		# Device number (default 0)
 	[subdevice INT]		# Subdevice number (default -1: first available)
 	[sync_ptr_ioctl BOOL]	# Use SYNC_PTR ioctl rather than the direct mmap access for control structures
+	[sync_ptr_defer BOOL]	# Pass appl_ptr with the next SYNC_PTR ioctl (see below)
 	[nonblock BOOL]		# Force non-blocking open mode
 	[format STR]		# Restrict only to the given format
 	[channels INT]		# Restrict only to the given channels
@@ -1882,7 +2013,7 @@ int _snd_pcm_hw_open(snd_pcm_t **pcmp, const char *name,
 	snd_config_iterator_t i, next;
 	long card = -1, device = 0, subdevice = -1;
 	const char *str;
-	int err, sync_ptr_ioctl = 0;
+	int err, sync_ptr_ioctl = 0, sync_ptr_defer = 0;
 	int min_rate = 0, max_rate = 0, channels = 0, drain_silence = -1;
 	snd_pcm_format_t format = SND_PCM_FORMAT_UNKNOWN;
 	snd_config_t *n;
@@ -1933,6 +2064,13 @@ int _snd_pcm_hw_open(snd_pcm_t **pcmp, const char *name,
 			sync_ptr_ioctl = err;
 			continue;
 		}
+		if (strcmp(id, "sync_ptr_defer") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0)
+				continue;
+			sync_ptr_defer = err;
+			continue;
+		}
 		if (strcmp(id, "nonblock") == 0) {
 			err = snd_config_get_bool(n);
 			if (err < 0)
@@ -2077,6 +2215,7 @@ int _snd_pcm_hw_open(snd_pcm_t **pcmp, const char *name,
 	if (chmap)
 		hw->chmap_override = chmap;
 	hw->drain_silence = drain_silence;
+	hw->sync_ptr_defer = sync_ptr_defer;
 
 	return 0;
 
@@ -105,6 +105,10 @@ void snd_pcm_lfloat_convert_integer_float(const snd_pcm_channel_area_t *dst_area
 	void *get32 = get32_labels[get32idx];
 	void *put32float = put32float_labels[put32floatidx];
 	unsigned int channel;
+
+	if (snd_pcm_simd_integer_float(dst_areas, dst_offset, src_areas, src_offset,
+				       channels, frames, get32idx, put32floatidx) == 0)
+		return;
 	for (channel = 0; channel < channels; ++channel) {
 		const char *src;
 		char *dst;
@@ -150,6 +154,10 @@ void snd_pcm_lfloat_convert_float_integer(const snd_pcm_channel_area_t *dst_area
 	void *put32 = put32_labels[put32idx];
 	void *get32float = get32float_labels[get32floatidx];
 	unsigned int channel;
+
+	if (snd_pcm_simd_float_integer(dst_areas, dst_offset, src_areas, src_offset,
+				       channels, frames, put32idx, get32floatidx) == 0)
+		return;
 	for (channel = 0; channel < channels; ++channel) {
 		const char *src;
 		char *dst;
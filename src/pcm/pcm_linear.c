@@ -153,6 +153,10 @@ void snd_pcm_linear_convert(const snd_pcm_channel_area_t *dst_areas, snd_pcm_ufr
 #undef CONV_LABELS
 	void *conv = conv_labels[convidx];
 	unsigned int channel;
+
+	if (snd_pcm_simd_linear_convert(dst_areas, dst_offset, src_areas, src_offset,
+					channels, frames, convidx) == 0)
+		return;
 	for (channel = 0; channel < channels; ++channel) {
 		const char *src;
 		char *dst;
@@ -189,6 +193,10 @@ void snd_pcm_linear_getput(const snd_pcm_channel_area_t *dst_areas, snd_pcm_ufra
 	void *put = put32_labels[put_idx];
 	unsigned int channel;
 	uint32_t sample = 0;
+
+	if (snd_pcm_simd_linear_getput(dst_areas, dst_offset, src_areas, src_offset,
+				       channels, frames, get_idx, put_idx) == 0)
+		return;
 	for (channel = 0; channel < channels; ++channel) {
 		const char *src;
 		char *dst;
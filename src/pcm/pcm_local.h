@@ -191,6 +191,26 @@ typedef struct {
 	int (*mmap_begin)(snd_pcm_t *pcm, const snd_pcm_channel_area_t **areas, snd_pcm_uframes_t *offset, snd_pcm_uframes_t *frames); /* locked */
 } snd_pcm_fast_ops_t;
 
+#ifdef THREAD_SAFE_API
+/*
+ * the status values published by the lock holder for the other threads,
+ * updated and read under the seq counter (odd while being updated)
+ */
+typedef struct {
+	unsigned int seq;
+	int writer_valid;
+	pthread_t writer;		/* the thread doing the transfers */
+	uint64_t avail_time;		/* monotonic ns, 0 = not published */
+	snd_pcm_sframes_t avail;
+	uint64_t delay_time;
+	snd_pcm_sframes_t delay;
+	int delay_follows;		/* delay published together with avail */
+	uint64_t tstamp_time;
+	snd_pcm_uframes_t tstamp_avail;
+	snd_htimestamp_t tstamp;
+} snd_pcm_snapshot_t;
+#endif
+
 struct _snd_pcm {
 	void *open_func;
 	char *name;
@@ -257,7 +277,12 @@ struct _snd_pcm {
 	int lock_enabled;	/* thread-safety lock is enabled on the system;
 				 * it's set depending on $LIBASOUND_THREAD_SAFE.
 				 */
+	int lock_snapshot;	/* the status queries of other threads than
+				 * the transferring one are served from the
+				 * snapshot; $LIBASOUND_THREAD_SAFE=2.
+				 */
 	pthread_mutex_t lock;
+	snd_pcm_snapshot_t snapshot;
 #endif
 };
 
@@ -280,10 +305,16 @@ struct _snd_pcm {
 	snd1_pcm_areas_from_buf
 #define snd_pcm_areas_from_bufs \
 	snd1_pcm_areas_from_bufs
+#define snd_pcm_simd_areas_copy \
+	snd1_pcm_simd_areas_copy
 #define snd_pcm_open_named_slave \
 	snd1_pcm_open_named_slave
 #define snd_pcm_hw_open_fd \
 	snd1_pcm_hw_open_fd
+#define snd_pcm_hw_ring_fd \
+	snd1_pcm_hw_ring_fd
+#define snd_pcm_hw_ring_result \
+	snd1_pcm_hw_ring_result
 #define snd_pcm_wait_nocheck \
 	snd1_pcm_wait_nocheck
 #define snd_pcm_rate_get_default_converter \
@@ -377,6 +408,13 @@ int snd_pcm_free(snd_pcm_t *pcm);
 
 void snd_pcm_areas_from_buf(snd_pcm_t *pcm, snd_pcm_channel_area_t *areas, void *buf);
 void snd_pcm_areas_from_bufs(snd_pcm_t *pcm, snd_pcm_channel_area_t *areas, void **bufs);
+/* vectorized interleave/deinterleave (pcm_simd.c), -EINVAL when the areas
+ * aren't handled
+ */
+int snd_pcm_simd_areas_copy(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_t dst_offset,
+			    const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
+			    unsigned int channels, snd_pcm_uframes_t frames,
+			    unsigned int width);
 
 int snd_pcm_async(snd_pcm_t *pcm, int sig, pid_t pid);
 int snd_pcm_mmap(snd_pcm_t *pcm);
@@ -1008,6 +1046,9 @@ snd_pcm_open_slave(snd_pcm_t **pcmp, snd_config_t *root,
 
 int snd_pcm_hw_open_fd(snd_pcm_t **pcmp, const char *name, int fd,
 		       int sync_ptr_ioctl);
+/* kernel transfers of the io_uring transfer ring (pcm_uring.c) */
+int snd_pcm_hw_ring_fd(snd_pcm_t *pcm);
+snd_pcm_sframes_t snd_pcm_hw_ring_result(snd_pcm_t *pcm, snd_pcm_sframes_t result);
 int __snd_pcm_mmap_emul_open(snd_pcm_t **pcmp, const char *name,
 			     snd_pcm_t *slave, int close_slave);
 
@@ -1220,11 +1261,15 @@ static inline void snd_pcm_unlock(snd_pcm_t *pcm)
 	if (pcm->lock_enabled && pcm->need_lock)
 		pthread_mutex_unlock(&pcm->lock);
 }
+/* drop the status snapshot, called with the PCM locked */
+#define snd_pcm_snapshot_reset snd1_pcm_snapshot_reset
+void snd_pcm_snapshot_reset(snd_pcm_t *pcm);
 #else /* THREAD_SAFE_API */
 #define __snd_pcm_lock(pcm)		do {} while (0)
 #define __snd_pcm_unlock(pcm)		do {} while (0)
 #define snd_pcm_lock(pcm)		do {} while (0)
 #define snd_pcm_unlock(pcm)		do {} while (0)
+#define snd_pcm_snapshot_reset(pcm)	do {} while (0)
 #endif /* THREAD_SAFE_API */
 
 #endif /* __PCM_LOCAL_H */
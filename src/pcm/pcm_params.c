@@ -20,6 +20,10 @@
  */
   
 #include "pcm_local.h"
+#include <stddef.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 #ifndef NDEBUG
 /*
@@ -2071,7 +2075,7 @@ static const snd_interval_t refine_intervals[SND_PCM_HW_PARAM_LAST_INTERVAL - SN
 #define RULES_DEBUG
 #endif
 
-int snd_pcm_hw_refine_soft(snd_pcm_t *pcm ATTRIBUTE_UNUSED, snd_pcm_hw_params_t *params)
+static int hw_refine_rules(snd_pcm_t *pcm ATTRIBUTE_UNUSED, snd_pcm_hw_params_t *params)
 {
 	unsigned int k;
 	snd_interval_t *i;
@@ -2185,6 +2189,114 @@ int snd_pcm_hw_refine_soft(snd_pcm_t *pcm ATTRIBUTE_UNUSED, snd_pcm_hw_params_t
 	return changed;
 }
 
+#ifdef RULES_DEBUG
+/* log every refinement, no cache */
+int snd_pcm_hw_refine_soft(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
+{
+	return hw_refine_rules(pcm, params);
+}
+#else
+/*
+ * The result of the rules refinement depends only on the passed params,
+ * but the same requests are refined over and over: at every level of
+ * a plugin chain, in every iteration of snd_pcm_hw_refine_slave() and
+ * again on each open of the same PCM.  Remember the recent results in
+ * a small per-process table indexed by a hash of the request.  The
+ * table is freed by snd_config_update_free_global().
+ *
+ * Only the leading part of the structure up to fifo_size is read or
+ * written by the refinement, so only that part is used as the key.
+ */
+#define REFINE_CACHE_SIZE	32
+#define REFINE_CACHE_BYTES	offsetof(snd_pcm_hw_params_t, fifo_size)
+
+typedef struct {
+	unsigned int hash;
+	int err;
+	snd_pcm_hw_params_t req;
+	snd_pcm_hw_params_t res;
+} refine_cache_entry_t;
+
+static refine_cache_entry_t *refine_cache;
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t refine_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline void refine_cache_lock(void)
+{
+	pthread_mutex_lock(&refine_cache_mutex);
+}
+
+static inline void refine_cache_unlock(void)
+{
+	pthread_mutex_unlock(&refine_cache_mutex);
+}
+#else
+static inline void refine_cache_lock(void) {}
+static inline void refine_cache_unlock(void) {}
+#endif
+
+static unsigned int refine_cache_hash(const snd_pcm_hw_params_t *params)
+{
+	const unsigned int *p = (const unsigned int *)params;
+	unsigned int n = REFINE_CACHE_BYTES / sizeof(*p);
+	unsigned int hash = 2166136261U;
+
+	while (n--)
+		hash = (hash ^ *p++) * 16777619U;
+	return hash ? hash : 1;
+}
+
+int snd_pcm_hw_refine_soft(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
+{
+	snd_pcm_hw_params_t req;
+	refine_cache_entry_t *e;
+	unsigned int hash;
+	int err;
+
+	hash = refine_cache_hash(params);
+	refine_cache_lock();
+	if (!refine_cache)
+		refine_cache = calloc(REFINE_CACHE_SIZE, sizeof(*refine_cache));
+	if (refine_cache) {
+		e = &refine_cache[hash % REFINE_CACHE_SIZE];
+		if (e->hash == hash &&
+		    !memcmp(&e->req, params, REFINE_CACHE_BYTES)) {
+			memcpy(params, &e->res, REFINE_CACHE_BYTES);
+			err = e->err;
+			refine_cache_unlock();
+			return err;
+		}
+	}
+	refine_cache_unlock();
+
+	memcpy(&req, params, REFINE_CACHE_BYTES);
+	err = hw_refine_rules(pcm, params);
+
+	refine_cache_lock();
+	if (refine_cache) {
+		e = &refine_cache[hash % REFINE_CACHE_SIZE];
+		e->hash = hash;
+		e->err = err;
+		memcpy(&e->req, &req, REFINE_CACHE_BYTES);
+		memcpy(&e->res, params, REFINE_CACHE_BYTES);
+	}
+	refine_cache_unlock();
+	return err;
+}
+#endif /* RULES_DEBUG */
+
+/* free the cache with the global configuration */
+void snd_pcm_hw_refine_cache_free(void)
+{
+#ifndef RULES_DEBUG
+	refine_cache_lock();
+	free(refine_cache);
+	refine_cache = NULL;
+	refine_cache_unlock();
+#endif
+}
+
 int _snd_pcm_hw_params_refine(snd_pcm_hw_params_t *params,
 			      unsigned int vars,
 			      const snd_pcm_hw_params_t *src)
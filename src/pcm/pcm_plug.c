@@ -372,44 +372,17 @@ typedef struct {
 } snd_pcm_plug_params_t;
 #endif
 
-#ifdef BUILD_PCM_PLUGIN_RATE
-static int snd_pcm_plug_change_rate(snd_pcm_t *pcm, snd_pcm_t **new, snd_pcm_plug_params_t *clt, snd_pcm_plug_params_t *slv)
-{
-	snd_pcm_plug_t *plug = pcm->private_data;
-	int err;
-	if (clt->rate == slv->rate)
-		return 0;
-	assert(snd_pcm_format_linear(slv->format));
-	err = snd_pcm_rate_open(new, NULL, slv->format, slv->rate, plug->rate_converter,
-				plug->gen.slave, plug->gen.slave != plug->req_slave);
-	if (err < 0)
-		return err;
-	slv->access = clt->access;
-	slv->rate = clt->rate;
-	if (snd_pcm_format_linear(clt->format))
-		slv->format = clt->format;
-	return 1;
-}
-#endif
-
 #ifdef BUILD_PCM_PLUGIN_ROUTE
-static int snd_pcm_plug_change_channels(snd_pcm_t *pcm, snd_pcm_t **new, snd_pcm_plug_params_t *clt, snd_pcm_plug_params_t *slv)
+/* fill the transfer table of clt->channels * slv->channels entries */
+static void snd_pcm_plug_fill_ttable(snd_pcm_t *pcm,
+				     snd_pcm_route_ttable_entry_t *ttable,
+				     snd_pcm_plug_params_t *clt,
+				     snd_pcm_plug_params_t *slv)
 {
 	snd_pcm_plug_t *plug = pcm->private_data;
-	unsigned int tt_ssize, tt_cused, tt_sused;
-	snd_pcm_route_ttable_entry_t *ttable;
-	int err;
-	if (clt->channels == slv->channels &&
-	    (!plug->ttable || plug->ttable_ok))
-		return 0;
-	if (clt->rate != slv->rate &&
-	    clt->channels > slv->channels)
-		return 0;
-	assert(snd_pcm_format_linear(slv->format));
-	tt_ssize = slv->channels;
-	tt_cused = clt->channels;
-	tt_sused = slv->channels;
-	ttable = alloca(tt_cused * tt_sused * sizeof(*ttable));
+	unsigned int tt_ssize = slv->channels;
+	unsigned int tt_cused = clt->channels;
+	unsigned int tt_sused = slv->channels;
 	if (plug->ttable) {	/* expand or shrink table */
 		unsigned int c = 0, s = 0;
 		for (c = 0; c < tt_cused; c++) {
@@ -484,12 +457,81 @@ static int snd_pcm_plug_change_channels(snd_pcm_t *pcm, snd_pcm_t **new, snd_pcm
 			break;
 		}
 	}
+}
+#endif
+
+#ifdef BUILD_PCM_PLUGIN_RATE
+static int snd_pcm_plug_change_rate(snd_pcm_t *pcm, snd_pcm_t **new, snd_pcm_plug_params_t *clt, snd_pcm_plug_params_t *slv)
+{
+	snd_pcm_plug_t *plug = pcm->private_data;
+	int err;
+	if (clt->rate == slv->rate)
+		return 0;
+	assert(snd_pcm_format_linear(slv->format));
+#ifdef BUILD_PCM_PLUGIN_ROUTE
+	/* route the channels in the conversion pass, the float samples
+	 * are still downmixed in float by a route PCM on top
+	 */
+	if ((clt->channels != slv->channels ||
+	     (plug->ttable && !plug->ttable_ok)) &&
+	    (snd_pcm_format_linear(clt->format) ||
+	     clt->channels <= slv->channels)) {
+		snd_pcm_route_ttable_entry_t *ttable;
+		ttable = alloca(clt->channels * slv->channels * sizeof(*ttable));
+		snd_pcm_plug_fill_ttable(pcm, ttable, clt, slv);
+		err = snd_pcm_rate_route_open(new, NULL, slv->format, slv->rate,
+					      slv->channels, ttable,
+					      slv->channels, clt->channels,
+					      slv->channels,
+					      plug->rate_converter,
+					      plug->gen.slave,
+					      plug->gen.slave != plug->req_slave);
+		if (err < 0)
+			return err;
+		slv->channels = clt->channels;
+	} else
+#endif
+	{
+		err = snd_pcm_rate_open(new, NULL, slv->format, slv->rate, plug->rate_converter,
+					plug->gen.slave, plug->gen.slave != plug->req_slave);
+		if (err < 0)
+			return err;
+	}
+	slv->access = clt->access;
+	slv->rate = clt->rate;
+	if (snd_pcm_format_linear(clt->format))
+		slv->format = clt->format;
+	return 1;
+}
+#endif
+
+#ifdef BUILD_PCM_PLUGIN_ROUTE
+static int snd_pcm_plug_change_channels(snd_pcm_t *pcm, snd_pcm_t **new, snd_pcm_plug_params_t *clt, snd_pcm_plug_params_t *slv)
+{
+	snd_pcm_plug_t *plug = pcm->private_data;
+	unsigned int tt_ssize, tt_cused, tt_sused;
+	snd_pcm_route_ttable_entry_t *ttable;
+	int err;
+	if (clt->channels == slv->channels &&
+	    (!plug->ttable || plug->ttable_ok))
+		return 0;
+	/* the rate plugin routes the channels while converting */
+	if (clt->rate != slv->rate)
+		return 0;
+	assert(snd_pcm_route_format_ok(slv->format));
+	tt_ssize = slv->channels;
+	tt_cused = clt->channels;
+	tt_sused = slv->channels;
+	ttable = alloca(tt_cused * tt_sused * sizeof(*ttable));
+	snd_pcm_plug_fill_ttable(pcm, ttable, clt, slv);
 	err = snd_pcm_route_open(new, NULL, slv->format, (int) slv->channels, ttable, tt_ssize, tt_cused, tt_sused, plug->gen.slave, plug->gen.slave != plug->req_slave);
 	if (err < 0)
 		return err;
 	slv->channels = clt->channels;
 	slv->access = clt->access;
-	if (snd_pcm_format_linear(clt->format))
+	/* the rate plugin takes only the linear formats */
+	if (snd_pcm_format_linear(clt->format) ||
+	    (clt->rate == slv->rate && snd_pcm_route_format_ok(clt->format)))
 		slv->format = clt->format;
 	return 1;
 }
@@ -560,6 +602,15 @@ static int snd_pcm_plug_change_format(snd_pcm_t *pcm, snd_pcm_t **new, snd_pcm_p
 				f = snd_pcm_linear_open;
 			break;
 		}
+#ifdef BUILD_PCM_PLUGIN_ROUTE
+	} else if (snd_pcm_route_format_ok(slv->format) &&
+		   snd_pcm_route_format_ok(clt->format) &&
+		   clt->rate == slv->rate &&
+		   (clt->channels != slv->channels ||
+		    (plug->ttable && !plug->ttable_ok))) {
+		/* The float samples are converted by the route plugin */
+		return 0;
+#endif
 #ifdef BUILD_PCM_PLUGIN_LFLOAT
 	} else if (snd_pcm_format_float(slv->format)) {
 		if (snd_pcm_format_linear(clt->format)) {
@@ -1239,6 +1290,11 @@ pcm.name {
 }
 \endcode
 
+When both the rate and the channels have to be converted, the channels
+are routed by the rate plugin in its conversion pass; no separate route
+plugin is inserted, except for downmixing float samples, which are
+still mixed in float.
+
 \subsection pcm_plugins_plug_funcref Function reference
 
 <UL>
@@ -100,6 +100,10 @@ snd_pcm_sframes_t snd_pcm_plugin_undo_write_generic
 #define snd_pcm_mulaw_encode	snd1_pcm_mulaw_encode
 #define snd_pcm_adpcm_decode	snd1_pcm_adpcm_decode
 #define snd_pcm_adpcm_encode	snd1_pcm_adpcm_encode
+#define snd_pcm_simd_linear_convert	snd1_pcm_simd_linear_convert
+#define snd_pcm_simd_linear_getput	snd1_pcm_simd_linear_getput
+#define snd_pcm_simd_integer_float	snd1_pcm_simd_integer_float
+#define snd_pcm_simd_float_integer	snd1_pcm_simd_float_integer
 
 int snd_pcm_linear_get_index(snd_pcm_format_t src_format, snd_pcm_format_t dst_format);
 int snd_pcm_linear_put_index(snd_pcm_format_t src_format, snd_pcm_format_t dst_format);
@@ -113,6 +117,25 @@ void snd_pcm_linear_getput(const snd_pcm_channel_area_t *dst_areas, snd_pcm_ufra
 			   const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
 			   unsigned int channels, snd_pcm_uframes_t frames,
 			   unsigned int get_idx, unsigned int put_idx);
+/* vectorized conversions (pcm_simd.c), -EINVAL when the areas or the
+ * formats aren't handled
+ */
+int snd_pcm_simd_linear_convert(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_t dst_offset,
+				const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
+				unsigned int channels, snd_pcm_uframes_t frames,
+				unsigned int convidx);
+int snd_pcm_simd_linear_getput(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_t dst_offset,
+			       const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
+			       unsigned int channels, snd_pcm_uframes_t frames,
+			       unsigned int get_idx, unsigned int put_idx);
+int snd_pcm_simd_integer_float(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_t dst_offset,
+			       const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
+			       unsigned int channels, snd_pcm_uframes_t frames,
+			       unsigned int get32idx, unsigned int put32floatidx);
+int snd_pcm_simd_float_integer(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_t dst_offset,
+			       const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
+			       unsigned int channels, snd_pcm_uframes_t frames,
+			       unsigned int put32idx, unsigned int get32floatidx);
 void snd_pcm_alaw_decode(const snd_pcm_channel_area_t *dst_areas,
 			 snd_pcm_uframes_t dst_offset,
 			 const snd_pcm_channel_area_t *src_areas,
@@ -157,3 +180,62 @@ void snd_pcm_adpcm_encode(const snd_pcm_channel_area_t *dst_areas,
 			  unsigned int channels, snd_pcm_uframes_t frames,
 			  unsigned int getidx,
 			  snd_pcm_adpcm_state_t *states);
+
+/* formats the route plugin handles without a format conversion plugin */
+static inline int snd_pcm_route_format_ok(snd_pcm_format_t format)
+{
+#if SND_PCM_PLUGIN_ROUTE_FLOAT
+	if (format == SND_PCM_FORMAT_FLOAT || format == SND_PCM_FORMAT_FLOAT64)
+		return 1;
+#endif
+	return snd_pcm_format_linear(format) == 1;
+}
+
+/* channel routing of the route plugin, also used by the rate plugin
+ * to route the channels in its conversion pass
+ */
+typedef struct _snd_pcm_route_params snd_pcm_route_params_t;
+
+#define snd_pcm_route_params_new	snd1_pcm_route_params_new
+#define snd_pcm_route_params_setup	snd1_pcm_route_params_setup
+#define snd_pcm_route_params_convert	snd1_pcm_route_params_convert
+#define snd_pcm_route_params_chmap	snd1_pcm_route_params_chmap
+#define snd_pcm_route_params_dump	snd1_pcm_route_params_dump
+#define snd_pcm_route_params_free	snd1_pcm_route_params_free
+
+int snd_pcm_route_params_new(snd_pcm_route_params_t **paramsp,
+			     snd_pcm_stream_t stream,
+			     snd_pcm_route_ttable_entry_t *ttable,
+			     unsigned int tt_ssize,
+			     unsigned int tt_cused, unsigned int tt_sused);
+int snd_pcm_route_params_setup(snd_pcm_route_params_t *params,
+			       snd_pcm_format_t src_format,
+			       unsigned int src_channels,
+			       snd_pcm_format_t dst_format,
+			       unsigned int dst_channels,
+			       int use_float);
+void snd_pcm_route_params_convert(const snd_pcm_channel_area_t *dst_areas,
+				  snd_pcm_uframes_t dst_offset,
+				  const snd_pcm_channel_area_t *src_areas,
+				  snd_pcm_uframes_t src_offset,
+				  unsigned int src_channels,
+				  unsigned int dst_channels,
+				  snd_pcm_uframes_t frames,
+				  snd_pcm_route_params_t *params);
+snd_pcm_chmap_t *snd_pcm_route_params_chmap(const snd_pcm_route_params_t *params,
+					    const snd_pcm_chmap_t *slave_map);
+void snd_pcm_route_params_dump(const snd_pcm_route_params_t *params,
+			       snd_output_t *out);
+void snd_pcm_route_params_free(snd_pcm_route_params_t *params);
+
+/* rate conversion with channel routing, schannels are the slave channels */
+#define snd_pcm_rate_route_open	snd1_pcm_rate_route_open
+
+int snd_pcm_rate_route_open(snd_pcm_t **pcmp, const char *name,
+			    snd_pcm_format_t sformat, unsigned int srate,
+			    unsigned int schannels,
+			    snd_pcm_route_ttable_entry_t *ttable,
+			    unsigned int tt_ssize,
+			    unsigned int tt_cused, unsigned int tt_sused,
+			    const snd_config_t *converter,
+			    snd_pcm_t *slave, int close_slave);
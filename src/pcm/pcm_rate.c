@@ -55,6 +55,9 @@ struct _snd_pcm_rate {
 	snd_pcm_sw_params_t sw_params;
 	snd_pcm_format_t sformat;
 	unsigned int srate;
+	unsigned int schannels;		/* slave channels with the routing */
+	snd_pcm_route_params_t *route;	/* channel routing, NULL = none */
+	int route_in;			/* routed before the converter */
 	snd_pcm_channel_area_t *pareas;	/* areas for splitted period (rate pcm) */
 	snd_pcm_channel_area_t *sareas;	/* areas for splitted period (slave pcm) */
 	snd_pcm_rate_info_t info;
@@ -74,9 +77,29 @@ struct _snd_pcm_rate {
 	uint64_t in_formats;
 	uint64_t out_formats;
 	unsigned int format_flags;
+	/* drift compensation (playback), see snd_pcm_rate_set_drift() */
+	int drift;			/* enabled by the config or the API */
+	long drift_ppb;			/* requested correction */
+	long drift_cur;			/* slewed correction in use */
+	snd_pcm_uframes_t drift_fill;	/* target fill level, 0 = off */
+	long long drift_acc;		/* fraction of a frame, in 1e-9 frames */
+	long long drift_isum;		/* integral of the fill level error */
+	int drift_next;			/* extra input frames of the next period */
+	int drift_pitch;		/* delta the converter is adjusted to */
+	int drift_max;			/* max. extra frames per period, 0 = off */
+	short *drift_queue;		/* deltas of the committed periods */
+	unsigned int drift_queue_size;
+	unsigned int drift_queue_head;
+	unsigned int drift_queue_len;
 };
 
 #define SND_PCM_RATE_PLUGIN_VERSION_OLD	0x010001	/* old rate plugin */
+
+#define DRIFT_NS		1000000000LL
+#define DRIFT_MAX_PPB		1000000		/* 1000 ppm */
+#define DRIFT_SLEW_PPB		100000		/* max. change per second */
+#define DRIFT_TP		2		/* fill level controller, seconds */
+#define DRIFT_TI		8
 #endif /* DOC_HIDDEN */
 
 /* allocate a channel area and a temporary buffer for the given size */
@@ -99,8 +122,8 @@ rate_alloc_tmp_buf(snd_pcm_format_t format,
 
 	/* set up in interleaved format */
 	for (i = 0; i < channels; i++) {
-		ap[i].addr = ap[0].addr + (i * width) / 8;
-		ap[i].first = 0;
+		ap[i].addr = ap[0].addr;
+		ap[i].first = i * width;
 		ap[i].step = width * channels;
 	}
 
@@ -128,6 +151,10 @@ static int snd_pcm_rate_hw_refine_cprepare(snd_pcm_t *pcm ATTRIBUTE_UNUSED, snd_
 					 &access_mask);
 	if (err < 0)
 		return err;
+	/* float can be passed only as is, there is no conversion from it */
+	if (rate->sformat == SND_PCM_FORMAT_UNKNOWN &&
+	    (rate->in_formats & rate->out_formats & (1ULL << SND_PCM_FORMAT_FLOAT)))
+		snd_pcm_format_mask_set(&format_mask, SND_PCM_FORMAT_FLOAT);
 	err = _snd_pcm_hw_param_set_mask(params, SND_PCM_HW_PARAM_FORMAT,
 					 &format_mask);
 	if (err < 0)
@@ -164,6 +191,9 @@ static int snd_pcm_rate_hw_refine_sprepare(snd_pcm_t *pcm, snd_pcm_hw_params_t *
 	}
 	_snd_pcm_hw_param_set_minmax(sparams, SND_PCM_HW_PARAM_RATE,
 				     rate->srate, 0, rate->srate + 1, -1);
+	if (rate->route)
+		_snd_pcm_hw_param_set(sparams, SND_PCM_HW_PARAM_CHANNELS,
+				      rate->schannels, 0);
 	return 0;
 }
 
@@ -174,14 +204,17 @@ static int snd_pcm_rate_hw_refine_schange(snd_pcm_t *pcm, snd_pcm_hw_params_t *p
 	snd_interval_t t, buffer_size;
 	const snd_interval_t *srate, *crate;
 	int err;
-	unsigned int links = (SND_PCM_HW_PARBIT_CHANNELS |
-			      SND_PCM_HW_PARBIT_PERIOD_TIME |
+	unsigned int links = (SND_PCM_HW_PARBIT_PERIOD_TIME |
 			      SND_PCM_HW_PARBIT_TICK_TIME);
-	if (rate->sformat == SND_PCM_FORMAT_UNKNOWN)
+	if (!rate->route)
+		links |= SND_PCM_HW_PARBIT_CHANNELS;
+	if (rate->sformat == SND_PCM_FORMAT_UNKNOWN) {
 		links |= (SND_PCM_HW_PARBIT_FORMAT |
 			  SND_PCM_HW_PARBIT_SUBFORMAT |
-			  SND_PCM_HW_PARBIT_SAMPLE_BITS |
-			  SND_PCM_HW_PARBIT_FRAME_BITS);
+			  SND_PCM_HW_PARBIT_SAMPLE_BITS);
+		if (!rate->route)
+			links |= SND_PCM_HW_PARBIT_FRAME_BITS;
+	}
 	snd_interval_copy(&buffer_size, snd_pcm_hw_param_get_interval(params, SND_PCM_HW_PARAM_BUFFER_SIZE));
 	snd_interval_unfloor(&buffer_size);
 	crate = snd_pcm_hw_param_get_interval(params, SND_PCM_HW_PARAM_RATE);
@@ -207,14 +240,17 @@ static int snd_pcm_rate_hw_refine_cchange(snd_pcm_t *pcm, snd_pcm_hw_params_t *p
 	const snd_interval_t *sbuffer_size, *buffer_size;
 	const snd_interval_t *srate, *crate;
 	int err;
-	unsigned int links = (SND_PCM_HW_PARBIT_CHANNELS |
-			      SND_PCM_HW_PARBIT_PERIOD_TIME |
+	unsigned int links = (SND_PCM_HW_PARBIT_PERIOD_TIME |
 			      SND_PCM_HW_PARBIT_TICK_TIME);
-	if (rate->sformat == SND_PCM_FORMAT_UNKNOWN)
+	if (!rate->route)
+		links |= SND_PCM_HW_PARBIT_CHANNELS;
+	if (rate->sformat == SND_PCM_FORMAT_UNKNOWN) {
 		links |= (SND_PCM_HW_PARBIT_FORMAT |
 			  SND_PCM_HW_PARBIT_SUBFORMAT |
-			  SND_PCM_HW_PARBIT_SAMPLE_BITS |
-			  SND_PCM_HW_PARBIT_FRAME_BITS);
+			  SND_PCM_HW_PARBIT_SAMPLE_BITS);
+		if (!rate->route)
+			links |= SND_PCM_HW_PARBIT_FRAME_BITS;
+	}
 	sbuffer_size = snd_pcm_hw_param_get_interval(sparams, SND_PCM_HW_PARAM_BUFFER_SIZE);
 	crate = snd_pcm_hw_param_get_interval(params, SND_PCM_HW_PARAM_RATE);
 	srate = snd_pcm_hw_param_get_interval(sparams, SND_PCM_HW_PARAM_RATE);
@@ -287,6 +323,9 @@ static int get_best_format(uint64_t mask, snd_pcm_format_t orig)
 	int match = -1;
 	int f, score;
 
+	/* an unchanged format needs no conversion */
+	if ((unsigned int)orig < 64 && (mask & (1ULL << orig)))
+		return orig;
 	for (f = 0; f <= SND_PCM_FORMAT_LAST; f++) {
 		if (!(mask & (1ULL << f)))
 			continue;
@@ -315,11 +354,20 @@ static int choose_preferred_format(snd_pcm_rate_t *rate)
 {
 	uint64_t in_mask = rate->in_formats;
 	uint64_t out_mask = rate->out_formats;
+	uint64_t float_mask = 1ULL << SND_PCM_FORMAT_FLOAT;
 	int in, out;
 
 	if (!in_mask || !out_mask)
 		return 0;
 
+	/* only linear formats can be converted to the converter format */
+	if (rate->orig_in_format != SND_PCM_FORMAT_FLOAT)
+		in_mask &= ~float_mask;
+	if (rate->orig_out_format != SND_PCM_FORMAT_FLOAT)
+		out_mask &= ~float_mask;
+	if (!in_mask || !out_mask)
+		return -ENOENT;
+
 	if (rate->orig_in_format == rate->orig_out_format)
 		if (in_mask & out_mask & (1ULL << rate->orig_in_format))
 			return 0; /* nothing changed */
@@ -348,12 +396,53 @@ static int choose_preferred_format(snd_pcm_rate_t *rate)
 	return 0;
 }
 
+/*
+ * The drift compensation converts up to drift_max more client frames
+ * per period, the split period buffer is reallocated for them.
+ */
+static int snd_pcm_rate_drift_setup(snd_pcm_t *pcm, snd_pcm_format_t format,
+				    unsigned int channels,
+				    snd_pcm_uframes_t period_size)
+{
+	snd_pcm_rate_t *rate = pcm->private_data;
+	snd_pcm_t *slave = rate->gen.slave;
+	snd_pcm_channel_area_t *pareas;
+	unsigned int queue_size;
+	short *queue;
+
+	if (pcm->stream != SND_PCM_STREAM_PLAYBACK || !rate->ops.adjust_pitch)
+		return 0;
+	queue_size = slave->buffer_size / slave->period_size + 1;
+	queue = calloc(queue_size, sizeof(*queue));
+	if (!queue)
+		return -ENOMEM;
+	pareas = rate_alloc_tmp_buf(format, channels,
+				    period_size + period_size / 512 + 1);
+	if (!pareas) {
+		free(queue);
+		return -ENOMEM;
+	}
+	rate_free_tmp_buf(&rate->pareas);
+	rate->pareas = pareas;
+	free(rate->drift_queue);
+	rate->drift_queue = queue;
+	rate->drift_queue_size = queue_size;
+	rate->drift_queue_head = 0;
+	rate->drift_queue_len = 0;
+	rate->drift_acc = 0;
+	rate->drift_next = 0;
+	rate->drift_max = period_size / 512 + 1;
+	return 0;
+}
+
 static int snd_pcm_rate_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 {
 	snd_pcm_rate_t *rate = pcm->private_data;
 	snd_pcm_t *slave = rate->gen.slave;
 	snd_pcm_rate_side_info_t *sinfo, *cinfo;
 	unsigned int channels, acc;
+	unsigned int in_channels, out_channels;
+	snd_pcm_format_t route_format = SND_PCM_FORMAT_UNKNOWN;
 	int need_src_buf, need_dst_buf;
 	int err = snd_pcm_hw_params_slave(pcm, params,
 					  snd_pcm_rate_hw_refine_cchange,
@@ -389,7 +478,16 @@ static int snd_pcm_rate_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 	if (err < 0)
 		return err;
 
-	rate->info.channels = channels;
+	if (pcm->stream == SND_PCM_STREAM_PLAYBACK) {
+		in_channels = channels;
+		out_channels = slave->channels;
+	} else {
+		in_channels = slave->channels;
+		out_channels = channels;
+	}
+	/* convert the rate of the fewer channels */
+	rate->route_in = in_channels > out_channels;
+	rate->info.channels = rate->route_in ? out_channels : in_channels;
 	sinfo->format = slave->format;
 	sinfo->rate = slave->rate;
 	sinfo->buffer_size = slave->buffer_size;
@@ -400,15 +498,35 @@ static int snd_pcm_rate_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 		return -EBUSY;
 	}
 
+	rate->drift_max = 0;
+	rate->drift_pitch = 0;
 	rate->pareas = rate_alloc_tmp_buf(cinfo->format, channels,
 					  cinfo->period_size);
-	rate->sareas = rate_alloc_tmp_buf(sinfo->format, channels,
+	rate->sareas = rate_alloc_tmp_buf(sinfo->format, slave->channels,
 					  sinfo->period_size);
 	if (!rate->pareas || !rate->sareas) {
 		err = -ENOMEM;
 		goto error_pareas;
 	}
+	if (rate->drift) {
+		err = snd_pcm_rate_drift_setup(pcm, cinfo->format, channels,
+					       cinfo->period_size);
+		if (err < 0)
+			goto error_pareas;
+	}
 
+	/* the routing converts the format of its side, the converter
+	 * then takes the format of the other side
+	 */
+	if (rate->route) {
+		if (rate->route_in) {
+			route_format = rate->info.in.format;
+			rate->info.in.format = rate->info.out.format;
+		} else {
+			route_format = rate->info.out.format;
+			rate->info.out.format = rate->info.in.format;
+		}
+	}
 	rate->orig_in_format = rate->info.in.format;
 	rate->orig_out_format = rate->info.out.format;
 	if (choose_preferred_format(rate) < 0) {
@@ -425,6 +543,13 @@ static int snd_pcm_rate_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 	rate_free_tmp_buf(&rate->dst_buf);
 
 	need_src_buf = need_dst_buf = 0;
+	if (rate->route) {
+		/* the routing writes to src_buf or reads from dst_buf */
+		if (rate->route_in)
+			need_src_buf = 1;
+		else
+			need_dst_buf = 1;
+	}
 
 	if ((rate->format_flags & SND_PCM_RATE_FLAG_INTERLEAVED) &&
 	    !(acc == SND_PCM_ACCESS_MMAP_INTERLEAVED ||
@@ -438,11 +563,14 @@ static int snd_pcm_rate_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 	}
 
 	if (need_src_buf) {
-		rate->src_conv_idx =
-			snd_pcm_linear_convert_index(rate->orig_in_format,
-						     rate->info.in.format);
+		if (rate->orig_in_format != rate->info.in.format)
+			rate->src_conv_idx =
+				snd_pcm_linear_convert_index(rate->orig_in_format,
+							     rate->info.in.format);
 		rate->src_buf = rate_alloc_tmp_buf(rate->info.in.format,
-						   channels, rate->info.in.period_size);
+						   rate->info.channels,
+						   rate->info.in.period_size +
+						   rate->drift_max);
 		if (!rate->src_buf) {
 			err = -ENOMEM;
 			goto error;
@@ -450,17 +578,38 @@ static int snd_pcm_rate_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 	}
 
 	if (need_dst_buf) {
-		rate->dst_conv_idx =
-			snd_pcm_linear_convert_index(rate->info.out.format,
-						     rate->orig_out_format);
+		if (rate->orig_out_format != rate->info.out.format)
+			rate->dst_conv_idx =
+				snd_pcm_linear_convert_index(rate->info.out.format,
+							     rate->orig_out_format);
 		rate->dst_buf = rate_alloc_tmp_buf(rate->info.out.format,
-						   channels, rate->info.out.period_size);
+						   rate->info.channels,
+						   rate->info.out.period_size);
 		if (!rate->dst_buf) {
 			err = -ENOMEM;
 			goto error;
 		}
 	}
 
+#ifdef BUILD_PCM_PLUGIN_ROUTE
+	if (rate->route) {
+		if (rate->route_in)
+			err = snd_pcm_route_params_setup(rate->route,
+							 route_format,
+							 in_channels,
+							 rate->info.in.format,
+							 rate->info.channels, 0);
+		else
+			err = snd_pcm_route_params_setup(rate->route,
+							 rate->info.out.format,
+							 rate->info.channels,
+							 route_format,
+							 out_channels, 0);
+		if (err < 0)
+			goto error;
+	}
+#endif
+
 	return 0;
 
  error:
@@ -485,6 +634,9 @@ static int snd_pcm_rate_hw_free(snd_pcm_t *pcm)
 		rate->ops.free(rate->obj);
 	rate_free_tmp_buf(&rate->src_buf);
 	rate_free_tmp_buf(&rate->dst_buf);
+	free(rate->drift_queue);
+	rate->drift_queue = NULL;
+	rate->drift_max = 0;
 	return snd_pcm_hw_free(rate->gen.slave);
 }
 
@@ -554,6 +706,101 @@ static int snd_pcm_rate_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t * params)
 	return snd_pcm_sw_params(slave, sparams);
 }
 
+/*
+ * Drift compensation
+ *
+ * The converter works on whole periods, so the ratio is corrected by
+ * converting sometimes a period with one frame more or less from the
+ * client buffer to a slave period.  The converter pitch is adjusted for
+ * such a period, which spreads the extra frame over the whole period.
+ * The deltas of the committed periods are queued until the slave hw_ptr
+ * passes them, so that the client hw_ptr follows the consumed frames.
+ */
+static int snd_pcm_rate_drift_pitch(snd_pcm_rate_t *rate, int delta)
+{
+	snd_pcm_rate_info_t info;
+	int err;
+
+	if (delta == rate->drift_pitch)
+		return 0;
+	info = rate->info;
+	info.in.period_size += delta;
+	err = rate->ops.adjust_pitch(rate->obj, &info);
+	if (err < 0) {
+		rate->ops.adjust_pitch(rate->obj, &rate->info);
+		delta = 0;
+	}
+	rate->drift_pitch = delta;
+	return err;
+}
+
+static void snd_pcm_rate_drift_push(snd_pcm_rate_t *rate, int delta)
+{
+	assert(rate->drift_queue_len < rate->drift_queue_size);
+	rate->drift_queue[(rate->drift_queue_head + rate->drift_queue_len) %
+			  rate->drift_queue_size] = delta;
+	rate->drift_queue_len++;
+}
+
+static long snd_pcm_rate_drift_pop(snd_pcm_rate_t *rate, snd_pcm_uframes_t periods)
+{
+	long frames = 0;
+
+	while (periods-- > 0 && rate->drift_queue_len > 0) {
+		frames += rate->drift_queue[rate->drift_queue_head];
+		rate->drift_queue_head = (rate->drift_queue_head + 1) %
+			rate->drift_queue_size;
+		rate->drift_queue_len--;
+	}
+	return frames;
+}
+
+/* evaluate the extra frames of the next period */
+static void snd_pcm_rate_drift_update(snd_pcm_t *pcm)
+{
+	snd_pcm_rate_t *rate = pcm->private_data;
+	long long period = pcm->period_size;
+	long long target = rate->drift_ppb;
+	long long step, delta;
+
+	if (rate->drift_fill) {
+		/* PI controller on the buffer fill level */
+		long long r = pcm->rate;
+		long long err = (long long)snd_pcm_mmap_playback_hw_avail(pcm) -
+			(long long)rate->drift_fill;
+		long long imax = DRIFT_MAX_PPB * r * r / (DRIFT_NS / (DRIFT_TI * DRIFT_TI));
+
+		rate->drift_isum += err * period;
+		if (rate->drift_isum > imax)
+			rate->drift_isum = imax;
+		else if (rate->drift_isum < -imax)
+			rate->drift_isum = -imax;
+		target = err * DRIFT_NS / (r * DRIFT_TP) +
+			rate->drift_isum * (DRIFT_NS / (DRIFT_TI * DRIFT_TI)) / (r * r);
+		if (target > DRIFT_MAX_PPB)
+			target = DRIFT_MAX_PPB;
+		else if (target < -DRIFT_MAX_PPB)
+			target = -DRIFT_MAX_PPB;
+	}
+
+	step = DRIFT_SLEW_PPB * period / pcm->rate + 1;
+	if (target > rate->drift_cur + step)
+		rate->drift_cur += step;
+	else if (target < rate->drift_cur - step)
+		rate->drift_cur -= step;
+	else
+		rate->drift_cur = target;
+
+	rate->drift_acc += rate->drift_cur * period;
+	delta = rate->drift_acc / DRIFT_NS;
+	if (delta > rate->drift_max)
+		delta = rate->drift_max;
+	else if (delta < -rate->drift_max)
+		delta = -rate->drift_max;
+	rate->drift_acc -= delta * DRIFT_NS;
+	rate->drift_next = delta;
+}
+
 static int snd_pcm_rate_init(snd_pcm_t *pcm)
 {
 	snd_pcm_rate_t *rate = pcm->private_data;
@@ -562,18 +809,28 @@ static int snd_pcm_rate_init(snd_pcm_t *pcm)
 		rate->ops.reset(rate->obj);
 	rate->last_commit_ptr = 0;
 	rate->start_pending = 0;
+	if (rate->drift_max) {
+		snd_pcm_rate_drift_pitch(rate, 0);
+		rate->drift_acc = 0;
+		rate->drift_isum = 0;
+		rate->drift_next = 0;
+		rate->drift_queue_head = 0;
+		rate->drift_queue_len = 0;
+	}
 	return 0;
 }
 
 static void do_convert(const snd_pcm_channel_area_t *dst_areas,
 		       snd_pcm_uframes_t dst_offset, unsigned int dst_frames,
+		       unsigned int dst_channels,
 		       const snd_pcm_channel_area_t *src_areas,
 		       snd_pcm_uframes_t src_offset, unsigned int src_frames,
-		       unsigned int channels,
+		       unsigned int src_channels,
 		       snd_pcm_rate_t *rate)
 {
 	const snd_pcm_channel_area_t *out_areas;
 	snd_pcm_uframes_t out_offset;
+	unsigned int channels = rate->info.channels;
 
 	if (rate->dst_buf) {
 		out_areas = rate->dst_buf;
@@ -584,28 +841,70 @@ static void do_convert(const snd_pcm_channel_area_t *dst_areas,
 	}
 
 	if (rate->src_buf) {
-		snd_pcm_linear_convert(rate->src_buf, 0,
-				       src_areas, src_offset,
-				       channels, src_frames,
-				       rate->src_conv_idx);
+#ifdef BUILD_PCM_PLUGIN_ROUTE
+		if (rate->route && rate->route_in)
+			snd_pcm_route_params_convert(rate->src_buf, 0,
+						     src_areas, src_offset,
+						     src_channels, channels,
+						     src_frames, rate->route);
+		else
+#endif
+		if (rate->orig_in_format == rate->info.in.format)
+			snd_pcm_areas_copy(rate->src_buf, 0,
+					   src_areas, src_offset,
+					   channels, src_frames,
+					   rate->info.in.format);
+		else
+			snd_pcm_linear_convert(rate->src_buf, 0,
+					       src_areas, src_offset,
+					       channels, src_frames,
+					       rate->src_conv_idx);
 		src_areas = rate->src_buf;
 		src_offset = 0;
 	}
 
-	if (rate->ops.convert)
+	if (rate->ops.convert) {
 		rate->ops.convert(rate->obj, out_areas, out_offset, dst_frames,
 				   src_areas, src_offset, src_frames);
-	else
-		rate->ops.convert_s16(rate->obj,
-				      snd_pcm_channel_area_addr(out_areas, out_offset),
-				      dst_frames,
-				      snd_pcm_channel_area_addr(src_areas, src_offset),
-				      src_frames);
-	if (rate->dst_buf)
-		snd_pcm_linear_convert(dst_areas, dst_offset,
-				       rate->dst_buf, 0,
-				       channels, dst_frames,
-				       rate->dst_conv_idx);
+	} else {
+		void *dst = snd_pcm_channel_area_addr(out_areas, out_offset);
+		const void *src = snd_pcm_channel_area_addr(src_areas, src_offset);
+
+		switch (rate->info.in.format) {
+		case SND_PCM_FORMAT_S32:
+			rate->ops.convert_s32(rate->obj, dst, dst_frames,
+					      src, src_frames);
+			break;
+		case SND_PCM_FORMAT_FLOAT:
+			rate->ops.convert_float(rate->obj, dst, dst_frames,
+						src, src_frames);
+			break;
+		default:
+			rate->ops.convert_s16(rate->obj, dst, dst_frames,
+					      src, src_frames);
+			break;
+		}
+	}
+	if (rate->dst_buf) {
+#ifdef BUILD_PCM_PLUGIN_ROUTE
+		if (rate->route && !rate->route_in)
+			snd_pcm_route_params_convert(dst_areas, dst_offset,
+						     rate->dst_buf, 0,
+						     channels, dst_channels,
+						     dst_frames, rate->route);
+		else
+#endif
+		if (rate->orig_out_format == rate->info.out.format)
+			snd_pcm_areas_copy(dst_areas, dst_offset,
+					   rate->dst_buf, 0,
+					   channels, dst_frames,
+					   rate->info.out.format);
+		else
+			snd_pcm_linear_convert(dst_areas, dst_offset,
+					       rate->dst_buf, 0,
+					       channels, dst_frames,
+					       rate->dst_conv_idx);
+	}
 }
 
 static inline void
@@ -617,7 +916,8 @@ snd_pcm_rate_write_areas1(snd_pcm_t *pcm,
 {
 	snd_pcm_rate_t *rate = pcm->private_data;
 	do_convert(slave_areas, slave_offset, rate->gen.slave->period_size,
-		   areas, offset, pcm->period_size,
+		   rate->gen.slave->channels,
+		   areas, offset, pcm->period_size + rate->drift_pitch,
 		   pcm->channels, rate);
 }
 
@@ -629,9 +929,9 @@ snd_pcm_rate_read_areas1(snd_pcm_t *pcm,
 			 snd_pcm_uframes_t slave_offset)
 {
 	snd_pcm_rate_t *rate = pcm->private_data;
-	do_convert(areas, offset, pcm->period_size,
+	do_convert(areas, offset, pcm->period_size, pcm->channels,
 		   slave_areas, slave_offset, rate->gen.slave->period_size,
-		   pcm->channels, rate);
+		   rate->gen.slave->channels, rate);
 }
 
 static inline void snd_pcm_rate_sync_hwptr0(snd_pcm_t *pcm, snd_pcm_uframes_t slave_hw_ptr)
@@ -639,6 +939,7 @@ static inline void snd_pcm_rate_sync_hwptr0(snd_pcm_t *pcm, snd_pcm_uframes_t sl
 	snd_pcm_rate_t *rate;
 	snd_pcm_sframes_t slave_hw_ptr_diff;
 	snd_pcm_sframes_t last_slave_hw_ptr_frac;
+	snd_pcm_uframes_t periods;
 
 	if (pcm->stream != SND_PCM_STREAM_PLAYBACK)
 		return;
@@ -657,8 +958,11 @@ static inline void snd_pcm_rate_sync_hwptr0(snd_pcm_t *pcm, snd_pcm_uframes_t sl
 	 * 	fractional part of last_slave_hw_ptr rounded value +
 	 * 	fractional part of updated slave hw ptr's rounded value ]
 	 */
+	periods = (last_slave_hw_ptr_frac + slave_hw_ptr_diff) / rate->gen.slave->period_size;
+	if (rate->drift_queue_len)
+		rate->hw_ptr += snd_pcm_rate_drift_pop(rate, periods);
 	rate->hw_ptr += (
-			(((last_slave_hw_ptr_frac + slave_hw_ptr_diff) / rate->gen.slave->period_size) * pcm->period_size) -
+			(periods * pcm->period_size) -
 			rate->ops.input_frames(rate->obj, last_slave_hw_ptr_frac) +
 			rate->ops.input_frames(rate->obj, (last_slave_hw_ptr_frac + slave_hw_ptr_diff) % rate->gen.slave->period_size));
 	rate->last_slave_hw_ptr = slave_hw_ptr;
@@ -773,6 +1077,7 @@ static int snd_pcm_rate_commit_area(snd_pcm_t *pcm, snd_pcm_rate_t *rate,
 				    snd_pcm_uframes_t slave_size)
 {
 	snd_pcm_uframes_t cont = pcm->buffer_size - appl_offset;
+	snd_pcm_uframes_t psize = pcm->period_size + rate->drift_pitch;
 	const snd_pcm_channel_area_t *areas;
 	const snd_pcm_channel_area_t *slave_areas;
 	snd_pcm_uframes_t slave_offset, xfer;
@@ -784,7 +1089,7 @@ static int snd_pcm_rate_commit_area(snd_pcm_t *pcm, snd_pcm_rate_t *rate,
 	 * Because snd_pcm_rate_write_areas1() below will convert a full source period
 	 * then there had better be a full period available in the current buffer.
 	 */
-	if (cont >= pcm->period_size) {
+	if (cont >= psize) {
 		result = snd_pcm_mmap_begin(rate->gen.slave, &slave_areas, &slave_offset, &slave_frames);
 		if (result < 0)
 			return result;
@@ -815,7 +1120,7 @@ static int snd_pcm_rate_commit_area(snd_pcm_t *pcm, snd_pcm_rate_t *rate,
 				   pcm->format);
 		snd_pcm_areas_copy(rate->pareas, cont,
 				   areas, 0,
-				   pcm->channels, pcm->period_size - cont,
+				   pcm->channels, psize - cont,
 				   pcm->format);
 
 		snd_pcm_rate_write_areas1(pcm, rate->pareas, 0, rate->sareas, 0);
@@ -830,7 +1135,7 @@ static int snd_pcm_rate_commit_area(snd_pcm_t *pcm, snd_pcm_rate_t *rate,
 			cont = slave_size;
 		snd_pcm_areas_copy(slave_areas, slave_offset,
 				   rate->sareas, 0,
-				   pcm->channels, cont,
+				   rate->gen.slave->channels, cont,
 				   rate->gen.slave->format);
 		result = snd_pcm_mmap_commit(rate->gen.slave, slave_offset, cont);
 		if (result < (snd_pcm_sframes_t)cont) {
@@ -860,7 +1165,7 @@ static int snd_pcm_rate_commit_area(snd_pcm_t *pcm, snd_pcm_rate_t *rate,
 #endif
 		snd_pcm_areas_copy(slave_areas, slave_offset,
 				   rate->sareas, xfer,
-				   pcm->channels, cont,
+				   rate->gen.slave->channels, cont,
 				   rate->gen.slave->format);
 		result = snd_pcm_mmap_commit(rate->gen.slave, slave_offset, cont);
 		if (result < (snd_pcm_sframes_t)cont) {
@@ -929,7 +1234,7 @@ static int snd_pcm_rate_grab_next_period(snd_pcm_t *pcm, snd_pcm_uframes_t hw_of
 			cont = rate->gen.slave->period_size;
 		snd_pcm_areas_copy(rate->sareas, 0,
 				   slave_areas, slave_offset,
-				   pcm->channels, cont,
+				   rate->gen.slave->channels, cont,
 				   rate->gen.slave->format);
 		result = snd_pcm_mmap_commit(rate->gen.slave, slave_offset, cont);
 		if (result < (snd_pcm_sframes_t)cont) {
@@ -959,7 +1264,7 @@ static int snd_pcm_rate_grab_next_period(snd_pcm_t *pcm, snd_pcm_uframes_t hw_of
 #endif
 		snd_pcm_areas_copy(rate->sareas, xfer,
 		                   slave_areas, slave_offset,
-				   pcm->channels, cont,
+				   rate->gen.slave->channels, cont,
 				   rate->gen.slave->format);
 		result = snd_pcm_mmap_commit(rate->gen.slave, slave_offset, cont);
 		if (result < (snd_pcm_sframes_t)cont) {
@@ -1006,18 +1311,37 @@ static int snd_pcm_rate_sync_playback_area(snd_pcm_t *pcm, snd_pcm_uframes_t app
 		return slave_size;
 
 	xfer = pcm_frame_diff(appl_ptr, rate->last_commit_ptr, pcm->boundary);
-	while (xfer >= pcm->period_size &&
+	while (xfer >= pcm->period_size + rate->drift_next &&
 	       (snd_pcm_uframes_t)slave_size >= rate->gen.slave->period_size) {
+		snd_pcm_uframes_t psize;
+
+		if (rate->drift_max &&
+		    snd_pcm_rate_drift_pitch(rate, rate->drift_next) < 0) {
+			/* retry later, the converter refused the ratio */
+			rate->drift_acc += rate->drift_next * DRIFT_NS;
+			rate->drift_next = 0;
+		}
+		if (rate->drift_max &&
+		    rate->drift_queue_len == rate->drift_queue_size) {
+			/* the slave consumed periods behind our back */
+			SNDERR("drift queue overflow");
+			return -EPIPE;
+		}
+		psize = pcm->period_size + rate->drift_pitch;
 		err = snd_pcm_rate_commit_next_period(pcm, rate->last_commit_ptr % pcm->buffer_size);
 		if (err == 0)
 			break;
 		if (err < 0)
 			return err;
-		xfer -= pcm->period_size;
+		xfer -= psize;
 		slave_size -= rate->gen.slave->period_size;
-		rate->last_commit_ptr += pcm->period_size;
+		rate->last_commit_ptr += psize;
 		if (rate->last_commit_ptr >= pcm->boundary)
 			rate->last_commit_ptr -= pcm->boundary;
+		if (rate->drift_max) {
+			snd_pcm_rate_drift_push(rate, rate->drift_pitch);
+			snd_pcm_rate_drift_update(pcm);
+		}
 	}
 	return 0;
 }
@@ -1133,6 +1457,9 @@ static int snd_pcm_rate_drain(snd_pcm_t *pcm)
 		int commit_err = 0;
 
 		__snd_pcm_lock(pcm);
+		/* the remaining frames are converted at the nominal ratio */
+		if (rate->drift_max)
+			snd_pcm_rate_drift_pitch(rate, 0);
 		/* temporarily set avail_min to one */
 		sw_params = rate->sw_params;
 		saved_avail_min = sw_params.avail_min;
@@ -1262,6 +1589,10 @@ static void snd_pcm_rate_dump(snd_pcm_t *pcm, snd_output_t *out)
 	if (rate->ops.dump)
 		rate->ops.dump(rate->obj, out);
 	snd_output_printf(out, "Protocol version: %x\n", rate->plugin_version);
+#ifdef BUILD_PCM_PLUGIN_ROUTE
+	if (rate->route)
+		snd_pcm_route_params_dump(rate->route, out);
+#endif
 	if (pcm->setup) {
 		snd_output_printf(out, "Its setup is:\n");
 		snd_pcm_dump_setup(pcm, out);
@@ -1278,9 +1609,59 @@ static int snd_pcm_rate_close(snd_pcm_t *pcm)
 		rate->ops.close(rate->obj);
 	if (rate->open_func)
 		snd_dlobj_cache_put(rate->open_func);
+	free(rate->drift_queue);
+#ifdef BUILD_PCM_PLUGIN_ROUTE
+	snd_pcm_route_params_free(rate->route);
+#endif
 	return snd_pcm_generic_close(pcm);
 }
 
+#ifdef BUILD_PCM_PLUGIN_ROUTE
+static snd_pcm_chmap_t *snd_pcm_rate_get_chmap(snd_pcm_t *pcm)
+{
+	snd_pcm_rate_t *rate = pcm->private_data;
+	snd_pcm_chmap_t *map, *slave_map;
+
+	if (!rate->route)
+		return snd_pcm_generic_get_chmap(pcm);
+	slave_map = snd_pcm_generic_get_chmap(pcm);
+	if (!slave_map)
+		return NULL;
+	map = snd_pcm_route_params_chmap(rate->route, slave_map);
+	free(slave_map);
+	return map;
+}
+
+static snd_pcm_chmap_query_t **snd_pcm_rate_query_chmaps(snd_pcm_t *pcm)
+{
+	snd_pcm_rate_t *rate = pcm->private_data;
+	snd_pcm_chmap_query_t **maps;
+	snd_pcm_chmap_t *map;
+
+	if (!rate->route)
+		return snd_pcm_generic_query_chmaps(pcm);
+	map = snd_pcm_rate_get_chmap(pcm);
+	if (!map)
+		return NULL;
+	maps = _snd_pcm_make_single_query_chmaps(map);
+	free(map);
+	return maps;
+}
+
+static int snd_pcm_rate_set_chmap(snd_pcm_t *pcm, const snd_pcm_chmap_t *map)
+{
+	snd_pcm_rate_t *rate = pcm->private_data;
+
+	if (rate->route)
+		return -ENXIO;
+	return snd_pcm_generic_set_chmap(pcm, map);
+}
+#else
+#define snd_pcm_rate_query_chmaps	snd_pcm_generic_query_chmaps
+#define snd_pcm_rate_get_chmap		snd_pcm_generic_get_chmap
+#define snd_pcm_rate_set_chmap		snd_pcm_generic_set_chmap
+#endif
+
 /**
  * \brief Convert rate pcm frames to corresponding rate slave pcm frames
  * \param pcm PCM handle
@@ -1349,9 +1730,9 @@ static const snd_pcm_ops_t snd_pcm_rate_ops = {
 	.async = snd_pcm_generic_async,
 	.mmap = snd_pcm_generic_mmap,
 	.munmap = snd_pcm_generic_munmap,
-	.query_chmaps = snd_pcm_generic_query_chmaps,
-	.get_chmap = snd_pcm_generic_get_chmap,
-	.set_chmap = snd_pcm_generic_set_chmap,
+	.query_chmaps = snd_pcm_rate_query_chmaps,
+	.get_chmap = snd_pcm_rate_get_chmap,
+	.set_chmap = snd_pcm_rate_set_chmap,
 };
 
 /**
@@ -1368,8 +1749,10 @@ const snd_config_t *snd_pcm_rate_get_default_converter(snd_config_t *root)
 	return NULL;
 }
 
-static void rate_initial_setup(snd_pcm_rate_t *rate)
+static int rate_initial_setup(snd_pcm_rate_t *rate)
 {
+	uint64_t ops_formats;
+
 	if (rate->plugin_version == SND_PCM_RATE_PLUGIN_VERSION)
 		rate->plugin_version = rate->ops.version;
 
@@ -1385,16 +1768,54 @@ static void rate_initial_setup(snd_pcm_rate_t *rate)
 						&rate->in_formats,
 						&rate->out_formats,
 						&rate->format_flags);
-	} else if (!rate->ops.convert && rate->ops.convert_s16) {
-		rate->in_formats = rate->out_formats =
-			1ULL << SND_PCM_FORMAT_S16;
+	} else if (!rate->ops.convert) {
+		/* the interleaved ops take the same format on both sides */
+		rate->in_formats = 0;
+		if (rate->ops.convert_s16)
+			rate->in_formats |= 1ULL << SND_PCM_FORMAT_S16;
+		if (rate->plugin_version >= 0x010004) {
+			if (rate->ops.convert_s32)
+				rate->in_formats |= 1ULL << SND_PCM_FORMAT_S32;
+			if (rate->ops.convert_float)
+				rate->in_formats |= 1ULL << SND_PCM_FORMAT_FLOAT;
+		}
+		rate->out_formats = rate->in_formats;
 		rate->format_flags = SND_PCM_RATE_FLAG_INTERLEAVED;
+		if (rate->in_formats != (1ULL << SND_PCM_FORMAT_S16))
+			rate->format_flags |= SND_PCM_RATE_FLAG_SYNC_FORMATS;
+	}
+
+	if (rate->ops.convert)
+		return 0;
+	/* the interleaved ops exist per format, drop the formats without one */
+	ops_formats = 0;
+	if (rate->ops.convert_s16)
+		ops_formats |= 1ULL << SND_PCM_FORMAT_S16;
+	if (rate->plugin_version >= 0x010004) {
+		if (rate->ops.convert_s32)
+			ops_formats |= 1ULL << SND_PCM_FORMAT_S32;
+		if (rate->ops.convert_float)
+			ops_formats |= 1ULL << SND_PCM_FORMAT_FLOAT;
 	}
+	rate->in_formats &= ops_formats;
+	rate->out_formats &= ops_formats;
+	if (!(rate->in_formats & rate->out_formats)) {
+		SNDERR("No convert op for the formats of the rate plugin");
+		return -EINVAL;
+	}
+	/* one op converts both sides */
+	rate->format_flags |= SND_PCM_RATE_FLAG_SYNC_FORMATS;
+	return 0;
 }
 
 #ifdef PIC
 static int is_builtin_plugin(const char *type)
 {
+#ifndef HAVE_SOFT_FLOAT
+	if (strcmp(type, "sinc") == 0 || strcmp(type, "sinc_fast") == 0 ||
+	    strcmp(type, "sinc_best") == 0)
+		return 1;
+#endif
 	return strcmp(type, "linear") == 0;
 }
 
@@ -1451,6 +1872,51 @@ static int rate_open_func(snd_pcm_rate_t *rate, const char *type, const snd_conf
 	rate->open_func = NULL;
 	return err;
 }
+#else /* !PIC */
+extern int SND_PCM_RATE_PLUGIN_ENTRY(linear) (unsigned int version, void **objp, snd_pcm_rate_ops_t *ops);
+#ifndef HAVE_SOFT_FLOAT
+extern int SND_PCM_RATE_PLUGIN_ENTRY(sinc) (unsigned int version, void **objp, snd_pcm_rate_ops_t *ops);
+extern int SND_PCM_RATE_PLUGIN_ENTRY(sinc_fast) (unsigned int version, void **objp, snd_pcm_rate_ops_t *ops);
+extern int SND_PCM_RATE_PLUGIN_ENTRY(sinc_best) (unsigned int version, void **objp, snd_pcm_rate_ops_t *ops);
+extern int SND_PCM_RATE_PLUGIN_CONF_ENTRY(sinc) (unsigned int version, void **objp, snd_pcm_rate_ops_t *ops, const snd_config_t *conf);
+#endif
+
+/* no plugin can be loaded by the static library, only these are known */
+static const struct {
+	const char *name;
+	snd_pcm_rate_open_func_t open_func;
+	snd_pcm_rate_open_conf_func_t open_conf_func;
+} builtin_rate_plugins[] = {
+	{ "linear", SND_PCM_RATE_PLUGIN_ENTRY(linear), NULL },
+#ifndef HAVE_SOFT_FLOAT
+	{ "sinc", SND_PCM_RATE_PLUGIN_ENTRY(sinc), SND_PCM_RATE_PLUGIN_CONF_ENTRY(sinc) },
+	{ "sinc_fast", SND_PCM_RATE_PLUGIN_ENTRY(sinc_fast), NULL },
+	{ "sinc_best", SND_PCM_RATE_PLUGIN_ENTRY(sinc_best), NULL },
+#endif
+};
+
+static const char *const default_rate_plugins[] = {
+	"linear", NULL
+};
+
+static int rate_open_func(snd_pcm_rate_t *rate, const char *type, const snd_config_t *converter_conf, int verbose)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(builtin_rate_plugins); i++) {
+		if (strcmp(type, builtin_rate_plugins[i].name))
+			continue;
+		if (converter_conf && builtin_rate_plugins[i].open_conf_func)
+			return builtin_rate_plugins[i].open_conf_func(SND_PCM_RATE_PLUGIN_VERSION,
+								      &rate->obj, &rate->ops,
+								      converter_conf);
+		return builtin_rate_plugins[i].open_func(SND_PCM_RATE_PLUGIN_VERSION,
+							 &rate->obj, &rate->ops);
+	}
+	if (verbose)
+		SNDERR("Rate converter %s is not built in the static library", type);
+	return -ENOENT;
+}
 #endif
 
 /*
@@ -1501,10 +1967,6 @@ int snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 	snd_pcm_rate_t *rate;
 	const char *type = NULL;
 	int err;
-#ifndef PIC
-	snd_pcm_rate_open_func_t open_func;
-	extern int SND_PCM_RATE_PLUGIN_ENTRY(linear) (unsigned int version, void **objp, snd_pcm_rate_ops_t *ops);
-#endif
 
 	assert(pcmp && slave);
 	if (sformat != SND_PCM_FORMAT_UNKNOWN &&
@@ -1529,7 +1991,6 @@ int snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 		return err;
 	}
 
-#ifdef PIC
 	err = -ENOENT;
 	if (!converter) {
 		const char *const *types;
@@ -1583,27 +2044,26 @@ int snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 		free(rate);
 		return -ENOENT;
 	}
-#else
-	type = "linear";
-	open_func = SND_PCM_RATE_PLUGIN_ENTRY(linear);
-	err = open_func(SND_PCM_RATE_PLUGIN_VERSION, &rate->obj, &rate->ops);
-	if (err < 0) {
-		snd_pcm_free(pcm);
-		free(rate);
-		return err;
-	}
-#endif
 
-	if (! rate->ops.init || ! (rate->ops.convert || rate->ops.convert_s16) ||
+	if (! rate->ops.init ||
+	    ! (rate->ops.convert || rate->ops.convert_s16 ||
+	       rate->ops.convert_s32 || rate->ops.convert_float) ||
 	    ! rate->ops.input_frames || ! rate->ops.output_frames) {
 		SNDERR("Inproper rate plugin %s initialization", type);
+		err = -EINVAL;
+	} else {
+		err = rate_initial_setup(rate);
+	}
+	if (err < 0) {
+		if (rate->ops.close)
+			rate->ops.close(rate->obj);
+		if (rate->open_func)
+			snd_dlobj_cache_put(rate->open_func);
 		snd_pcm_free(pcm);
 		free(rate);
 		return err;
 	}
 
-	rate_initial_setup(rate);
-
 	pcm->ops = &snd_pcm_rate_ops;
 	pcm->fast_ops = &snd_pcm_rate_fast_ops;
 	pcm->private_data = rate;
@@ -1618,11 +2078,212 @@ int snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 	return 0;
 }
 
+#ifdef BUILD_PCM_PLUGIN_ROUTE
+#ifndef DOC_HIDDEN
+/*
+ * Creates a rate PCM which also routes the channels with the given
+ * transfer table, like a route PCM stacked on it but in the same pass
+ * over the period.  The converter works on the side with the fewer
+ * channels.
+ */
+int snd_pcm_rate_route_open(snd_pcm_t **pcmp, const char *name,
+			    snd_pcm_format_t sformat, unsigned int srate,
+			    unsigned int schannels,
+			    snd_pcm_route_ttable_entry_t *ttable,
+			    unsigned int tt_ssize,
+			    unsigned int tt_cused, unsigned int tt_sused,
+			    const snd_config_t *converter,
+			    snd_pcm_t *slave, int close_slave)
+{
+	snd_pcm_t *pcm;
+	snd_pcm_rate_t *rate;
+	int err;
+
+	assert(ttable && schannels > 0);
+	err = snd_pcm_rate_open(&pcm, name, sformat, srate, converter,
+				slave, close_slave);
+	if (err < 0)
+		return err;
+	rate = pcm->private_data;
+	err = snd_pcm_route_params_new(&rate->route, pcm->stream, ttable,
+				       tt_ssize, tt_cused, tt_sused);
+	if (err < 0) {
+		/* the caller keeps the slave on errors */
+		rate->gen.close_slave = 0;
+		snd_pcm_close(pcm);
+		return err;
+	}
+	rate->schannels = schannels;
+	*pcmp = pcm;
+	return 0;
+}
+#endif /* DOC_HIDDEN */
+#endif
+
+/* find the rate PCM, also behind the plug plugin and its converters */
+static snd_pcm_t *rate_find(snd_pcm_t *pcm)
+{
+	while (pcm) {
+		switch (pcm->type) {
+		case SND_PCM_TYPE_RATE:
+			return pcm;
+		case SND_PCM_TYPE_PLUG:
+		case SND_PCM_TYPE_LINEAR:
+		case SND_PCM_TYPE_LINEAR_FLOAT:
+		case SND_PCM_TYPE_ROUTE:
+		case SND_PCM_TYPE_MULAW:
+		case SND_PCM_TYPE_ALAW:
+		case SND_PCM_TYPE_ADPCM:
+		case SND_PCM_TYPE_COPY:
+		case SND_PCM_TYPE_SOFTVOL:
+			pcm = ((snd_pcm_generic_t *)pcm->private_data)->slave;
+			break;
+		default:
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+static int rate_find_drift(snd_pcm_t *pcm, snd_pcm_rate_t **ratep)
+{
+	snd_pcm_t *rpcm = rate_find(pcm);
+	snd_pcm_rate_t *rate;
+
+	if (!rpcm)
+		return -EINVAL;
+	rate = rpcm->private_data;
+	if (pcm->stream != SND_PCM_STREAM_PLAYBACK || !rate->ops.adjust_pitch)
+		return -ENOSYS;
+	*ratep = rate;
+	return 0;
+}
+
+/* enable the drift compensation, called with the PCM locked */
+static int rate_enable_drift(snd_pcm_t *pcm, snd_pcm_rate_t **ratep)
+{
+	snd_pcm_t *rpcm = rate_find(pcm);
+	snd_pcm_rate_t *rate;
+	int err;
+
+	err = rate_find_drift(pcm, &rate);
+	if (err < 0)
+		return err;
+	if (!rate->drift_max && rpcm->setup) {
+		err = snd_pcm_rate_drift_setup(rpcm, rpcm->format,
+					       rpcm->channels,
+					       rpcm->period_size);
+		if (err < 0)
+			return err;
+	}
+	rate->drift = 1;
+	*ratep = rate;
+	return 0;
+}
+
+/**
+ * \brief Set the drift correction of a rate PCM
+ * \param pcm PCM handle (rate PCM or a plug PCM converting the rate)
+ * \param ppb Correction in parts per billion (1000 = 1 ppm)
+ * \retval zero on success otherwise a negative error code
+ *
+ * A positive value consumes the client samples faster than the nominal
+ * rate ratio, e.g. when the source of the written data runs on a faster
+ * clock than the slave device.  The correction in use follows the new
+ * value with a limited slew rate.  The range is +-1000 ppm.  Only the
+ * playback direction and converters with the adjust_pitch callback are
+ * supported.  It also disables the fill level control set by
+ * snd_pcm_rate_set_drift_target().
+ *
+ * The drift compensation is off unless enabled by the \c drift option
+ * of the rate PCM or by the first call of this function or of
+ * snd_pcm_rate_set_drift_target().  A plug PCM creates its rate PCM in
+ * snd_pcm_hw_params(), call it afterwards then.
+ */
+int snd_pcm_rate_set_drift(snd_pcm_t *pcm, long ppb)
+{
+	snd_pcm_rate_t *rate;
+	int err;
+
+	assert(pcm);
+	if (ppb > DRIFT_MAX_PPB || ppb < -DRIFT_MAX_PPB)
+		return -EINVAL;
+	snd_pcm_lock(pcm);
+	err = rate_enable_drift(pcm, &rate);
+	if (err < 0) {
+		snd_pcm_unlock(pcm);
+		return err;
+	}
+	rate->drift_fill = 0;
+	rate->drift_isum = 0;
+	rate->drift_ppb = ppb;
+	snd_pcm_unlock(pcm);
+	return 0;
+}
+
+/**
+ * \brief Steer the drift correction of a rate PCM by the buffer fill level
+ * \param pcm PCM handle (rate PCM or a plug PCM converting the rate)
+ * \param frames Target fill level (queued frames) or zero to stop
+ * \retval zero on success otherwise a negative error code
+ *
+ * For writers paced by an external clock, e.g. data captured from
+ * another device.  After each period the correction is evaluated from the
+ * difference of the queued frames (snd_pcm_mmap_playback_hw_avail()) to
+ * \p frames, so that the buffer stays at the given level.  Stopping the
+ * control keeps the last correction, it can be read with
+ * snd_pcm_rate_get_drift().  Like snd_pcm_rate_set_drift(), it enables
+ * the drift compensation.
+ */
+int snd_pcm_rate_set_drift_target(snd_pcm_t *pcm, snd_pcm_uframes_t frames)
+{
+	snd_pcm_rate_t *rate;
+	int err;
+
+	assert(pcm);
+	snd_pcm_lock(pcm);
+	err = rate_enable_drift(pcm, &rate);
+	if (err < 0) {
+		snd_pcm_unlock(pcm);
+		return err;
+	}
+	if (!frames)
+		rate->drift_ppb = rate->drift_cur;
+	else if (!rate->drift_fill)
+		rate->drift_isum = 0;
+	rate->drift_fill = frames;
+	snd_pcm_unlock(pcm);
+	return 0;
+}
+
+/**
+ * \brief Get the drift correction in use by a rate PCM
+ * \param pcm PCM handle (rate PCM or a plug PCM converting the rate)
+ * \param ppb Returns the correction in parts per billion
+ * \retval zero on success otherwise a negative error code
+ */
+int snd_pcm_rate_get_drift(snd_pcm_t *pcm, long *ppb)
+{
+	snd_pcm_rate_t *rate;
+	int err;
+
+	assert(pcm && ppb);
+	err = rate_find_drift(pcm, &rate);
+	if (err < 0)
+		return err;
+	snd_pcm_lock(pcm);
+	*ppb = rate->drift_cur;
+	snd_pcm_unlock(pcm);
+	return 0;
+}
+
 /*! \page pcm_plugins
 
 \section pcm_plugins_rate Plugin: Rate
 
 This plugin converts a stream rate. The input and output formats must be linear.
+Float streams are passed as they are when the slave format is not given and
+the converter handles float samples.
 
 \code
 pcm.name {
@@ -1646,14 +2307,47 @@ pcm.name {
 		name STR	# Convertor type
 		xxx yyy		# optional convertor-specific configuration
 	}
+	drift BOOL		# enable the drift compensation (playback),
+				# default is off
 }
 \endcode
 
+Besides the external converter plugins, two converters are built in:
+<code>linear</code> (linear interpolation) and <code>sinc</code>, a polyphase
+windowed-sinc FIR resampler working on S16, S32 or float samples.  The sinc filter table
+is computed at hw_params for the ratio of the period sizes.  Its quality is
+selected by the type name (<code>sinc_fast</code>, <code>sinc</code>,
+<code>sinc_best</code>) or in the compound form:
+
+\code
+	converter {
+		name sinc
+		quality STR	# fast, medium (default) or best
+	}
+\endcode
+
+The static library cannot load converter plugins, it knows only the
+built-in converters.  Another converter type fails to open there, a
+list of alternatives like <code>[ "speexrate" "sinc" ]</code> picks the
+first built-in one.
+
+For the playback direction, the ratio can be corrected at run time to
+follow a clock drift between the writer and the slave device, see
+snd_pcm_rate_set_drift() and snd_pcm_rate_set_drift_target().  The
+correction is off unless enabled by the <code>drift</code> option or by
+one of these functions.  A period
+is then converted now and then from one client frame more or less, with
+the converter pitch adjusted for it.  This requires a converter with the
+adjust_pitch callback, like the built-in ones.
+
 \subsection pcm_plugins_rate_funcref Function reference
 
 <UL>
   <LI>snd_pcm_rate_open()
   <LI>_snd_pcm_rate_open()
+  <LI>snd_pcm_rate_set_drift()
+  <LI>snd_pcm_rate_set_drift_target()
+  <LI>snd_pcm_rate_get_drift()
 </UL>
 
 */
@@ -1682,6 +2376,7 @@ int _snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 	snd_pcm_format_t sformat = SND_PCM_FORMAT_UNKNOWN;
 	int srate = -1;
 	const snd_config_t *converter = NULL;
+	int drift = 0;
 
 	snd_config_for_each(i, next, conf) {
 		snd_config_t *n = snd_config_iterator_entry(i);
@@ -1698,6 +2393,13 @@ int _snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 			converter = n;
 			continue;
 		}
+		if (strcmp(id, "drift") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0)
+				return err;
+			drift = err;
+			continue;
+		}
 		SNDERR("Unknown field %s", id);
 		return -EINVAL;
 	}
@@ -1723,9 +2425,12 @@ int _snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 		return err;
 	err = snd_pcm_rate_open(pcmp, name, sformat, (unsigned int) srate,
 				converter, spcm, 1);
-	if (err < 0)
+	if (err < 0) {
 		snd_pcm_close(spcm);
-	return err;
+		return err;
+	}
+	((snd_pcm_rate_t *)(*pcmp)->private_data)->drift = drift;
+	return 0;
 }
 #ifndef DOC_HIDDEN
 SND_DLSYM_BUILD_VERSION(_snd_pcm_rate_open, SND_PCM_DLSYM_VERSION);
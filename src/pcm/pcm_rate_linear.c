@@ -32,18 +32,43 @@
 #define LINEAR_DIV_SHIFT 19
 #define LINEAR_DIV (1<<LINEAR_DIV_SHIFT)
 
+/* interpolation step of a single output frame, see linear_fill_phases() */
+struct linear_phase {
+	int old_idx;		/* source frame, -1 = last frame of the previous period */
+	int new_idx;
+	int new_weight;		/* 0 .. 0x10000 */
+};
+
+typedef void (*linear_interleaved_func_t)(const struct linear_phase *phase,
+					  unsigned int frames, void *dst,
+					  const void *src, const void *last,
+					  unsigned int channels);
+
 struct rate_linear {
 	unsigned int get_idx;
 	unsigned int put_idx;
 	unsigned int pitch;
 	unsigned int pitch_shift;	/* for expand interpolation */
 	unsigned int channels;
+	unsigned int expand: 1;
 	int16_t *old_sample;
+	int32_t *old_sample32;		/* S32 interleaved path */
+	float *old_samplef;		/* FLOAT path */
 	void (*func)(struct rate_linear *rate,
 		     const snd_pcm_channel_area_t *dst_areas,
 		     snd_pcm_uframes_t dst_offset, unsigned int dst_frames,
 		     const snd_pcm_channel_area_t *src_areas,
 		     snd_pcm_uframes_t src_offset, unsigned int src_frames);
+	/* interleaved S16/S32/FLOAT path using a per-period phase table */
+	linear_interleaved_func_t ifunc;
+	unsigned int sample_bits;
+	unsigned int is_float: 1;	/* only the phase table path exists */
+	struct linear_phase *phases;	/* table of the full period */
+	struct linear_phase *phases_partial;	/* built for a partial period */
+	unsigned int phase_alloc;	/* frames allocated in each table */
+	unsigned int phase_src_frames;
+	unsigned int phase_dst_frames;
+	int phase_last_idx;
 };
 
 static snd_pcm_uframes_t input_frames(void *obj, snd_pcm_uframes_t frames)
@@ -307,6 +332,359 @@ static void linear_shrink_s16(struct rate_linear *rate,
 	}
 }
 
+/*
+ * The interpolation positions and weights only depend on the pitch and
+ * on the period sizes, the positions are reset at each period.  They are
+ * recorded once by running the per-channel algorithms above without the
+ * samples, so the interleaved path gives identical results.  Returns the
+ * count of the filled output frames, which is less than dst_frames when
+ * a shrink runs out of the source frames.
+ */
+static unsigned int linear_fill_phases(struct rate_linear *rate,
+				       struct linear_phase *phase,
+				       unsigned int src_frames,
+				       unsigned int dst_frames, int *last_idx)
+{
+	unsigned int src_frames1 = 0, dst_frames1 = 0;
+	unsigned int pos;
+	int old_idx = -1, new_idx = -1;
+
+	if (rate->expand) {
+		unsigned int get_threshold = rate->pitch;
+
+		pos = get_threshold;
+		while (dst_frames1 < dst_frames) {
+			if (pos >= get_threshold) {
+				pos -= get_threshold;
+				old_idx = new_idx;
+				if (src_frames1 < src_frames)
+					new_idx = src_frames1;
+			}
+			phase[dst_frames1].old_idx = old_idx;
+			phase[dst_frames1].new_idx = new_idx;
+			phase[dst_frames1].new_weight = (pos << (16 - rate->pitch_shift)) / (get_threshold >> rate->pitch_shift);
+			dst_frames1++;
+			pos += LINEAR_DIV;
+			if (pos >= get_threshold)
+				src_frames1++;
+		}
+	} else {
+		unsigned int get_increment = rate->pitch;
+
+		pos = LINEAR_DIV - get_increment;
+		for (; src_frames1 < src_frames; src_frames1++) {
+			pos += get_increment;
+			if (pos >= LINEAR_DIV) {
+				pos -= LINEAR_DIV;
+				if (dst_frames1 >= dst_frames)
+					break;
+				/* the first frame has always zero old_weight */
+				phase[dst_frames1].old_idx = src_frames1 ? src_frames1 - 1 : 0;
+				phase[dst_frames1].new_idx = src_frames1;
+				phase[dst_frames1].new_weight = 0x10000 - (pos << (32 - LINEAR_DIV_SHIFT)) / (get_increment >> (LINEAR_DIV_SHIFT - 16));
+				dst_frames1++;
+			}
+		}
+	}
+	*last_idx = new_idx;
+	return dst_frames1;
+}
+
+/* the table of the full period, in the buffer allocated by linear_init() */
+static void linear_build_phases(struct rate_linear *rate,
+				unsigned int src_frames, unsigned int dst_frames)
+{
+	rate->phase_src_frames = rate->phase_dst_frames = 0;
+	if (!rate->phases || !src_frames || !dst_frames ||
+	    dst_frames > rate->phase_alloc)
+		return;
+	/* an incomplete shrink table is rebuilt at each conversion */
+	if (linear_fill_phases(rate, rate->phases, src_frames, dst_frames,
+			       &rate->phase_last_idx) != dst_frames)
+		return;
+	rate->phase_src_frames = src_frames;
+	rate->phase_dst_frames = dst_frames;
+}
+
+/*
+ * All channels of a frame are interpolated with the same weights, so the
+ * inner loops run across the channels.  The channel count is a constant
+ * in the specialized variants below, which lets the compiler unroll them
+ * and use vector instructions for the whole frame.
+ */
+static inline void linear_interleaved_s16(const struct linear_phase *phase,
+					  unsigned int frames, void *dst,
+					  const void *src, const void *last,
+					  unsigned int channels)
+{
+	int16_t *d = dst;
+	unsigned int c;
+
+	for (; frames > 0; frames--, phase++, d += channels) {
+		const int16_t *o = phase->old_idx < 0 ? (const int16_t *)last :
+			(const int16_t *)src + phase->old_idx * channels;
+		const int16_t *n = phase->new_idx < 0 ? (const int16_t *)last :
+			(const int16_t *)src + phase->new_idx * channels;
+		int new_weight = phase->new_weight;
+		int old_weight = 0x10000 - new_weight;
+
+		for (c = 0; c < channels; c++)
+			d[c] = (o[c] * old_weight + n[c] * new_weight) >> 16;
+	}
+}
+
+static inline void linear_interleaved_s32(const struct linear_phase *phase,
+					  unsigned int frames, void *dst,
+					  const void *src, const void *last,
+					  unsigned int channels)
+{
+	int32_t *d = dst;
+	unsigned int c;
+
+	for (; frames > 0; frames--, phase++, d += channels) {
+		const int32_t *o = phase->old_idx < 0 ? (const int32_t *)last :
+			(const int32_t *)src + phase->old_idx * channels;
+		const int32_t *n = phase->new_idx < 0 ? (const int32_t *)last :
+			(const int32_t *)src + phase->new_idx * channels;
+		int64_t new_weight = phase->new_weight;
+		int64_t old_weight = 0x10000 - new_weight;
+
+		for (c = 0; c < channels; c++)
+			d[c] = (o[c] * old_weight + n[c] * new_weight) >> 16;
+	}
+}
+
+#ifndef HAVE_SOFT_FLOAT
+static inline void linear_interleaved_float(const struct linear_phase *phase,
+					    unsigned int frames, void *dst,
+					    const void *src, const void *last,
+					    unsigned int channels)
+{
+	float *d = dst;
+	unsigned int c;
+
+	for (; frames > 0; frames--, phase++, d += channels) {
+		const float *o = phase->old_idx < 0 ? (const float *)last :
+			(const float *)src + phase->old_idx * channels;
+		const float *n = phase->new_idx < 0 ? (const float *)last :
+			(const float *)src + phase->new_idx * channels;
+		float new_weight = phase->new_weight * (1.0f / 0x10000);
+		float old_weight = 1.0f - new_weight;
+
+		for (c = 0; c < channels; c++)
+			d[c] = o[c] * old_weight + n[c] * new_weight;
+	}
+}
+#define LINEAR_INTERLEAVED_FLOAT_FUNC(ch) \
+static void linear_interleaved_float_##ch(const struct linear_phase *phase, \
+					  unsigned int frames, void *dst, \
+					  const void *src, const void *last, \
+					  ATTRIBUTE_UNUSED unsigned int channels) \
+{ \
+	linear_interleaved_float(phase, frames, dst, src, last, ch); \
+}
+#else
+#define LINEAR_INTERLEAVED_FLOAT_FUNC(ch)
+#endif
+
+#define LINEAR_INTERLEAVED_FUNCS(ch) \
+static void linear_interleaved_s16_##ch(const struct linear_phase *phase, \
+					unsigned int frames, void *dst, \
+					const void *src, const void *last, \
+					ATTRIBUTE_UNUSED unsigned int channels) \
+{ \
+	linear_interleaved_s16(phase, frames, dst, src, last, ch); \
+} \
+static void linear_interleaved_s32_##ch(const struct linear_phase *phase, \
+					unsigned int frames, void *dst, \
+					const void *src, const void *last, \
+					ATTRIBUTE_UNUSED unsigned int channels) \
+{ \
+	linear_interleaved_s32(phase, frames, dst, src, last, ch); \
+} \
+LINEAR_INTERLEAVED_FLOAT_FUNC(ch)
+
+LINEAR_INTERLEAVED_FUNCS(1)
+LINEAR_INTERLEAVED_FUNCS(2)
+LINEAR_INTERLEAVED_FUNCS(4)
+LINEAR_INTERLEAVED_FUNCS(6)
+LINEAR_INTERLEAVED_FUNCS(8)
+
+static void linear_interleaved_s16_n(const struct linear_phase *phase,
+				     unsigned int frames, void *dst,
+				     const void *src, const void *last,
+				     unsigned int channels)
+{
+	linear_interleaved_s16(phase, frames, dst, src, last, channels);
+}
+
+static void linear_interleaved_s32_n(const struct linear_phase *phase,
+				     unsigned int frames, void *dst,
+				     const void *src, const void *last,
+				     unsigned int channels)
+{
+	linear_interleaved_s32(phase, frames, dst, src, last, channels);
+}
+
+#ifndef HAVE_SOFT_FLOAT
+static void linear_interleaved_float_n(const struct linear_phase *phase,
+				       unsigned int frames, void *dst,
+				       const void *src, const void *last,
+				       unsigned int channels)
+{
+	linear_interleaved_float(phase, frames, dst, src, last, channels);
+}
+
+static linear_interleaved_func_t linear_interleaved_select_float(unsigned int channels)
+{
+#define LINEAR_SELECT(ch) \
+	case ch: return linear_interleaved_float_##ch
+	switch (channels) {
+	LINEAR_SELECT(1);
+	LINEAR_SELECT(2);
+	LINEAR_SELECT(4);
+	LINEAR_SELECT(6);
+	LINEAR_SELECT(8);
+	default:
+		return linear_interleaved_float_n;
+	}
+#undef LINEAR_SELECT
+}
+
+/* FLOAT in separate channel areas, one channel at a time with the table */
+static void linear_float_areas(struct rate_linear *rate,
+			       const struct linear_phase *phase,
+			       unsigned int frames,
+			       const snd_pcm_channel_area_t *dst_areas,
+			       snd_pcm_uframes_t dst_offset,
+			       const snd_pcm_channel_area_t *src_areas,
+			       snd_pcm_uframes_t src_offset)
+{
+	unsigned int channel, i;
+
+	for (channel = 0; channel < rate->channels; ++channel) {
+		const float *src = snd_pcm_channel_area_addr(&src_areas[channel], src_offset);
+		float *dst = snd_pcm_channel_area_addr(&dst_areas[channel], dst_offset);
+		int src_step = snd_pcm_channel_area_step(&src_areas[channel]) / sizeof(float);
+		int dst_step = snd_pcm_channel_area_step(&dst_areas[channel]) / sizeof(float);
+		float last = rate->old_samplef[channel];
+
+		for (i = 0; i < frames; i++, dst += dst_step) {
+			float o = phase[i].old_idx < 0 ? last : src[phase[i].old_idx * src_step];
+			float n = phase[i].new_idx < 0 ? last : src[phase[i].new_idx * src_step];
+			float new_weight = phase[i].new_weight * (1.0f / 0x10000);
+
+			*dst = o * (1.0f - new_weight) + n * new_weight;
+		}
+	}
+}
+#endif
+
+static linear_interleaved_func_t linear_interleaved_select(unsigned int bits,
+							   unsigned int channels)
+{
+#define LINEAR_SELECT(ch) \
+	case ch: return bits == 16 ? linear_interleaved_s16_##ch : linear_interleaved_s32_##ch
+	switch (channels) {
+	LINEAR_SELECT(1);
+	LINEAR_SELECT(2);
+	LINEAR_SELECT(4);
+	LINEAR_SELECT(6);
+	LINEAR_SELECT(8);
+	default:
+		return bits == 16 ? linear_interleaved_s16_n : linear_interleaved_s32_n;
+	}
+#undef LINEAR_SELECT
+}
+
+/* check whether the channel areas form a single interleaved buffer */
+static const char *linear_interleaved_addr(const snd_pcm_channel_area_t *areas,
+					   snd_pcm_uframes_t offset,
+					   unsigned int channels,
+					   unsigned int bits)
+{
+	unsigned int c;
+
+	for (c = 0; c < channels; c++) {
+		if (areas[c].addr != areas[0].addr ||
+		    areas[c].first != areas[0].first + c * bits ||
+		    areas[c].step != channels * bits)
+			return NULL;
+	}
+	return snd_pcm_channel_area_addr(areas, offset);
+}
+
+static int linear_convert_interleaved(struct rate_linear *rate,
+				      const snd_pcm_channel_area_t *dst_areas,
+				      snd_pcm_uframes_t dst_offset, unsigned int dst_frames,
+				      const snd_pcm_channel_area_t *src_areas,
+				      snd_pcm_uframes_t src_offset, unsigned int src_frames)
+{
+	unsigned int bits = rate->sample_bits;
+	unsigned int bytes = bits / 8;
+	const struct linear_phase *phases;
+	const char *src;
+	char *dst;
+	const void *last;
+	unsigned int c, frames;
+	int last_idx;
+
+	if (!rate->phases || !dst_frames || dst_frames > rate->phase_alloc)
+		return 0;
+	src = linear_interleaved_addr(src_areas, src_offset, rate->channels, bits);
+	dst = (char *)linear_interleaved_addr(dst_areas, dst_offset, rate->channels, bits);
+	if ((!src || !dst) && !rate->is_float)
+		return 0;
+	if (src_frames == rate->phase_src_frames &&
+	    dst_frames == rate->phase_dst_frames) {
+		phases = rate->phases;
+		frames = dst_frames;
+		last_idx = rate->phase_last_idx;
+	} else {
+		/* a partial period, the table is built like the full one */
+		frames = linear_fill_phases(rate, rate->phases_partial, src_frames,
+					    dst_frames, &last_idx);
+		/* FLOAT has no generic code, it writes the filled frames */
+		if (frames != dst_frames && !rate->is_float)
+			return 0;
+		phases = rate->phases_partial;
+	}
+
+#ifndef HAVE_SOFT_FLOAT
+	if (rate->is_float) {
+		if (src && dst)
+			rate->ifunc(phases, frames, dst, src, rate->old_samplef,
+				    rate->channels);
+		else
+			linear_float_areas(rate, phases, frames,
+					   dst_areas, dst_offset,
+					   src_areas, src_offset);
+		if (rate->expand && last_idx >= 0) {
+			for (c = 0; c < rate->channels; c++)
+				rate->old_samplef[c] = *((const float *)
+					snd_pcm_channel_area_addr(&src_areas[c],
+								  src_offset + last_idx));
+		}
+		return 1;
+	}
+#endif
+
+	last = bits == 16 ? (const void *)rate->old_sample : (const void *)rate->old_sample32;
+	rate->ifunc(phases, frames, dst, src, last, rate->channels);
+
+	if (rate->expand && last_idx >= 0) {
+		src += last_idx * rate->channels * bytes;
+		if (bits == 16) {
+			memcpy(rate->old_sample, src, rate->channels * bytes);
+		} else {
+			memcpy(rate->old_sample32, src, rate->channels * bytes);
+			for (c = 0; c < rate->channels; c++)
+				rate->old_sample[c] = rate->old_sample32[c] >> 16;
+		}
+	}
+	return 1;
+}
+
 static void linear_convert(void *obj, 
 			   const snd_pcm_channel_area_t *dst_areas,
 			   snd_pcm_uframes_t dst_offset, unsigned int dst_frames,
@@ -314,8 +692,25 @@ static void linear_convert(void *obj,
 			   snd_pcm_uframes_t src_offset, unsigned int src_frames)
 {
 	struct rate_linear *rate = obj;
+	unsigned int c;
+
+	if (rate->ifunc &&
+	    linear_convert_interleaved(rate, dst_areas, dst_offset, dst_frames,
+				       src_areas, src_offset, src_frames))
+		return;
+	if (rate->is_float) {
+		/* no phase table, can't happen with a configured period */
+		snd_pcm_areas_silence(dst_areas, dst_offset, rate->channels,
+				      dst_frames, SND_PCM_FORMAT_FLOAT);
+		return;
+	}
 	rate->func(rate, dst_areas, dst_offset, dst_frames,
 		   src_areas, src_offset, src_frames);
+	/* keep the S32 path continuous after the generic code */
+	if (rate->old_sample32 && rate->expand) {
+		for (c = 0; c < rate->channels; c++)
+			rate->old_sample32[c] = (int32_t)rate->old_sample[c] * 65536;
+	}
 }
 
 static void linear_free(void *obj)
@@ -324,6 +719,15 @@ static void linear_free(void *obj)
 
 	free(rate->old_sample);
 	rate->old_sample = NULL;
+	free(rate->old_sample32);
+	rate->old_sample32 = NULL;
+	free(rate->old_samplef);
+	rate->old_samplef = NULL;
+	free(rate->phases);
+	rate->phases = NULL;
+	rate->phases_partial = NULL;
+	rate->phase_alloc = 0;
+	rate->phase_src_frames = rate->phase_dst_frames = 0;
 }
 
 static int linear_init(void *obj, snd_pcm_rate_info_t *info)
@@ -348,12 +752,57 @@ static int linear_init(void *obj, snd_pcm_rate_info_t *info)
 	rate->pitch = (((uint64_t)info->out.rate * LINEAR_DIV) +
 		       (info->in.rate / 2)) / info->in.rate;
 	rate->channels = info->channels;
+	rate->expand = info->in.rate < info->out.rate;
 
-	free(rate->old_sample);
+	linear_free(rate);
 	rate->old_sample = malloc(sizeof(*rate->old_sample) * rate->channels);
 	if (! rate->old_sample)
 		return -ENOMEM;
 
+	rate->ifunc = NULL;
+	rate->sample_bits = 0;
+	rate->is_float = 0;
+#ifndef HAVE_SOFT_FLOAT
+	if (info->in.format == SND_PCM_FORMAT_FLOAT) {
+		/* get_supported_formats() gives float only on both sides */
+		if (info->out.format != SND_PCM_FORMAT_FLOAT ||
+		    !info->out.period_size)
+			return -EINVAL;
+		rate->is_float = 1;
+		rate->old_samplef = calloc(rate->channels, sizeof(*rate->old_samplef));
+		if (! rate->old_samplef)
+			return -ENOMEM;
+	}
+#endif
+	if (rate->is_float ||
+	    (info->in.format == info->out.format &&
+	     (info->in.format == SND_PCM_FORMAT_S16 ||
+	      info->in.format == SND_PCM_FORMAT_S32))) {
+		rate->sample_bits = snd_pcm_format_physical_width(info->in.format);
+		if (rate->sample_bits == 32 && !rate->is_float) {
+			rate->old_sample32 = calloc(rate->channels, sizeof(*rate->old_sample32));
+			if (! rate->old_sample32)
+				return -ENOMEM;
+		}
+#ifndef HAVE_SOFT_FLOAT
+		if (rate->is_float)
+			rate->ifunc = linear_interleaved_select_float(rate->channels);
+		else
+#endif
+		rate->ifunc = linear_interleaved_select(rate->sample_bits, rate->channels);
+		/* the output period doesn't change with the pitch, so the
+		 * tables are allocated once here
+		 */
+		if (rate->ifunc && info->out.period_size) {
+			rate->phases = malloc(2 * sizeof(*rate->phases) *
+					      info->out.period_size);
+			if (!rate->phases)
+				return -ENOMEM;
+			rate->phases_partial = rate->phases + info->out.period_size;
+			rate->phase_alloc = info->out.period_size;
+		}
+	}
+
 	return 0;
 }
 
@@ -387,6 +836,7 @@ static int linear_adjust_pitch(void *obj, snd_pcm_rate_info_t *info)
 		while ((rate->pitch >> rate->pitch_shift) >= (1 << 16))
 			rate->pitch_shift++;
 	}
+	linear_build_phases(rate, info->in.period_size, info->out.period_size);
 	return 0;
 }
 
@@ -397,6 +847,10 @@ static void linear_reset(void *obj)
 	/* for expand */
 	if (rate->old_sample)
 		memset(rate->old_sample, 0, sizeof(*rate->old_sample) * rate->channels);
+	if (rate->old_sample32)
+		memset(rate->old_sample32, 0, sizeof(*rate->old_sample32) * rate->channels);
+	if (rate->old_samplef)
+		memset(rate->old_samplef, 0, sizeof(*rate->old_samplef) * rate->channels);
 }
 
 static void linear_close(void *obj)
@@ -412,6 +866,29 @@ static int get_supported_rates(ATTRIBUTE_UNUSED void *rate,
 	return 0;
 }
 
+/*
+ * Any linear format is converted through S16 by the generic code, S16
+ * and S32 are interpolated directly.  FLOAT has only the phase table
+ * path, so it must be on both sides.
+ */
+static int get_supported_formats(ATTRIBUTE_UNUSED void *rate,
+				 uint64_t *in_formats, uint64_t *out_formats,
+				 unsigned int *flags)
+{
+	uint64_t formats = 0;
+	int f;
+
+	for (f = 0; f < 64 && f <= SND_PCM_FORMAT_LAST; f++)
+		if (snd_pcm_format_linear(f) == 1)
+			formats |= 1ULL << f;
+#ifndef HAVE_SOFT_FLOAT
+	formats |= 1ULL << SND_PCM_FORMAT_FLOAT;
+#endif
+	*in_formats = *out_formats = formats;
+	*flags = 0;
+	return 0;
+}
+
 static void linear_dump(ATTRIBUTE_UNUSED void *rate, snd_output_t *out)
 {
 	snd_output_printf(out, "Converter: linear-interpolation\n");
@@ -429,6 +906,7 @@ static const snd_pcm_rate_ops_t linear_ops = {
 	.version = SND_PCM_RATE_PLUGIN_VERSION,
 	.get_supported_rates = get_supported_rates,
 	.dump = linear_dump,
+	.get_supported_formats = get_supported_formats,
 };
 
 int SND_PCM_RATE_PLUGIN_ENTRY(linear) (ATTRIBUTE_UNUSED unsigned int version,
@@ -0,0 +1,529 @@
+/*
+ *  Polyphase windowed-sinc rate converter plugin
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * The conversion ratio is reduced to L/M (L output frames per M input
+ * frames) from the period sizes, so that each period consumes exactly
+ * one input period.  For the usual period sizes this is the rate ratio
+ * itself, e.g. 160/147 for 44100 -> 48000.  The filter for each of the
+ * L phases is computed once at hw_params, the conversion is then a dot
+ * product of a row of the table with the input history per sample.
+ * When L is larger than the phase limit of the quality preset, or the
+ * ratio was changed by adjust_pitch, the output is interpolated linearly
+ * between two neighbouring phases.
+ */
+
+#include "pcm_local.h"
+#include "pcm_plugin.h"
+#include "pcm_rate.h"
+#include <inttypes.h>
+#include <math.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifndef HAVE_SOFT_FLOAT
+
+#define SINC_MAX_TAPS		512
+#define SINC_MAX_COEFS		(1 << 18)
+
+struct sinc_quality {
+	const char *name;
+	unsigned int taps;	/* filter length at 1:1, multiple of 4 */
+	unsigned int phases;	/* max. number of precomputed phases */
+	double beta;		/* Kaiser window parameter */
+	double cutoff;		/* passband edge relative to Nyquist */
+};
+
+static const struct sinc_quality sinc_qualities[] = {
+	{ "fast", 16, 128, 6.0, 0.85 },
+	{ "medium", 32, 256, 8.0, 0.91 },
+	{ "best", 64, 1024, 10.0, 0.95 },
+};
+
+#define SINC_FAST	(&sinc_qualities[0])
+#define SINC_MEDIUM	(&sinc_qualities[1])
+#define SINC_BEST	(&sinc_qualities[2])
+
+struct rate_sinc {
+	const struct sinc_quality *quality;
+	unsigned int channels;
+	unsigned int in_step;		/* M */
+	unsigned int out_step;		/* L */
+	unsigned int in_frames;		/* input period size */
+	unsigned int max_in_frames;	/* input space in hist */
+	unsigned int taps;
+	unsigned int phases;
+	double cutoff;
+	float *coefs;			/* (phases + 1) rows of taps */
+	float *hist;			/* per channel: taps - 1 + max_in_frames */
+};
+
+static snd_pcm_uframes_t input_frames(void *obj, snd_pcm_uframes_t frames)
+{
+	struct rate_sinc *rate = obj;
+	if (frames == 0)
+		return 0;
+	return muldiv_near(frames, rate->in_step, rate->out_step);
+}
+
+static snd_pcm_uframes_t output_frames(void *obj, snd_pcm_uframes_t frames)
+{
+	struct rate_sinc *rate = obj;
+	if (frames == 0)
+		return 0;
+	return muldiv_near(frames, rate->out_step, rate->in_step);
+}
+
+static unsigned int sinc_gcd(unsigned int a, unsigned int b)
+{
+	while (b) {
+		unsigned int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* zeroth order modified Bessel function of the first kind */
+static double sinc_bessel_i0(double x)
+{
+	double sum = 1.0, term = 1.0, y = x * x / 4.0;
+	unsigned int k;
+
+	for (k = 1; k < 64; k++) {
+		term *= y / ((double)k * k);
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+	return sum;
+}
+
+/*
+ * Fill rate->coefs.  The taps are stored in the order of the input
+ * history, so that the output for phase p at the position pos is
+ * dot(coefs[p], hist + pos).  Row "phases" is the phase 0 of the next
+ * input frame and is used only by the interpolation.
+ */
+static void sinc_make_table(struct rate_sinc *rate)
+{
+	double cutoff = rate->cutoff;
+	const struct sinc_quality *q = rate->quality;
+	double half = rate->taps / 2;
+	double norm = sinc_bessel_i0(q->beta);
+	unsigned int p, k;
+
+	for (p = 0; p <= rate->phases; p++) {
+		float *row = rate->coefs + p * rate->taps;
+		double sum = 0.0;
+
+		for (k = 0; k < rate->taps; k++) {
+			double t = (double)p / rate->phases + half - 1 - k;
+			double x = t / half;
+			double h = cutoff;
+
+			if (x <= -1.0 || x >= 1.0) {
+				row[k] = 0.0f;
+				continue;
+			}
+			if (t != 0.0)
+				h = sin(M_PI * cutoff * t) / (M_PI * t);
+			h *= sinc_bessel_i0(q->beta * sqrt(1.0 - x * x)) / norm;
+			row[k] = h;
+			sum += h;
+		}
+		/* unity gain at DC for every phase */
+		for (k = 0; k < rate->taps; k++)
+			row[k] /= sum;
+	}
+}
+
+static inline float sinc_dot(const float *coef, const float *src,
+			     unsigned int taps)
+{
+	unsigned int i;
+#if defined(__SSE__)
+	__m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+	float r[4];
+
+	for (i = 0; i + 8 <= taps; i += 8) {
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(coef + i),
+						   _mm_loadu_ps(src + i)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(coef + i + 4),
+						   _mm_loadu_ps(src + i + 4)));
+	}
+	if (i < taps)
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(coef + i),
+						   _mm_loadu_ps(src + i)));
+	_mm_storeu_ps(r, _mm_add_ps(acc0, acc1));
+	return (r[0] + r[2]) + (r[1] + r[3]);
+#elif defined(__ARM_NEON)
+	float32x4_t acc = vdupq_n_f32(0.0f);
+	float32x2_t r;
+
+	for (i = 0; i < taps; i += 4)
+		acc = vmlaq_f32(acc, vld1q_f32(coef + i), vld1q_f32(src + i));
+	r = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+	return vget_lane_f32(vpadd_f32(r, r), 0);
+#else
+	float acc0 = 0.0f, acc1 = 0.0f, acc2 = 0.0f, acc3 = 0.0f;
+
+	for (i = 0; i < taps; i += 4) {
+		acc0 += coef[i] * src[i];
+		acc1 += coef[i + 1] * src[i + 1];
+		acc2 += coef[i + 2] * src[i + 2];
+		acc3 += coef[i + 3] * src[i + 3];
+	}
+	return (acc0 + acc2) + (acc1 + acc3);
+#endif
+}
+
+static inline float sinc_load(const void *src, unsigned int idx,
+			      snd_pcm_format_t format)
+{
+	switch (format) {
+	case SND_PCM_FORMAT_S16:
+		return ((const int16_t *)src)[idx];
+	case SND_PCM_FORMAT_S32:
+		return ((const int32_t *)src)[idx];
+	default:
+		return ((const float *)src)[idx];
+	}
+}
+
+static inline void sinc_store(void *dst, unsigned int idx, float v,
+			      snd_pcm_format_t format)
+{
+	switch (format) {
+	case SND_PCM_FORMAT_S16:
+		if (v >= 32767.0f)
+			((int16_t *)dst)[idx] = 32767;
+		else if (v <= -32768.0f)
+			((int16_t *)dst)[idx] = -32768;
+		else
+			((int16_t *)dst)[idx] = lrintf(v);
+		break;
+	case SND_PCM_FORMAT_S32:
+		/* 0x7fffffff is not representable, clip at 2^31 */
+		if (v >= 2147483648.0f)
+			((int32_t *)dst)[idx] = 0x7fffffff;
+		else if (v <= -2147483648.0f)
+			((int32_t *)dst)[idx] = -0x7fffffff - 1;
+		else
+			((int32_t *)dst)[idx] = lrintf(v);
+		break;
+	default:
+		((float *)dst)[idx] = v;
+		break;
+	}
+}
+
+/*
+ * The S32 samples are filtered in float as well, which keeps 24 bits of
+ * precision.  The format is a constant in each of the callers below.
+ */
+static inline void sinc_convert(struct rate_sinc *rate,
+				void *dst, unsigned int dst_frames,
+				const void *src, unsigned int src_frames,
+				snd_pcm_format_t format)
+{
+	unsigned int channels = rate->channels;
+	unsigned int taps = rate->taps;
+	unsigned int hist_size = taps - 1 + rate->max_in_frames;
+	unsigned int channel, i;
+
+	if (src_frames > rate->in_frames) {
+		SNDERR("src_frames overflow");
+		src_frames = rate->in_frames;
+	}
+
+	for (channel = 0; channel < channels; channel++) {
+		float *hist = rate->hist + channel * hist_size;
+		float *in = hist + taps - 1;
+		const float *coefs = rate->coefs;
+		unsigned int ipos = 0, pos = 0;
+		unsigned int d = channel;
+
+		for (i = 0; i < src_frames; i++)
+			in[i] = sinc_load(src, i * channels + channel, format);
+
+		for (i = 0; i < dst_frames; i++) {
+			const float *x = hist + ipos;
+			float v;
+
+			if (ipos >= src_frames) {
+				SNDERR("dst_frames overflow");
+				break;
+			}
+			if (rate->phases == rate->out_step) {
+				v = sinc_dot(coefs + pos * taps, x, taps);
+			} else {
+				uint64_t scaled = (uint64_t)pos * rate->phases;
+				unsigned int p = scaled / rate->out_step;
+				float a = (float)(scaled % rate->out_step) / rate->out_step;
+				const float *row = coefs + p * taps;
+				float v0 = sinc_dot(row, x, taps);
+				float v1 = sinc_dot(row + taps, x, taps);
+
+				v = v0 + a * (v1 - v0);
+			}
+			sinc_store(dst, d, v, format);
+			d += channels;
+			pos += rate->in_step;
+			while (pos >= rate->out_step) {
+				pos -= rate->out_step;
+				ipos++;
+			}
+		}
+		/* keep the tail as the history for the next period */
+		memmove(hist, hist + src_frames, (taps - 1) * sizeof(*hist));
+	}
+}
+
+static void sinc_convert_s16(void *obj, int16_t *dst, unsigned int dst_frames,
+			     const int16_t *src, unsigned int src_frames)
+{
+	sinc_convert(obj, dst, dst_frames, src, src_frames, SND_PCM_FORMAT_S16);
+}
+
+static void sinc_convert_s32(void *obj, int32_t *dst, unsigned int dst_frames,
+			     const int32_t *src, unsigned int src_frames)
+{
+	sinc_convert(obj, dst, dst_frames, src, src_frames, SND_PCM_FORMAT_S32);
+}
+
+static void sinc_convert_float(void *obj, float *dst, unsigned int dst_frames,
+			       const float *src, unsigned int src_frames)
+{
+	sinc_convert(obj, dst, dst_frames, src, src_frames, SND_PCM_FORMAT_FLOAT);
+}
+
+static void sinc_free(void *obj)
+{
+	struct rate_sinc *rate = obj;
+
+	free(rate->coefs);
+	rate->coefs = NULL;
+	free(rate->hist);
+	rate->hist = NULL;
+}
+
+static int sinc_init(void *obj, snd_pcm_rate_info_t *info)
+{
+	struct rate_sinc *rate = obj;
+	const struct sinc_quality *q = rate->quality;
+	unsigned int in_period = info->in.period_size;
+	unsigned int out_period = info->out.period_size;
+	unsigned int g, taps, phases;
+	double cutoff;
+
+	if (!in_period || !out_period)
+		return -EINVAL;
+	g = sinc_gcd(in_period, out_period);
+
+	sinc_free(rate);
+	rate->channels = info->channels;
+	rate->in_step = in_period / g;
+	rate->out_step = out_period / g;
+	rate->in_frames = in_period;
+	/* room for the period size changes by adjust_pitch */
+	rate->max_in_frames = in_period * 2;
+
+	/* the passband shrinks to the output Nyquist frequency when
+	 * decimating, the filter gets longer to keep the transition band
+	 */
+	cutoff = q->cutoff;
+	taps = q->taps;
+	if (rate->in_step > rate->out_step) {
+		cutoff = cutoff * rate->out_step / rate->in_step;
+		taps = (uint64_t)taps * rate->in_step / rate->out_step;
+		taps = (taps + 3) & ~3U;
+		if (taps > SINC_MAX_TAPS)
+			taps = SINC_MAX_TAPS;
+	}
+	phases = rate->out_step;
+	if (phases > q->phases)
+		phases = q->phases;
+	while (phases > 1 && (phases + 1) * taps > SINC_MAX_COEFS)
+		phases /= 2;
+	rate->taps = taps;
+	rate->phases = phases;
+	rate->cutoff = cutoff;
+
+	rate->coefs = malloc((phases + 1) * taps * sizeof(*rate->coefs));
+	rate->hist = calloc((size_t)rate->channels * (taps - 1 + rate->max_in_frames),
+			    sizeof(*rate->hist));
+	if (!rate->coefs || !rate->hist) {
+		sinc_free(rate);
+		return -ENOMEM;
+	}
+	sinc_make_table(rate);
+	return 0;
+}
+
+/*
+ * Follow a change of the period sizes without losing the history, e.g.
+ * for the drift compensation of the rate plugin.  The table set up at
+ * init is kept as is, only the phase step changes: the phase positions
+ * of the new ratio are interpolated between the rows of the table.
+ */
+static int sinc_adjust_pitch(void *obj, snd_pcm_rate_info_t *info)
+{
+	struct rate_sinc *rate = obj;
+	unsigned int in_period = info->in.period_size;
+	unsigned int out_period = info->out.period_size;
+	unsigned int g;
+
+	if (!rate->coefs || !in_period || !out_period ||
+	    in_period > rate->max_in_frames)
+		return -EINVAL;
+	g = sinc_gcd(in_period, out_period);
+	rate->in_step = in_period / g;
+	rate->out_step = out_period / g;
+	rate->in_frames = in_period;
+	return 0;
+}
+
+static void sinc_reset(void *obj)
+{
+	struct rate_sinc *rate = obj;
+
+	if (rate->hist)
+		memset(rate->hist, 0, sizeof(*rate->hist) * rate->channels *
+		       (rate->taps - 1 + rate->max_in_frames));
+}
+
+static void sinc_close(void *obj)
+{
+	sinc_free(obj);
+	free(obj);
+}
+
+static int get_supported_rates(ATTRIBUTE_UNUSED void *rate,
+			       unsigned int *rate_min, unsigned int *rate_max)
+{
+	*rate_min = SND_PCM_PLUGIN_RATE_MIN;
+	*rate_max = SND_PCM_PLUGIN_RATE_MAX;
+	return 0;
+}
+
+static void sinc_dump(void *obj, snd_output_t *out)
+{
+	struct rate_sinc *rate = obj;
+
+	snd_output_printf(out, "Converter: polyphase-sinc (%s)\n",
+			  rate->quality->name);
+	if (rate->coefs)
+		snd_output_printf(out, "  ratio %u/%u, %u taps, %u phases\n",
+				  rate->out_step, rate->in_step,
+				  rate->taps, rate->phases);
+}
+
+static const snd_pcm_rate_ops_t sinc_ops = {
+	.close = sinc_close,
+	.init = sinc_init,
+	.free = sinc_free,
+	.reset = sinc_reset,
+	.adjust_pitch = sinc_adjust_pitch,
+	.convert_s16 = sinc_convert_s16,
+	.convert_s32 = sinc_convert_s32,
+	.convert_float = sinc_convert_float,
+	.input_frames = input_frames,
+	.output_frames = output_frames,
+	.version = SND_PCM_RATE_PLUGIN_VERSION,
+	.get_supported_rates = get_supported_rates,
+	.dump = sinc_dump,
+};
+
+static int sinc_open(const struct sinc_quality *quality,
+		     void **objp, snd_pcm_rate_ops_t *ops)
+{
+	struct rate_sinc *rate;
+
+	rate = calloc(1, sizeof(*rate));
+	if (! rate)
+		return -ENOMEM;
+	rate->quality = quality;
+
+	*objp = rate;
+	*ops = sinc_ops;
+	return 0;
+}
+
+int SND_PCM_RATE_PLUGIN_ENTRY(sinc) (ATTRIBUTE_UNUSED unsigned int version,
+				     void **objp, snd_pcm_rate_ops_t *ops)
+{
+	return sinc_open(SINC_MEDIUM, objp, ops);
+}
+
+int SND_PCM_RATE_PLUGIN_ENTRY(sinc_fast) (ATTRIBUTE_UNUSED unsigned int version,
+					  void **objp, snd_pcm_rate_ops_t *ops)
+{
+	return sinc_open(SINC_FAST, objp, ops);
+}
+
+int SND_PCM_RATE_PLUGIN_ENTRY(sinc_best) (ATTRIBUTE_UNUSED unsigned int version,
+					  void **objp, snd_pcm_rate_ops_t *ops)
+{
+	return sinc_open(SINC_BEST, objp, ops);
+}
+
+int SND_PCM_RATE_PLUGIN_CONF_ENTRY(sinc) (ATTRIBUTE_UNUSED unsigned int version,
+					  void **objp, snd_pcm_rate_ops_t *ops,
+					  const snd_config_t *conf)
+{
+	const struct sinc_quality *quality = SINC_MEDIUM;
+	snd_config_iterator_t i, next;
+
+	if (!conf)
+		return sinc_open(quality, objp, ops);
+
+	snd_config_for_each(i, next, conf) {
+		snd_config_t *n = snd_config_iterator_entry(i);
+		const char *id, *str;
+		unsigned int k;
+
+		if (snd_config_get_id(n, &id) < 0)
+			continue;
+		if (strcmp(id, "name") == 0)
+			continue;
+		if (strcmp(id, "quality") == 0) {
+			if (snd_config_get_string(n, &str) < 0) {
+				SNDERR("Invalid type for %s", id);
+				return -EINVAL;
+			}
+			for (k = 0; k < ARRAY_SIZE(sinc_qualities); k++)
+				if (strcmp(str, sinc_qualities[k].name) == 0)
+					break;
+			if (k == ARRAY_SIZE(sinc_qualities)) {
+				SNDERR("Unknown sinc quality %s", str);
+				return -EINVAL;
+			}
+			quality = &sinc_qualities[k];
+			continue;
+		}
+		SNDERR("Unknown field %s", id);
+		return -EINVAL;
+	}
+	return sinc_open(quality, objp, ops);
+}
+
+#endif /* HAVE_SOFT_FLOAT */
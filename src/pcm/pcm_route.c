@@ -58,7 +58,26 @@ typedef struct {
 
 typedef struct snd_pcm_route_ttable_dst snd_pcm_route_ttable_dst_t;
 
+/* a destination channel summed by the block kernel */
 typedef struct {
+	unsigned int channel;	/* destination channel */
+	int att;		/* Attenuated */
+	unsigned int nsrcs;
+	snd_pcm_route_ttable_src_t *srcs;	/* channel is the block row */
+} snd_pcm_route_mix_t;
+
+#if SND_PCM_PLUGIN_ROUTE_FLOAT
+typedef float snd_pcm_route_sample_t;
+typedef float snd_pcm_route_acc_t;
+#else
+typedef int32_t snd_pcm_route_sample_t;
+typedef int64_t snd_pcm_route_acc_t;
+#endif
+
+/* frames per block, a constant trip count lets the compiler vectorize */
+#define ROUTE_BLOCK	64
+
+struct _snd_pcm_route_params {
 	enum {UINT64, FLOAT} sum_idx;
 	unsigned int get_idx;
 	unsigned int put_idx;
@@ -69,7 +88,16 @@ typedef struct {
 	unsigned int nsrcs;
 	unsigned int ndsts;
 	snd_pcm_route_ttable_dst_t *dsts;
-} snd_pcm_route_params_t;
+	/* compiled at hw_params */
+	snd_pcm_format_t load_fmt;	/* native S16/S32, otherwise get32 */
+	snd_pcm_format_t store_fmt;	/* native S16/S32, otherwise put32 */
+	int use_float;			/* sum normalized float samples */
+	unsigned int nrows;
+	unsigned int *rows;		/* source channel of each block row */
+	unsigned int nmix;
+	snd_pcm_route_mix_t *mix;
+	snd_pcm_route_sample_t *block;	/* nrows * ROUTE_BLOCK samples */
+};
 
 
 typedef void (*route_f)(const snd_pcm_channel_area_t *dst_area,
@@ -86,6 +114,7 @@ struct snd_pcm_route_ttable_dst {
 	unsigned int nsrcs;
 	snd_pcm_route_ttable_src_t* srcs;
 	route_f func;
+	int compiled;	/* summed by the block kernel */
 };
 
 typedef union {
@@ -102,6 +131,7 @@ typedef struct {
 	snd_pcm_format_t sformat;
 	int schannels;
 	snd_pcm_route_params_t params;
+	int use_float;		/* float option */
 	snd_pcm_chmap_t *chmap;
 	snd_pcm_chmap_query_t **chmap_override;
 } snd_pcm_route_t;
@@ -395,9 +425,336 @@ static void snd_pcm_route_convert1_many(const snd_pcm_channel_area_t *dst_area,
 	}
 }
 
-#endif /* DOC_HIDDEN */
+/*
+ * The block kernel: the source channels used by the mixing destinations
+ * are loaded once per block into planar rows, then every destination is
+ * summed from its sparse list of rows and stored.  This replaces the
+ * per sample get/add/put dispatch of snd_pcm_route_convert1_many() and
+ * reads each source sample only once regardless of the number of
+ * destinations using it.  The sums are done in the same order and with
+ * the same precision as in snd_pcm_route_convert1_many().
+ *
+ * In the float mode the rows hold samples normalized to -1.0 .. 1.0,
+ * FLOAT and FLOAT64 are then loaded and stored without any conversion
+ * to the integer domain.
+ */
+static void snd_pcm_route_load_block(snd_pcm_route_sample_t *row,
+				     const snd_pcm_channel_area_t *src_area,
+				     snd_pcm_uframes_t src_offset,
+				     unsigned int frames,
+				     const snd_pcm_route_params_t *params)
+{
+#define GET32_LABELS
+#include "plugin_ops.h"
+#undef GET32_LABELS
+	void *get32;
+	const char *src = snd_pcm_channel_area_addr(src_area, src_offset);
+	int src_step = snd_pcm_channel_area_step(src_area);
+	int32_t sample = 0;
+	unsigned int i;
 
-static void snd_pcm_route_convert(const snd_pcm_channel_area_t *dst_areas,
+	switch (params->load_fmt) {
+	case SND_PCM_FORMAT_S16:
+		for (i = 0; i < frames; i++) {
+			row[i] = (int32_t)((uint32_t)*(const uint16_t *)src << 16);
+			src += src_step;
+		}
+		break;
+	case SND_PCM_FORMAT_S32:
+		for (i = 0; i < frames; i++) {
+			row[i] = *(const int32_t *)src;
+			src += src_step;
+		}
+		break;
+#if SND_PCM_PLUGIN_ROUTE_FLOAT
+	case SND_PCM_FORMAT_FLOAT:
+		for (i = 0; i < frames; i++) {
+			row[i] = *(const float *)src;
+			src += src_step;
+		}
+		return;
+	case SND_PCM_FORMAT_FLOAT64:
+		for (i = 0; i < frames; i++) {
+			row[i] = *(const double *)src;
+			src += src_step;
+		}
+		return;
+#endif
+	default:
+		get32 = get32_labels[params->get_idx];
+		for (i = 0; i < frames; i++) {
+			goto *get32;
+#define GET32_END after_get
+#include "plugin_ops.h"
+#undef GET32_END
+		after_get:
+			row[i] = sample;
+			src += src_step;
+		}
+		break;
+	}
+#if SND_PCM_PLUGIN_ROUTE_FLOAT
+	if (params->use_float) {
+		for (i = 0; i < frames; i++)
+			row[i] *= 1.0f / 2147483648.0f;
+	}
+#endif
+}
+
+static void snd_pcm_route_mix_block(const snd_pcm_route_mix_t *mix,
+				    const snd_pcm_route_sample_t *block,
+				    snd_pcm_route_acc_t *acc)
+{
+	unsigned int srcidx, i;
+
+	/* the padding of the rows is summed as well, the loops then
+	 * always run ROUTE_BLOCK times
+	 */
+	for (i = 0; i < ROUTE_BLOCK; i++)
+		acc[i] = 0;
+	for (srcidx = 0; srcidx < mix->nsrcs; srcidx++) {
+		const snd_pcm_route_ttable_src_t *tt = &mix->srcs[srcidx];
+		const snd_pcm_route_sample_t *row = block + tt->channel * ROUTE_BLOCK;
+#if SND_PCM_PLUGIN_ROUTE_FLOAT
+		const float gain = tt->as_float;
+
+		if (!mix->att || gain == 1.0f) {
+			for (i = 0; i < ROUTE_BLOCK; i++)
+				acc[i] += row[i];
+		} else {
+			for (i = 0; i < ROUTE_BLOCK; i++)
+				acc[i] += row[i] * gain;
+		}
+#else
+		const int gain = tt->as_int;
+
+		if (!mix->att) {
+			for (i = 0; i < ROUTE_BLOCK; i++)
+				acc[i] += row[i];
+		} else {
+			for (i = 0; i < ROUTE_BLOCK; i++)
+				acc[i] += (int64_t)row[i] * gain;
+		}
+#endif
+	}
+}
+
+/* Normalization */
+static void snd_pcm_route_norm_block(int32_t *samples,
+				     const snd_pcm_route_acc_t *acc,
+				     unsigned int frames,
+				     int att ATTRIBUTE_UNUSED,
+				     const snd_pcm_route_params_t *params ATTRIBUTE_UNUSED)
+{
+	unsigned int i;
+
+	for (i = 0; i < frames; i++) {
+		snd_pcm_route_acc_t sum = acc[i];
+#if SND_PCM_PLUGIN_ROUTE_FLOAT
+		if (params->use_float)
+			sum *= 2147483648.0f;
+		if (sum >= 2147483648.0f)
+			samples[i] = 0x7fffffff;
+		else if (sum < -2147483648.0f)
+			samples[i] = 0x80000000;
+		else
+			samples[i] = lrintf(sum);
+#else
+		if (att)
+			div(sum);
+		if (sum > (int64_t)0x7fffffff)
+			samples[i] = 0x7fffffff;
+		else if (sum < -(int64_t)0x80000000)
+			samples[i] = 0x80000000;
+		else
+			samples[i] = sum;
+#endif
+	}
+}
+
+static void snd_pcm_route_store_block(const snd_pcm_channel_area_t *dst_area,
+				      snd_pcm_uframes_t dst_offset,
+				      const snd_pcm_route_acc_t *acc,
+				      unsigned int frames, int att,
+				      const snd_pcm_route_params_t *params)
+{
+#define PUT32_LABELS
+#include "plugin_ops.h"
+#undef PUT32_LABELS
+	void *put32;
+	char *dst = snd_pcm_channel_area_addr(dst_area, dst_offset);
+	int dst_step = snd_pcm_channel_area_step(dst_area);
+	int32_t samples[ROUTE_BLOCK];
+	int32_t sample;
+	unsigned int i;
+
+	switch (params->store_fmt) {
+#if SND_PCM_PLUGIN_ROUTE_FLOAT
+	case SND_PCM_FORMAT_FLOAT:
+		for (i = 0; i < frames; i++) {
+			*(float *)dst = acc[i];
+			dst += dst_step;
+		}
+		return;
+	case SND_PCM_FORMAT_FLOAT64:
+		for (i = 0; i < frames; i++) {
+			*(double *)dst = acc[i];
+			dst += dst_step;
+		}
+		return;
+#endif
+	default:
+		break;
+	}
+
+	snd_pcm_route_norm_block(samples, acc, frames, att, params);
+	switch (params->store_fmt) {
+	case SND_PCM_FORMAT_S16:
+		for (i = 0; i < frames; i++) {
+			*(int16_t *)dst = samples[i] >> 16;
+			dst += dst_step;
+		}
+		return;
+	case SND_PCM_FORMAT_S32:
+		for (i = 0; i < frames; i++) {
+			*(int32_t *)dst = samples[i];
+			dst += dst_step;
+		}
+		return;
+	default:
+		break;
+	}
+	put32 = put32_labels[params->put_idx];
+	for (i = 0; i < frames; i++) {
+		sample = samples[i];
+		goto *put32;
+#define PUT32_END after_put32
+#include "plugin_ops.h"
+#undef PUT32_END
+	after_put32:
+		dst += dst_step;
+	}
+}
+
+static void snd_pcm_route_convert_mix(const snd_pcm_channel_area_t *dst_areas,
+				      snd_pcm_uframes_t dst_offset,
+				      const snd_pcm_channel_area_t *src_areas,
+				      snd_pcm_uframes_t src_offset,
+				      snd_pcm_uframes_t frames,
+				      const snd_pcm_route_params_t *params)
+{
+	snd_pcm_route_acc_t acc[ROUTE_BLOCK];
+	unsigned int r, m;
+
+	while (frames > 0) {
+		unsigned int n = frames > ROUTE_BLOCK ? ROUTE_BLOCK : frames;
+
+		for (r = 0; r < params->nrows; r++)
+			snd_pcm_route_load_block(params->block + r * ROUTE_BLOCK,
+						 &src_areas[params->rows[r]],
+						 src_offset, n, params);
+		for (m = 0; m < params->nmix; m++) {
+			const snd_pcm_route_mix_t *mix = &params->mix[m];
+
+			snd_pcm_route_mix_block(mix, params->block, acc);
+			snd_pcm_route_store_block(&dst_areas[mix->channel],
+						  dst_offset, acc, n, mix->att,
+						  params);
+		}
+		src_offset += n;
+		dst_offset += n;
+		frames -= n;
+	}
+}
+
+static void snd_pcm_route_free_kernel(snd_pcm_route_params_t *params)
+{
+	unsigned int m;
+
+	for (m = 0; m < params->nmix; m++) {
+		params->dsts[params->mix[m].channel].compiled = 0;
+		free(params->mix[m].srcs);
+	}
+	free(params->mix);
+	params->mix = NULL;
+	params->nmix = 0;
+	free(params->rows);
+	params->rows = NULL;
+	params->nrows = 0;
+	free(params->block);
+	params->block = NULL;
+}
+
+/*
+ * Select the destinations for the block kernel.  The silenced ones and
+ * the plain copies of a single source keep their convert1 functions,
+ * except for the copies in the float mode.
+ */
+static int snd_pcm_route_compile(snd_pcm_route_params_t *params,
+				 unsigned int src_channels,
+				 unsigned int dst_channels)
+{
+	unsigned int row_of[src_channels];
+	unsigned int dst_channel, src_channel, srcidx;
+	unsigned int ndsts = params->ndsts;
+
+	snd_pcm_route_free_kernel(params);
+	if (ndsts > dst_channels)
+		ndsts = dst_channels;
+	params->mix = calloc(ndsts ? ndsts : 1, sizeof(*params->mix));
+	params->rows = calloc(src_channels ? src_channels : 1, sizeof(*params->rows));
+	if (!params->mix || !params->rows)
+		goto _nomem;
+	for (src_channel = 0; src_channel < src_channels; src_channel++)
+		row_of[src_channel] = UINT_MAX;
+
+	for (dst_channel = 0; dst_channel < ndsts; dst_channel++) {
+		snd_pcm_route_ttable_dst_t *d = &params->dsts[dst_channel];
+		snd_pcm_route_mix_t *mix;
+		unsigned int nsrcs = 0;
+
+		for (srcidx = 0; srcidx < d->nsrcs; srcidx++)
+			if ((unsigned int)d->srcs[srcidx].channel < src_channels)
+				nsrcs++;
+		if (nsrcs == 0 ||
+		    (nsrcs == 1 && !params->use_float &&
+		     d->srcs[0].as_int == SND_PCM_PLUGIN_ROUTE_RESOLUTION))
+			continue;
+		mix = &params->mix[params->nmix];
+		mix->srcs = calloc(nsrcs, sizeof(*mix->srcs));
+		if (!mix->srcs)
+			goto _nomem;
+		params->nmix++;
+		mix->channel = dst_channel;
+		mix->att = d->att;
+		for (srcidx = 0; srcidx < d->nsrcs; srcidx++) {
+			snd_pcm_route_ttable_src_t tt = d->srcs[srcidx];
+
+			src_channel = tt.channel;
+			if (src_channel >= src_channels)
+				continue;
+			if (row_of[src_channel] == UINT_MAX) {
+				row_of[src_channel] = params->nrows;
+				params->rows[params->nrows++] = src_channel;
+			}
+			tt.channel = row_of[src_channel];
+			mix->srcs[mix->nsrcs++] = tt;
+		}
+		d->compiled = 1;
+	}
+	if (params->nmix == 0)
+		return 0;
+	params->block = calloc(params->nrows * ROUTE_BLOCK, sizeof(*params->block));
+	if (!params->block)
+		goto _nomem;
+	return 0;
+
+ _nomem:
+	snd_pcm_route_free_kernel(params);
+	return -ENOMEM;
+}
+
+void snd_pcm_route_params_convert(const snd_pcm_channel_area_t *dst_areas,
 				  snd_pcm_uframes_t dst_offset,
 				  const snd_pcm_channel_area_t *src_areas,
 				  snd_pcm_uframes_t src_offset,
@@ -418,7 +775,7 @@ static void snd_pcm_route_convert(const snd_pcm_channel_area_t *dst_areas,
 						    src_areas, src_offset,
 						    src_channels,
 						    frames, dstp, params);
-		else
+		else if (!dstp->compiled)
 			dstp->func(dst_area, dst_offset,
 				   src_areas, src_offset,
 				   src_channels,
@@ -426,20 +783,41 @@ static void snd_pcm_route_convert(const snd_pcm_channel_area_t *dst_areas,
 		dstp++;
 		dst_area++;
 	}
+	if (params->nmix)
+		snd_pcm_route_convert_mix(dst_areas, dst_offset,
+					  src_areas, src_offset,
+					  frames, params);
 }
 
-static int snd_pcm_route_close(snd_pcm_t *pcm)
+static void route_free_params(snd_pcm_route_params_t *params)
 {
-	snd_pcm_route_t *route = pcm->private_data;
-	snd_pcm_route_params_t *params = &route->params;
 	unsigned int dst_channel;
 
 	if (params->dsts) {
+		snd_pcm_route_free_kernel(params);
 		for (dst_channel = 0; dst_channel < params->ndsts; ++dst_channel) {
 			free(params->dsts[dst_channel].srcs);
 		}
 		free(params->dsts);
+		params->dsts = NULL;
 	}
+}
+
+void snd_pcm_route_params_free(snd_pcm_route_params_t *params)
+{
+	if (params) {
+		route_free_params(params);
+		free(params);
+	}
+}
+
+#endif /* DOC_HIDDEN */
+
+static int snd_pcm_route_close(snd_pcm_t *pcm)
+{
+	snd_pcm_route_t *route = pcm->private_data;
+
+	route_free_params(&route->params);
 	free(route->chmap);
 	snd_pcm_free_chmaps(route->chmap_override);
 	return snd_pcm_generic_close(pcm);
@@ -454,6 +832,10 @@ static int snd_pcm_route_hw_refine_cprepare(snd_pcm_t *pcm ATTRIBUTE_UNUSED, snd
 					 &access_mask);
 	if (err < 0)
 		return err;
+#if SND_PCM_PLUGIN_ROUTE_FLOAT
+	snd_pcm_format_mask_set(&format_mask, SND_PCM_FORMAT_FLOAT);
+	snd_pcm_format_mask_set(&format_mask, SND_PCM_FORMAT_FLOAT64);
+#endif
 	err = _snd_pcm_hw_param_set_mask(params, SND_PCM_HW_PARAM_FORMAT,
 					 &format_mask);
 	if (err < 0)
@@ -544,11 +926,70 @@ static int snd_pcm_route_hw_refine(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 				       snd_pcm_generic_hw_refine);
 }
 
+/* the formats loaded and stored by the block kernel without get/put */
+static snd_pcm_format_t route_block_format(snd_pcm_format_t format)
+{
+	switch (format) {
+	case SND_PCM_FORMAT_S16:
+	case SND_PCM_FORMAT_S32:
+#if SND_PCM_PLUGIN_ROUTE_FLOAT
+	case SND_PCM_FORMAT_FLOAT:
+	case SND_PCM_FORMAT_FLOAT64:
+#endif
+		return format;
+	default:
+		return SND_PCM_FORMAT_UNKNOWN;
+	}
+}
+
+#ifndef DOC_HIDDEN
+int snd_pcm_route_params_setup(snd_pcm_route_params_t *params,
+			       snd_pcm_format_t src_format,
+			       unsigned int src_channels,
+			       snd_pcm_format_t dst_format,
+			       unsigned int dst_channels,
+			       int use_float ATTRIBUTE_UNUSED)
+{
+	if (!snd_pcm_route_format_ok(src_format) ||
+	    !snd_pcm_route_format_ok(dst_format))
+		return -EINVAL;
+	/* 3 bytes or 20-bit formats? */
+	params->use_getput =
+		(snd_pcm_format_physical_width(src_format) + 7) / 8 == 3 ||
+		(snd_pcm_format_physical_width(dst_format) + 7) / 8 == 3 ||
+		snd_pcm_format_width(src_format) == 20 ||
+		snd_pcm_format_width(dst_format) == 20;
+	if (snd_pcm_format_linear(src_format) == 1)
+		params->get_idx = snd_pcm_linear_get_index(src_format, SND_PCM_FORMAT_S32);
+	if (snd_pcm_format_linear(dst_format) == 1)
+		params->put_idx = snd_pcm_linear_put_index(SND_PCM_FORMAT_S32, dst_format);
+	if (snd_pcm_format_linear(src_format) == 1 &&
+	    snd_pcm_format_linear(dst_format) == 1)
+		params->conv_idx = snd_pcm_linear_convert_index(src_format, dst_format);
+	params->src_size = snd_pcm_format_width(src_format) / 8;
+	params->dst_sfmt = dst_format;
+#if SND_PCM_PLUGIN_ROUTE_FLOAT
+	params->sum_idx = FLOAT;
+#else
+	params->sum_idx = UINT64;
+#endif
+	params->load_fmt = route_block_format(src_format);
+	params->store_fmt = route_block_format(dst_format);
+#if SND_PCM_PLUGIN_ROUTE_FLOAT
+	params->use_float = use_float ||
+			    snd_pcm_format_float(src_format) == 1 ||
+			    snd_pcm_format_float(dst_format) == 1;
+#endif
+	return snd_pcm_route_compile(params, src_channels, dst_channels);
+}
+#endif /* DOC_HIDDEN */
+
 static int snd_pcm_route_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 {
 	snd_pcm_route_t *route = pcm->private_data;
 	snd_pcm_t *slave = route->plug.gen.slave;
 	snd_pcm_format_t src_format, dst_format;
+	unsigned int channels;
 	int err = snd_pcm_hw_params_slave(pcm, params,
 					  snd_pcm_route_hw_refine_cchange,
 					  snd_pcm_route_hw_refine_sprepare,
@@ -566,25 +1007,34 @@ static int snd_pcm_route_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 	}
 	if (err < 0)
 		return err;
-	/* 3 bytes or 20-bit formats? */
-	route->params.use_getput =
-		(snd_pcm_format_physical_width(src_format) + 7) / 8 == 3 ||
-		(snd_pcm_format_physical_width(dst_format) + 7) / 8 == 3 ||
-		snd_pcm_format_width(src_format) == 20 ||
-		snd_pcm_format_width(dst_format) == 20;
-	route->params.get_idx = snd_pcm_linear_get_index(src_format, SND_PCM_FORMAT_S32);
-	route->params.put_idx = snd_pcm_linear_put_index(SND_PCM_FORMAT_S32, dst_format);
-	route->params.conv_idx = snd_pcm_linear_convert_index(src_format, dst_format);
-	route->params.src_size = snd_pcm_format_width(src_format) / 8;
-	route->params.dst_sfmt = dst_format;
-#if SND_PCM_PLUGIN_ROUTE_FLOAT
-	route->params.sum_idx = FLOAT;
-#else
-	route->params.sum_idx = UINT64;
-#endif
+	err = INTERNAL(snd_pcm_hw_params_get_channels)(params, &channels);
+	if (err < 0)
+		return err;
+	if (pcm->stream == SND_PCM_STREAM_PLAYBACK)
+		err = snd_pcm_route_params_setup(&route->params,
+						 src_format, channels,
+						 dst_format, slave->channels,
+						 route->use_float);
+	else
+		err = snd_pcm_route_params_setup(&route->params,
+						 src_format, slave->channels,
+						 dst_format, channels,
+						 route->use_float);
+	if (err < 0) {
+		snd_pcm_hw_free(slave);
+		return err;
+	}
 	return 0;
 }
 
+static int snd_pcm_route_hw_free(snd_pcm_t *pcm)
+{
+	snd_pcm_route_t *route = pcm->private_data;
+
+	snd_pcm_route_free_kernel(&route->params);
+	return snd_pcm_generic_hw_free(pcm);
+}
+
 static snd_pcm_uframes_t
 snd_pcm_route_write_areas(snd_pcm_t *pcm,
 			  const snd_pcm_channel_area_t *areas,
@@ -598,11 +1048,11 @@ snd_pcm_route_write_areas(snd_pcm_t *pcm,
 	snd_pcm_t *slave = route->plug.gen.slave;
 	if (size > *slave_sizep)
 		size = *slave_sizep;
-	snd_pcm_route_convert(slave_areas, slave_offset,
-			      areas, offset, 
-			      pcm->channels,
-			      slave->channels,
-			      size, &route->params);
+	snd_pcm_route_params_convert(slave_areas, slave_offset,
+				     areas, offset,
+				     pcm->channels,
+				     slave->channels,
+				     size, &route->params);
 	*slave_sizep = size;
 	return size;
 }
@@ -620,44 +1070,56 @@ snd_pcm_route_read_areas(snd_pcm_t *pcm,
 	snd_pcm_t *slave = route->plug.gen.slave;
 	if (size > *slave_sizep)
 		size = *slave_sizep;
-	snd_pcm_route_convert(areas, offset, 
-			      slave_areas, slave_offset,
-			      slave->channels,
-			      pcm->channels,
-			      size, &route->params);
+	snd_pcm_route_params_convert(areas, offset,
+				     slave_areas, slave_offset,
+				     slave->channels,
+				     pcm->channels,
+				     size, &route->params);
 	*slave_sizep = size;
 	return size;
 }
 
-static snd_pcm_chmap_t *snd_pcm_route_get_chmap(snd_pcm_t *pcm)
+#ifndef DOC_HIDDEN
+/* the client channel map, each source takes the position of its first
+ * destination
+ */
+snd_pcm_chmap_t *snd_pcm_route_params_chmap(const snd_pcm_route_params_t *params,
+					    const snd_pcm_chmap_t *slave_map)
 {
-	snd_pcm_route_t *route = pcm->private_data;
-	snd_pcm_chmap_t *map, *slave_map;
+	snd_pcm_chmap_t *map;
 	unsigned int src, dst, nsrcs;
 
-	if (route->chmap_override)
-		return _snd_pcm_choose_fixed_chmap(pcm, route->chmap_override);
-
-	slave_map = snd_pcm_generic_get_chmap(pcm);
-	if (!slave_map)
-		return NULL;
-	nsrcs = route->params.nsrcs;
+	nsrcs = params->nsrcs;
 	map = calloc(4, nsrcs + 1);
-	if (!map) {
-		free(slave_map);
+	if (!map)
 		return NULL;
-	}
 	map->channels = nsrcs;
 	for (src = 0; src < nsrcs; src++)
 		map->pos[src] = SND_CHMAP_NA;
-	for (dst = 0; dst < route->params.ndsts; dst++) {
-		snd_pcm_route_ttable_dst_t *d = &route->params.dsts[dst];
+	for (dst = 0; dst < params->ndsts; dst++) {
+		snd_pcm_route_ttable_dst_t *d = &params->dsts[dst];
 		for (src = 0; src < d->nsrcs; src++) {
 			unsigned int c = d->srcs[src].channel;
 			if (c < nsrcs && map->pos[c] == SND_CHMAP_NA)
 				map->pos[c] = slave_map->pos[dst];
 		}
 	}
+	return map;
+}
+#endif /* DOC_HIDDEN */
+
+static snd_pcm_chmap_t *snd_pcm_route_get_chmap(snd_pcm_t *pcm)
+{
+	snd_pcm_route_t *route = pcm->private_data;
+	snd_pcm_chmap_t *map, *slave_map;
+
+	if (route->chmap_override)
+		return _snd_pcm_choose_fixed_chmap(pcm, route->chmap_override);
+
+	slave_map = snd_pcm_generic_get_chmap(pcm);
+	if (!slave_map)
+		return NULL;
+	map = snd_pcm_route_params_chmap(&route->params, slave_map);
 	free(slave_map);
 	return map;
 }
@@ -679,18 +1141,14 @@ static snd_pcm_chmap_query_t **snd_pcm_route_query_chmaps(snd_pcm_t *pcm)
 	return maps;
 }
 
-static void snd_pcm_route_dump(snd_pcm_t *pcm, snd_output_t *out)
+#ifndef DOC_HIDDEN
+void snd_pcm_route_params_dump(const snd_pcm_route_params_t *params,
+			       snd_output_t *out)
 {
-	snd_pcm_route_t *route = pcm->private_data;
 	unsigned int dst;
-	if (route->sformat == SND_PCM_FORMAT_UNKNOWN)
-		snd_output_printf(out, "Route conversion PCM\n");
-	else
-		snd_output_printf(out, "Route conversion PCM (sformat=%s)\n", 
-			snd_pcm_format_name(route->sformat));
 	snd_output_puts(out, "  Transformation table:\n");
-	for (dst = 0; dst < route->params.ndsts; dst++) {
-		snd_pcm_route_ttable_dst_t *d = &route->params.dsts[dst];
+	for (dst = 0; dst < params->ndsts; dst++) {
+		snd_pcm_route_ttable_dst_t *d = &params->dsts[dst];
 		unsigned int src;
 		snd_output_printf(out, "    %d <- ", dst);
 		if (d->nsrcs == 0) {
@@ -715,6 +1173,18 @@ static void snd_pcm_route_dump(snd_pcm_t *pcm, snd_output_t *out)
 		}
 		snd_output_putc(out, '\n');
 	}
+}
+#endif /* DOC_HIDDEN */
+
+static void snd_pcm_route_dump(snd_pcm_t *pcm, snd_output_t *out)
+{
+	snd_pcm_route_t *route = pcm->private_data;
+	if (route->sformat == SND_PCM_FORMAT_UNKNOWN)
+		snd_output_printf(out, "Route conversion PCM\n");
+	else
+		snd_output_printf(out, "Route conversion PCM (sformat=%s)\n", 
+			snd_pcm_format_name(route->sformat));
+	snd_pcm_route_params_dump(&route->params, out);
 	if (pcm->setup) {
 		snd_output_printf(out, "Its setup is:\n");
 		snd_pcm_dump_setup(pcm, out);
@@ -914,7 +1384,7 @@ static const snd_pcm_ops_t snd_pcm_route_ops = {
 	.info = snd_pcm_generic_info,
 	.hw_refine = snd_pcm_route_hw_refine,
 	.hw_params = snd_pcm_route_hw_params,
-	.hw_free = snd_pcm_generic_hw_free,
+	.hw_free = snd_pcm_route_hw_free,
 	.sw_params = snd_pcm_generic_sw_params,
 	.channel_info = snd_pcm_generic_channel_info,
 	.dump = snd_pcm_route_dump,
@@ -997,6 +1467,29 @@ static int route_load_ttable(snd_pcm_route_params_t *params, snd_pcm_stream_t st
 	return 0;
 }
 
+#ifndef DOC_HIDDEN
+int snd_pcm_route_params_new(snd_pcm_route_params_t **paramsp,
+			     snd_pcm_stream_t stream,
+			     snd_pcm_route_ttable_entry_t *ttable,
+			     unsigned int tt_ssize,
+			     unsigned int tt_cused, unsigned int tt_sused)
+{
+	snd_pcm_route_params_t *params;
+	int err;
+
+	params = calloc(1, sizeof(*params));
+	if (!params)
+		return -ENOMEM;
+	err = route_load_ttable(params, stream, tt_ssize, ttable, tt_cused, tt_sused);
+	if (err < 0) {
+		snd_pcm_route_params_free(params);
+		return err;
+	}
+	*paramsp = params;
+	return 0;
+}
+#endif /* DOC_HIDDEN */
+
 /**
  * \brief Creates a new Route & Volume PCM
  * \param pcmp Returns created PCM handle
@@ -1026,7 +1519,7 @@ int snd_pcm_route_open(snd_pcm_t **pcmp, const char *name,
 	int err;
 	assert(pcmp && slave && ttable);
 	if (sformat != SND_PCM_FORMAT_UNKNOWN && 
-	    snd_pcm_format_linear(sformat) != 1)
+	    !snd_pcm_route_format_ok(sformat))
 		return -EINVAL;
 	route = calloc(1, sizeof(snd_pcm_route_t));
 	if (!route) {
@@ -1261,9 +1754,15 @@ pcm.name {
                 }
         }
         [chmap MAP]             # Override channel maps; MAP is a string array
+        [float BOOL]            # Mix in float also for integer formats
 }
 \endcode
 
+The samples are mixed in float, normalized to -1.0 .. 1.0, when the
+client or the slave format is FLOAT or FLOAT64 (native endian), or when
+the float option is set.  The float formats are then routed without
+a conversion through the lfloat plugin.
+
 \subsection pcm_plugins_route_funcref Function reference
 
 <UL>
@@ -1302,6 +1801,7 @@ int _snd_pcm_route_open(snd_pcm_t **pcmp, const char *name,
 	unsigned int csize, ssize;
 	unsigned int cused, sused;
 	snd_pcm_chmap_query_t **chmaps = NULL;
+	int use_float = 0;
 	snd_config_for_each(i, next, conf) {
 		snd_config_t *n = snd_config_iterator_entry(i);
 		const char *id;
@@ -1330,6 +1830,15 @@ int _snd_pcm_route_open(snd_pcm_t **pcmp, const char *name,
 			}
 			continue;
 		}
+		if (strcmp(id, "float") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0) {
+				snd_pcm_free_chmaps(chmaps);
+				return err;
+			}
+			use_float = err;
+			continue;
+		}
 		SNDERR("Unknown field %s", id);
 		return -EINVAL;
 	}
@@ -1351,9 +1860,9 @@ int _snd_pcm_route_open(snd_pcm_t **pcmp, const char *name,
 		return err;
 	}
 	if (sformat != SND_PCM_FORMAT_UNKNOWN &&
-	    snd_pcm_format_linear(sformat) != 1) {
+	    !snd_pcm_route_format_ok(sformat)) {
 	    	snd_config_delete(sconf);
-		SNDERR("slave format is not linear");
+		SNDERR("slave format is not linear or float");
 		snd_pcm_free_chmaps(chmaps);
 		return -EINVAL;
 	}
@@ -1425,6 +1934,7 @@ int _snd_pcm_route_open(snd_pcm_t **pcmp, const char *name,
 
 		route->chmap = chmap;
 		route->chmap_override = chmaps;
+		route->use_float = use_float;
 	}
 
 	return err;
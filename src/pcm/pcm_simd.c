@@ -0,0 +1,1464 @@
+/*
+ *  PCM - vectorized sample format conversions
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * The conversions of plugin_ops.h go sample by sample through a host
+ * endian 32-bit value.  This file does the same in vectors for the
+ * common signed formats: S16, S32, S24_3LE and FLOAT in both byte
+ * orders.  A conversion is a "get" kernel (format -> 32-bit) followed by
+ * a "put" kernel (32-bit -> format) on a small block, so each format
+ * needs only one kernel per direction.  The results are identical to
+ * the labels in plugin_ops.h.
+ *
+ * Only the interleaved buffers and the buffers with a contiguous area
+ * per channel are handled, the callers fall back to plugin_ops.h when
+ * the functions here return an error.  The kernels are selected once at
+ * runtime by the CPU features (SSE2, SSSE3 and AVX2 on x86-64, NEON on
+ * AArch64).
+ *
+ * The interleave and deinterleave kernels for snd_pcm_areas_copy() need
+ * only the base instruction sets, this file is therefore built also
+ * without the PCM plugins.
+ */
+
+#include "pcm_local.h"
+#include "pcm_plugin.h"
+#include "bswap.h"
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+
+#if defined(__x86_64__) && \
+    (defined(__clang__) || \
+     (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define PCM_SIMD_X86_64
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON) && \
+      defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define PCM_SIMD_AARCH64
+#include <arm_neon.h>
+#endif
+
+#ifndef DOC_HIDDEN
+
+/* the sample types, host endian and swapped */
+enum {
+	SIMD_S16,
+	SIMD_S16_SWAP,
+	SIMD_S32,
+	SIMD_S32_SWAP,
+	SIMD_S24_3,
+	SIMD_S24_3_SWAP,
+	SIMD_FLOAT,
+	SIMD_FLOAT_SWAP,
+	SIMD_TYPES
+};
+
+#define SIMD_BLOCK	256	/* samples converted through the 32-bit buffer */
+
+typedef void (*simd_get_t)(int32_t *dst, const unsigned char *src, unsigned int samples);
+typedef void (*simd_put_t)(unsigned char *dst, const int32_t *src, unsigned int samples);
+
+#if defined(PCM_SIMD_X86_64) || defined(PCM_SIMD_AARCH64)
+
+static const unsigned char simd_bytes[SIMD_TYPES] = { 2, 2, 4, 4, 3, 3, 4, 4 };
+static simd_get_t simd_get[SIMD_TYPES];
+static simd_put_t simd_put[SIMD_TYPES];
+
+/*
+ * the scalar code for the remaining samples, the same as the labels
+ * in plugin_ops.h
+ */
+static void simd_get_tail(unsigned int type, int32_t *dst,
+			  const unsigned char *src, unsigned int i,
+			  unsigned int samples)
+{
+	union {
+		float f;
+		uint32_t i;
+	} tmp;
+	uint32_t sample;
+
+	for (src += i * simd_bytes[type]; i < samples; i++, src += simd_bytes[type]) {
+		switch (type) {
+		case SIMD_S16:
+			sample = (uint32_t)*(const uint16_t *)src << 16;
+			break;
+		case SIMD_S16_SWAP:
+			sample = (uint32_t)bswap_16(*(const uint16_t *)src) << 16;
+			break;
+		case SIMD_S32:
+			sample = *(const uint32_t *)src;
+			break;
+		case SIMD_S32_SWAP:
+			sample = bswap_32(*(const uint32_t *)src);
+			break;
+		case SIMD_S24_3:
+			sample = ((uint32_t)src[0] << 8) | ((uint32_t)src[1] << 16) |
+				 ((uint32_t)src[2] << 24);
+			break;
+		case SIMD_S24_3_SWAP:
+			sample = ((uint32_t)src[2] << 8) | ((uint32_t)src[1] << 16) |
+				 ((uint32_t)src[0] << 24);
+			break;
+		default:
+			tmp.i = *(const uint32_t *)src;
+			if (type == SIMD_FLOAT_SWAP)
+				tmp.i = bswap_32(tmp.i);
+			if (tmp.f >= 1.0)
+				sample = 0x7fffffff;
+			else if (tmp.f <= -1.0)
+				sample = 0x80000000;
+			else
+				sample = (int32_t)(tmp.f * (float)0x80000000UL);
+			break;
+		}
+		dst[i] = sample;
+	}
+}
+
+static void simd_put_tail(unsigned int type, unsigned char *dst,
+			  const int32_t *src, unsigned int i,
+			  unsigned int samples)
+{
+	union {
+		float f;
+		uint32_t i;
+	} tmp;
+	uint32_t sample;
+
+	for (dst += i * simd_bytes[type]; i < samples; i++, dst += simd_bytes[type]) {
+		sample = src[i];
+		switch (type) {
+		case SIMD_S16:
+			*(uint16_t *)dst = sample >> 16;
+			break;
+		case SIMD_S16_SWAP:
+			*(uint16_t *)dst = bswap_16(sample >> 16);
+			break;
+		case SIMD_S32:
+			*(uint32_t *)dst = sample;
+			break;
+		case SIMD_S32_SWAP:
+			*(uint32_t *)dst = bswap_32(sample);
+			break;
+		case SIMD_S24_3:
+			dst[0] = sample >> 8;
+			dst[1] = sample >> 16;
+			dst[2] = sample >> 24;
+			break;
+		case SIMD_S24_3_SWAP:
+			dst[0] = sample >> 24;
+			dst[1] = sample >> 16;
+			dst[2] = sample >> 8;
+			break;
+		default:
+			tmp.f = (float)(int32_t)sample / (float)0x80000000UL;
+			if (type == SIMD_FLOAT_SWAP)
+				tmp.i = bswap_32(tmp.i);
+			*(uint32_t *)dst = tmp.i;
+			break;
+		}
+	}
+}
+
+static void simd_get_s32(int32_t *dst, const unsigned char *src,
+			 unsigned int samples)
+{
+	memcpy(dst, src, samples * 4);
+}
+
+static void simd_put_s32(unsigned char *dst, const int32_t *src,
+			 unsigned int samples)
+{
+	memcpy(dst, src, samples * 4);
+}
+
+#endif /* PCM_SIMD_X86_64 || PCM_SIMD_AARCH64 */
+
+#ifdef PCM_SIMD_X86_64
+
+static inline __m128i simd_swap16_sse2(__m128i x)
+{
+	return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+static inline __m128i simd_swap32_sse2(__m128i x)
+{
+	x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+	x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+	return simd_swap16_sse2(x);
+}
+
+/* the float in [-1.0, 1.0) to 32-bit, the overflow of the conversion
+ * is 0x80000000, flip it to 0x7fffffff for the positive values
+ */
+static inline __m128i simd_float_s32_sse2(__m128 f)
+{
+	const __m128 scale = _mm_set1_ps((float)0x80000000UL);
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128i r = _mm_cvttps_epi32(_mm_mul_ps(f, scale));
+
+	return _mm_xor_si128(r, _mm_castps_si128(_mm_cmpge_ps(f, one)));
+}
+
+static inline __m128 simd_s32_float_sse2(__m128i x)
+{
+	const __m128 scale = _mm_set1_ps(1.0f / (float)0x80000000UL);
+
+	return _mm_mul_ps(_mm_cvtepi32_ps(x), scale);
+}
+
+static void simd_get_s16_sse2(int32_t *dst, const unsigned char *src,
+			      unsigned int samples)
+{
+	const __m128i zero = _mm_setzero_si128();
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i * 2));
+
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi16(zero, x));
+		_mm_storeu_si128((__m128i *)(dst + i + 4), _mm_unpackhi_epi16(zero, x));
+	}
+	simd_get_tail(SIMD_S16, dst, src, i, samples);
+}
+
+static void simd_get_s16_swap_sse2(int32_t *dst, const unsigned char *src,
+				   unsigned int samples)
+{
+	const __m128i zero = _mm_setzero_si128();
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i * 2));
+
+		x = simd_swap16_sse2(x);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi16(zero, x));
+		_mm_storeu_si128((__m128i *)(dst + i + 4), _mm_unpackhi_epi16(zero, x));
+	}
+	simd_get_tail(SIMD_S16_SWAP, dst, src, i, samples);
+}
+
+static void simd_get_s32_swap_sse2(int32_t *dst, const unsigned char *src,
+				   unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= samples; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i * 4));
+
+		_mm_storeu_si128((__m128i *)(dst + i), simd_swap32_sse2(x));
+	}
+	simd_get_tail(SIMD_S32_SWAP, dst, src, i, samples);
+}
+
+static void simd_get_float_sse2(int32_t *dst, const unsigned char *src,
+				unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= samples; i += 4) {
+		__m128 f = _mm_loadu_ps((const float *)(src + i * 4));
+
+		_mm_storeu_si128((__m128i *)(dst + i), simd_float_s32_sse2(f));
+	}
+	simd_get_tail(SIMD_FLOAT, dst, src, i, samples);
+}
+
+static void simd_get_float_swap_sse2(int32_t *dst, const unsigned char *src,
+				     unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= samples; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i * 4));
+		__m128 f = _mm_castsi128_ps(simd_swap32_sse2(x));
+
+		_mm_storeu_si128((__m128i *)(dst + i), simd_float_s32_sse2(f));
+	}
+	simd_get_tail(SIMD_FLOAT_SWAP, dst, src, i, samples);
+}
+
+static void simd_put_s16_sse2(unsigned char *dst, const int32_t *src,
+			      unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		__m128i a = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(src + i)), 16);
+		__m128i b = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(src + i + 4)), 16);
+
+		_mm_storeu_si128((__m128i *)(dst + i * 2), _mm_packs_epi32(a, b));
+	}
+	simd_put_tail(SIMD_S16, dst, src, i, samples);
+}
+
+static void simd_put_s16_swap_sse2(unsigned char *dst, const int32_t *src,
+				   unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		__m128i a = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(src + i)), 16);
+		__m128i b = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(src + i + 4)), 16);
+
+		_mm_storeu_si128((__m128i *)(dst + i * 2),
+				 simd_swap16_sse2(_mm_packs_epi32(a, b)));
+	}
+	simd_put_tail(SIMD_S16_SWAP, dst, src, i, samples);
+}
+
+static void simd_put_s32_swap_sse2(unsigned char *dst, const int32_t *src,
+				   unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= samples; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+
+		_mm_storeu_si128((__m128i *)(dst + i * 4), simd_swap32_sse2(x));
+	}
+	simd_put_tail(SIMD_S32_SWAP, dst, src, i, samples);
+}
+
+static void simd_put_float_sse2(unsigned char *dst, const int32_t *src,
+				unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= samples; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+
+		_mm_storeu_ps((float *)(dst + i * 4), simd_s32_float_sse2(x));
+	}
+	simd_put_tail(SIMD_FLOAT, dst, src, i, samples);
+}
+
+static void simd_put_float_swap_sse2(unsigned char *dst, const int32_t *src,
+				     unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= samples; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+
+		x = _mm_castps_si128(simd_s32_float_sse2(x));
+		_mm_storeu_si128((__m128i *)(dst + i * 4), simd_swap32_sse2(x));
+	}
+	simd_put_tail(SIMD_FLOAT_SWAP, dst, src, i, samples);
+}
+
+/* 16 bytes are loaded for 4 samples, don't read over the end */
+#define SIMD_GET_S24_3_SSSE3(name, type, b0, b1, b2)			\
+__attribute__((target("ssse3")))					\
+static void name(int32_t *dst, const unsigned char *src,		\
+		 unsigned int samples)					\
+{									\
+	const __m128i expand = _mm_setr_epi8(-1, b0, b1, b2,		\
+					     -1, b0 + 3, b1 + 3, b2 + 3, \
+					     -1, b0 + 6, b1 + 6, b2 + 6, \
+					     -1, b0 + 9, b1 + 9, b2 + 9); \
+	unsigned int i;							\
+									\
+	for (i = 0; i + 6 <= samples; i += 4) {				\
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i * 3)); \
+									\
+		_mm_storeu_si128((__m128i *)(dst + i),			\
+				 _mm_shuffle_epi8(x, expand));		\
+	}								\
+	simd_get_tail(type, dst, src, i, samples);			\
+}
+
+#define SIMD_PUT_S24_3_SSSE3(name, type, b0, b1, b2)			\
+__attribute__((target("ssse3")))					\
+static void name(unsigned char *dst, const int32_t *src,		\
+		 unsigned int samples)					\
+{									\
+	const __m128i pack = _mm_setr_epi8(b0, b1, b2,			\
+					   b0 + 4, b1 + 4, b2 + 4,	\
+					   b0 + 8, b1 + 8, b2 + 8,	\
+					   b0 + 12, b1 + 12, b2 + 12,	\
+					   -1, -1, -1, -1);		\
+	unsigned int i;							\
+									\
+	for (i = 0; i + 4 <= samples; i += 4) {				\
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i)); \
+		unsigned char *d3 = dst + i * 3;			\
+		int tail;						\
+									\
+		x = _mm_shuffle_epi8(x, pack);				\
+		_mm_storel_epi64((__m128i *)d3, x);			\
+		tail = _mm_cvtsi128_si32(_mm_srli_si128(x, 8));		\
+		memcpy(d3 + 8, &tail, 4);				\
+	}								\
+	simd_put_tail(type, dst, src, i, samples);			\
+}
+
+SIMD_GET_S24_3_SSSE3(simd_get_s24_3_ssse3, SIMD_S24_3, 0, 1, 2)
+SIMD_GET_S24_3_SSSE3(simd_get_s24_3_swap_ssse3, SIMD_S24_3_SWAP, 2, 1, 0)
+SIMD_PUT_S24_3_SSSE3(simd_put_s24_3_ssse3, SIMD_S24_3, 1, 2, 3)
+SIMD_PUT_S24_3_SSSE3(simd_put_s24_3_swap_ssse3, SIMD_S24_3_SWAP, 3, 2, 1)
+
+__attribute__((target("avx2")))
+static void simd_get_s16_avx2(int32_t *dst, const unsigned char *src,
+			      unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i * 2));
+
+		_mm256_storeu_si256((__m256i *)(dst + i),
+				    _mm256_slli_epi32(_mm256_cvtepu16_epi32(x), 16));
+	}
+	simd_get_tail(SIMD_S16, dst, src, i, samples);
+}
+
+__attribute__((target("avx2")))
+static void simd_put_s16_avx2(unsigned char *dst, const int32_t *src,
+			      unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 16 <= samples; i += 16) {
+		__m256i a = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(src + i)), 16);
+		__m256i b = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(src + i + 8)), 16);
+
+		/* the pack works on the 128-bit lanes, restore the order */
+		_mm256_storeu_si256((__m256i *)(dst + i * 2),
+				    _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b),
+							     _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+	simd_put_s16_sse2(dst + i * 2, src + i, samples - i);
+}
+
+__attribute__((target("avx2")))
+static void simd_get_float_avx2(int32_t *dst, const unsigned char *src,
+				unsigned int samples)
+{
+	const __m256 scale = _mm256_set1_ps((float)0x80000000UL);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		__m256 f = _mm256_loadu_ps((const float *)(src + i * 4));
+		__m256i r = _mm256_cvttps_epi32(_mm256_mul_ps(f, scale));
+
+		r = _mm256_xor_si256(r, _mm256_castps_si256(_mm256_cmp_ps(f, one, _CMP_GE_OQ)));
+		_mm256_storeu_si256((__m256i *)(dst + i), r);
+	}
+	simd_get_float_sse2(dst + i, src + i * 4, samples - i);
+}
+
+__attribute__((target("avx2")))
+static void simd_put_float_avx2(unsigned char *dst, const int32_t *src,
+				unsigned int samples)
+{
+	const __m256 scale = _mm256_set1_ps(1.0f / (float)0x80000000UL);
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+
+		_mm256_storeu_ps((float *)(dst + i * 4),
+				 _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+	}
+	simd_put_float_sse2(dst + i * 4, src + i, samples - i);
+}
+
+static void simd_select(void)
+{
+	int ssse3, avx2;
+
+	/* cpuid, the AVX2 check includes the OS support of the YMM state */
+	__builtin_cpu_init();
+	ssse3 = __builtin_cpu_supports("ssse3");
+	avx2 = __builtin_cpu_supports("avx2");
+
+	simd_get[SIMD_S16] = avx2 ? simd_get_s16_avx2 : simd_get_s16_sse2;
+	simd_get[SIMD_S16_SWAP] = simd_get_s16_swap_sse2;
+	simd_get[SIMD_S32] = simd_get_s32;
+	simd_get[SIMD_S32_SWAP] = simd_get_s32_swap_sse2;
+	simd_get[SIMD_FLOAT] = avx2 ? simd_get_float_avx2 : simd_get_float_sse2;
+	simd_get[SIMD_FLOAT_SWAP] = simd_get_float_swap_sse2;
+	simd_put[SIMD_S16] = avx2 ? simd_put_s16_avx2 : simd_put_s16_sse2;
+	simd_put[SIMD_S16_SWAP] = simd_put_s16_swap_sse2;
+	simd_put[SIMD_S32] = simd_put_s32;
+	simd_put[SIMD_S32_SWAP] = simd_put_s32_swap_sse2;
+	simd_put[SIMD_FLOAT] = avx2 ? simd_put_float_avx2 : simd_put_float_sse2;
+	simd_put[SIMD_FLOAT_SWAP] = simd_put_float_swap_sse2;
+	/* the 3-byte formats need the byte shuffle */
+	if (ssse3) {
+		simd_get[SIMD_S24_3] = simd_get_s24_3_ssse3;
+		simd_get[SIMD_S24_3_SWAP] = simd_get_s24_3_swap_ssse3;
+		simd_put[SIMD_S24_3] = simd_put_s24_3_ssse3;
+		simd_put[SIMD_S24_3_SWAP] = simd_put_s24_3_swap_ssse3;
+	}
+}
+
+#endif /* PCM_SIMD_X86_64 */
+
+#ifdef PCM_SIMD_AARCH64
+
+static void simd_get_s16_neon(int32_t *dst, const unsigned char *src,
+			      unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		uint16x8_t x = vld1q_u16((const uint16_t *)(src + i * 2));
+
+		vst1q_s32(dst + i, vreinterpretq_s32_u32(vshll_n_u16(vget_low_u16(x), 16)));
+		vst1q_s32(dst + i + 4, vreinterpretq_s32_u32(vshll_high_n_u16(x, 16)));
+	}
+	simd_get_tail(SIMD_S16, dst, src, i, samples);
+}
+
+static void simd_get_s16_swap_neon(int32_t *dst, const unsigned char *src,
+				   unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		uint16x8_t x = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(src + i * 2)));
+
+		vst1q_s32(dst + i, vreinterpretq_s32_u32(vshll_n_u16(vget_low_u16(x), 16)));
+		vst1q_s32(dst + i + 4, vreinterpretq_s32_u32(vshll_high_n_u16(x, 16)));
+	}
+	simd_get_tail(SIMD_S16_SWAP, dst, src, i, samples);
+}
+
+static void simd_get_s32_swap_neon(int32_t *dst, const unsigned char *src,
+				   unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= samples; i += 4)
+		vst1q_s32(dst + i, vreinterpretq_s32_u8(vrev32q_u8(vld1q_u8(src + i * 4))));
+	simd_get_tail(SIMD_S32_SWAP, dst, src, i, samples);
+}
+
+/* the fixed point conversion saturates like the scalar code */
+static void simd_get_float_neon(int32_t *dst, const unsigned char *src,
+				unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= samples; i += 4)
+		vst1q_s32(dst + i, vcvtq_n_s32_f32(vld1q_f32((const float *)(src + i * 4)), 31));
+	simd_get_tail(SIMD_FLOAT, dst, src, i, samples);
+}
+
+static void simd_get_float_swap_neon(int32_t *dst, const unsigned char *src,
+				     unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= samples; i += 4) {
+		float32x4_t f = vreinterpretq_f32_u8(vrev32q_u8(vld1q_u8(src + i * 4)));
+
+		vst1q_s32(dst + i, vcvtq_n_s32_f32(f, 31));
+	}
+	simd_get_tail(SIMD_FLOAT_SWAP, dst, src, i, samples);
+}
+
+static void simd_put_s16_neon(unsigned char *dst, const int32_t *src,
+			      unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		uint32x4_t a = vreinterpretq_u32_s32(vld1q_s32(src + i));
+		uint32x4_t b = vreinterpretq_u32_s32(vld1q_s32(src + i + 4));
+
+		vst1q_u16((uint16_t *)(dst + i * 2),
+			  vcombine_u16(vshrn_n_u32(a, 16), vshrn_n_u32(b, 16)));
+	}
+	simd_put_tail(SIMD_S16, dst, src, i, samples);
+}
+
+static void simd_put_s16_swap_neon(unsigned char *dst, const int32_t *src,
+				   unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		uint32x4_t a = vreinterpretq_u32_s32(vld1q_s32(src + i));
+		uint32x4_t b = vreinterpretq_u32_s32(vld1q_s32(src + i + 4));
+		uint16x8_t x = vcombine_u16(vshrn_n_u32(a, 16), vshrn_n_u32(b, 16));
+
+		vst1q_u8(dst + i * 2, vrev16q_u8(vreinterpretq_u8_u16(x)));
+	}
+	simd_put_tail(SIMD_S16_SWAP, dst, src, i, samples);
+}
+
+static void simd_put_s32_swap_neon(unsigned char *dst, const int32_t *src,
+				   unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= samples; i += 4)
+		vst1q_u8(dst + i * 4, vrev32q_u8(vreinterpretq_u8_s32(vld1q_s32(src + i))));
+	simd_put_tail(SIMD_S32_SWAP, dst, src, i, samples);
+}
+
+static void simd_put_float_neon(unsigned char *dst, const int32_t *src,
+				unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= samples; i += 4)
+		vst1q_f32((float *)(dst + i * 4), vcvtq_n_f32_s32(vld1q_s32(src + i), 31));
+	simd_put_tail(SIMD_FLOAT, dst, src, i, samples);
+}
+
+static void simd_put_float_swap_neon(unsigned char *dst, const int32_t *src,
+				     unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= samples; i += 4) {
+		float32x4_t f = vcvtq_n_f32_s32(vld1q_s32(src + i), 31);
+
+		vst1q_u8(dst + i * 4, vrev32q_u8(vreinterpretq_u8_f32(f)));
+	}
+	simd_put_tail(SIMD_FLOAT_SWAP, dst, src, i, samples);
+}
+
+/* the table lookup gives zero for the out of range indexes (0xff) */
+#define SIMD_GET_S24_3_NEON(name, type, b0, b1, b2)			\
+static void name(int32_t *dst, const unsigned char *src,		\
+		 unsigned int samples)					\
+{									\
+	static const uint8_t expand_idx[16] = {				\
+		0xff, b0, b1, b2, 0xff, b0 + 3, b1 + 3, b2 + 3,		\
+		0xff, b0 + 6, b1 + 6, b2 + 6, 0xff, b0 + 9, b1 + 9, b2 + 9 \
+	};								\
+	const uint8x16_t expand = vld1q_u8(expand_idx);			\
+	unsigned int i;							\
+									\
+	for (i = 0; i + 6 <= samples; i += 4) {				\
+		uint8x16_t x = vqtbl1q_u8(vld1q_u8(src + i * 3), expand); \
+									\
+		vst1q_s32(dst + i, vreinterpretq_s32_u8(x));		\
+	}								\
+	simd_get_tail(type, dst, src, i, samples);			\
+}
+
+#define SIMD_PUT_S24_3_NEON(name, type, b0, b1, b2)			\
+static void name(unsigned char *dst, const int32_t *src,		\
+		 unsigned int samples)					\
+{									\
+	static const uint8_t pack_idx[16] = {				\
+		b0, b1, b2, b0 + 4, b1 + 4, b2 + 4, b0 + 8, b1 + 8,	\
+		b2 + 8, b0 + 12, b1 + 12, b2 + 12, 0xff, 0xff, 0xff, 0xff \
+	};								\
+	const uint8x16_t pack = vld1q_u8(pack_idx);			\
+	unsigned int i;							\
+									\
+	for (i = 0; i + 4 <= samples; i += 4) {				\
+		uint8x16_t x = vqtbl1q_u8(vreinterpretq_u8_s32(vld1q_s32(src + i)), pack); \
+		unsigned char *d3 = dst + i * 3;			\
+									\
+		vst1_u8(d3, vget_low_u8(x));				\
+		vst1q_lane_u32((uint32_t *)(d3 + 8), vreinterpretq_u32_u8(x), 2); \
+	}								\
+	simd_put_tail(type, dst, src, i, samples);			\
+}
+
+SIMD_GET_S24_3_NEON(simd_get_s24_3_neon, SIMD_S24_3, 0, 1, 2)
+SIMD_GET_S24_3_NEON(simd_get_s24_3_swap_neon, SIMD_S24_3_SWAP, 2, 1, 0)
+SIMD_PUT_S24_3_NEON(simd_put_s24_3_neon, SIMD_S24_3, 1, 2, 3)
+SIMD_PUT_S24_3_NEON(simd_put_s24_3_swap_neon, SIMD_S24_3_SWAP, 3, 2, 1)
+
+static void simd_select(void)
+{
+	simd_get[SIMD_S16] = simd_get_s16_neon;
+	simd_get[SIMD_S16_SWAP] = simd_get_s16_swap_neon;
+	simd_get[SIMD_S32] = simd_get_s32;
+	simd_get[SIMD_S32_SWAP] = simd_get_s32_swap_neon;
+	simd_get[SIMD_S24_3] = simd_get_s24_3_neon;
+	simd_get[SIMD_S24_3_SWAP] = simd_get_s24_3_swap_neon;
+	simd_get[SIMD_FLOAT] = simd_get_float_neon;
+	simd_get[SIMD_FLOAT_SWAP] = simd_get_float_swap_neon;
+	simd_put[SIMD_S16] = simd_put_s16_neon;
+	simd_put[SIMD_S16_SWAP] = simd_put_s16_swap_neon;
+	simd_put[SIMD_S32] = simd_put_s32;
+	simd_put[SIMD_S32_SWAP] = simd_put_s32_swap_neon;
+	simd_put[SIMD_S24_3] = simd_put_s24_3_neon;
+	simd_put[SIMD_S24_3_SWAP] = simd_put_s24_3_swap_neon;
+	simd_put[SIMD_FLOAT] = simd_put_float_neon;
+	simd_put[SIMD_FLOAT_SWAP] = simd_put_float_swap_neon;
+}
+
+#endif /* PCM_SIMD_AARCH64 */
+
+#if defined(PCM_SIMD_X86_64) || defined(PCM_SIMD_AARCH64)
+
+/* the areas of all channels are interleaved in a single buffer */
+static int simd_interleaved(const snd_pcm_channel_area_t *areas,
+			    unsigned int channels, unsigned int width)
+{
+	unsigned int ch;
+
+	if (areas[0].first % 8)
+		return 0;
+	for (ch = 0; ch < channels; ch++) {
+		if (areas[ch].addr != areas[0].addr ||
+		    areas[ch].first != areas[0].first + ch * width ||
+		    areas[ch].step != channels * width)
+			return 0;
+	}
+	return 1;
+}
+
+/* each channel has a contiguous area */
+static int simd_contiguous(const snd_pcm_channel_area_t *areas,
+			   unsigned int channels, unsigned int width)
+{
+	unsigned int ch;
+
+	for (ch = 0; ch < channels; ch++) {
+		if (areas[ch].first % 8 || areas[ch].step != width)
+			return 0;
+	}
+	return 1;
+}
+
+static void simd_convert_buffer(unsigned int get_type, unsigned int put_type,
+				unsigned char *dst, const unsigned char *src,
+				snd_pcm_uframes_t samples)
+{
+	simd_get_t get = simd_get[get_type];
+	simd_put_t put = simd_put[put_type];
+	int32_t tmp[SIMD_BLOCK];
+
+	if (get_type == SIMD_S32) {
+		while (samples > 0) {
+			unsigned int n = samples < SIMD_BLOCK ? samples : SIMD_BLOCK;
+
+			put(dst, (const int32_t *)src, n);
+			src += n * 4;
+			dst += n * simd_bytes[put_type];
+			samples -= n;
+		}
+		return;
+	}
+	if (put_type == SIMD_S32) {
+		while (samples > 0) {
+			unsigned int n = samples < SIMD_BLOCK ? samples : SIMD_BLOCK;
+
+			get((int32_t *)dst, src, n);
+			src += n * simd_bytes[get_type];
+			dst += n * 4;
+			samples -= n;
+		}
+		return;
+	}
+	while (samples > 0) {
+		unsigned int n = samples < SIMD_BLOCK ? samples : SIMD_BLOCK;
+
+		get(tmp, src, n);
+		put(dst, tmp, n);
+		src += n * simd_bytes[get_type];
+		dst += n * simd_bytes[put_type];
+		samples -= n;
+	}
+}
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_once_t simd_select_once = PTHREAD_ONCE_INIT;
+#endif
+
+static int simd_convert(const snd_pcm_channel_area_t *dst_areas,
+			snd_pcm_uframes_t dst_offset,
+			const snd_pcm_channel_area_t *src_areas,
+			snd_pcm_uframes_t src_offset,
+			unsigned int channels, snd_pcm_uframes_t frames,
+			int get_type, int put_type)
+{
+#ifndef HAVE_LIBPTHREAD
+	static int selected;
+#endif
+	unsigned int src_width, dst_width, ch;
+
+	if (get_type < 0 || put_type < 0 || !channels)
+		return -EINVAL;
+#ifdef HAVE_LIBPTHREAD
+	pthread_once(&simd_select_once, simd_select);
+#else
+	/* without threads there is no race */
+	if (!selected) {
+		simd_select();
+		selected = 1;
+	}
+#endif
+	if (!simd_get[get_type] || !simd_put[put_type])
+		return -EINVAL;
+	src_width = simd_bytes[get_type] * 8;
+	dst_width = simd_bytes[put_type] * 8;
+	if (simd_interleaved(src_areas, channels, src_width) &&
+	    simd_interleaved(dst_areas, channels, dst_width)) {
+		simd_convert_buffer(get_type, put_type,
+				    snd_pcm_channel_area_addr(dst_areas, dst_offset),
+				    snd_pcm_channel_area_addr(src_areas, src_offset),
+				    frames * channels);
+		return 0;
+	}
+	if (simd_contiguous(src_areas, channels, src_width) &&
+	    simd_contiguous(dst_areas, channels, dst_width)) {
+		for (ch = 0; ch < channels; ch++)
+			simd_convert_buffer(get_type, put_type,
+					    snd_pcm_channel_area_addr(&dst_areas[ch], dst_offset),
+					    snd_pcm_channel_area_addr(&src_areas[ch], src_offset),
+					    frames);
+		return 0;
+	}
+	return -EINVAL;
+}
+
+/*
+ * interleave and deinterleave
+ *
+ * The channels are transposed in square blocks of 128-bit vectors with
+ * the lo/hi zips of 16, 32 and 64-bit elements (SSE2 unpack or NEON
+ * zip1/zip2), the same kernels serve both directions.
+ */
+#ifdef PCM_SIMD_X86_64
+
+typedef __m128i simd_vec_t;
+
+#define simd_zero()		_mm_setzero_si128()
+#define simd_load(p)		_mm_loadu_si128((const __m128i *)(p))
+#define simd_store(p, v)	_mm_storeu_si128((__m128i *)(p), v)
+#define simd_load64(p)		_mm_loadl_epi64((const __m128i *)(p))
+#define simd_store64(p, v)	_mm_storel_epi64((__m128i *)(p), v)
+#define simd_zip16lo(a, b)	_mm_unpacklo_epi16(a, b)
+#define simd_zip16hi(a, b)	_mm_unpackhi_epi16(a, b)
+#define simd_zip32lo(a, b)	_mm_unpacklo_epi32(a, b)
+#define simd_zip32hi(a, b)	_mm_unpackhi_epi32(a, b)
+#define simd_zip64lo(a, b)	_mm_unpacklo_epi64(a, b)
+#define simd_zip64hi(a, b)	_mm_unpackhi_epi64(a, b)
+
+static inline simd_vec_t simd_load32(const unsigned char *p)
+{
+	int v;
+
+	memcpy(&v, p, 4);
+	return _mm_cvtsi32_si128(v);
+}
+
+static inline void simd_store32(unsigned char *p, simd_vec_t x)
+{
+	int v = _mm_cvtsi128_si32(x);
+
+	memcpy(p, &v, 4);
+}
+
+#else /* PCM_SIMD_AARCH64 */
+
+typedef uint8x16_t simd_vec_t;
+
+#define simd_zero()		vdupq_n_u8(0)
+#define simd_load(p)		vld1q_u8(p)
+#define simd_store(p, v)	vst1q_u8(p, v)
+#define simd_load64(p)		vcombine_u8(vld1_u8(p), vdup_n_u8(0))
+#define simd_store64(p, v)	vst1_u8(p, vget_low_u8(v))
+#define SIMD_ZIP(name, op, type)					\
+static inline simd_vec_t name(simd_vec_t a, simd_vec_t b)		\
+{									\
+	return vreinterpretq_u8_##type(op(vreinterpretq_##type##_u8(a),	\
+					  vreinterpretq_##type##_u8(b)));	\
+}
+SIMD_ZIP(simd_zip16lo, vzip1q_u16, u16)
+SIMD_ZIP(simd_zip16hi, vzip2q_u16, u16)
+SIMD_ZIP(simd_zip32lo, vzip1q_u32, u32)
+SIMD_ZIP(simd_zip32hi, vzip2q_u32, u32)
+SIMD_ZIP(simd_zip64lo, vzip1q_u64, u64)
+SIMD_ZIP(simd_zip64hi, vzip2q_u64, u64)
+
+static inline simd_vec_t simd_load32(const unsigned char *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, 4);
+	return vreinterpretq_u8_u32(vsetq_lane_u32(v, vdupq_n_u32(0), 0));
+}
+
+static inline void simd_store32(unsigned char *p, simd_vec_t x)
+{
+	uint32_t v = vgetq_lane_u32(vreinterpretq_u32_u8(x), 0);
+
+	memcpy(p, &v, 4);
+}
+
+#endif /* PCM_SIMD_X86_64 */
+
+/* transpose 8 rows of 8 16-bit samples */
+static inline void simd_transpose16x8(simd_vec_t *o, const simd_vec_t *r)
+{
+	simd_vec_t t[8], u[8];
+	unsigned int k;
+
+	for (k = 0; k < 4; k++) {
+		t[k * 2] = simd_zip16lo(r[k * 2], r[k * 2 + 1]);
+		t[k * 2 + 1] = simd_zip16hi(r[k * 2], r[k * 2 + 1]);
+	}
+	for (k = 0; k < 2; k++) {
+		u[k * 4 + 0] = simd_zip32lo(t[k * 4 + 0], t[k * 4 + 2]);
+		u[k * 4 + 1] = simd_zip32hi(t[k * 4 + 0], t[k * 4 + 2]);
+		u[k * 4 + 2] = simd_zip32lo(t[k * 4 + 1], t[k * 4 + 3]);
+		u[k * 4 + 3] = simd_zip32hi(t[k * 4 + 1], t[k * 4 + 3]);
+	}
+	for (k = 0; k < 4; k++) {
+		o[k * 2] = simd_zip64lo(u[k], u[k + 4]);
+		o[k * 2 + 1] = simd_zip64hi(u[k], u[k + 4]);
+	}
+}
+
+/* transpose 4 rows of 4 32-bit samples */
+static inline void simd_transpose32x4(simd_vec_t *o, const simd_vec_t *r)
+{
+	simd_vec_t t0 = simd_zip32lo(r[0], r[1]);
+	simd_vec_t t1 = simd_zip32lo(r[2], r[3]);
+	simd_vec_t t2 = simd_zip32hi(r[0], r[1]);
+	simd_vec_t t3 = simd_zip32hi(r[2], r[3]);
+
+	o[0] = simd_zip64lo(t0, t1);
+	o[1] = simd_zip64hi(t0, t1);
+	o[2] = simd_zip64lo(t2, t3);
+	o[3] = simd_zip64hi(t2, t3);
+}
+
+/*
+ * The kernels transpose between the interleaved buffer "buf" and the
+ * channel buffers "chn" for the given count of frames, the count is
+ * a multiple of the block: 8 frames for 16-bit and 4 for 32-bit.
+ */
+typedef void (*simd_transpose_t)(unsigned char *buf, unsigned char **chn,
+				 snd_pcm_uframes_t frames);
+
+static void simd_interleave16_2(unsigned char *buf, unsigned char **chn,
+				snd_pcm_uframes_t frames)
+{
+	snd_pcm_uframes_t f;
+
+	for (f = 0; f < frames; f += 8, buf += 32) {
+		simd_vec_t a = simd_load(chn[0] + f * 2);
+		simd_vec_t b = simd_load(chn[1] + f * 2);
+
+		simd_store(buf, simd_zip16lo(a, b));
+		simd_store(buf + 16, simd_zip16hi(a, b));
+	}
+}
+
+static void simd_deinterleave16_2(unsigned char *buf, unsigned char **chn,
+				  snd_pcm_uframes_t frames)
+{
+	snd_pcm_uframes_t f;
+
+	for (f = 0; f < frames; f += 8, buf += 32) {
+		simd_vec_t x = simd_load(buf);
+		simd_vec_t y = simd_load(buf + 16);
+		simd_vec_t p = simd_zip16lo(x, y);
+		simd_vec_t q = simd_zip16hi(x, y);
+		simd_vec_t r = simd_zip16lo(p, q);
+		simd_vec_t s = simd_zip16hi(p, q);
+
+		simd_store(chn[0] + f * 2, simd_zip16lo(r, s));
+		simd_store(chn[1] + f * 2, simd_zip16hi(r, s));
+	}
+}
+
+static void simd_interleave16_4(unsigned char *buf, unsigned char **chn,
+				snd_pcm_uframes_t frames)
+{
+	snd_pcm_uframes_t f;
+
+	for (f = 0; f < frames; f += 8, buf += 64) {
+		simd_vec_t a = simd_load(chn[0] + f * 2);
+		simd_vec_t b = simd_load(chn[1] + f * 2);
+		simd_vec_t c = simd_load(chn[2] + f * 2);
+		simd_vec_t d = simd_load(chn[3] + f * 2);
+		simd_vec_t ab_lo = simd_zip16lo(a, b);
+		simd_vec_t ab_hi = simd_zip16hi(a, b);
+		simd_vec_t cd_lo = simd_zip16lo(c, d);
+		simd_vec_t cd_hi = simd_zip16hi(c, d);
+
+		simd_store(buf, simd_zip32lo(ab_lo, cd_lo));
+		simd_store(buf + 16, simd_zip32hi(ab_lo, cd_lo));
+		simd_store(buf + 32, simd_zip32lo(ab_hi, cd_hi));
+		simd_store(buf + 48, simd_zip32hi(ab_hi, cd_hi));
+	}
+}
+
+static void simd_deinterleave16_4(unsigned char *buf, unsigned char **chn,
+				  snd_pcm_uframes_t frames)
+{
+	snd_pcm_uframes_t f;
+
+	for (f = 0; f < frames; f += 8, buf += 64) {
+		simd_vec_t v0 = simd_load(buf);
+		simd_vec_t v1 = simd_load(buf + 16);
+		simd_vec_t v2 = simd_load(buf + 32);
+		simd_vec_t v3 = simd_load(buf + 48);
+		simd_vec_t t0 = simd_zip16lo(v0, v1);
+		simd_vec_t t1 = simd_zip16hi(v0, v1);
+		simd_vec_t t2 = simd_zip16lo(v2, v3);
+		simd_vec_t t3 = simd_zip16hi(v2, v3);
+		simd_vec_t u0 = simd_zip16lo(t0, t1);
+		simd_vec_t u1 = simd_zip16hi(t0, t1);
+		simd_vec_t u2 = simd_zip16lo(t2, t3);
+		simd_vec_t u3 = simd_zip16hi(t2, t3);
+
+		simd_store(chn[0] + f * 2, simd_zip64lo(u0, u2));
+		simd_store(chn[1] + f * 2, simd_zip64hi(u0, u2));
+		simd_store(chn[2] + f * 2, simd_zip64lo(u1, u3));
+		simd_store(chn[3] + f * 2, simd_zip64hi(u1, u3));
+	}
+}
+
+/* 6 channels go through the 8x8 transpose, two rows stay unused */
+static void simd_interleave16_6(unsigned char *buf, unsigned char **chn,
+				snd_pcm_uframes_t frames)
+{
+	simd_vec_t r[8], o[8];
+	snd_pcm_uframes_t f;
+	unsigned int k;
+
+	r[6] = r[7] = simd_zero();
+	for (f = 0; f < frames; f += 8) {
+		for (k = 0; k < 6; k++)
+			r[k] = simd_load(chn[k] + f * 2);
+		simd_transpose16x8(o, r);
+		for (k = 0; k < 8; k++, buf += 12) {
+			simd_store64(buf, o[k]);
+			simd_store32(buf + 8, simd_zip64hi(o[k], o[k]));
+		}
+	}
+}
+
+static void simd_deinterleave16_6(unsigned char *buf, unsigned char **chn,
+				  snd_pcm_uframes_t frames)
+{
+	simd_vec_t r[8], o[8];
+	snd_pcm_uframes_t f;
+	unsigned int k;
+
+	for (f = 0; f < frames; f += 8) {
+		for (k = 0; k < 8; k++, buf += 12)
+			r[k] = simd_zip64lo(simd_load64(buf), simd_load32(buf + 8));
+		simd_transpose16x8(o, r);
+		for (k = 0; k < 6; k++)
+			simd_store(chn[k] + f * 2, o[k]);
+	}
+}
+
+static void simd_interleave16_8(unsigned char *buf, unsigned char **chn,
+				snd_pcm_uframes_t frames)
+{
+	simd_vec_t r[8], o[8];
+	snd_pcm_uframes_t f;
+	unsigned int k;
+
+	for (f = 0; f < frames; f += 8) {
+		for (k = 0; k < 8; k++)
+			r[k] = simd_load(chn[k] + f * 2);
+		simd_transpose16x8(o, r);
+		for (k = 0; k < 8; k++, buf += 16)
+			simd_store(buf, o[k]);
+	}
+}
+
+static void simd_deinterleave16_8(unsigned char *buf, unsigned char **chn,
+				  snd_pcm_uframes_t frames)
+{
+	simd_vec_t r[8], o[8];
+	snd_pcm_uframes_t f;
+	unsigned int k;
+
+	for (f = 0; f < frames; f += 8) {
+		for (k = 0; k < 8; k++, buf += 16)
+			r[k] = simd_load(buf);
+		simd_transpose16x8(o, r);
+		for (k = 0; k < 8; k++)
+			simd_store(chn[k] + f * 2, o[k]);
+	}
+}
+
+static void simd_interleave32_2(unsigned char *buf, unsigned char **chn,
+				snd_pcm_uframes_t frames)
+{
+	snd_pcm_uframes_t f;
+
+	for (f = 0; f < frames; f += 4, buf += 32) {
+		simd_vec_t a = simd_load(chn[0] + f * 4);
+		simd_vec_t b = simd_load(chn[1] + f * 4);
+
+		simd_store(buf, simd_zip32lo(a, b));
+		simd_store(buf + 16, simd_zip32hi(a, b));
+	}
+}
+
+static void simd_deinterleave32_2(unsigned char *buf, unsigned char **chn,
+				  snd_pcm_uframes_t frames)
+{
+	snd_pcm_uframes_t f;
+
+	for (f = 0; f < frames; f += 4, buf += 32) {
+		simd_vec_t x = simd_load(buf);
+		simd_vec_t y = simd_load(buf + 16);
+		simd_vec_t p = simd_zip32lo(x, y);
+		simd_vec_t q = simd_zip32hi(x, y);
+
+		simd_store(chn[0] + f * 4, simd_zip32lo(p, q));
+		simd_store(chn[1] + f * 4, simd_zip32hi(p, q));
+	}
+}
+
+static void simd_interleave32_4(unsigned char *buf, unsigned char **chn,
+				snd_pcm_uframes_t frames)
+{
+	simd_vec_t r[4], o[4];
+	snd_pcm_uframes_t f;
+	unsigned int k;
+
+	for (f = 0; f < frames; f += 4) {
+		for (k = 0; k < 4; k++)
+			r[k] = simd_load(chn[k] + f * 4);
+		simd_transpose32x4(o, r);
+		for (k = 0; k < 4; k++, buf += 16)
+			simd_store(buf, o[k]);
+	}
+}
+
+static void simd_deinterleave32_4(unsigned char *buf, unsigned char **chn,
+				  snd_pcm_uframes_t frames)
+{
+	simd_vec_t r[4], o[4];
+	snd_pcm_uframes_t f;
+	unsigned int k;
+
+	for (f = 0; f < frames; f += 4) {
+		for (k = 0; k < 4; k++, buf += 16)
+			r[k] = simd_load(buf);
+		simd_transpose32x4(o, r);
+		for (k = 0; k < 4; k++)
+			simd_store(chn[k] + f * 4, o[k]);
+	}
+}
+
+/* 6 channels are a 4x4 transpose and a pair of channels */
+static void simd_interleave32_6(unsigned char *buf, unsigned char **chn,
+				snd_pcm_uframes_t frames)
+{
+	simd_vec_t r[4], o[4], p[2];
+	snd_pcm_uframes_t f;
+	unsigned int k;
+
+	for (f = 0; f < frames; f += 4) {
+		simd_vec_t a = simd_load(chn[4] + f * 4);
+		simd_vec_t b = simd_load(chn[5] + f * 4);
+
+		for (k = 0; k < 4; k++)
+			r[k] = simd_load(chn[k] + f * 4);
+		simd_transpose32x4(o, r);
+		p[0] = simd_zip32lo(a, b);
+		p[1] = simd_zip32hi(a, b);
+		for (k = 0; k < 4; k++, buf += 24) {
+			simd_store(buf, o[k]);
+			if (k & 1)
+				simd_store64(buf + 16, simd_zip64hi(p[k / 2], p[k / 2]));
+			else
+				simd_store64(buf + 16, p[k / 2]);
+		}
+	}
+}
+
+static void simd_deinterleave32_6(unsigned char *buf, unsigned char **chn,
+				  snd_pcm_uframes_t frames)
+{
+	simd_vec_t r[4], o[4], p[4];
+	snd_pcm_uframes_t f;
+	unsigned int k;
+
+	for (f = 0; f < frames; f += 4) {
+		simd_vec_t x, y;
+
+		for (k = 0; k < 4; k++, buf += 24) {
+			r[k] = simd_load(buf);
+			p[k] = simd_load64(buf + 16);
+		}
+		simd_transpose32x4(o, r);
+		for (k = 0; k < 4; k++)
+			simd_store(chn[k] + f * 4, o[k]);
+		x = simd_zip32lo(simd_zip64lo(p[0], p[1]), simd_zip64lo(p[2], p[3]));
+		y = simd_zip32hi(simd_zip64lo(p[0], p[1]), simd_zip64lo(p[2], p[3]));
+		simd_store(chn[4] + f * 4, simd_zip32lo(x, y));
+		simd_store(chn[5] + f * 4, simd_zip32hi(x, y));
+	}
+}
+
+static void simd_interleave32_8(unsigned char *buf, unsigned char **chn,
+				snd_pcm_uframes_t frames)
+{
+	simd_vec_t r[4], lo[4], hi[4];
+	snd_pcm_uframes_t f;
+	unsigned int k;
+
+	for (f = 0; f < frames; f += 4) {
+		for (k = 0; k < 4; k++)
+			r[k] = simd_load(chn[k] + f * 4);
+		simd_transpose32x4(lo, r);
+		for (k = 0; k < 4; k++)
+			r[k] = simd_load(chn[k + 4] + f * 4);
+		simd_transpose32x4(hi, r);
+		for (k = 0; k < 4; k++, buf += 32) {
+			simd_store(buf, lo[k]);
+			simd_store(buf + 16, hi[k]);
+		}
+	}
+}
+
+static void simd_deinterleave32_8(unsigned char *buf, unsigned char **chn,
+				  snd_pcm_uframes_t frames)
+{
+	simd_vec_t lo[4], hi[4], o[4];
+	snd_pcm_uframes_t f;
+	unsigned int k;
+
+	for (f = 0; f < frames; f += 4) {
+		for (k = 0; k < 4; k++, buf += 32) {
+			lo[k] = simd_load(buf);
+			hi[k] = simd_load(buf + 16);
+		}
+		simd_transpose32x4(o, lo);
+		for (k = 0; k < 4; k++)
+			simd_store(chn[k] + f * 4, o[k]);
+		simd_transpose32x4(o, hi);
+		for (k = 0; k < 4; k++)
+			simd_store(chn[k + 4] + f * 4, o[k]);
+	}
+}
+
+#define SIMD_TRANSPOSE_CHANNELS	8
+
+/* indexed by the channels for 16-bit and 32-bit samples */
+static const simd_transpose_t simd_interleave[2][SIMD_TRANSPOSE_CHANNELS + 1] = {
+	{ [2] = simd_interleave16_2, [4] = simd_interleave16_4,
+	  [6] = simd_interleave16_6, [8] = simd_interleave16_8 },
+	{ [2] = simd_interleave32_2, [4] = simd_interleave32_4,
+	  [6] = simd_interleave32_6, [8] = simd_interleave32_8 },
+};
+
+static const simd_transpose_t simd_deinterleave[2][SIMD_TRANSPOSE_CHANNELS + 1] = {
+	{ [2] = simd_deinterleave16_2, [4] = simd_deinterleave16_4,
+	  [6] = simd_deinterleave16_6, [8] = simd_deinterleave16_8 },
+	{ [2] = simd_deinterleave32_2, [4] = simd_deinterleave32_4,
+	  [6] = simd_deinterleave32_6, [8] = simd_deinterleave32_8 },
+};
+
+static int simd_areas_copy(const snd_pcm_channel_area_t *dst_areas,
+			   snd_pcm_uframes_t dst_offset,
+			   const snd_pcm_channel_area_t *src_areas,
+			   snd_pcm_uframes_t src_offset,
+			   unsigned int channels, snd_pcm_uframes_t frames,
+			   unsigned int width)
+{
+	const snd_pcm_channel_area_t *buf_areas, *chn_areas;
+	snd_pcm_uframes_t buf_offset, chn_offset, block, done;
+	unsigned char *chn[SIMD_TRANSPOSE_CHANNELS];
+	simd_transpose_t transpose;
+	unsigned char *buf;
+	unsigned int bytes, ch;
+
+	if (channels > SIMD_TRANSPOSE_CHANNELS || (width != 16 && width != 32))
+		return -EINVAL;
+	if (simd_interleaved(dst_areas, channels, width) &&
+	    simd_contiguous(src_areas, channels, width)) {
+		transpose = simd_interleave[width / 32][channels];
+		buf_areas = dst_areas;
+		buf_offset = dst_offset;
+		chn_areas = src_areas;
+		chn_offset = src_offset;
+	} else if (simd_interleaved(src_areas, channels, width) &&
+		   simd_contiguous(dst_areas, channels, width)) {
+		transpose = simd_deinterleave[width / 32][channels];
+		buf_areas = src_areas;
+		buf_offset = src_offset;
+		chn_areas = dst_areas;
+		chn_offset = dst_offset;
+	} else {
+		return -EINVAL;
+	}
+	if (!transpose || !buf_areas[0].addr)
+		return -EINVAL;
+	for (ch = 0; ch < channels; ch++) {
+		if (!chn_areas[ch].addr)
+			return -EINVAL;
+		chn[ch] = snd_pcm_channel_area_addr(&chn_areas[ch], chn_offset);
+	}
+	buf = snd_pcm_channel_area_addr(buf_areas, buf_offset);
+	bytes = width / 8;
+	block = width == 16 ? 8 : 4;
+	done = frames - frames % block;
+	if (done)
+		transpose(buf, chn, done);
+
+	/* the remaining frames */
+	buf += done * channels * bytes;
+	for (; done < frames; done++) {
+		for (ch = 0; ch < channels; ch++, buf += bytes) {
+			if (buf_areas == dst_areas)
+				memcpy(buf, chn[ch] + done * bytes, bytes);
+			else
+				memcpy(chn[ch] + done * bytes, buf, bytes);
+		}
+	}
+	return 0;
+}
+
+#else
+
+static int simd_convert(const snd_pcm_channel_area_t *dst_areas ATTRIBUTE_UNUSED,
+			snd_pcm_uframes_t dst_offset ATTRIBUTE_UNUSED,
+			const snd_pcm_channel_area_t *src_areas ATTRIBUTE_UNUSED,
+			snd_pcm_uframes_t src_offset ATTRIBUTE_UNUSED,
+			unsigned int channels ATTRIBUTE_UNUSED,
+			snd_pcm_uframes_t frames ATTRIBUTE_UNUSED,
+			int get_type ATTRIBUTE_UNUSED,
+			int put_type ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+static int simd_areas_copy(const snd_pcm_channel_area_t *dst_areas ATTRIBUTE_UNUSED,
+			   snd_pcm_uframes_t dst_offset ATTRIBUTE_UNUSED,
+			   const snd_pcm_channel_area_t *src_areas ATTRIBUTE_UNUSED,
+			   snd_pcm_uframes_t src_offset ATTRIBUTE_UNUSED,
+			   unsigned int channels ATTRIBUTE_UNUSED,
+			   snd_pcm_uframes_t frames ATTRIBUTE_UNUSED,
+			   unsigned int width ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+#endif /* PCM_SIMD_X86_64 || PCM_SIMD_AARCH64 */
+
+/* the type of the get and put index of plugin_ops.h, no sign toggle */
+static int simd_getput_type(unsigned int idx)
+{
+	switch (idx) {
+	case 4:
+		return SIMD_S16;
+	case 6:
+		return SIMD_S16_SWAP;
+	case 12:
+		return SIMD_S32;
+	case 14:
+		return SIMD_S32_SWAP;
+	case 20:
+		return SIMD_S24_3;
+	case 22:
+		return SIMD_S24_3_SWAP;
+	default:
+		return -EINVAL;
+	}
+}
+
+/* the type of the conversion index width, 16 and 32 bits */
+static int simd_conv_type(unsigned int width, unsigned int endian)
+{
+	switch (width) {
+	case 1:
+		return endian ? SIMD_S16_SWAP : SIMD_S16;
+	case 3:
+		return endian ? SIMD_S32_SWAP : SIMD_S32;
+	default:
+		return -EINVAL;
+	}
+}
+
+/* the float index of plugin_ops.h, float64 isn't handled */
+static int simd_float_type(unsigned int idx)
+{
+	switch (idx) {
+	case 0:
+		return SIMD_FLOAT;
+	case 1:
+		return SIMD_FLOAT_SWAP;
+	default:
+		return -EINVAL;
+	}
+}
+
+int snd_pcm_simd_linear_convert(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_t dst_offset,
+				const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
+				unsigned int channels, snd_pcm_uframes_t frames,
+				unsigned int convidx)
+{
+	/* src_wid src_endswap sign_toggle dst_wid dst_endswap */
+	if (convidx & 8)
+		return -EINVAL;
+	return simd_convert(dst_areas, dst_offset, src_areas, src_offset,
+			    channels, frames,
+			    simd_conv_type(convidx >> 5, (convidx >> 4) & 1),
+			    simd_conv_type((convidx >> 1) & 3, convidx & 1));
+}
+
+int snd_pcm_simd_linear_getput(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_t dst_offset,
+			       const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
+			       unsigned int channels, snd_pcm_uframes_t frames,
+			       unsigned int get_idx, unsigned int put_idx)
+{
+	return simd_convert(dst_areas, dst_offset, src_areas, src_offset,
+			    channels, frames,
+			    simd_getput_type(get_idx), simd_getput_type(put_idx));
+}
+
+int snd_pcm_simd_integer_float(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_t dst_offset,
+			       const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
+			       unsigned int channels, snd_pcm_uframes_t frames,
+			       unsigned int get32idx, unsigned int put32floatidx)
+{
+	return simd_convert(dst_areas, dst_offset, src_areas, src_offset,
+			    channels, frames,
+			    simd_getput_type(get32idx), simd_float_type(put32floatidx));
+}
+
+int snd_pcm_simd_float_integer(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_t dst_offset,
+			       const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
+			       unsigned int channels, snd_pcm_uframes_t frames,
+			       unsigned int put32idx, unsigned int get32floatidx)
+{
+	return simd_convert(dst_areas, dst_offset, src_areas, src_offset,
+			    channels, frames,
+			    simd_float_type(get32floatidx), simd_getput_type(put32idx));
+}
+
+int snd_pcm_simd_areas_copy(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_t dst_offset,
+			    const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
+			    unsigned int channels, snd_pcm_uframes_t frames,
+			    unsigned int width)
+{
+	return simd_areas_copy(dst_areas, dst_offset, src_areas, src_offset,
+			       channels, frames, width);
+}
+
+#endif /* DOC_HIDDEN */
@@ -28,7 +28,7 @@
 
 #include "pcm_local.h"
 #include "pcm_plugin.h"
-#include "bswap.h"
+#include "pcm_softvol_scale.h"
 #include <math.h>
 #include <sound/tlv.h>
 
@@ -46,7 +46,15 @@ typedef struct {
 	unsigned int cchannels;
 	snd_ctl_t *ctl;
 	snd_ctl_elem_value_t elem;
+	struct pollfd ctl_pfd;	/* ctl events, valid if vol_events is set */
+	int vol_events;		/* cur_vol[] follows the change events */
+	int vol_dirty;		/* cur_vol[] must be read again */
+	snd_pcm_uframes_t vol_check;	/* frames since the ctl fd was polled */
 	unsigned int cur_vol[2];
+	int ramp;			/* ramp enabled by the config */
+	snd_pcm_softvol_ramp_t vol_ramp;
+	unsigned int *gains;		/* gain table of the interleaved frames */
+	unsigned int *slots;		/* gain slot per channel */
 	unsigned int max_val;     /* max index */
 	unsigned int zero_dB_val; /* index at 0 dB */
 	double min_dB;
@@ -101,342 +109,220 @@ static const unsigned int preset_dB_value[PRESET_RESOLUTION] = {
 	0xd9e3, 0xdef6, 0xe428, 0xe978, 0xeee8, 0xf479, 0xfa2b, 0xffff,
 };
 
-/* (32bit x 16bit) >> 16 */
-typedef union {
-	int i;
-	short s[2];
-} val_t;
-static inline int MULTI_DIV_32x16(int a, unsigned short b)
+/*
+ * the gain slot of the channel: the stereo control sets the left and
+ * right gains on the even and odd channels, the center and LFE (and the
+ * last channel of an odd count) get the average of both
+ */
+static unsigned int softvol_slot(snd_pcm_softvol_t *svol, unsigned int ch,
+				 unsigned int channels)
 {
-	val_t v, x, y;
-	v.i = a;
-	y.i = 0;
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-	x.i = (unsigned short)v.s[0];
-	x.i *= (unsigned int)b;
-	y.s[0] = x.s[1];
-	y.i += (int)v.s[1] * b;
-#else
-	x.i = (unsigned int)v.s[1] * b;
-	y.s[1] = x.s[0];
-	y.i += (int)v.s[0] * b;
-#endif
-	return y.i;
+	if (svol->cchannels == 1)
+		return 0;
+	switch (ch) {
+	case 0:
+	case 2:
+		return channels == ch + 1 ? 2 : 0;
+	case 4:
+	case 5:
+		return 2;
+	default:
+		return ch & 1;
+	}
 }
 
-static inline int MULTI_DIV_int(int a, unsigned int b, int swap)
+static void softvol_get_target(snd_pcm_softvol_t *svol, unsigned int *vol)
 {
-	unsigned int gain = (b >> VOL_SCALE_SHIFT);
-	int fraction;
-	a = swap ? (int)bswap_32(a) : a;
-	fraction = MULTI_DIV_32x16(a, b & VOL_SCALE_MASK);
-	if (gain) {
-		long long amp = (long long)a * gain + fraction;
-		if (amp > (int)0x7fffffff)
-			amp = (int)0x7fffffff;
-		else if (amp < (int)0x80000000)
-			amp = (int)0x80000000;
-		return swap ? (int)bswap_32((int)amp) : (int)amp;
+	unsigned int cur1 = svol->cchannels == 1 ? svol->cur_vol[0] : svol->cur_vol[1];
+
+	if (svol->max_val == 1) {
+		vol[0] = svol->cur_vol[0] ? SOFTVOL_UNITY : 0;
+		vol[1] = cur1 ? SOFTVOL_UNITY : 0;
+		vol[2] = vol[0] | vol[1];
+	} else {
+		vol[0] = softvol_gain(svol->dB_value[svol->cur_vol[0]]);
+		vol[1] = softvol_gain(svol->dB_value[cur1]);
+		vol[2] = softvol_gain(svol->dB_value[(svol->cur_vol[0] + cur1) / 2]);
 	}
-	return swap ? (int)bswap_32(fraction) : fraction;
 }
 
-/* always little endian */
-static inline int MULTI_DIV_24(int a, unsigned int b)
+/*
+ * Start a ramp when the control value was changed.  Without the ramp
+ * option the ramp length is zero and the new gain applies at once.
+ */
+static void softvol_update_ramp(snd_pcm_softvol_t *svol)
 {
-	unsigned int gain = b >> VOL_SCALE_SHIFT;
-	int fraction;
-	fraction = MULTI_DIV_32x16(a, b & VOL_SCALE_MASK);
-	if (gain) {
-		long long amp = (long long)a * gain + fraction;
-		if (amp > (int)0x7fffff)
-			amp = (int)0x7fffff;
-		else if (amp < (int)0x800000)
-			amp = (int)0x800000;
-		return (int)amp;
-	}
-	return fraction;
+	unsigned int vol[VOL_SLOTS];
+
+	softvol_get_target(svol, vol);
+	softvol_ramp_start(&svol->vol_ramp, vol);
 }
 
-static inline short MULTI_DIV_short(short a, unsigned int b, int swap)
+static int softvol_interleaved(const snd_pcm_channel_area_t *areas,
+			       unsigned int channels, unsigned int width)
 {
-	unsigned int gain = b >> VOL_SCALE_SHIFT;
-	int fraction;
-	a = swap ? (short)bswap_16(a) : a;
-	fraction = (int)(a * (b & VOL_SCALE_MASK)) >> VOL_SCALE_SHIFT;
-	if (gain) {
-		int amp = a * gain + fraction;
-		if (abs(amp) > 0x7fff)
-			amp = (a<0) ? (short)0x8000 : (short)0x7fff;
-		return swap ? (short)bswap_16((short)amp) : (short)amp;
+	unsigned int ch;
+
+	for (ch = 0; ch < channels; ch++) {
+		if (areas[ch].addr != areas[0].addr ||
+		    areas[ch].first != areas[0].first + ch * width ||
+		    areas[ch].step != channels * width)
+			return 0;
 	}
-	return swap ? (short)bswap_16((short)fraction) : (short)fraction;
+	return 1;
 }
 
 #endif /* DOC_HIDDEN */
 
 /*
- * apply volumue attenuation
- *
- * TODO: use SIMD operations
+ * apply volume attenuation
  */
-
-#ifndef DOC_HIDDEN
-#define CONVERT_AREA(TYPE, swap) do {	\
-	unsigned int ch, fr; \
-	TYPE *src, *dst; \
-	for (ch = 0; ch < channels; ch++) { \
-		src_area = &src_areas[ch]; \
-		dst_area = &dst_areas[ch]; \
-		src = snd_pcm_channel_area_addr(src_area, src_offset); \
-		dst = snd_pcm_channel_area_addr(dst_area, dst_offset); \
-		src_step = snd_pcm_channel_area_step(src_area) / sizeof(TYPE); \
-		dst_step = snd_pcm_channel_area_step(dst_area) / sizeof(TYPE); \
-		GET_VOL_SCALE; \
-		fr = frames; \
-		if (! vol_scale) { \
-			while (fr--) { \
-				*dst = 0; \
-				dst += dst_step; \
-			} \
-		} else if (vol_scale == 0xffff) { \
-			while (fr--) { \
-				*dst = *src; \
-				src += src_step; \
-				dst += dst_step; \
-			} \
-		} else { \
-			while (fr--) { \
-				*dst = (TYPE) MULTI_DIV_##TYPE(*src, vol_scale, swap); \
-				src += src_step; \
-				dst += dst_step; \
-			} \
-		} \
-	} \
-} while (0)
-
-#define CONVERT_AREA_S24_3LE() do {					\
-	unsigned int ch, fr;						\
-	unsigned char *src, *dst;					\
-	int tmp;							\
-	for (ch = 0; ch < channels; ch++) {				\
-		src_area = &src_areas[ch];				\
-		dst_area = &dst_areas[ch];				\
-		src = snd_pcm_channel_area_addr(src_area, src_offset);	\
-		dst = snd_pcm_channel_area_addr(dst_area, dst_offset);	\
-		src_step = snd_pcm_channel_area_step(src_area);		\
-		dst_step = snd_pcm_channel_area_step(dst_area);		\
-		GET_VOL_SCALE;						\
-		fr = frames;						\
-		if (! vol_scale) {					\
-			while (fr--) {					\
-				dst[0] = dst[1] = dst[2] = 0;		\
-				dst += dst_step;			\
-			}						\
-		} else if (vol_scale == 0xffff) {			\
-			while (fr--) {					\
-				dst[0] = src[0];			\
-				dst[1] = src[1];			\
-				dst[2] = src[2];			\
-				src += dst_step;			\
-				dst += src_step;			\
-			}						\
-		} else {						\
-			while (fr--) {					\
-				tmp = src[0] |				\
-				      (src[1] << 8) |			\
-				      (((signed char *) src)[2] << 16);	\
-				tmp = MULTI_DIV_24(tmp, vol_scale);	\
-				dst[0] = tmp;				\
-				dst[1] = tmp >> 8;			\
-				dst[2] = tmp >> 16;			\
-				src += dst_step;			\
-				dst += src_step;			\
-			}						\
-		}							\
-	}								\
-} while (0)
-
-#define CONVERT_AREA_S24_LE() do {					\
-	unsigned int ch, fr;						\
-	int *src, *dst;							\
-	int tmp;							\
-	for (ch = 0; ch < channels; ch++) {				\
-		src_area = &src_areas[ch];				\
-		dst_area = &dst_areas[ch];				\
-		src = snd_pcm_channel_area_addr(src_area, src_offset);	\
-		dst = snd_pcm_channel_area_addr(dst_area, dst_offset);	\
-		src_step = snd_pcm_channel_area_step(src_area)		\
-				/ sizeof(int);				\
-		dst_step = snd_pcm_channel_area_step(dst_area)		\
-				/ sizeof(int);				\
-		GET_VOL_SCALE;						\
-		fr = frames;						\
-		if (! vol_scale) {					\
-			while (fr--) {					\
-				*dst = 0;				\
-				dst += dst_step;			\
-			}						\
-		} else if (vol_scale == 0xffff) {			\
-			while (fr--) {					\
-				*dst = *src;				\
-				src += dst_step;			\
-				dst += src_step;			\
-			}						\
-		} else {						\
-			while (fr--) {					\
-				tmp = *src << 8;			\
-				tmp = (signed int) tmp >> 8;		\
-				*dst = MULTI_DIV_24(tmp, vol_scale);	\
-				src += dst_step;			\
-				dst += src_step;			\
-			}						\
-		}							\
-	}								\
-} while (0)
-		
-#define GET_VOL_SCALE \
-	switch (ch) { \
-	case 0: \
-	case 2: \
-		vol_scale = (channels == ch + 1) ? vol_c : vol[0]; \
-		break; \
-	case 4: \
-	case 5: \
-		vol_scale = vol_c; \
-		break; \
-	default: \
-		vol_scale = vol[ch & 1]; \
-		break; \
-	}
-
-#endif /* DOC_HIDDEN */
-
-/* 2-channel stereo control */
-static void softvol_convert_stereo_vol(snd_pcm_softvol_t *svol,
-				       const snd_pcm_channel_area_t *dst_areas,
-				       snd_pcm_uframes_t dst_offset,
-				       const snd_pcm_channel_area_t *src_areas,
-				       snd_pcm_uframes_t src_offset,
-				       unsigned int channels,
-				       snd_pcm_uframes_t frames)
+static void softvol_convert(snd_pcm_softvol_t *svol,
+			    const snd_pcm_channel_area_t *dst_areas,
+			    snd_pcm_uframes_t dst_offset,
+			    const snd_pcm_channel_area_t *src_areas,
+			    snd_pcm_uframes_t src_offset,
+			    unsigned int channels,
+			    snd_pcm_uframes_t frames)
 {
-	const snd_pcm_channel_area_t *dst_area, *src_area;
-	unsigned int src_step, dst_step;
-	unsigned int vol_scale, vol[2], vol_c;
-
-	if (svol->cur_vol[0] == 0 && svol->cur_vol[1] == 0) {
-		snd_pcm_areas_silence(dst_areas, dst_offset, channels, frames,
-				      svol->sformat);
-		return;
-	} else if (svol->zero_dB_val && svol->cur_vol[0] == svol->zero_dB_val &&
-		   svol->cur_vol[1] == svol->zero_dB_val) {
-		snd_pcm_areas_copy(dst_areas, dst_offset, src_areas, src_offset,
-				   channels, frames, svol->sformat);
-		return;
+	unsigned int width = snd_pcm_format_physical_width(svol->sformat);
+	snd_pcm_softvol_ramp_t *vol_ramp = &svol->vol_ramp;
+	int ramp = softvol_ramp_running(vol_ramp);
+	unsigned int slot, ch, i;
+	snd_pcm_uframes_t done;
+	int boost = 0;
+
+	if (!ramp) {
+		int silent = 1, unity = svol->zero_dB_val != 0;
+
+		for (i = 0; i < svol->cchannels; i++) {
+			if (svol->cur_vol[i])
+				silent = 0;
+			if (svol->cur_vol[i] != svol->zero_dB_val)
+				unity = 0;
+		}
+		if (silent) {
+			snd_pcm_areas_silence(dst_areas, dst_offset, channels,
+					      frames, svol->sformat);
+			return;
+		} else if (unity) {
+			snd_pcm_areas_copy(dst_areas, dst_offset, src_areas,
+					   src_offset, channels, frames,
+					   svol->sformat);
+			return;
+		}
+	}
+	for (slot = 0; slot < VOL_SLOTS; slot++) {
+		if (vol_ramp->to[slot] > SOFTVOL_UNITY ||
+		    (ramp && vol_ramp->from[slot] > SOFTVOL_UNITY))
+			boost = 1;
 	}
 
-	if (svol->max_val == 1) {
-		vol[0] = svol->cur_vol[0] ? 0xffff : 0;
-		vol[1] = svol->cur_vol[1] ? 0xffff : 0;
-		vol_c = vol[0] | vol[1];
+	if (softvol_interleaved(src_areas, channels, width) &&
+	    softvol_interleaved(dst_areas, channels, width)) {
+		/* one pass over all channels, a table of whole frames */
+		unsigned int block = SOFTVOL_BLOCK / channels ? SOFTVOL_BLOCK / channels : 1;
+		unsigned int *gains = svol->gains;
+		unsigned int *slots = svol->slots;
+		char *dst = snd_pcm_channel_area_addr(dst_areas, dst_offset);
+		const char *src = snd_pcm_channel_area_addr(src_areas, src_offset);
+		unsigned int frame_bytes = channels * width / 8;
+
+		for (ch = 0; ch < channels; ch++)
+			slots[ch] = softvol_slot(svol, ch, channels);
+		for (done = 0; done < frames; done += block) {
+			unsigned int n = frames - done < block ? frames - done : block;
+
+			if (done == 0 || ramp)
+				softvol_ramp_gains(vol_ramp, slots, channels,
+						   done, n, gains);
+			softvol_scale(svol->sformat, dst + done * frame_bytes, width / 8,
+				      src + done * frame_bytes, width / 8,
+				      gains, n * channels, boost);
+		}
 	} else {
-		vol[0] = svol->dB_value[svol->cur_vol[0]];
-		vol[1] = svol->dB_value[svol->cur_vol[1]];
-		vol_c = svol->dB_value[(svol->cur_vol[0] + svol->cur_vol[1]) / 2];
-	}
-	switch (svol->sformat) {
-	case SND_PCM_FORMAT_S16_LE:
-	case SND_PCM_FORMAT_S16_BE:
-		/* 16bit samples */
-		CONVERT_AREA(short, 
-			     !snd_pcm_format_cpu_endian(svol->sformat));
-		break;
-	case SND_PCM_FORMAT_S32_LE:
-	case SND_PCM_FORMAT_S32_BE:
-		/* 32bit samples */
-		CONVERT_AREA(int,
-			     !snd_pcm_format_cpu_endian(svol->sformat));
-		break;
-	case SND_PCM_FORMAT_S24_LE:
-		/* 24bit samples */
-		CONVERT_AREA_S24_LE();
-		break;
-	case SND_PCM_FORMAT_S24_3LE:
-		CONVERT_AREA_S24_3LE();
-		break;
-	default:
-		break;
+		unsigned int gains[SOFTVOL_BLOCK];
+
+		for (ch = 0; ch < channels; ch++) {
+			const snd_pcm_channel_area_t *dst_area = &dst_areas[ch];
+			const snd_pcm_channel_area_t *src_area = &src_areas[ch];
+			char *dst = snd_pcm_channel_area_addr(dst_area, dst_offset);
+			const char *src = snd_pcm_channel_area_addr(src_area, src_offset);
+			unsigned int dst_step = snd_pcm_channel_area_step(dst_area);
+			unsigned int src_step = snd_pcm_channel_area_step(src_area);
+
+			slot = softvol_slot(svol, ch, channels);
+			for (done = 0; done < frames; done += SOFTVOL_BLOCK) {
+				unsigned int n = frames - done < SOFTVOL_BLOCK ?
+						 frames - done : SOFTVOL_BLOCK;
+
+				if (done == 0 || ramp) {
+					for (i = 0; i < n; i++)
+						gains[i] = softvol_ramp_gain(vol_ramp, slot, done + i);
+				}
+				softvol_scale(svol->sformat, dst + done * dst_step, dst_step,
+					      src + done * src_step, src_step,
+					      gains, n, boost);
+			}
+		}
 	}
+	if (ramp)
+		softvol_ramp_advance(vol_ramp, frames);
 }
 
-#undef GET_VOL_SCALE
-#define GET_VOL_SCALE
-
-/* mono control */
-static void softvol_convert_mono_vol(snd_pcm_softvol_t *svol,
-				     const snd_pcm_channel_area_t *dst_areas,
-				     snd_pcm_uframes_t dst_offset,
-				     const snd_pcm_channel_area_t *src_areas,
-				     snd_pcm_uframes_t src_offset,
-				     unsigned int channels,
-				     snd_pcm_uframes_t frames)
+/*
+ * check the queued ctl events for a change of our control
+ */
+static void softvol_read_events(snd_pcm_softvol_t *svol)
 {
-	const snd_pcm_channel_area_t *dst_area, *src_area;
-	unsigned int src_step, dst_step;
-	unsigned int vol_scale;
+	snd_ctl_event_t event;
+	snd_ctl_elem_id_t id;
+	int err;
 
-	if (svol->cur_vol[0] == 0) {
-		snd_pcm_areas_silence(dst_areas, dst_offset, channels, frames,
-				      svol->sformat);
-		return;
-	} else if (svol->zero_dB_val && svol->cur_vol[0] == svol->zero_dB_val) {
-		snd_pcm_areas_copy(dst_areas, dst_offset, src_areas, src_offset,
-				   channels, frames, svol->sformat);
-		return;
+	while ((err = snd_ctl_read(svol->ctl, &event)) > 0) {
+		if (snd_ctl_event_get_type(&event) != SND_CTL_EVENT_ELEM)
+			continue;
+		snd_ctl_event_elem_get_id(&event, &id);
+		if (snd_ctl_elem_id_compare_set(&id, &svol->elem.id) == 0)
+			svol->vol_dirty = 1;
 	}
-
-	if (svol->max_val == 1)
-		vol_scale = svol->cur_vol[0] ? 0xffff : 0;
-	else
-		vol_scale = svol->dB_value[svol->cur_vol[0]];
-	switch (svol->sformat) {
-	case SND_PCM_FORMAT_S16_LE:
-	case SND_PCM_FORMAT_S16_BE:
-		/* 16bit samples */
-		CONVERT_AREA(short, 
-			     !snd_pcm_format_cpu_endian(svol->sformat));
-		break;
-	case SND_PCM_FORMAT_S32_LE:
-	case SND_PCM_FORMAT_S32_BE:
-		/* 32bit samples */
-		CONVERT_AREA(int,
-			     !snd_pcm_format_cpu_endian(svol->sformat));
-		break;
-	case SND_PCM_FORMAT_S24_LE:
-		/* 24bit samples */
-		CONVERT_AREA_S24_LE();
-		break;
-	case SND_PCM_FORMAT_S24_3LE:
-		CONVERT_AREA_S24_3LE();
-		break;
-	default:
-		break;
+	if (err < 0 && err != -EAGAIN) {
+		/* don't trust the events anymore, read on each transfer */
+		svol->vol_events = 0;
+		svol->vol_dirty = 1;
 	}
 }
 
 /*
  * get the current volume value from driver
  *
- * TODO: mmap support?
+ * The value is read only after a change event of the control.  The ctl
+ * fd is polled at most once per period of transferred frames, so a
+ * change is applied up to a period late.  Without the events it's read
+ * on each transfer.
  */
-static void get_current_volume(snd_pcm_softvol_t *svol)
+static void get_current_volume(snd_pcm_softvol_t *svol,
+			       snd_pcm_uframes_t frames,
+			       snd_pcm_uframes_t period_size)
 {
 	unsigned int val;
 	unsigned int i;
 
+	if (svol->vol_events && !svol->vol_dirty) {
+		if (svol->vol_check < period_size) {
+			svol->vol_check += frames;
+			return;
+		}
+		svol->vol_check = frames;
+		if (poll(&svol->ctl_pfd, 1, 0) <= 0)
+			return;
+		softvol_read_events(svol);
+		if (!svol->vol_dirty)
+			return;
+	}
 	if (snd_ctl_elem_read(svol->ctl, &svol->elem) < 0)
 		return;
+	svol->vol_dirty = 0;
 	for (i = 0; i < svol->cchannels; i++) {
 		val = svol->elem.value.integer.value[i];
 		if (val > svol->max_val)
@@ -445,6 +331,22 @@ static void get_current_volume(snd_pcm_softvol_t *svol)
 	}
 }
 
+/*
+ * subscribe the change events of the control, keep reading the value
+ * on each transfer when it fails
+ */
+static void softvol_subscribe(snd_pcm_softvol_t *svol)
+{
+	svol->vol_dirty = 1;
+	if (snd_ctl_poll_descriptors(svol->ctl, &svol->ctl_pfd, 1) != 1)
+		return;
+	if (snd_ctl_nonblock(svol->ctl, 1) < 0)
+		return;
+	if (snd_ctl_subscribe_events(svol->ctl, 1) < 0)
+		return;
+	svol->vol_events = 1;
+}
+
 static void softvol_free(snd_pcm_softvol_t *svol)
 {
 	if (svol->plug.gen.close_slave)
@@ -453,6 +355,8 @@ static void softvol_free(snd_pcm_softvol_t *svol)
 		snd_ctl_close(svol->ctl);
 	if (svol->dB_value && svol->dB_value != preset_dB_value)
 		free(svol->dB_value);
+	free(svol->gains);
+	free(svol->slots);
 	free(svol);
 }
 
@@ -475,7 +379,9 @@ static int snd_pcm_softvol_hw_refine_cprepare(snd_pcm_t *pcm,
 			(1ULL << SND_PCM_FORMAT_S16_BE) |
 			(1ULL << SND_PCM_FORMAT_S24_LE) |
 			(1ULL << SND_PCM_FORMAT_S32_LE) |
- 			(1ULL << SND_PCM_FORMAT_S32_BE),
+ 			(1ULL << SND_PCM_FORMAT_S32_BE) |
+			(1ULL << SND_PCM_FORMAT_FLOAT_LE) |
+			(1ULL << SND_PCM_FORMAT_FLOAT_BE),
 			(1ULL << (SND_PCM_FORMAT_S24_3LE - 32))
 		}
 	};
@@ -619,6 +525,7 @@ static int snd_pcm_softvol_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * param
 {
 	snd_pcm_softvol_t *svol = pcm->private_data;
 	snd_pcm_t *slave = svol->plug.gen.slave;
+	unsigned int block;
 	int err = snd_pcm_hw_params_slave(pcm, params,
 					  snd_pcm_softvol_hw_refine_cchange,
 					  snd_pcm_softvol_hw_refine_sprepare,
@@ -631,12 +538,29 @@ static int snd_pcm_softvol_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * param
 	    slave->format != SND_PCM_FORMAT_S24_3LE && 
 	    slave->format != SND_PCM_FORMAT_S24_LE &&
 	    slave->format != SND_PCM_FORMAT_S32_LE &&
-	    slave->format != SND_PCM_FORMAT_S32_BE) {
+	    slave->format != SND_PCM_FORMAT_S32_BE &&
+	    slave->format != SND_PCM_FORMAT_FLOAT_LE &&
+	    slave->format != SND_PCM_FORMAT_FLOAT_BE) {
 		SNDERR("softvol supports only S16_LE, S16_BE, S24_LE, S24_3LE, "
-		       "S32_LE or S32_BE");
+		       "S32_LE, S32_BE, FLOAT_LE or FLOAT_BE");
 		return -EINVAL;
 	}
 	svol->sformat = slave->format;
+	block = SOFTVOL_BLOCK / slave->channels ? SOFTVOL_BLOCK / slave->channels : 1;
+	free(svol->gains);
+	free(svol->slots);
+	svol->gains = malloc(block * slave->channels * sizeof(*svol->gains));
+	svol->slots = malloc(slave->channels * sizeof(*svol->slots));
+	if (!svol->gains || !svol->slots)
+		return -ENOMEM;
+	svol->vol_ramp.len = 0;
+	if (svol->ramp) {
+		err = INTERNAL(snd_pcm_hw_params_get_period_size)(params, &svol->vol_ramp.len, NULL);
+		if (err < 0)
+			return err;
+	}
+	svol->vol_ramp.valid = 0;
+	svol->vol_check = 0;
 	return 0;
 }
 
@@ -652,13 +576,10 @@ snd_pcm_softvol_write_areas(snd_pcm_t *pcm,
 	snd_pcm_softvol_t *svol = pcm->private_data;
 	if (size > *slave_sizep)
 		size = *slave_sizep;
-	get_current_volume(svol);
-	if (svol->cchannels == 1)
-		softvol_convert_mono_vol(svol, slave_areas, slave_offset,
-					 areas, offset, pcm->channels, size);
-	else
-		softvol_convert_stereo_vol(svol, slave_areas, slave_offset,
-					   areas, offset, pcm->channels, size);
+	get_current_volume(svol, size, pcm->period_size);
+	softvol_update_ramp(svol);
+	softvol_convert(svol, slave_areas, slave_offset,
+			areas, offset, pcm->channels, size);
 	*slave_sizep = size;
 	return size;
 }
@@ -675,13 +596,10 @@ snd_pcm_softvol_read_areas(snd_pcm_t *pcm,
 	snd_pcm_softvol_t *svol = pcm->private_data;
 	if (size > *slave_sizep)
 		size = *slave_sizep;
-	get_current_volume(svol);
-	if (svol->cchannels == 1)
-		softvol_convert_mono_vol(svol, areas, offset, slave_areas,
-					 slave_offset, pcm->channels, size);
-	else
-		softvol_convert_stereo_vol(svol, areas, offset, slave_areas,
-					   slave_offset, pcm->channels, size);
+	get_current_volume(svol, size, pcm->period_size);
+	softvol_update_ramp(svol);
+	softvol_convert(svol, areas, offset, slave_areas,
+			slave_offset, pcm->channels, size);
 	*slave_sizep = size;
 	return size;
 }
@@ -928,7 +846,9 @@ int snd_pcm_softvol_open(snd_pcm_t **pcmp, const char *name,
 	    sformat != SND_PCM_FORMAT_S24_3LE && 
 	    sformat != SND_PCM_FORMAT_S24_LE &&
 	    sformat != SND_PCM_FORMAT_S32_LE &&
-	    sformat != SND_PCM_FORMAT_S32_BE)
+	    sformat != SND_PCM_FORMAT_S32_BE &&
+	    sformat != SND_PCM_FORMAT_FLOAT_LE &&
+	    sformat != SND_PCM_FORMAT_FLOAT_BE)
 		return -EINVAL;
 	svol = calloc(1, sizeof(*svol));
 	if (! svol)
@@ -946,6 +866,7 @@ int snd_pcm_softvol_open(snd_pcm_t **pcmp, const char *name,
 			slave->name = strdup(name);
 		return 0;
 	}
+	softvol_subscribe(svol);
 
 	/* do softvol */
 	snd_pcm_plugin_init(&svol->plug);
@@ -1098,6 +1019,11 @@ If the control already exists and it's a system control (i.e. no
 user-defined control), the plugin simply passes its slave without
 any changes.
 
+The supported formats are S16_LE, S16_BE, S24_LE, S24_3LE, S32_LE,
+S32_BE, FLOAT_LE and FLOAT_BE.  With the ramp option, the gain moves
+linearly to a new volume over one period to avoid clicks, otherwise it's
+applied at once.
+
 \code
 pcm.name {
         type softvol            # Soft Volume conversion PCM
@@ -1122,6 +1048,8 @@ pcm.name {
 	[max_dB REAL]           # maximal dB value (default:   0.0)
 	[resolution INT]        # resolution (default: 256)
 				# resolution = 2 means a mute switch
+	[ramp BOOL]             # ramp volume changes over a period
+				# (default: off)
 }
 \endcode
 
@@ -1162,6 +1090,7 @@ int _snd_pcm_softvol_open(snd_pcm_t **pcmp, const char *name,
 	double min_dB = PRESET_MIN_DB;
 	double max_dB = ZERO_DB;
 	int card = -1, cchannels = 2;
+	int ramp = 0;
 
 	snd_config_for_each(i, next, conf) {
 		snd_config_t *n = snd_config_iterator_entry(i);
@@ -1204,6 +1133,13 @@ int _snd_pcm_softvol_open(snd_pcm_t **pcmp, const char *name,
 			}
 			continue;
 		}
+		if (strcmp(id, "ramp") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0)
+				return err;
+			ramp = err;
+			continue;
+		}
 		SNDERR("Unknown field %s", id);
 		return -EINVAL;
 	}
@@ -1246,8 +1182,10 @@ int _snd_pcm_softvol_open(snd_pcm_t **pcmp, const char *name,
 		    sformat != SND_PCM_FORMAT_S24_3LE && 
 		    sformat != SND_PCM_FORMAT_S24_LE &&
 		    sformat != SND_PCM_FORMAT_S32_LE &&
-		    sformat != SND_PCM_FORMAT_S32_BE) {
-			SNDERR("only S16_LE, S16_BE, S24_LE, S24_3LE, S32_LE or S32_BE format is supported");
+		    sformat != SND_PCM_FORMAT_S32_BE &&
+		    sformat != SND_PCM_FORMAT_FLOAT_LE &&
+		    sformat != SND_PCM_FORMAT_FLOAT_BE) {
+			SNDERR("only S16_LE, S16_BE, S24_LE, S24_3LE, S32_LE, S32_BE, FLOAT_LE or FLOAT_BE format is supported");
 			snd_config_delete(sconf);
 			return -EINVAL;
 		}
@@ -1265,6 +1203,8 @@ int _snd_pcm_softvol_open(snd_pcm_t **pcmp, const char *name,
 					   resolution, spcm, 1);
 		if (err < 0)
 			snd_pcm_close(spcm);
+		else if ((*pcmp)->type == SND_PCM_TYPE_SOFTVOL)
+			((snd_pcm_softvol_t *)(*pcmp)->private_data)->ramp = ramp;
 	}
 	return err;
 }
@@ -0,0 +1,356 @@
+/**
+ * \file pcm/pcm_softvol_scale.h
+ * \ingroup PCM_Plugins
+ * \brief PCM Soft Volume Plugin Interface - gain kernels and ramp
+ */
+/*
+ *  PCM - Soft Volume Plugin
+ *
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ *  The scaling and the volume ramp don't need the control element, so
+ *  test/lsb/pcm_softvol_scale.c runs them without a sound card.
+ */
+
+#ifndef __PCM_SOFTVOL_SCALE_H
+#define __PCM_SOFTVOL_SCALE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "bswap.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * The volume is a 16.16 fixed point gain, the sample is multiplied and
+ * shifted down by 16 bits with the rounding towards minus infinity:
+ *   out = clip((in * vol) >> 16)
+ * The table value 0xffff means the unity gain, it's replaced with 0x10000
+ * before the scaling so that the samples pass unchanged.
+ *
+ * The kernels below take a gain per sample, so the same code does the
+ * constant volume, the volume ramps and the different gains of the
+ * interleaved channels.  The contiguous loops are written so that the
+ * compiler can vectorize them, S16 without boost has SSE2 code.
+ */
+#define VOL_SLOTS		3	/* left, right and center gain */
+#define SOFTVOL_BLOCK		256	/* samples per gain table */
+#define SOFTVOL_UNITY		0x10000
+
+static inline unsigned int softvol_gain(unsigned int vol)
+{
+	return vol == 0xffff ? SOFTVOL_UNITY : vol;
+}
+
+static inline int softvol_clip(long long v, int min, int max)
+{
+	if (v > max)
+		return max;
+	if (v < min)
+		return min;
+	return (int)v;
+}
+
+static inline void softvol_scale_s16(char *dst, unsigned int dst_step,
+			      const char *src, unsigned int src_step,
+			      const unsigned int *gains, unsigned int n,
+			      int swap, int boost)
+{
+	unsigned int i = 0;
+
+	if (!swap && !boost && src_step == 2 && dst_step == 2) {
+		const int16_t *s = (const int16_t *)src;
+		int16_t *d = (int16_t *)dst;
+#if defined(__SSE2__)
+		/* (s16 * u16) >> 16: the signed high half plus the sample
+		 * when the gain doesn't fit into the signed 16 bits, the
+		 * unity gain takes the sample as is
+		 */
+		const __m128i bias = _mm_set1_epi32(0x8000);
+		const __m128i sign = _mm_set1_epi16((short)0x8000);
+		const __m128i unity = _mm_set1_epi32(SOFTVOL_UNITY);
+
+		for (; i + 8 <= n; i += 8) {
+			__m128i l0 = _mm_loadu_si128((const __m128i *)(gains + i));
+			__m128i l1 = _mm_loadu_si128((const __m128i *)(gains + i + 4));
+			__m128i g = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(l0, bias),
+								  _mm_sub_epi32(l1, bias)),
+						  sign);
+			__m128i u = _mm_packs_epi32(_mm_cmpeq_epi32(l0, unity),
+						    _mm_cmpeq_epi32(l1, unity));
+			__m128i a = _mm_loadu_si128((const __m128i *)(s + i));
+			__m128i r = _mm_add_epi16(_mm_mulhi_epi16(a, g),
+						  _mm_and_si128(a, _mm_srai_epi16(g, 15)));
+			r = _mm_or_si128(_mm_andnot_si128(u, r), _mm_and_si128(u, a));
+			_mm_storeu_si128((__m128i *)(d + i), r);
+		}
+#endif
+		for (; i < n; i++)
+			d[i] = ((int)s[i] * (int)gains[i]) >> 16;
+		return;
+	}
+	if (!swap && src_step == 2 && dst_step == 2) {
+		const int16_t *s = (const int16_t *)src;
+		int16_t *d = (int16_t *)dst;
+
+		for (; i < n; i++)
+			d[i] = softvol_clip(((long long)s[i] * gains[i]) >> 16,
+					    -0x8000, 0x7fff);
+		return;
+	}
+	for (; i < n; i++) {
+		int16_t a = *(const int16_t *)src;
+		int v;
+
+		if (swap)
+			a = (int16_t)bswap_16(a);
+		v = softvol_clip(((long long)a * gains[i]) >> 16, -0x8000, 0x7fff);
+		*(int16_t *)dst = swap ? (int16_t)bswap_16(v) : v;
+		src += src_step;
+		dst += dst_step;
+	}
+}
+
+static inline void softvol_scale_s32(char *dst, unsigned int dst_step,
+			      const char *src, unsigned int src_step,
+			      const unsigned int *gains, unsigned int n,
+			      int swap)
+{
+	unsigned int i;
+
+	if (!swap && src_step == 4 && dst_step == 4) {
+		const int32_t *s = (const int32_t *)src;
+		int32_t *d = (int32_t *)dst;
+
+		for (i = 0; i < n; i++)
+			d[i] = softvol_clip(((long long)s[i] * gains[i]) >> 16,
+					    (int)0x80000000, 0x7fffffff);
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		int32_t a = *(const int32_t *)src;
+		int v;
+
+		if (swap)
+			a = (int32_t)bswap_32(a);
+		v = softvol_clip(((long long)a * gains[i]) >> 16,
+				 (int)0x80000000, 0x7fffffff);
+		*(int32_t *)dst = swap ? (int32_t)bswap_32(v) : v;
+		src += src_step;
+		dst += dst_step;
+	}
+}
+
+/* always little endian, in the lower 24 bits of 32 */
+static inline void softvol_scale_s24(char *dst, unsigned int dst_step,
+			      const char *src, unsigned int src_step,
+			      const unsigned int *gains, unsigned int n)
+{
+	unsigned int i;
+
+	if (src_step == 4 && dst_step == 4) {
+		const int32_t *s = (const int32_t *)src;
+		int32_t *d = (int32_t *)dst;
+
+		for (i = 0; i < n; i++) {
+			int a = (int32_t)((uint32_t)s[i] << 8) >> 8;
+			d[i] = softvol_clip(((long long)a * gains[i]) >> 16,
+					    -0x800000, 0x7fffff);
+		}
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		int a = (int32_t)(*(const uint32_t *)src << 8) >> 8;
+
+		*(int32_t *)dst = softvol_clip(((long long)a * gains[i]) >> 16,
+					       -0x800000, 0x7fffff);
+		src += src_step;
+		dst += dst_step;
+	}
+}
+
+static inline void softvol_scale_s24_3le(char *dst, unsigned int dst_step,
+				  const char *src, unsigned int src_step,
+				  const unsigned int *gains, unsigned int n)
+{
+	const unsigned char *s = (const unsigned char *)src;
+	unsigned char *d = (unsigned char *)dst;
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		int a = s[0] | (s[1] << 8) | (((const signed char *)s)[2] << 16);
+		int v = softvol_clip(((long long)a * gains[i]) >> 16,
+				     -0x800000, 0x7fffff);
+
+		d[0] = v;
+		d[1] = v >> 8;
+		d[2] = v >> 16;
+		s += src_step;
+		d += dst_step;
+	}
+}
+
+static inline float softvol_gain_float(unsigned int vol)
+{
+	return vol * (1.0f / 65536.0f);
+}
+
+static inline void softvol_scale_float(char *dst, unsigned int dst_step,
+				const char *src, unsigned int src_step,
+				const unsigned int *gains, unsigned int n,
+				int swap)
+{
+	union {
+		float f;
+		uint32_t i;
+	} v;
+	unsigned int i;
+
+	if (!swap && src_step == 4 && dst_step == 4) {
+		const float *s = (const float *)src;
+		float *d = (float *)dst;
+
+		for (i = 0; i < n; i++)
+			d[i] = s[i] * softvol_gain_float(gains[i]);
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		v.i = *(const uint32_t *)src;
+		if (swap)
+			v.i = bswap_32(v.i);
+		v.f *= softvol_gain_float(gains[i]);
+		*(uint32_t *)dst = swap ? bswap_32(v.i) : v.i;
+		src += src_step;
+		dst += dst_step;
+	}
+}
+
+static inline void softvol_scale(snd_pcm_format_t format,
+				 char *dst, unsigned int dst_step,
+				 const char *src, unsigned int src_step,
+				 const unsigned int *gains, unsigned int n,
+				 int boost)
+{
+	int swap = !snd_pcm_format_cpu_endian(format);
+
+	switch (format) {
+	case SND_PCM_FORMAT_S16_LE:
+	case SND_PCM_FORMAT_S16_BE:
+		softvol_scale_s16(dst, dst_step, src, src_step, gains, n,
+				  swap, boost);
+		break;
+	case SND_PCM_FORMAT_S32_LE:
+	case SND_PCM_FORMAT_S32_BE:
+		softvol_scale_s32(dst, dst_step, src, src_step, gains, n, swap);
+		break;
+	case SND_PCM_FORMAT_S24_LE:
+		softvol_scale_s24(dst, dst_step, src, src_step, gains, n);
+		break;
+	case SND_PCM_FORMAT_S24_3LE:
+		softvol_scale_s24_3le(dst, dst_step, src, src_step, gains, n);
+		break;
+	case SND_PCM_FORMAT_FLOAT_LE:
+	case SND_PCM_FORMAT_FLOAT_BE:
+		softvol_scale_float(dst, dst_step, src, src_step, gains, n, swap);
+		break;
+	default:
+		break;
+	}
+}
+
+/* volume ramp, per gain slot */
+typedef struct {
+	snd_pcm_uframes_t len;		/* ramp length, one period or 0 */
+	snd_pcm_uframes_t pos;		/* frames done of the ramp */
+	int valid;			/* to[] is the applied volume */
+	unsigned int from[VOL_SLOTS];
+	unsigned int to[VOL_SLOTS];
+} snd_pcm_softvol_ramp_t;
+
+/* the gain of the slot at the given frame from the current position */
+static inline unsigned int softvol_ramp_gain(const snd_pcm_softvol_ramp_t *ramp,
+					     unsigned int slot,
+					     snd_pcm_uframes_t frame)
+{
+	snd_pcm_uframes_t pos = ramp->pos + frame;
+	long long from = ramp->from[slot];
+	long long to = ramp->to[slot];
+
+	if (pos >= ramp->len)
+		return to;
+	return from + (to - from) * (long long)pos / (long long)ramp->len;
+}
+
+/*
+ * start a linear ramp over ramp->len frames from the gain applied right
+ * now to vol, the first call after the setup applies vol at once
+ */
+static inline void softvol_ramp_start(snd_pcm_softvol_ramp_t *ramp,
+				      const unsigned int *vol)
+{
+	unsigned int slot;
+
+	if (!ramp->valid) {
+		memcpy(ramp->to, vol, sizeof(ramp->to));
+		ramp->pos = ramp->len;
+		ramp->valid = 1;
+		return;
+	}
+	if (!memcmp(ramp->to, vol, sizeof(ramp->to)))
+		return;
+	for (slot = 0; slot < VOL_SLOTS; slot++)
+		ramp->from[slot] = softvol_ramp_gain(ramp, slot, 0);
+	memcpy(ramp->to, vol, sizeof(ramp->to));
+	ramp->pos = 0;
+}
+
+static inline int softvol_ramp_running(const snd_pcm_softvol_ramp_t *ramp)
+{
+	return ramp->pos < ramp->len;
+}
+
+static inline void softvol_ramp_advance(snd_pcm_softvol_ramp_t *ramp,
+					snd_pcm_uframes_t frames)
+{
+	if (frames >= ramp->len - ramp->pos)
+		ramp->pos = ramp->len;
+	else
+		ramp->pos += frames;
+}
+
+/*
+ * the gain table of n interleaved frames from the given frame on, the
+ * channel ch takes the gain of slots[ch]
+ */
+static inline void softvol_ramp_gains(const snd_pcm_softvol_ramp_t *ramp,
+				      const unsigned int *slots,
+				      unsigned int channels,
+				      snd_pcm_uframes_t frame, unsigned int n,
+				      unsigned int *gains)
+{
+	unsigned int i, ch;
+
+	for (i = 0; i < n; i++)
+		for (ch = 0; ch < channels; ch++)
+			gains[i * channels + ch] =
+				softvol_ramp_gain(ramp, slots[ch], frame + i);
+}
+
+#endif /* __PCM_SOFTVOL_SCALE_H */
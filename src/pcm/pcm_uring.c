@@ -0,0 +1,893 @@
+/**
+ * \file pcm/pcm_uring.c
+ * \ingroup PCM
+ * \brief PCM Transfer Ring Interface
+ * \date 2026
+ *
+ * The transfer ring queues the read and write requests of many PCMs
+ * to one io_uring instance and returns their completions in batches.
+ */
+/*
+ *  PCM - io_uring transfer ring
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * io_uring has no operation for the PCM ioctls, so a request is done in
+ * one of two ways:
+ *
+ * - nonblocking hw PCM with the RW_NONINTERLEAVED access: a POLL_ADD on
+ *   the PCM file linked to a READV/WRITEV with one iovec per channel.
+ *   The kernel read_iter/write_iter of the PCM device accept only this
+ *   layout, the transfer is then done completely in the kernel.  In the
+ *   blocking mode the READV/WRITEV could sleep in an io-wq worker, such
+ *   PCMs take the way below.
+ *
+ * - any other PCM with a single poll descriptor: a POLL_ADD on that
+ *   descriptor, the transfer is done by the library with the usual
+ *   snd_pcm_readi/writei/readn/writen() when the completion is reaped.
+ *   At most the available frames are transferred, so the call never
+ *   blocks.
+ *
+ * The ring uses the raw system calls, liburing is not needed.
+ */
+
+#include "pcm_local.h"
+#include <sys/uio.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#ifndef DOC_HIDDEN
+
+enum {
+	RING_OP_WRITEI,
+	RING_OP_WRITEN,
+	RING_OP_READI,
+	RING_OP_READN,
+};
+
+typedef struct {
+	snd_pcm_t *pcm;
+	void *private_data;
+	int type;			/* RING_OP_* */
+	int kernel;			/* transfer done by the kernel */
+	void *buf;			/* interleaved buffer */
+	void **bufs;			/* non-interleaved buffers */
+	snd_pcm_uframes_t size;
+	struct pollfd pfd;
+	int poll_err;			/* error of the linked poll */
+	struct iovec *iov;		/* one per channel for the kernel */
+	unsigned int iov_count;
+	unsigned int inflight;		/* submitted sqes without a cqe */
+	int next_free;
+} snd_pcm_ring_op_t;
+
+struct _snd_pcm_ring {
+	int fd;
+	/* submission queue */
+	void *sq_ring;
+	size_t sq_ring_size;
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_array;
+	unsigned int sq_mask;
+	unsigned int sq_entries;
+	unsigned int sq_local_tail;	/* tail with the not yet published sqes */
+	unsigned int sq_flushed;	/* published tail */
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	/* completion queue */
+	void *cq_ring;
+	size_t cq_ring_size;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int cq_mask;
+	struct io_uring_cqe *cqes;
+	/* requests */
+	snd_pcm_ring_op_t *ops;
+	unsigned int ops_count;
+	unsigned int ops_used;
+	unsigned int inflight;		/* sum of the requests' inflight */
+	int free_op;
+};
+
+/* user_data: request index << 1, bit 0 marks the linked poll */
+#define RING_UDATA(idx, link)	(((__u64)(idx) << 1) | (link))
+/* user_data of the cancel requests */
+#define RING_UDATA_CANCEL	(~(__u64)0)
+
+static int sys_io_uring_setup(unsigned int entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned int to_submit,
+			      unsigned int min_complete, unsigned int flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+		       flags, NULL, 0);
+}
+
+static void ring_unmap(snd_pcm_ring_t *ring)
+{
+	if (ring->sqes)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring && ring->cq_ring != ring->sq_ring)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	if (ring->sq_ring)
+		munmap(ring->sq_ring, ring->sq_ring_size);
+}
+
+static int ring_map(snd_pcm_ring_t *ring, struct io_uring_params *p)
+{
+	char *sq, *cq;
+
+	ring->sq_ring_size = p->sq_off.array + p->sq_entries * sizeof(unsigned int);
+	ring->cq_ring_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+	if (p->features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_ring_size > ring->sq_ring_size)
+			ring->sq_ring_size = ring->cq_ring_size;
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+	sq = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (sq == MAP_FAILED)
+		return -errno;
+	ring->sq_ring = sq;
+	if (p->features & IORING_FEAT_SINGLE_MMAP) {
+		cq = sq;
+	} else {
+		cq = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+		if (cq == MAP_FAILED)
+			return -errno;
+	}
+	ring->cq_ring = cq;
+	ring->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		ring->sqes = NULL;
+		return -errno;
+	}
+
+	ring->sq_head = (unsigned int *)(sq + p->sq_off.head);
+	ring->sq_tail = (unsigned int *)(sq + p->sq_off.tail);
+	ring->sq_array = (unsigned int *)(sq + p->sq_off.array);
+	ring->sq_mask = *(unsigned int *)(sq + p->sq_off.ring_mask);
+	ring->sq_entries = p->sq_entries;
+	ring->sq_local_tail = ring->sq_flushed = *ring->sq_tail;
+	ring->cq_head = (unsigned int *)(cq + p->cq_off.head);
+	ring->cq_tail = (unsigned int *)(cq + p->cq_off.tail);
+	ring->cq_mask = *(unsigned int *)(cq + p->cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + p->cq_off.cqes);
+	return 0;
+}
+
+static struct io_uring_sqe *ring_get_sqe(snd_pcm_ring_t *ring)
+{
+	unsigned int head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+	struct io_uring_sqe *sqe;
+	unsigned int idx;
+
+	if (ring->sq_local_tail - head >= ring->sq_entries)
+		return NULL;
+	idx = ring->sq_local_tail & ring->sq_mask;
+	sqe = &ring->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	ring->sq_array[idx] = idx;
+	ring->sq_local_tail++;
+	return sqe;
+}
+
+static unsigned int ring_sq_space(snd_pcm_ring_t *ring)
+{
+	unsigned int head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+	return ring->sq_entries - (ring->sq_local_tail - head);
+}
+
+static void ring_prep_poll(struct io_uring_sqe *sqe, int fd, unsigned int events,
+			   __u64 user_data)
+{
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+#ifdef IORING_FEAT_POLL_32BITS
+#if __BYTE_ORDER == __BIG_ENDIAN
+	events = (events << 16) | (events >> 16);
+#endif
+	sqe->poll32_events = events;
+#else
+	sqe->poll_events = events;
+#endif
+	sqe->user_data = user_data;
+}
+
+/* publish the queued sqes, return the count not yet consumed by the kernel */
+static unsigned int ring_publish(snd_pcm_ring_t *ring)
+{
+	if (ring->sq_local_tail != ring->sq_flushed) {
+		__atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+		ring->sq_flushed = ring->sq_local_tail;
+	}
+	/* the kernel consumes the sqes up to the published tail */
+	return ring->sq_flushed - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+}
+
+static int ring_flush(snd_pcm_ring_t *ring)
+{
+	unsigned int to_submit;
+	int err;
+
+	to_submit = ring_publish(ring);
+	while (to_submit > 0) {
+		err = sys_io_uring_enter(ring->fd, to_submit, 0, 0);
+		if (err < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		if (err == 0)
+			return -EAGAIN;
+		to_submit -= err;
+	}
+	return 0;
+}
+
+static snd_pcm_ring_op_t *ring_op_alloc(snd_pcm_ring_t *ring)
+{
+	snd_pcm_ring_op_t *op;
+
+	if (ring->free_op < 0)
+		return NULL;
+	op = &ring->ops[ring->free_op];
+	ring->free_op = op->next_free;
+	ring->ops_used++;
+	return op;
+}
+
+static void ring_op_free(snd_pcm_ring_t *ring, snd_pcm_ring_op_t *op)
+{
+	op->pcm = NULL;
+	op->next_free = ring->free_op;
+	ring->free_op = op - ring->ops;
+	ring->ops_used--;
+}
+
+/* set up the iovecs of a kernel transfer, return the hw PCM file or an error */
+static int ring_op_kernel(snd_pcm_ring_op_t *op)
+{
+	snd_pcm_t *pcm = op->pcm;
+	size_t len;
+	unsigned int c;
+	int fd;
+
+	if (op->type != RING_OP_WRITEN && op->type != RING_OP_READN)
+		return -EINVAL;
+	fd = snd_pcm_hw_ring_fd(pcm);
+	if (fd < 0)
+		return fd;
+	/* the kernel wants each iovec aligned to the frame size */
+	len = snd_pcm_samples_to_bytes(pcm, op->size);
+	if (pcm->channels > 128 || len % snd_pcm_frames_to_bytes(pcm, 1))
+		return -EINVAL;
+	if (op->iov_count < pcm->channels) {
+		struct iovec *iov = realloc(op->iov, pcm->channels * sizeof(*iov));
+		if (!iov)
+			return -ENOMEM;
+		op->iov = iov;
+		op->iov_count = pcm->channels;
+	}
+	for (c = 0; c < pcm->channels; c++) {
+		op->iov[c].iov_base = op->bufs[c];
+		op->iov[c].iov_len = len;
+	}
+	return fd;
+}
+
+static int ring_queue(snd_pcm_ring_t *ring, snd_pcm_t *pcm, int type,
+		      void *buf, void **bufs, snd_pcm_uframes_t size,
+		      void *private_data)
+{
+	struct io_uring_sqe *sqe;
+	snd_pcm_ring_op_t *op;
+	unsigned int idx;
+	int fd, err;
+
+	assert(ring && pcm);
+	if (size == 0)
+		return -EINVAL;
+	if ((type == RING_OP_READI || type == RING_OP_READN) !=
+	    (pcm->stream == SND_PCM_STREAM_CAPTURE))
+		return -EINVAL;
+	if (ring_sq_space(ring) < 2) {
+		err = ring_flush(ring);
+		if (err < 0)
+			return err;
+		if (ring_sq_space(ring) < 2)
+			return -EAGAIN;
+	}
+	op = ring_op_alloc(ring);
+	if (!op)
+		return -EAGAIN;
+	op->pcm = pcm;
+	op->private_data = private_data;
+	op->type = type;
+	op->buf = buf;
+	op->bufs = bufs;
+	op->size = size;
+	op->poll_err = 0;
+	idx = op - ring->ops;
+
+	/* a capture must run before its poll can wake up, as with snd_pcm_read*() */
+	if (pcm->stream == SND_PCM_STREAM_CAPTURE &&
+	    snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED) {
+		err = snd_pcm_start(pcm);
+		if (err < 0)
+			goto __error;
+	}
+
+	fd = ring_op_kernel(op);
+	op->kernel = fd >= 0;
+	if (op->kernel) {
+		sqe = ring_get_sqe(ring);
+		ring_prep_poll(sqe, fd, pcm->poll_events | POLLERR, RING_UDATA(idx, 1));
+		sqe->flags = IOSQE_IO_LINK;
+		sqe = ring_get_sqe(ring);
+		sqe->opcode = type == RING_OP_WRITEN ? IORING_OP_WRITEV : IORING_OP_READV;
+		sqe->fd = fd;
+		sqe->addr = (unsigned long)op->iov;
+		sqe->len = pcm->channels;
+		sqe->user_data = RING_UDATA(idx, 0);
+		op->inflight = 2;
+		ring->inflight += 2;
+		return 0;
+	}
+	if (fd != -EINVAL) {
+		err = fd;
+		goto __error;
+	}
+
+	err = snd_pcm_poll_descriptors_count(pcm);
+	if (err != 1) {
+		err = err < 0 ? err : -EINVAL;
+		goto __error;
+	}
+	err = snd_pcm_poll_descriptors(pcm, &op->pfd, 1);
+	if (err < 0)
+		goto __error;
+	sqe = ring_get_sqe(ring);
+	ring_prep_poll(sqe, op->pfd.fd, op->pfd.events, RING_UDATA(idx, 0));
+	op->inflight = 1;
+	ring->inflight++;
+	return 0;
+
+ __error:
+	ring_op_free(ring, op);
+	return err;
+}
+
+/* do the transfer of a request after its poll, 0 = poll again */
+static snd_pcm_sframes_t ring_op_transfer(snd_pcm_ring_op_t *op, int mask)
+{
+	snd_pcm_t *pcm = op->pcm;
+	snd_pcm_sframes_t avail;
+	snd_pcm_uframes_t frames;
+	unsigned short revents;
+	int err;
+
+	op->pfd.revents = mask;
+	err = snd_pcm_poll_descriptors_revents(pcm, &op->pfd, 1, &revents);
+	if (err < 0)
+		return err;
+	if (!revents)
+		return 0;
+	avail = snd_pcm_avail_update(pcm);
+	if (avail <= 0)
+		return avail;
+	frames = op->size < (snd_pcm_uframes_t)avail ? op->size : (snd_pcm_uframes_t)avail;
+	switch (op->type) {
+	case RING_OP_WRITEI:
+		return snd_pcm_writei(pcm, op->buf, frames);
+	case RING_OP_WRITEN:
+		return snd_pcm_writen(pcm, op->bufs, frames);
+	case RING_OP_READI:
+		return snd_pcm_readi(pcm, op->buf, frames);
+	default:
+		return snd_pcm_readn(pcm, op->bufs, frames);
+	}
+}
+
+static int ring_reap(snd_pcm_ring_t *ring, snd_pcm_ring_event_t *events,
+		     unsigned int space)
+{
+	unsigned int head = *ring->cq_head, tail;
+	unsigned int count = 0;
+	struct io_uring_cqe *cqe;
+	struct io_uring_sqe *sqe;
+	snd_pcm_ring_op_t *op;
+	snd_pcm_sframes_t result;
+
+	tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+	while (head != tail && count < space) {
+		cqe = &ring->cqes[head & ring->cq_mask];
+		head++;
+		if (cqe->user_data == RING_UDATA_CANCEL)
+			continue;
+		op = &ring->ops[cqe->user_data >> 1];
+		op->inflight--;
+		ring->inflight--;
+		if (cqe->user_data & 1) {
+			/* linked poll, the transfer follows */
+			if (cqe->res < 0)
+				op->poll_err = cqe->res;
+			continue;
+		}
+		if (op->kernel) {
+			result = cqe->res;
+			if (result == -ECANCELED && op->poll_err)
+				result = op->poll_err;
+			result = snd_pcm_hw_ring_result(op->pcm, result);
+		} else if (cqe->res < 0) {
+			result = cqe->res;
+		} else {
+			result = ring_op_transfer(op, cqe->res);
+			if (result == 0 || result == -EAGAIN) {
+				sqe = ring_get_sqe(ring);
+				if (sqe) {
+					ring_prep_poll(sqe, op->pfd.fd, op->pfd.events,
+						       RING_UDATA(op - ring->ops, 0));
+					op->inflight++;
+					ring->inflight++;
+					continue;
+				}
+				result = -EAGAIN;
+			}
+		}
+		events[count].pcm = op->pcm;
+		events[count].private_data = op->private_data;
+		events[count].result = result;
+		count++;
+		ring_op_free(ring, op);
+	}
+	__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+	return count;
+}
+
+static struct io_uring_sqe *ring_get_sqe_flush(snd_pcm_ring_t *ring, int *err)
+{
+	struct io_uring_sqe *sqe = ring_get_sqe(ring);
+
+	if (sqe)
+		return sqe;
+	*err = ring_flush(ring);
+	if (*err < 0)
+		return NULL;
+	sqe = ring_get_sqe(ring);
+	if (!sqe)
+		*err = -EAGAIN;
+	return sqe;
+}
+
+/* cancel all submitted requests and wait until the kernel releases them */
+static int ring_cancel_all(snd_pcm_ring_t *ring)
+{
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	snd_pcm_ring_op_t *op;
+	unsigned int i, head, tail;
+	int link, err;
+
+	err = ring_flush(ring);
+	if (err < 0)
+		return err;
+	for (i = 0; i < ring->ops_count; i++) {
+		op = &ring->ops[i];
+		/* a kernel transfer may be past its linked poll already */
+		for (link = op->kernel; op->inflight && link >= 0; link--) {
+			sqe = ring_get_sqe_flush(ring, &err);
+			if (!sqe)
+				return err;
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->fd = -1;
+			sqe->addr = RING_UDATA(i, link);
+			sqe->user_data = RING_UDATA_CANCEL;
+		}
+	}
+	err = ring_flush(ring);
+	if (err < 0)
+		return err;
+
+	head = *ring->cq_head;
+	while (ring->inflight > 0) {
+		tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+		if (head == tail) {
+			__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+			err = sys_io_uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS);
+			if (err < 0 && errno != EINTR)
+				return -errno;
+			continue;
+		}
+		cqe = &ring->cqes[head & ring->cq_mask];
+		head++;
+		if (cqe->user_data == RING_UDATA_CANCEL)
+			continue;
+		ring->ops[cqe->user_data >> 1].inflight--;
+		ring->inflight--;
+	}
+	__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+	return 0;
+}
+
+#endif /* DOC_HIDDEN */
+
+/**
+ * \brief Open a PCM transfer ring
+ * \param ringp Returned ring handle
+ * \param entries Maximum number of the queued requests
+ * \return 0 on success otherwise a negative error code
+ *
+ * The ring queues the read and write requests of any number of PCMs
+ * and returns their completions with #snd_pcm_ring_wait(), so one
+ * thread can drive many PCMs.  The requests of a hw PCM opened with
+ * #SND_PCM_NONBLOCK and set up with the #SND_PCM_ACCESS_RW_NONINTERLEAVED
+ * access are transferred by the kernel.  The other requests wait for the PCM in the kernel and are
+ * transferred in #snd_pcm_ring_wait().
+ *
+ * The ring is not thread-safe, it must be used from one thread.
+ * -ENOSYS is returned when the library has no io_uring support or the
+ * kernel is older than 5.5, which added the request cancellation.
+ */
+int snd_pcm_ring_open(snd_pcm_ring_t **ringp, unsigned int entries)
+{
+	struct io_uring_params p;
+	snd_pcm_ring_t *ring;
+	unsigned int i;
+	int err;
+
+	assert(ringp);
+	if (entries == 0 || entries > 4096)
+		return -EINVAL;
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return -ENOMEM;
+	ring->ops = calloc(entries, sizeof(*ring->ops));
+	if (!ring->ops) {
+		free(ring);
+		return -ENOMEM;
+	}
+	ring->ops_count = entries;
+	for (i = 0; i < entries; i++)
+		ring->ops[i].next_free = i + 1 < entries ? (int)i + 1 : -1;
+	ring->free_op = 0;
+
+	/* a kernel transfer takes two sqes, the poll and the transfer */
+	memset(&p, 0, sizeof(p));
+	ring->fd = sys_io_uring_setup(entries * 2, &p);
+	if (ring->fd < 0) {
+		err = -errno;
+		free(ring->ops);
+		free(ring);
+		return err;
+	}
+	/* IORING_OP_ASYNC_CANCEL came with the IORING_FEAT_NODROP release */
+	if (!(p.features & IORING_FEAT_NODROP)) {
+		close(ring->fd);
+		free(ring->ops);
+		free(ring);
+		return -ENOSYS;
+	}
+	err = ring_map(ring, &p);
+	if (err < 0) {
+		snd_pcm_ring_close(ring);
+		return err;
+	}
+	*ringp = ring;
+	return 0;
+}
+
+/**
+ * \brief Close a PCM transfer ring
+ * \param ring Ring handle
+ * \return 0 on success otherwise a negative error code
+ *
+ * The pending requests are cancelled without completion events.  The
+ * call waits until the kernel has released them, so their buffers may
+ * be freed when it returns.  If the cancellation fails, the error is
+ * returned and the ring memory the kernel may still use is not freed.
+ */
+int snd_pcm_ring_close(snd_pcm_ring_t *ring)
+{
+	unsigned int i;
+	int err = 0;
+
+	assert(ring);
+	if (ring->inflight > 0)
+		err = ring_cancel_all(ring);
+	ring_unmap(ring);
+	close(ring->fd);
+	if (err >= 0) {
+		for (i = 0; i < ring->ops_count; i++)
+			free(ring->ops[i].iov);
+		free(ring->ops);
+	}
+	free(ring);
+	return err;
+}
+
+/**
+ * \brief Get the count of the poll descriptors of a transfer ring
+ * \param ring Ring handle
+ * \return Count of the poll descriptors
+ */
+int snd_pcm_ring_poll_descriptors_count(snd_pcm_ring_t *ring)
+{
+	assert(ring);
+	return 1;
+}
+
+/**
+ * \brief Get the poll descriptors of a transfer ring
+ * \param ring Ring handle
+ * \param pfds Array of poll descriptors
+ * \param space Space in the poll descriptor array
+ * \return Count of the filled descriptors
+ *
+ * The descriptor reports POLLIN when completions are pending, call
+ * #snd_pcm_ring_wait() with a zero timeout to get them.
+ */
+int snd_pcm_ring_poll_descriptors(snd_pcm_ring_t *ring, struct pollfd *pfds,
+				  unsigned int space)
+{
+	assert(ring && pfds);
+	if (space < 1)
+		return 0;
+	pfds->fd = ring->fd;
+	pfds->events = POLLIN;
+	pfds->revents = 0;
+	return 1;
+}
+
+/**
+ * \brief Queue a write request of interleaved frames
+ * \param ring Ring handle
+ * \param pcm PCM handle
+ * \param buffer Frames containing buffer
+ * \param size Frames to be written
+ * \param private_data Value returned in the completion event
+ * \return 0 on success otherwise a negative error code
+ *
+ * The buffer must stay valid until the completion.  The completion
+ * result is the count of the written frames, which may be less than
+ * \p size, or a negative error code as from #snd_pcm_writei().
+ * -EAGAIN is returned when the ring is full.
+ */
+int snd_pcm_ring_writei(snd_pcm_ring_t *ring, snd_pcm_t *pcm,
+			const void *buffer, snd_pcm_uframes_t size,
+			void *private_data)
+{
+	return ring_queue(ring, pcm, RING_OP_WRITEI, (void *)buffer, NULL,
+			  size, private_data);
+}
+
+/**
+ * \brief Queue a write request of non-interleaved frames
+ * \param ring Ring handle
+ * \param pcm PCM handle
+ * \param bufs Frames containing buffers (one for each channel)
+ * \param size Frames to be written
+ * \param private_data Value returned in the completion event
+ * \return 0 on success otherwise a negative error code
+ *
+ * The buffers and the \p bufs array must stay valid until the
+ * completion.  See #snd_pcm_ring_writei() for the result.
+ */
+int snd_pcm_ring_writen(snd_pcm_ring_t *ring, snd_pcm_t *pcm,
+			void **bufs, snd_pcm_uframes_t size,
+			void *private_data)
+{
+	return ring_queue(ring, pcm, RING_OP_WRITEN, NULL, bufs,
+			  size, private_data);
+}
+
+/**
+ * \brief Queue a read request of interleaved frames
+ * \param ring Ring handle
+ * \param pcm PCM handle
+ * \param buffer Frames containing buffer
+ * \param size Frames to be read
+ * \param private_data Value returned in the completion event
+ * \return 0 on success otherwise a negative error code
+ *
+ * A prepared capture PCM is started.  The buffer must stay valid until
+ * the completion.  The completion result is the count of the read
+ * frames, which may be less than \p size, or a negative error code as
+ * from #snd_pcm_readi().  -EAGAIN is returned when the ring is full.
+ */
+int snd_pcm_ring_readi(snd_pcm_ring_t *ring, snd_pcm_t *pcm,
+		       void *buffer, snd_pcm_uframes_t size,
+		       void *private_data)
+{
+	return ring_queue(ring, pcm, RING_OP_READI, buffer, NULL,
+			  size, private_data);
+}
+
+/**
+ * \brief Queue a read request of non-interleaved frames
+ * \param ring Ring handle
+ * \param pcm PCM handle
+ * \param bufs Frames containing buffers (one for each channel)
+ * \param size Frames to be read
+ * \param private_data Value returned in the completion event
+ * \return 0 on success otherwise a negative error code
+ *
+ * The buffers and the \p bufs array must stay valid until the
+ * completion.  See #snd_pcm_ring_readi() for the result.
+ */
+int snd_pcm_ring_readn(snd_pcm_ring_t *ring, snd_pcm_t *pcm,
+		       void **bufs, snd_pcm_uframes_t size,
+		       void *private_data)
+{
+	return ring_queue(ring, pcm, RING_OP_READN, NULL, bufs,
+			  size, private_data);
+}
+
+/**
+ * \brief Submit the queued requests of a transfer ring
+ * \param ring Ring handle
+ * \return 0 on success otherwise a negative error code
+ *
+ * #snd_pcm_ring_wait() submits the queued requests too, this call is
+ * needed only when the application waits on the ring poll descriptor.
+ */
+int snd_pcm_ring_submit(snd_pcm_ring_t *ring)
+{
+	assert(ring);
+	return ring_flush(ring);
+}
+
+/**
+ * \brief Submit the queued requests and get the completed ones
+ * \param ring Ring handle
+ * \param events Array for the completion events
+ * \param space Space in the events array
+ * \param timeout Maximum time in milliseconds to wait for a completion,
+ *        a negative value means infinity
+ * \return Count of the returned events (0 on timeout or when no request
+ *         is pending) otherwise a negative error code
+ */
+int snd_pcm_ring_wait(snd_pcm_ring_t *ring, snd_pcm_ring_event_t *events,
+		      unsigned int space, int timeout)
+{
+	snd_htimestamp_t start, now;
+	struct pollfd pfd;
+	int count, err, left;
+
+	assert(ring && events);
+	if (timeout > 0)
+		gettimestamp(&start, SND_PCM_TSTAMP_TYPE_MONOTONIC);
+	err = ring_flush(ring);
+	if (err < 0)
+		return err;
+	for (;;) {
+		count = ring_reap(ring, events, space);
+		/* submit the polls requeued by the reap before blocking */
+		err = ring_flush(ring);
+		if (count > 0)
+			return count;
+		if (err < 0)
+			return err;
+		if (timeout == 0 || ring->ops_used == 0)
+			return 0;
+		if (timeout < 0) {
+			err = sys_io_uring_enter(ring->fd, ring_publish(ring), 1,
+						 IORING_ENTER_GETEVENTS);
+		} else {
+			gettimestamp(&now, SND_PCM_TSTAMP_TYPE_MONOTONIC);
+			left = timeout - (int)((now.tv_sec - start.tv_sec) * 1000 +
+					       (now.tv_nsec - start.tv_nsec) / 1000000);
+			if (left <= 0)
+				return 0;
+			pfd.fd = ring->fd;
+			pfd.events = POLLIN;
+			err = poll(&pfd, 1, left);
+			if (err == 0)
+				return 0;
+		}
+		if (err < 0)
+			return -errno;
+	}
+}
+
+#else /* HAVE_LINUX_IO_URING_H */
+
+int snd_pcm_ring_open(snd_pcm_ring_t **ringp ATTRIBUTE_UNUSED,
+		      unsigned int entries ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+int snd_pcm_ring_close(snd_pcm_ring_t *ring ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+int snd_pcm_ring_poll_descriptors_count(snd_pcm_ring_t *ring ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+int snd_pcm_ring_poll_descriptors(snd_pcm_ring_t *ring ATTRIBUTE_UNUSED,
+				  struct pollfd *pfds ATTRIBUTE_UNUSED,
+				  unsigned int space ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+int snd_pcm_ring_writei(snd_pcm_ring_t *ring ATTRIBUTE_UNUSED,
+			snd_pcm_t *pcm ATTRIBUTE_UNUSED,
+			const void *buffer ATTRIBUTE_UNUSED,
+			snd_pcm_uframes_t size ATTRIBUTE_UNUSED,
+			void *private_data ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+int snd_pcm_ring_writen(snd_pcm_ring_t *ring ATTRIBUTE_UNUSED,
+			snd_pcm_t *pcm ATTRIBUTE_UNUSED,
+			void **bufs ATTRIBUTE_UNUSED,
+			snd_pcm_uframes_t size ATTRIBUTE_UNUSED,
+			void *private_data ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+int snd_pcm_ring_readi(snd_pcm_ring_t *ring ATTRIBUTE_UNUSED,
+		       snd_pcm_t *pcm ATTRIBUTE_UNUSED,
+		       void *buffer ATTRIBUTE_UNUSED,
+		       snd_pcm_uframes_t size ATTRIBUTE_UNUSED,
+		       void *private_data ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+int snd_pcm_ring_readn(snd_pcm_ring_t *ring ATTRIBUTE_UNUSED,
+		       snd_pcm_t *pcm ATTRIBUTE_UNUSED,
+		       void **bufs ATTRIBUTE_UNUSED,
+		       snd_pcm_uframes_t size ATTRIBUTE_UNUSED,
+		       void *private_data ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+int snd_pcm_ring_submit(snd_pcm_ring_t *ring ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+int snd_pcm_ring_wait(snd_pcm_ring_t *ring ATTRIBUTE_UNUSED,
+		      snd_pcm_ring_event_t *events ATTRIBUTE_UNUSED,
+		      unsigned int space ATTRIBUTE_UNUSED,
+		      int timeout ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+#endif /* HAVE_LINUX_IO_URING_H */
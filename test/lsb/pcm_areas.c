@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+
+/*
+ * snd_pcm_areas_copy() transposes interleaved and planar buffers with
+ * vector kernels for some widths and channel counts.  Every layout is
+ * compared with the per-channel snd_pcm_area_copy() into a buffer with
+ * the same fill pattern, so a write outside of the copied frames is
+ * caught as well.  snd_pcm_areas_silence() is checked the same way
+ * against snd_pcm_area_silence().
+ */
+
+#define MAX_CHANNELS	10
+#define MAX_FRAMES	1100
+
+static unsigned int seed = 1;
+
+static unsigned int test_random(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+enum layout {
+	INTERLEAVED,
+	PLANAR,		/* one buffer, the channels one after another */
+	SEPARATE,	/* a buffer per channel */
+	REVERSED,	/* interleaved, the areas in reverse channel order */
+};
+
+static const char *const layout_names[] = {
+	"interleaved", "planar", "separate", "reversed",
+};
+
+struct buffer {
+	unsigned char *data[MAX_CHANNELS];
+	size_t bytes;		/* of each data block */
+	snd_pcm_channel_area_t areas[MAX_CHANNELS];
+};
+
+static int setup_buffer(struct buffer *b, enum layout layout,
+			unsigned int channels, unsigned int width)
+{
+	size_t frame_bytes = channels * width / 8;
+	unsigned int ch, blocks = layout == SEPARATE ? channels : 1;
+
+	memset(b, 0, sizeof(*b));
+	b->bytes = layout == SEPARATE ? MAX_FRAMES * width / 8 :
+		   MAX_FRAMES * frame_bytes;
+	for (ch = 0; ch < blocks; ch++) {
+		b->data[ch] = malloc(b->bytes);
+		if (!b->data[ch])
+			return -1;
+	}
+	for (ch = 0; ch < channels; ch++) {
+		snd_pcm_channel_area_t *a = &b->areas[ch];
+
+		switch (layout) {
+		case INTERLEAVED:
+			a->addr = b->data[0];
+			a->first = ch * width;
+			a->step = channels * width;
+			break;
+		case PLANAR:
+			a->addr = b->data[0] + ch * MAX_FRAMES * width / 8;
+			a->first = 0;
+			a->step = width;
+			break;
+		case SEPARATE:
+			a->addr = b->data[ch];
+			a->first = 0;
+			a->step = width;
+			break;
+		case REVERSED:
+			a->addr = b->data[0];
+			a->first = (channels - 1 - ch) * width;
+			a->step = channels * width;
+			break;
+		}
+	}
+	return 0;
+}
+
+static void fill_buffer(struct buffer *b, unsigned int channels)
+{
+	unsigned int ch;
+	size_t i;
+
+	for (ch = 0; ch < channels && b->data[ch]; ch++)
+		for (i = 0; i < b->bytes; i++)
+			b->data[ch][i] = test_random();
+}
+
+static void copy_buffer(struct buffer *dst, const struct buffer *src,
+			unsigned int channels)
+{
+	unsigned int ch;
+
+	for (ch = 0; ch < channels && src->data[ch]; ch++)
+		memcpy(dst->data[ch], src->data[ch], src->bytes);
+}
+
+static int equal_buffers(const struct buffer *a, const struct buffer *b,
+			 unsigned int channels)
+{
+	unsigned int ch;
+
+	for (ch = 0; ch < channels && a->data[ch]; ch++)
+		if (memcmp(a->data[ch], b->data[ch], a->bytes))
+			return 0;
+	return 1;
+}
+
+static void free_buffer(struct buffer *b)
+{
+	unsigned int ch;
+
+	for (ch = 0; ch < MAX_CHANNELS; ch++)
+		free(b->data[ch]);
+}
+
+static void test_copy(snd_pcm_format_t format, unsigned int channels,
+		      enum layout src_layout, enum layout dst_layout)
+{
+	static const snd_pcm_uframes_t frames[] = { 1, 3, 8, 17, 255, 1027 };
+	unsigned int width = snd_pcm_format_physical_width(format);
+	struct buffer src, dst, ref;
+	snd_pcm_uframes_t src_offset, dst_offset, n;
+	unsigned int i, ch, errors = 0;
+
+	if (setup_buffer(&src, src_layout, channels, width) < 0 ||
+	    setup_buffer(&dst, dst_layout, channels, width) < 0 ||
+	    setup_buffer(&ref, dst_layout, channels, width) < 0) {
+		TEST_CHECK(0);
+		goto __free;
+	}
+	for (i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+		n = frames[i];
+		src_offset = test_random() % (MAX_FRAMES - n + 1);
+		dst_offset = test_random() % (MAX_FRAMES - n + 1);
+		fill_buffer(&src, channels);
+		fill_buffer(&dst, channels);
+		copy_buffer(&ref, &dst, channels);
+		TEST_CHECK(snd_pcm_areas_copy(dst.areas, dst_offset, src.areas,
+					      src_offset, channels, n, format) == 0);
+		for (ch = 0; ch < channels; ch++)
+			snd_pcm_area_copy(&ref.areas[ch], dst_offset,
+					  &src.areas[ch], src_offset, n, format);
+		if (!equal_buffers(&dst, &ref, channels))
+			errors++;
+	}
+	if (errors)
+		fprintf(stderr, "copy %s %u channels %s -> %s: %u of %u differ\n",
+			snd_pcm_format_name(format), channels,
+			layout_names[src_layout], layout_names[dst_layout],
+			errors, i);
+	TEST_CHECK(errors == 0);
+ __free:
+	free_buffer(&src);
+	free_buffer(&dst);
+	free_buffer(&ref);
+}
+
+static void test_silence(snd_pcm_format_t format, unsigned int channels,
+			 enum layout layout)
+{
+	unsigned int width = snd_pcm_format_physical_width(format);
+	struct buffer dst, ref;
+	snd_pcm_uframes_t offset, n;
+	unsigned int i, ch, errors = 0;
+
+	if (setup_buffer(&dst, layout, channels, width) < 0 ||
+	    setup_buffer(&ref, layout, channels, width) < 0) {
+		TEST_CHECK(0);
+		goto __free;
+	}
+	for (i = 0; i < 8; i++) {
+		n = test_random() % MAX_FRAMES + 1;
+		offset = test_random() % (MAX_FRAMES - n + 1);
+		fill_buffer(&dst, channels);
+		copy_buffer(&ref, &dst, channels);
+		TEST_CHECK(snd_pcm_areas_silence(dst.areas, offset, channels,
+						 n, format) == 0);
+		for (ch = 0; ch < channels; ch++)
+			snd_pcm_area_silence(&ref.areas[ch], offset, n, format);
+		if (!equal_buffers(&dst, &ref, channels))
+			errors++;
+	}
+	if (errors)
+		fprintf(stderr, "silence %s %u channels %s: %u differ\n",
+			snd_pcm_format_name(format), channels,
+			layout_names[layout], errors);
+	TEST_CHECK(errors == 0);
+ __free:
+	free_buffer(&dst);
+	free_buffer(&ref);
+}
+
+static const snd_pcm_format_t formats[] = {
+	SND_PCM_FORMAT_U8,
+	SND_PCM_FORMAT_S16_LE,
+	SND_PCM_FORMAT_U16_LE,
+	SND_PCM_FORMAT_S24_3LE,
+	SND_PCM_FORMAT_S32_LE,
+	SND_PCM_FORMAT_FLOAT64_LE,
+};
+
+int main(void)
+{
+	unsigned int f, channels, src, dst;
+
+	for (f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+		for (channels = 1; channels <= MAX_CHANNELS; channels++) {
+			for (src = INTERLEAVED; src <= REVERSED; src++)
+				for (dst = INTERLEAVED; dst <= REVERSED; dst++)
+					test_copy(formats[f], channels, src, dst);
+			for (dst = INTERLEAVED; dst <= REVERSED; dst++)
+				test_silence(formats[f], channels, dst);
+		}
+	}
+	return TEST_EXIT_CODE();
+}
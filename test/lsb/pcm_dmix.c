@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "test.h"
+
+/*
+ * Mixes two dmix writers with constant signals into the playback side of
+ * the snd-aloop loopback card and checks the captured sum, with the locked
+ * mixing and with the staging slots.  Skipped when there is no loopback
+ * card.
+ */
+
+#define TEST_RATE	48000
+#define TEST_FRAMES	(TEST_RATE / 2)
+
+static const short values[2][2] = {
+	{ 1000, -3000 },
+	{ 200, 700 },
+};
+
+static const char config_fmt[] =
+	"pcm.test { type dmix ipc_key %d ipc_key_add_uid true "
+	"staging_slots %d slave { pcm { type hw card Loopback device 0 } "
+	"format S16_LE channels 2 rate 48000 period_size 1024 "
+	"buffer_size 4096 } } "
+	"pcm.capture { type hw card Loopback device 1 }";
+
+static int open_pcm(snd_pcm_t **pcm, const char *config, const char *name,
+		    snd_pcm_stream_t stream)
+{
+	snd_input_t *input;
+	snd_config_t *top;
+	int err;
+
+	err = snd_config_top(&top);
+	if (err < 0)
+		return err;
+	err = snd_input_buffer_open(&input, config, strlen(config));
+	if (err >= 0) {
+		err = snd_config_load(top, input);
+		snd_input_close(input);
+		if (err >= 0)
+			err = snd_pcm_open_lconf(pcm, name, stream,
+						 SND_PCM_NONBLOCK, top);
+	}
+	snd_config_delete(top);
+	if (err < 0)
+		return err;
+	err = snd_pcm_set_params(*pcm, SND_PCM_FORMAT_S16_LE,
+				 SND_PCM_ACCESS_RW_INTERLEAVED,
+				 2, TEST_RATE, 0, 100000);
+	if (err < 0)
+		snd_pcm_close(*pcm);
+	return err;
+}
+
+static int is_mix(short sample, int channel)
+{
+	return sample == 0 || sample == values[0][channel] ||
+	       sample == values[1][channel] ||
+	       sample == values[0][channel] + values[1][channel];
+}
+
+static int test_mix(int ipc_key, int staging_slots)
+{
+	static short bufs[2][1024 * 2];
+	static short capture_buf[1024 * 2];
+	char config[512];
+	snd_pcm_t *pcms[2], *capture;
+	snd_pcm_sframes_t frames, written[2] = { 0, 0 };
+	long mixed = 0, bad = 0;
+	int i, j, err;
+
+	snprintf(config, sizeof(config), config_fmt, ipc_key, staging_slots);
+	err = open_pcm(&pcms[0], config, "test", SND_PCM_STREAM_PLAYBACK);
+	if (err < 0)
+		return 77;
+	if (ALSA_CHECK(open_pcm(&pcms[1], config, "test",
+				SND_PCM_STREAM_PLAYBACK)) < 0)
+		goto __close0;
+	if (ALSA_CHECK(open_pcm(&capture, config, "capture",
+				SND_PCM_STREAM_CAPTURE)) < 0)
+		goto __close1;
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < 1024; j++) {
+			bufs[i][j * 2] = values[i][0];
+			bufs[i][j * 2 + 1] = values[i][1];
+		}
+	ALSA_CHECK(snd_pcm_start(capture));
+
+	while (written[0] < TEST_FRAMES || written[1] < TEST_FRAMES) {
+		for (i = 0; i < 2; i++) {
+			frames = TEST_FRAMES - written[i];
+			if (frames > 1024)
+				frames = 1024;
+			if (frames <= 0)
+				continue;
+			frames = snd_pcm_writei(pcms[i], bufs[i], frames);
+			if (frames == -EAGAIN)
+				continue;
+			if (ALSA_CHECK(frames) < 0)
+				goto __close;
+			written[i] += frames;
+		}
+		snd_pcm_wait(capture, 10);
+		frames = snd_pcm_readi(capture, capture_buf, 1024);
+		if (frames == -EAGAIN)
+			continue;
+		if (ALSA_CHECK(frames) < 0)
+			goto __close;
+		for (j = 0; j < frames; j++) {
+			if (capture_buf[j * 2] == values[0][0] + values[1][0] &&
+			    capture_buf[j * 2 + 1] == values[0][1] + values[1][1])
+				mixed++;
+			else if (!is_mix(capture_buf[j * 2], 0) ||
+				 !is_mix(capture_buf[j * 2 + 1], 1))
+				bad++;
+		}
+	}
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(mixed >= TEST_FRAMES / 2);
+	if (bad || mixed < TEST_FRAMES / 2)
+		fprintf(stderr, "staging_slots %d: %ld mixed, %ld bad frames\n",
+			staging_slots, mixed, bad);
+
+__close:
+	snd_pcm_close(capture);
+__close1:
+	snd_pcm_close(pcms[1]);
+__close0:
+	snd_pcm_close(pcms[0]);
+	return 0;
+}
+
+int main(void)
+{
+	int err;
+
+	err = test_mix(0x74657374, 0);
+	if (err)
+		return err;
+	test_mix(0x74657376, 4);
+	return TEST_EXIT_CODE();
+}
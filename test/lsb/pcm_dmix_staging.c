@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "test.h"
+#include "../../src/pcm/pcm_dmix_staging.h"
+
+/*
+ * Runs the bookkeeping of the dmix staging slots without a sound card: two
+ * clients stage frames ahead of a simulated hw_ptr in one process and
+ * every staged frame must be folded exactly once, also across the
+ * boundary, after a discontinuity and after a rewind.  A writer and a
+ * reader thread check that the seqcount never hands out a torn range.
+ * The mixing itself is covered by pcm_dmix with the loopback card.
+ */
+
+#define BUFFER_SIZE	4096
+#define PERIOD_SIZE	1024
+#define WINDOW		(2 * PERIOD_SIZE)
+#define BOUNDARY	(BUFFER_SIZE * 4)
+
+static snd_pcm_dmix_staging_t staging;
+
+static void reset_staging(unsigned int slots)
+{
+	unsigned int slot;
+
+	memset(&staging, 0, sizeof(staging));
+	staging.slots = slots;
+	for (slot = 0; slot < slots; slot++)
+		staging.slot[slot].folded_run = ~0U;
+}
+
+/* fold the window at hw, the folded frames of each slot must continue next[] */
+static int fold(snd_pcm_uframes_t hw, snd_pcm_uframes_t *next,
+		snd_pcm_uframes_t *folded)
+{
+	snd_pcm_uframes_t from[DMIX_STAGING_MAX_SLOTS], to[DMIX_STAGING_MAX_SLOTS];
+	unsigned int slot;
+	int lost;
+
+	lost = staging_fold_ranges(&staging, hw, WINDOW, BUFFER_SIZE, BOUNDARY,
+				   from, to);
+	for (slot = 0; slot < staging.slots; slot++) {
+		if (from[slot] == to[slot])
+			continue;
+		TEST_CHECK(to[slot] <= WINDOW);
+		TEST_CHECK((hw + from[slot]) % BOUNDARY == next[slot]);
+		next[slot] = (hw + to[slot]) % BOUNDARY;
+		folded[slot] += to[slot] - from[slot];
+	}
+	return lost;
+}
+
+/* two clients with different chunk sizes, several times around the boundary */
+static void test_fold(void)
+{
+	snd_pcm_uframes_t appl[2] = { 0, 0 }, next[2] = { 0, 0 };
+	snd_pcm_uframes_t staged[2] = { 0, 0 }, folded[2] = { 0, 0 };
+	static const snd_pcm_uframes_t chunk[2] = { 333, 1024 };
+	snd_pcm_uframes_t hw, size;
+	unsigned int slot;
+
+	reset_staging(2);
+	for (slot = 0; slot < 2; slot++)
+		staging_publish(&staging, slot, 1, 1, 0, 0);
+	for (hw = 0; hw < BOUNDARY * 3; hw += PERIOD_SIZE) {
+		for (slot = 0; slot < 2; slot++) {
+			/* keep up to three periods staged ahead of hw */
+			while (staging_diff(appl[slot], hw % BOUNDARY, BOUNDARY) <
+			       3 * PERIOD_SIZE) {
+				size = chunk[slot];
+				staging_stage(&staging, slot, appl[slot], size,
+					      BUFFER_SIZE, BOUNDARY);
+				appl[slot] = (appl[slot] + size) % BOUNDARY;
+				staged[slot] += size;
+			}
+		}
+		TEST_CHECK(!fold(hw % BOUNDARY, next, folded));
+		/* a second fold of the same window adds nothing */
+		size = folded[0] + folded[1];
+		fold(hw % BOUNDARY, next, folded);
+		TEST_CHECK(folded[0] + folded[1] == size);
+	}
+	for (slot = 0; slot < 2; slot++) {
+		/* everything before the last window end was folded */
+		TEST_CHECK(next[slot] == (hw - PERIOD_SIZE + WINDOW) % BOUNDARY);
+		TEST_CHECK(staged[slot] - folded[slot] ==
+			   staging_diff(appl[slot], next[slot], BOUNDARY));
+	}
+}
+
+/* a new run restarts the fold position, a range passed by hw is lost */
+static void test_run_and_lost(void)
+{
+	snd_pcm_uframes_t next[1], folded[1] = { 0 };
+
+	reset_staging(1);
+	staging_publish(&staging, 0, 1, 1, 0, 3000);
+	next[0] = 0;
+	fold(0, next, folded);
+	TEST_CHECK(folded[0] == WINDOW);
+
+	/* discontinuity: the owner starts a new run at another position */
+	staging_publish(&staging, 0, 1, 2, 8192, 8192 + 3000);
+	next[0] = 8192;
+	folded[0] = 0;
+	TEST_CHECK(!fold(8192 - 500, next, folded));
+	TEST_CHECK(folded[0] == WINDOW - 500);
+	TEST_CHECK(next[0] == 8192 + WINDOW - 500);
+
+	/* nobody folded in time, the rest of the range is dropped */
+	TEST_CHECK(fold(8192 + 6000, next, folded));
+	TEST_CHECK(staging.slot[0].folded == 8192 + 3000);
+	TEST_CHECK(!fold(8192 + 6000, next, folded));
+	TEST_CHECK(folded[0] == WINDOW - 500);
+
+	/* an inactive slot is never folded */
+	staging_publish(&staging, 0, 0, 3, 0, 3000);
+	TEST_CHECK(!fold(0, next, folded));
+	TEST_CHECK(folded[0] == WINDOW - 500);
+}
+
+/* a rewind removes the frames which were not folded yet */
+static void test_unstage(void)
+{
+	snd_pcm_uframes_t next[1] = { 100 }, folded[1] = { 0 };
+	snd_pcm_uframes_t start, appl;
+	unsigned int run;
+
+	reset_staging(1);
+	staging_publish(&staging, 0, 1, 1, 100, 3100);
+	fold(0, next, folded);
+	TEST_CHECK(next[0] == WINDOW);
+
+	/* rewind behind the fold position, 1052 frames were not folded yet */
+	TEST_CHECK(staging_unstage_slot(&staging, 0, 2500, 600, BOUNDARY) == 600);
+	TEST_CHECK(staging_read(&staging, 0, &start, &appl, &run));
+	TEST_CHECK(start == 100 && appl == 2500 && run == 1);
+	TEST_CHECK(staging.slot[0].folded == WINDOW);
+
+	/* rewind before the fold position, the caller remixes [1000, folded) */
+	TEST_CHECK(staging_unstage_slot(&staging, 0, 1000, 1500, BOUNDARY) ==
+		   2500 - WINDOW);
+	TEST_CHECK(staging_read(&staging, 0, &start, &appl, &run));
+	TEST_CHECK(start == 100 && appl == 1000);
+	TEST_CHECK(staging.slot[0].folded == 1000);
+
+	/* the next stage continues from there without a loss */
+	staging_publish(&staging, 0, 1, 1, 100, 4000);
+	next[0] = 1000;
+	folded[0] = 0;
+	TEST_CHECK(!fold(1000, next, folded));
+	TEST_CHECK(folded[0] == WINDOW);
+}
+
+#define SEQ_LOOPS	1000000
+
+static void *publisher(void *arg)
+{
+	snd_pcm_uframes_t i;
+
+	(void)arg;
+	for (i = 1; i <= SEQ_LOOPS; i++)
+		staging_publish(&staging, 0, 1, i, i, i * 3);
+	return NULL;
+}
+
+/* every range read while the owner publishes is one which was published */
+static void test_seqcount(void)
+{
+	snd_pcm_uframes_t start, appl, last = 0;
+	unsigned int run, reads = 0, torn = 0;
+	pthread_t thread;
+
+	reset_staging(1);
+	if (pthread_create(&thread, NULL, publisher, NULL)) {
+		TEST_CHECK(0);
+		return;
+	}
+	while (last < SEQ_LOOPS) {
+		if (!staging_read(&staging, 0, &start, &appl, &run))
+			continue;
+		reads++;
+		if (appl != start * 3 || run != (unsigned int)start || start < last)
+			torn++;
+		last = start;
+	}
+	pthread_join(thread, NULL);
+	TEST_CHECK(reads > 0);
+	TEST_CHECK(torn == 0);
+}
+
+int main(void)
+{
+	test_fold();
+	test_run_and_lost();
+	test_unstage();
+	test_seqcount();
+	return TEST_EXIT_CODE();
+}
@@ -0,0 +1,694 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "test.h"
+#include <alsa/pcm_plugin.h>
+
+/*
+ * Plays a fixed pseudo-random signal through a plugin chain that ends in a
+ * file PCM and compares a checksum of the written data with the recorded
+ * output of the generic conversion code.  Any change of the results, for
+ * example by an optimized code path, is caught here.  There are two
+ * exceptions.  S32 through the linear rate converter keeps the full sample
+ * width now instead of interpolating in 16 bits, so its checksum was
+ * recorded with the S32 path.  "plug float" mixes the channels in float
+ * now, which moves about half of the samples by up to 0.5 LSB of S16, so
+ * its checksum was recorded with the float route path.
+ */
+
+#define TEST_FRAMES	20000
+
+struct chain {
+	const char *name;
+	const char *config;	/* %s is replaced by the output file name */
+	snd_pcm_format_t format;
+	unsigned int channels;
+	unsigned int rate;
+	unsigned long long checksum;
+};
+
+static const struct chain chains[] = {
+	{
+		"plug format",
+		"pcm.test { type plug slave { pcm { type file file \"%s\" format raw "
+		"slave.pcm { type null } } format S24_3LE } }",
+		SND_PCM_FORMAT_S16_LE, 2, 48000,
+		0x5518717f1e6e608aULL,
+	},
+	{
+		"plug channels",
+		"pcm.test { type plug slave { pcm { type file file \"%s\" format raw "
+		"slave.pcm { type null } } format S16_LE channels 1 } }",
+		SND_PCM_FORMAT_S32_LE, 2, 48000,
+		0x139ad46bb37eec75ULL,
+	},
+	{
+		"route",
+		"pcm.test { type route slave { pcm { type file file \"%s\" format raw "
+		"slave.pcm { type null } } format S32_LE channels 3 } "
+		"ttable.0.0 1 ttable.1.1 1 ttable.0.2 0.5 ttable.1.2 0.5 }",
+		SND_PCM_FORMAT_S16_LE, 2, 48000,
+		0xdb4d806e458a9b8aULL,
+	},
+	{
+		"rate S16",
+		"pcm.test { type rate converter linear slave { pcm { type file "
+		"file \"%s\" format raw slave.pcm { type null } } rate 48000 } }",
+		SND_PCM_FORMAT_S16_LE, 2, 44100,
+		0x90b37ccf10b877fbULL,
+	},
+	{
+		"rate S32",
+		"pcm.test { type rate converter linear slave { pcm { type file "
+		"file \"%s\" format raw slave.pcm { type null } } rate 44100 } }",
+		SND_PCM_FORMAT_S32_LE, 2, 48000,
+		0x6aab16ae124881aeULL,
+	},
+	{
+		"plug float",
+		"pcm.test { type plug slave { pcm { type file file \"%s\" format raw "
+		"slave.pcm { type null } } format FLOAT_LE channels 1 } }",
+		SND_PCM_FORMAT_S16_LE, 2, 48000,
+		0xeb8a56641c213db9ULL,
+	},
+	{
+		"plug rate",
+		"pcm.test { type plug slave { pcm { type file file \"%s\" format raw "
+		"slave.pcm { type null } } format S16_LE rate 32000 channels 1 } "
+		"rate_converter linear }",
+		SND_PCM_FORMAT_S16_LE, 2, 44100,
+		0x706558cf2349b2b0ULL,
+	},
+	{
+		"plug rate route",
+		"pcm.test { type plug slave { pcm { type file file \"%s\" format raw "
+		"slave.pcm { type null } } format S16_LE rate 48000 channels 2 } "
+		"rate_converter linear "
+		"ttable.0.0 0.25 ttable.0.1 0.75 ttable.1.1 0.5 ttable.2.1 0.5 }",
+		SND_PCM_FORMAT_S16_LE, 3, 44100,
+		0xc9bef893118ff9bdULL,
+	},
+};
+
+/* 64-bit FNV-1a */
+static unsigned long long checksum_file(const char *path)
+{
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	unsigned char buf[4096];
+	size_t i, n;
+	FILE *f;
+
+	f = fopen(path, "rb");
+	if (!f)
+		return 0;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+		for (i = 0; i < n; i++) {
+			hash ^= buf[i];
+			hash *= 0x100000001b3ULL;
+		}
+	}
+	fclose(f);
+	return hash;
+}
+
+/* read the whole output file, returns the size in bytes */
+static size_t read_file(const char *path, void **data)
+{
+	size_t size = 0;
+	long len;
+	FILE *f;
+
+	*data = NULL;
+	f = fopen(path, "rb");
+	if (!f)
+		return 0;
+	if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0) {
+		rewind(f);
+		*data = malloc(len);
+		if (*data)
+			size = fread(*data, 1, len, f);
+	}
+	fclose(f);
+	return size;
+}
+
+static unsigned int test_random(unsigned int *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed;
+}
+
+static int open_chain(snd_pcm_t **pcm, const char *config)
+{
+	snd_input_t *input;
+	snd_config_t *top;
+	int err;
+
+	err = ALSA_CHECK(snd_config_top(&top));
+	if (err < 0)
+		return err;
+	err = ALSA_CHECK(snd_input_buffer_open(&input, config, strlen(config)));
+	if (err >= 0) {
+		err = ALSA_CHECK(snd_config_load(top, input));
+		snd_input_close(input);
+		if (err >= 0)
+			err = ALSA_CHECK(snd_pcm_open_lconf(pcm, "test",
+							    SND_PCM_STREAM_PLAYBACK,
+							    0, top));
+	}
+	snd_config_delete(top);
+	return err;
+}
+
+/*
+ * Write the frames of buf through the chain into the file at path, in odd
+ * chunk sizes to hit the period boundaries at varying offsets.  With the
+ * non-interleaved access, buf holds TEST_FRAMES frames of each channel in
+ * turn.
+ */
+static int play_chain(const char *config_fmt, const char *path,
+		      snd_pcm_format_t format, unsigned int channels,
+		      unsigned int rate, const unsigned char *buf,
+		      snd_pcm_access_t access)
+{
+	char config[512];
+	unsigned int seed = 1, c;
+	size_t sample_bytes, frame_bytes;
+	snd_pcm_sframes_t frames, written;
+	void *bufs[16];
+	snd_pcm_t *pcm;
+	int err;
+
+	snprintf(config, sizeof(config), config_fmt, path);
+	err = open_chain(&pcm, config);
+	if (err < 0)
+		return err;
+	err = ALSA_CHECK(snd_pcm_set_params(pcm, format, access,
+					    channels, rate, 1, 100000));
+	if (err < 0)
+		goto __close;
+
+	sample_bytes = snd_pcm_format_physical_width(format) / 8;
+	frame_bytes = sample_bytes * channels;
+	for (written = 0; written < TEST_FRAMES; written += frames) {
+		frames = test_random(&seed) % 1500 + 1;
+		if (frames > TEST_FRAMES - written)
+			frames = TEST_FRAMES - written;
+		if (access == SND_PCM_ACCESS_RW_NONINTERLEAVED) {
+			for (c = 0; c < channels && c < 16; c++)
+				bufs[c] = (void *)(buf + (c * TEST_FRAMES + written) *
+						   sample_bytes);
+			frames = snd_pcm_writen(pcm, bufs, frames);
+		} else {
+			frames = snd_pcm_writei(pcm, buf + written * frame_bytes,
+						frames);
+		}
+		if (frames < 0) {
+			err = ALSA_CHECK(frames);
+			goto __close;
+		}
+	}
+	err = ALSA_CHECK(snd_pcm_drain(pcm));
+__close:
+	snd_pcm_close(pcm);
+	return err;
+}
+
+static int temp_path(char *path)
+{
+	int fd;
+
+	strcpy(path, "/tmp/alsa-lib-test-XXXXXX");
+	fd = mkstemp(path);
+	TEST_CHECK(fd >= 0);
+	if (fd < 0)
+		return -1;
+	close(fd);
+	return 0;
+}
+
+static unsigned char *random_frames(snd_pcm_format_t format,
+				    unsigned int channels)
+{
+	size_t i, size = TEST_FRAMES * channels *
+		(snd_pcm_format_physical_width(format) / 8);
+	unsigned int seed = 1;
+	unsigned char *buf;
+
+	buf = malloc(size);
+	TEST_CHECK(buf != NULL);
+	if (buf)
+		for (i = 0; i < size; i++)
+			buf[i] = test_random(&seed) >> 16;
+	return buf;
+}
+
+static void test_chain(const struct chain *chain)
+{
+	char path[32];
+	unsigned char *buf;
+	unsigned long long sum;
+
+	if (temp_path(path) < 0)
+		return;
+	buf = random_frames(chain->format, chain->channels);
+	if (buf) {
+		play_chain(chain->config, path, chain->format,
+			   chain->channels, chain->rate, buf,
+			   SND_PCM_ACCESS_RW_INTERLEAVED);
+		free(buf);
+	}
+	sum = checksum_file(path);
+	if (sum != chain->checksum) {
+		fprintf(stderr, "%s: checksum 0x%016llx, expected 0x%016llx\n",
+			chain->name, sum, chain->checksum);
+		any_test_failed = 1;
+	}
+	unlink(path);
+}
+
+/*
+ * Play the same signal as S16 and as FLOAT through a chain that keeps the
+ * sample format, the float output must match the S16 output within the
+ * S16 rounding.  The float frames are given non-interleaved on request.
+ */
+static void test_float_chain(const char *name, const char *config,
+			     unsigned int channels, unsigned int rate,
+			     snd_pcm_access_t access)
+{
+	char path16[32], pathf[32];
+	short *buf16, *out16 = NULL;
+	float *buff, *outf = NULL;
+	size_t i, n16, nf, samples = TEST_FRAMES * channels;
+	unsigned int errors = 0;
+
+	buf16 = (short *)random_frames(SND_PCM_FORMAT_S16, channels);
+	buff = malloc(samples * sizeof(*buff));
+	if (!buf16 || !buff || temp_path(path16) < 0)
+		goto __free;
+	if (temp_path(pathf) < 0) {
+		unlink(path16);
+		goto __free;
+	}
+	for (i = 0; i < samples; i++) {
+		if (access == SND_PCM_ACCESS_RW_NONINTERLEAVED)
+			buff[i % channels * TEST_FRAMES + i / channels] =
+				buf16[i] / 32768.0f;
+		else
+			buff[i] = buf16[i] / 32768.0f;
+	}
+	if (play_chain(config, path16, SND_PCM_FORMAT_S16, channels, rate,
+		       (unsigned char *)buf16, SND_PCM_ACCESS_RW_INTERLEAVED) >= 0 &&
+	    play_chain(config, pathf, SND_PCM_FORMAT_FLOAT, channels, rate,
+		       (unsigned char *)buff, access) >= 0) {
+		n16 = read_file(path16, (void **)&out16) / sizeof(*out16);
+		nf = read_file(pathf, (void **)&outf) / sizeof(*outf);
+		TEST_CHECK(n16 > 0 && n16 == nf);
+		for (i = 0; i < n16 && i < nf; i++) {
+			float diff = outf[i] * 32768.0f - out16[i];
+			if (diff > 2.0f || diff < -2.0f)
+				errors++;
+		}
+		if (errors)
+			fprintf(stderr, "%s: %u float samples differ\n",
+				name, errors);
+		TEST_CHECK(errors == 0);
+	}
+	free(out16);
+	free(outf);
+	unlink(path16);
+	unlink(pathf);
+__free:
+	free(buf16);
+	free(buff);
+}
+
+/* read a sample of the output as a value in [-1, 1) */
+static double get_sample(const void *data, snd_pcm_format_t format, size_t i)
+{
+	switch (format) {
+	case SND_PCM_FORMAT_S16:
+		return ((const short *)data)[i] / 32768.0;
+	case SND_PCM_FORMAT_S32:
+		return ((const int *)data)[i] / 2147483648.0;
+	case SND_PCM_FORMAT_FLOAT:
+		return ((const float *)data)[i];
+	default:
+		return 0;
+	}
+}
+
+/* least squares fit of a sine with w to the channel 0, returns the amplitude */
+static double fit_sine(const void *data, snd_pcm_format_t format,
+		       unsigned int channels, size_t first, size_t last,
+		       double w, double *residue)
+{
+	double v, s, c, ss = 0, cc = 0, sc = 0, vs = 0, vc = 0, det, a, b;
+	double err = 0;
+	size_t f;
+
+	for (f = first; f < last; f++) {
+		v = get_sample(data, format, f * channels);
+		s = sin(w * f);
+		c = cos(w * f);
+		ss += s * s;
+		cc += c * c;
+		sc += s * c;
+		vs += v * s;
+		vc += v * c;
+	}
+	det = ss * cc - sc * sc;
+	a = (vs * cc - vc * sc) / det;
+	b = (vc * ss - vs * sc) / det;
+	if (residue) {
+		for (f = first; f < last; f++) {
+			v = get_sample(data, format, f * channels) -
+			    a * sin(w * f) - b * cos(w * f);
+			err += v * v;
+		}
+		*residue = sqrt(err / (last - first));
+	}
+	return sqrt(a * a + b * b);
+}
+
+static const float route_float_ttable[2][3][3] = {
+	{ { 1, 0, 0.5 }, { 0, 1, 0.5 } },
+	{ { 0, 0.7 }, { 0.3, 0 }, { 0.6, 0.25 } },
+};
+
+/*
+ * Mix FLOAT frames with the route plugin and compare each output sample
+ * with the sum of the inputs weighted by the ttable, the float path must
+ * neither quantize the samples nor lose the gains.
+ */
+static void test_route_float(const char *name, const float ttable[3][3],
+			     unsigned int channels, unsigned int schannels,
+			     snd_pcm_access_t access)
+{
+	char path[32], config[512], *p;
+	size_t i, n, len, samples = TEST_FRAMES * channels;
+	unsigned int seed = 1, c, s, errors = 0;
+	float *buf, *out = NULL;
+	double v;
+
+	p = config;
+	len = sizeof(config);
+	n = snprintf(p, len, "pcm.test { type route slave { pcm { type file "
+		     "file \"%%s\" format raw slave.pcm { type null } } "
+		     "channels %u } ", schannels);
+	for (c = 0; c < channels; c++)
+		for (s = 0; s < schannels; s++)
+			if (ttable[c][s] != 0)
+				n += snprintf(p + n, len - n, "ttable.%u.%u %g ",
+					      c, s, ttable[c][s]);
+	snprintf(p + n, len - n, "}");
+
+	buf = malloc(samples * sizeof(*buf));
+	TEST_CHECK(buf != NULL);
+	if (!buf || temp_path(path) < 0)
+		goto __free;
+	for (i = 0; i < samples; i++)
+		buf[i] = ((int)(test_random(&seed) >> 8) - 0x800000) / 8388608.0f;
+	if (play_chain(config, path, SND_PCM_FORMAT_FLOAT, channels, 48000,
+		       (unsigned char *)buf, access) < 0)
+		goto __unlink;
+	n = read_file(path, (void **)&out) / sizeof(*out);
+	TEST_CHECK(n == TEST_FRAMES * schannels);
+	for (i = 0; i < n && i < TEST_FRAMES * schannels; i++) {
+		size_t frame = i / schannels;
+
+		s = i % schannels;
+		v = 0;
+		for (c = 0; c < channels; c++) {
+			if (access == SND_PCM_ACCESS_RW_NONINTERLEAVED)
+				v += buf[c * TEST_FRAMES + frame] * ttable[c][s];
+			else
+				v += buf[frame * channels + c] * ttable[c][s];
+		}
+		if (fabs(out[i] - v) > 1e-6)
+			errors++;
+	}
+	if (errors)
+		fprintf(stderr, "%s: %u float samples differ\n", name, errors);
+	TEST_CHECK(errors == 0);
+ __unlink:
+	unlink(path);
+ __free:
+	free(buf);
+	free(out);
+}
+
+/*
+ * Play a 997 Hz sine with the amplitude 0.5 through a rate converter and
+ * fit a sine to the middle of the output.  The converted ratio follows
+ * the period sizes, so the frequency is searched around the expected one
+ * and must be within 0.5%.  The residue of the fit is the error of the
+ * converter, returns the SNR in dB.
+ */
+static double test_sine_chain(const char *name, const char *config,
+			      snd_pcm_format_t format, unsigned int channels,
+			      unsigned int rate, unsigned int srate)
+{
+	char path[32];
+	size_t i, n, samples = TEST_FRAMES * channels;
+	size_t width = snd_pcm_format_physical_width(format) / 8;
+	size_t first, last, frames;
+	unsigned char *buf = NULL;
+	void *out = NULL;
+	double w, v, step, best_w, amp, best = 0, err, snr = 0;
+
+	buf = malloc(samples * width);
+	TEST_CHECK(buf != NULL);
+	if (!buf || temp_path(path) < 0)
+		goto __free;
+	for (i = 0; i < samples; i++) {
+		v = 0.5 * sin(2 * M_PI * 997 * (i / channels) / rate);
+		switch (format) {
+		case SND_PCM_FORMAT_S16:
+			((short *)buf)[i] = lrint(v * 32767);
+			break;
+		case SND_PCM_FORMAT_S32:
+			((int *)buf)[i] = lrint(v * 2147483647.0);
+			break;
+		case SND_PCM_FORMAT_FLOAT:
+			((float *)buf)[i] = v;
+			break;
+		default:
+			break;
+		}
+	}
+	if (play_chain(config, path, format, channels, rate, buf,
+		       SND_PCM_ACCESS_RW_INTERLEAVED) < 0)
+		goto __unlink;
+	n = read_file(path, &out) / width;
+	frames = n / channels;
+	/* skip the filter settling at both ends */
+	first = frames / 4;
+	last = frames - frames / 4;
+	TEST_CHECK(last - first > 4096);
+	if (last - first <= 4096)
+		goto __unlink;
+	w = best_w = 2 * M_PI * 997 / srate;
+	best = 1;
+	for (step = w / 100; step > w * 1e-10; step /= 4) {
+		for (w = best_w - 4 * step; w <= best_w + 4 * step; w += step) {
+			fit_sine(out, format, channels, first, last, w, &err);
+			if (err < best) {
+				best = err;
+				best_w = w;
+			}
+		}
+	}
+	amp = fit_sine(out, format, channels, first, last, best_w, &err);
+	snr = err > 0 ? 20 * log10(amp / sqrt(2) / err) : 200;
+	w = 2 * M_PI * 997 / srate;
+	if (amp < 0.49 || amp > 0.51 || fabs(best_w / w - 1) > 0.005)
+		fprintf(stderr, "%s: sine amplitude %f, frequency %.1f Hz\n",
+			name, amp, best_w * srate / (2 * M_PI));
+	TEST_CHECK(amp >= 0.49 && amp <= 0.51);
+	TEST_CHECK(fabs(best_w / w - 1) <= 0.005);
+ __unlink:
+	unlink(path);
+ __free:
+	free(buf);
+	free(out);
+	return snr;
+}
+
+#define DRIFT_CONFIG	"pcm.test { type rate converter linear slave { pcm { " \
+			"type file file \"%s\" format raw slave.pcm { type null } } " \
+			"rate 48000 } }"
+#define DRIFT_RATE	44100
+#define DRIFT_SECONDS	20
+
+/*
+ * Write DRIFT_SECONDS of silence with the drift correction ppb or, when
+ * fill is not zero, with the fill level control.  Returns the written
+ * slave frames, the correction in use at the end and the client period
+ * size.
+ */
+static long play_drift(long ppb, snd_pcm_uframes_t fill, long *drift,
+		       snd_pcm_uframes_t *period_size)
+{
+	static short buf[2 * 1024];
+	snd_pcm_uframes_t buffer_size;
+	snd_pcm_sframes_t frames;
+	char path[32], config[512];
+	long written, size = -1;
+	snd_pcm_t *pcm;
+	void *out = NULL;
+	int err;
+
+	if (temp_path(path) < 0)
+		return -1;
+	snprintf(config, sizeof(config), DRIFT_CONFIG, path);
+	if (open_chain(&pcm, config) < 0)
+		goto __unlink;
+	err = ALSA_CHECK(snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16,
+					    SND_PCM_ACCESS_RW_INTERLEAVED,
+					    2, DRIFT_RATE, 1, 100000));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_get_params(pcm, &buffer_size,
+						    period_size));
+	if (err >= 0)
+		err = ALSA_CHECK(fill ? snd_pcm_rate_set_drift_target(pcm, fill) :
+				 snd_pcm_rate_set_drift(pcm, ppb));
+	for (written = 0; err >= 0 && written < DRIFT_SECONDS * DRIFT_RATE;
+	     written += frames) {
+		frames = snd_pcm_writei(pcm, buf, 1024);
+		if (frames < 0)
+			err = ALSA_CHECK(frames);
+	}
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_rate_get_drift(pcm, drift));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_drain(pcm));
+	snd_pcm_close(pcm);
+	if (err >= 0)
+		size = read_file(path, &out) / 4;
+	free(out);
+ __unlink:
+	unlink(path);
+	return size;
+}
+
+/*
+ * A positive correction consumes the client frames faster, the slave gets
+ * fewer frames, a negative one more.  The correction follows the request
+ * with the slew rate of 100000 ppb per second and adds at most
+ * period_size / 512 + 1 client frames per period.  A fill level control
+ * over a slave that never queues anything must turn negative.
+ */
+static void test_drift(void)
+{
+	snd_pcm_uframes_t period_size = 0;
+	long out0, out_pos, out_neg, drift, diff, bound;
+	double ramp, expected;
+	snd_pcm_t *pcm;
+
+	/* the range check and a PCM without a rate plugin */
+	if (open_chain(&pcm, "pcm.test { type null }") >= 0) {
+		TEST_CHECK(snd_pcm_rate_set_drift(pcm, 1000001) == -EINVAL);
+		TEST_CHECK(snd_pcm_rate_set_drift(pcm, -1000001) == -EINVAL);
+		TEST_CHECK(snd_pcm_rate_set_drift(pcm, 0) < 0);
+		TEST_CHECK(snd_pcm_rate_get_drift(pcm, &drift) < 0);
+		snd_pcm_close(pcm);
+	}
+
+	out0 = play_drift(0, 0, &drift, &period_size);
+	TEST_CHECK(drift == 0);
+	out_pos = play_drift(1000000, 0, &drift, &period_size);
+	TEST_CHECK(drift == 1000000);
+	out_neg = play_drift(-1000000, 0, &drift, &period_size);
+	TEST_CHECK(drift == -1000000);
+	if (out0 < 0 || out_pos < 0 || out_neg < 0 || !period_size)
+		return;
+
+	/* 10 seconds ramp, then 1000 ppm */
+	ramp = 1000000.0 / 100000;
+	expected = DRIFT_RATE * 1e-3 * (DRIFT_SECONDS - ramp / 2) * 48000 / DRIFT_RATE;
+	bound = (DRIFT_SECONDS * DRIFT_RATE / period_size + 1) *
+		(period_size / 512 + 1) * 48000 / DRIFT_RATE + 1;
+	fprintf(stderr, "drift: %ld slave frames, +1000 ppm %ld, -1000 ppm %ld, "
+		"expected %.0f\n", out0, out_pos - out0, out_neg - out0, expected);
+	TEST_CHECK(out_pos < out0 && out_neg > out0);
+	diff = out0 - out_pos;
+	TEST_CHECK(diff <= bound && fabs(diff - expected) < expected * 0.05 + 48);
+	diff = out_neg - out0;
+	TEST_CHECK(diff <= bound && fabs(diff - expected) < expected * 0.05 + 48);
+
+	/* the slave never queues frames, too little data for the target */
+	TEST_CHECK(play_drift(0, period_size * 2, &drift, &period_size) > 0);
+	TEST_CHECK(drift < 0 && drift >= -1000000);
+}
+
+int main(void)
+{
+	double snr_linear, snr_sinc, snr_s32, snr_float;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(chains) / sizeof(chains[0]); i++)
+		test_chain(&chains[i]);
+
+	test_float_chain("rate FLOAT expand",
+			 "pcm.test { type rate converter linear slave { pcm { "
+			 "type file file \"%s\" format raw slave.pcm { type null } } "
+			 "rate 48000 } }", 2, 44100,
+			 SND_PCM_ACCESS_RW_INTERLEAVED);
+	test_float_chain("rate FLOAT shrink",
+			 "pcm.test { type rate converter linear slave { pcm { "
+			 "type file file \"%s\" format raw slave.pcm { type null } } "
+			 "rate 44100 } }", 3, 48000,
+			 SND_PCM_ACCESS_RW_INTERLEAVED);
+	test_float_chain("rate FLOAT non-interleaved",
+			 "pcm.test { type rate converter linear slave { pcm { "
+			 "type file file \"%s\" format raw slave.pcm { type null } } "
+			 "rate 32000 } }", 2, 44100,
+			 SND_PCM_ACCESS_RW_NONINTERLEAVED);
+
+	/* the float mixing path of route */
+	test_route_float("route FLOAT", route_float_ttable[0], 2, 3,
+			 SND_PCM_ACCESS_RW_INTERLEAVED);
+	test_route_float("route FLOAT non-interleaved", route_float_ttable[1], 3, 2,
+			 SND_PCM_ACCESS_RW_NONINTERLEAVED);
+	test_float_chain("route FLOAT against S16",
+			 "pcm.test { type route slave { pcm { type file file \"%s\" "
+			 "format raw slave.pcm { type null } } channels 3 } "
+			 "ttable.0.0 1 ttable.1.1 1 ttable.0.2 0.5 ttable.1.2 0.5 }",
+			 2, 48000, SND_PCM_ACCESS_RW_INTERLEAVED);
+
+	/* the sinc converter keeps the sine far better than linear */
+	snr_linear = test_sine_chain("sine linear",
+				     "pcm.test { type rate converter linear slave { pcm { "
+				     "type file file \"%s\" format raw slave.pcm { type null } } "
+				     "rate 48000 } }", SND_PCM_FORMAT_S16, 2, 44100, 48000);
+	snr_sinc = test_sine_chain("sine sinc",
+				   "pcm.test { type rate converter sinc slave { pcm { "
+				   "type file file \"%s\" format raw slave.pcm { type null } } "
+				   "rate 48000 } }", SND_PCM_FORMAT_S16, 2, 44100, 48000);
+	fprintf(stderr, "sine SNR: linear %.1f dB, sinc %.1f dB\n", snr_linear, snr_sinc);
+	TEST_CHECK(snr_sinc > 80);
+	TEST_CHECK(snr_sinc > snr_linear + 20);
+
+	/* S32 and FLOAT take their own convert ops, above the S16 resolution */
+	snr_s32 = test_sine_chain("sine sinc S32",
+				  "pcm.test { type rate converter sinc_best slave { pcm { "
+				  "type file file \"%s\" format raw slave.pcm { type null } } "
+				  "rate 48000 } }", SND_PCM_FORMAT_S32, 2, 44100, 48000);
+	snr_float = test_sine_chain("sine sinc FLOAT",
+				    "pcm.test { type rate converter sinc_best slave { pcm { "
+				    "type file file \"%s\" format raw slave.pcm { type null } } "
+				    "rate 48000 } }", SND_PCM_FORMAT_FLOAT, 2, 44100, 48000);
+	snr_sinc = test_sine_chain("sine sinc S16",
+				   "pcm.test { type rate converter sinc_best slave { pcm { "
+				   "type file file \"%s\" format raw slave.pcm { type null } } "
+				   "rate 48000 } }", SND_PCM_FORMAT_S16, 2, 44100, 48000);
+	fprintf(stderr, "sine SNR sinc_best: S16 %.1f dB, S32 %.1f dB, FLOAT %.1f dB\n",
+		snr_sinc, snr_s32, snr_float);
+	TEST_CHECK(snr_s32 > snr_sinc + 15);
+	TEST_CHECK(snr_float > snr_sinc + 15);
+
+	test_drift();
+	return TEST_EXIT_CODE();
+}
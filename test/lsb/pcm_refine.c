@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+
+/*
+ * The rules refinement caches its recent results.  Runs the same
+ * sequence of hw_params restrictions with an empty cache, again with the
+ * results cached and once more after the cache was freed, every step
+ * must give the same params and return code in all runs.  Without a
+ * sound card the chains end in a null PCM.
+ */
+
+#define MAX_STEPS	16
+
+struct run {
+	unsigned int steps;
+	int err[MAX_STEPS];
+	unsigned char *params[MAX_STEPS];
+};
+
+static int open_chain(snd_pcm_t **pcm, const char *config)
+{
+	snd_input_t *input;
+	snd_config_t *top;
+	int err;
+
+	err = ALSA_CHECK(snd_config_top(&top));
+	if (err < 0)
+		return err;
+	err = ALSA_CHECK(snd_input_buffer_open(&input, config, strlen(config)));
+	if (err >= 0) {
+		err = ALSA_CHECK(snd_config_load(top, input));
+		snd_input_close(input);
+		if (err >= 0)
+			err = ALSA_CHECK(snd_pcm_open_lconf(pcm, "test",
+							    SND_PCM_STREAM_PLAYBACK,
+							    0, top));
+	}
+	snd_config_delete(top);
+	return err;
+}
+
+static void record(struct run *run, int err, const snd_pcm_hw_params_t *params)
+{
+	size_t size = snd_pcm_hw_params_sizeof();
+
+	if (run->steps >= MAX_STEPS)
+		return;
+	run->err[run->steps] = err;
+	run->params[run->steps] = malloc(size);
+	if (run->params[run->steps])
+		memcpy(run->params[run->steps], params, size);
+	run->steps++;
+}
+
+/* a typical setup with a few requests the chain can't satisfy */
+static void run_sequence(const char *config, struct run *run)
+{
+	snd_pcm_hw_params_t *params;
+	unsigned int rate = 44100, time = 20000;
+	snd_pcm_uframes_t size = 4096;
+	snd_pcm_t *pcm;
+
+	memset(run, 0, sizeof(*run));
+	if (open_chain(&pcm, config) < 0)
+		return;
+	snd_pcm_hw_params_alloca(&params);
+	record(run, snd_pcm_hw_params_any(pcm, params), params);
+	record(run, snd_pcm_hw_params_test_channels(pcm, params, 1000), params);
+	record(run, snd_pcm_hw_params_set_access(pcm, params,
+						 SND_PCM_ACCESS_RW_INTERLEAVED), params);
+	record(run, snd_pcm_hw_params_set_format(pcm, params,
+						 SND_PCM_FORMAT_S16_LE), params);
+	record(run, snd_pcm_hw_params_set_channels(pcm, params, 2), params);
+	record(run, snd_pcm_hw_params_set_rate_near(pcm, params, &rate, 0), params);
+	record(run, snd_pcm_hw_params_test_rate(pcm, params, 1, 0), params);
+	record(run, snd_pcm_hw_params_set_period_time_near(pcm, params, &time, 0),
+	       params);
+	record(run, snd_pcm_hw_params_set_buffer_size_near(pcm, params, &size),
+	       params);
+	record(run, snd_pcm_hw_params(pcm, params), params);
+	record(run, rate, params);
+	record(run, time, params);
+	record(run, size, params);
+	snd_pcm_close(pcm);
+}
+
+static void free_run(struct run *run)
+{
+	unsigned int i;
+
+	for (i = 0; i < run->steps; i++)
+		free(run->params[i]);
+}
+
+static void compare_runs(const char *name, const char *what,
+			 const struct run *a, const struct run *b)
+{
+	size_t size = snd_pcm_hw_params_sizeof();
+	unsigned int i;
+
+	TEST_CHECK(a->steps == b->steps);
+	for (i = 0; i < a->steps && i < b->steps; i++) {
+		if (a->err[i] != b->err[i] ||
+		    !a->params[i] || !b->params[i] ||
+		    memcmp(a->params[i], b->params[i], size)) {
+			fprintf(stderr, "%s: %s differs at step %u (%d, %d)\n",
+				name, what, i, a->err[i], b->err[i]);
+			any_test_failed = 1;
+		}
+	}
+}
+
+static void test_refine(const char *name, const char *config)
+{
+	struct run miss, hit, again;
+
+	snd_config_update_free_global();
+	run_sequence(config, &miss);
+	TEST_CHECK(miss.steps == MAX_STEPS - 3);
+	run_sequence(config, &hit);
+	snd_config_update_free_global();
+	run_sequence(config, &again);
+	compare_runs(name, "cached", &miss, &hit);
+	compare_runs(name, "after free", &miss, &again);
+	free_run(&miss);
+	free_run(&hit);
+	free_run(&again);
+}
+
+int main(void)
+{
+	test_refine("null", "pcm.test { type null }");
+	test_refine("plug",
+		    "pcm.test { type plug slave { pcm { type null } "
+		    "format S32_LE rate 48000 channels 4 } }");
+	test_refine("rate route",
+		    "pcm.test { type plug slave { pcm { type file file \"/dev/null\" "
+		    "slave.pcm { type null } } format FLOAT_LE rate 32000 channels 1 } "
+		    "rate_converter linear ttable.0.0 0.5 ttable.1.0 0.5 }");
+	return TEST_EXIT_CODE();
+}
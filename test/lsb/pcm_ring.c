@@ -0,0 +1,296 @@
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "test.h"
+#include <alsa/pcm_external.h>
+
+/*
+ * Queues transfers of several null PCMs on a transfer ring and checks that
+ * every request completes with all of its frames.  A capture ioplug whose
+ * poll descriptor is always ready checks that a request polled again
+ * because nothing was available is still submitted while waiting.
+ */
+
+#define TEST_PCMS	4
+#define TEST_FRAMES	1024
+#define TEST_ROUNDS	8
+
+static const char config[] = "pcm.test { type null }";
+
+static int open_null(snd_pcm_t **pcm, snd_pcm_stream_t stream)
+{
+	snd_input_t *input;
+	snd_config_t *top;
+	int err;
+
+	err = ALSA_CHECK(snd_config_top(&top));
+	if (err < 0)
+		return err;
+	err = ALSA_CHECK(snd_input_buffer_open(&input, config, strlen(config)));
+	if (err >= 0) {
+		err = ALSA_CHECK(snd_config_load(top, input));
+		snd_input_close(input);
+		if (err >= 0)
+			err = ALSA_CHECK(snd_pcm_open_lconf(pcm, "test", stream,
+							    SND_PCM_NONBLOCK,
+							    top));
+	}
+	snd_config_delete(top);
+	if (err < 0)
+		return err;
+	err = ALSA_CHECK(snd_pcm_set_params(*pcm, SND_PCM_FORMAT_S16_LE,
+					    SND_PCM_ACCESS_RW_INTERLEAVED,
+					    2, 48000, 0, 100000));
+	if (err < 0)
+		snd_pcm_close(*pcm);
+	return err;
+}
+
+static int queue(snd_pcm_ring_t *ring, snd_pcm_t *pcm, short *buf, long id)
+{
+	if (snd_pcm_stream(pcm) == SND_PCM_STREAM_PLAYBACK)
+		return snd_pcm_ring_writei(ring, pcm, buf, TEST_FRAMES,
+					   (void *)id);
+	return snd_pcm_ring_readi(ring, pcm, buf, TEST_FRAMES, (void *)id);
+}
+
+static int test_round_trip(void)
+{
+	static short bufs[TEST_PCMS][TEST_FRAMES * 2];
+	snd_pcm_t *pcms[TEST_PCMS];
+	long frames[TEST_PCMS], pending;
+	snd_pcm_ring_event_t events[TEST_PCMS];
+	snd_pcm_ring_t *ring;
+	long id;
+	int i, n, err, opened = 0;
+
+	err = snd_pcm_ring_open(&ring, TEST_PCMS);
+	if (err == -ENOSYS)
+		return 77;
+	if (ALSA_CHECK(err) < 0)
+		return 0;
+
+	/* even PCMs play back, odd PCMs capture */
+	for (; opened < TEST_PCMS; opened++) {
+		if (open_null(&pcms[opened], opened & 1 ?
+			      SND_PCM_STREAM_CAPTURE :
+			      SND_PCM_STREAM_PLAYBACK) < 0)
+			goto __close;
+		frames[opened] = 0;
+	}
+
+	pending = 0;
+	for (id = 0; id < TEST_PCMS; id++) {
+		if (ALSA_CHECK(queue(ring, pcms[id], bufs[id], id)) < 0)
+			goto __close;
+		pending++;
+	}
+	ALSA_CHECK(snd_pcm_ring_submit(ring));
+
+	while (pending > 0) {
+		n = snd_pcm_ring_wait(ring, events, TEST_PCMS, 1000);
+		if (ALSA_CHECK(n) < 0)
+			break;
+		TEST_CHECK(n > 0);
+		if (n == 0)
+			break;
+		for (i = 0; i < n; i++) {
+			id = (long)events[i].private_data;
+			pending--;
+			TEST_CHECK(id >= 0 && id < TEST_PCMS);
+			if (id < 0 || id >= TEST_PCMS)
+				continue;
+			TEST_CHECK(events[i].pcm == pcms[id]);
+			TEST_CHECK(events[i].result == TEST_FRAMES);
+			if (events[i].result < 0)
+				continue;
+			frames[id] += events[i].result;
+			if (frames[id] < TEST_ROUNDS * TEST_FRAMES) {
+				if (ALSA_CHECK(queue(ring, pcms[id], bufs[id], id)) >= 0)
+					pending++;
+			}
+		}
+		ALSA_CHECK(snd_pcm_ring_submit(ring));
+	}
+
+	for (i = 0; i < TEST_PCMS; i++)
+		TEST_CHECK(frames[i] == TEST_ROUNDS * TEST_FRAMES);
+
+__close:
+	snd_pcm_ring_close(ring);
+	while (opened-- > 0)
+		snd_pcm_close(pcms[opened]);
+	return 0;
+}
+
+/* capture plugin, the hw pointer moves TEST_DELAY ms after the start */
+
+#define TEST_DELAY	300
+
+struct late_capture {
+	snd_pcm_ioplug_t io;
+	struct timespec start;
+	int pipe[2];
+};
+
+static long elapsed_ms(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000 +
+	       (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static int late_start(snd_pcm_ioplug_t *io)
+{
+	struct late_capture *late = io->private_data;
+
+	clock_gettime(CLOCK_MONOTONIC, &late->start);
+	return 0;
+}
+
+static int late_stop(snd_pcm_ioplug_t *io ATTRIBUTE_UNUSED)
+{
+	return 0;
+}
+
+static snd_pcm_sframes_t late_pointer(snd_pcm_ioplug_t *io)
+{
+	struct late_capture *late = io->private_data;
+
+	if (elapsed_ms(&late->start) < TEST_DELAY)
+		return 0;
+	return io->period_size;
+}
+
+static snd_pcm_sframes_t late_transfer(snd_pcm_ioplug_t *io ATTRIBUTE_UNUSED,
+				       const snd_pcm_channel_area_t *areas,
+				       snd_pcm_uframes_t offset,
+				       snd_pcm_uframes_t size)
+{
+	snd_pcm_areas_silence(areas, offset, io->channels, size, io->format);
+	return size;
+}
+
+static const snd_pcm_ioplug_callback_t late_callback = {
+	.start = late_start,
+	.stop = late_stop,
+	.pointer = late_pointer,
+	.transfer = late_transfer,
+};
+
+static int late_open(struct late_capture *late)
+{
+	static const unsigned int access = SND_PCM_ACCESS_RW_INTERLEAVED;
+	static const unsigned int format = SND_PCM_FORMAT_S16_LE;
+	snd_pcm_ioplug_t *io = &late->io;
+	int err;
+
+	memset(late, 0, sizeof(*late));
+	if (pipe(late->pipe) < 0)
+		return -errno;
+	/* never drained, so the descriptor is always ready */
+	if (write(late->pipe[1], "x", 1) != 1) {
+		err = -errno;
+		goto __error;
+	}
+	io->version = SND_PCM_IOPLUG_VERSION;
+	io->name = "late capture";
+	io->poll_fd = late->pipe[0];
+	io->poll_events = POLLIN;
+	io->callback = &late_callback;
+	io->private_data = late;
+	err = ALSA_CHECK(snd_pcm_ioplug_create(io, "late", SND_PCM_STREAM_CAPTURE,
+					       SND_PCM_NONBLOCK));
+	if (err < 0)
+		goto __error;
+	snd_pcm_ioplug_set_param_list(io, SND_PCM_IOPLUG_HW_ACCESS, 1, &access);
+	snd_pcm_ioplug_set_param_list(io, SND_PCM_IOPLUG_HW_FORMAT, 1, &format);
+	snd_pcm_ioplug_set_param_minmax(io, SND_PCM_IOPLUG_HW_CHANNELS, 2, 2);
+	snd_pcm_ioplug_set_param_minmax(io, SND_PCM_IOPLUG_HW_RATE, 48000, 48000);
+	snd_pcm_ioplug_set_param_minmax(io, SND_PCM_IOPLUG_HW_PERIOD_BYTES,
+					1024, 1024);
+	snd_pcm_ioplug_set_param_minmax(io, SND_PCM_IOPLUG_HW_PERIODS, 4, 4);
+	err = ALSA_CHECK(snd_pcm_set_params(io->pcm, SND_PCM_FORMAT_S16_LE,
+					    SND_PCM_ACCESS_RW_INTERLEAVED,
+					    2, 48000, 0, 0));
+	if (err >= 0)
+		return 0;
+	snd_pcm_ioplug_delete(io);
+ __error:
+	close(late->pipe[0]);
+	close(late->pipe[1]);
+	return err;
+}
+
+static void late_close(struct late_capture *late)
+{
+	snd_pcm_ioplug_delete(&late->io);
+	close(late->pipe[0]);
+	close(late->pipe[1]);
+}
+
+/* the request polled again after an empty wakeup must complete in time */
+static void test_repoll(int timeout)
+{
+	static short buf[256 * 2];
+	struct late_capture late;
+	snd_pcm_ring_event_t event;
+	snd_pcm_ring_t *ring;
+	struct timespec start;
+	int n;
+
+	if (ALSA_CHECK(snd_pcm_ring_open(&ring, 1)) < 0)
+		return;
+	if (late_open(&late) < 0)
+		goto __close;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (ALSA_CHECK(snd_pcm_ring_readi(ring, late.io.pcm, buf, 256, NULL)) < 0)
+		goto __late;
+	n = snd_pcm_ring_wait(ring, &event, 1, timeout);
+	TEST_CHECK(n == 1);
+	if (n == 1)
+		TEST_CHECK(event.result == 256);
+	/* the pointer moved at TEST_DELAY, not at the timeout */
+	TEST_CHECK(elapsed_ms(&start) < TEST_DELAY + 500);
+ __late:
+	late_close(&late);
+ __close:
+	ALSA_CHECK(snd_pcm_ring_close(ring));
+}
+
+/* closing with a pending request cancels it */
+static void test_close_pending(void)
+{
+	static short buf[256 * 2];
+	struct late_capture late;
+	snd_pcm_ring_t *ring;
+
+	if (ALSA_CHECK(snd_pcm_ring_open(&ring, 1)) < 0)
+		return;
+	if (late_open(&late) < 0) {
+		snd_pcm_ring_close(ring);
+		return;
+	}
+	if (ALSA_CHECK(snd_pcm_ring_readi(ring, late.io.pcm, buf, 256, NULL)) >= 0)
+		ALSA_CHECK(snd_pcm_ring_submit(ring));
+	ALSA_CHECK(snd_pcm_ring_close(ring));
+	late_close(&late);
+}
+
+int main(void)
+{
+	int err;
+
+	err = test_round_trip();
+	if (err)
+		return err;
+	/* a lost request would block the infinite wait forever */
+	alarm(10);
+	test_repoll(-1);
+	test_repoll(2000);
+	test_close_pending();
+	return TEST_EXIT_CODE();
+}
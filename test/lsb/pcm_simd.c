@@ -0,0 +1,305 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <math.h>
+#include <endian.h>
+#include "test.h"
+#include "bswap.h"
+
+/*
+ * Converts random samples with the linear and lfloat plugins, which take
+ * the vectorized kernels of pcm_simd.c for interleaved and contiguous
+ * areas, and compares each sample with the labels of plugin_ops.h, the
+ * scalar conversions the kernels replace.  The chunk sizes vary so that
+ * the vector loops end at every possible tail length.
+ */
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+#define SNDRV_LITTLE_ENDIAN
+#endif
+
+/* the sign extension helpers, the labels are included in the functions */
+#include "../../src/pcm/plugin_ops.h"
+
+#define TEST_FRAMES	5000
+
+typedef union {
+	float f;
+	uint32_t i;
+} tmp_float_t;
+
+typedef union {
+	double d;
+	uint64_t l;
+} tmp_double_t;
+
+static unsigned int test_random(unsigned int *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed >> 8;
+}
+
+static int format_swapped(snd_pcm_format_t format)
+{
+#ifdef SNDRV_LITTLE_ENDIAN
+	return snd_pcm_format_big_endian(format) == 1;
+#else
+	return snd_pcm_format_little_endian(format) == 1;
+#endif
+}
+
+/* the index of the get32/put32 labels, as snd_pcm_linear_get_index() */
+static unsigned int label_index(snd_pcm_format_t format)
+{
+	unsigned int swap = format_swapped(format);
+
+	if (snd_pcm_format_physical_width(format) == 24)
+		return 20 + swap * 2;
+	return (snd_pcm_format_width(format) / 8 - 1) * 4 + swap * 2;
+}
+
+static int format_float(snd_pcm_format_t format)
+{
+	return format == SND_PCM_FORMAT_FLOAT_LE ||
+	       format == SND_PCM_FORMAT_FLOAT_BE;
+}
+
+/* read a sample into the host endian 32-bit value */
+static uint32_t ref_get(snd_pcm_format_t format, const char *src)
+{
+#define GET32_LABELS
+#define GET32F_LABELS
+#include "../../src/pcm/plugin_ops.h"
+#undef GET32F_LABELS
+#undef GET32_LABELS
+	void *get;
+	uint32_t sample = 0;
+	tmp_float_t tmp_float;
+	tmp_double_t tmp_double;
+
+	if (format_float(format))
+		get = get32float_labels[format_swapped(format)];
+	else
+		get = get32_labels[label_index(format)];
+	goto *get;
+#define GET32_END __get_end
+#define GET32F_END __get_end
+#include "../../src/pcm/plugin_ops.h"
+#undef GET32F_END
+#undef GET32_END
+ __get_end:
+	(void)tmp_double;
+	return sample;
+}
+
+/* write the host endian 32-bit value as a sample */
+static void ref_put(snd_pcm_format_t format, char *dst, uint32_t sample)
+{
+#define PUT32_LABELS
+#define PUT32F_LABELS
+#include "../../src/pcm/plugin_ops.h"
+#undef PUT32F_LABELS
+#undef PUT32_LABELS
+	void *put;
+	tmp_float_t tmp_float;
+	tmp_double_t tmp_double;
+
+	if (format_float(format))
+		put = put32float_labels[format_swapped(format)];
+	else
+		put = put32_labels[label_index(format)];
+	goto *put;
+#define PUT32_END __put_end
+#define PUT32F_END __put_end
+#include "../../src/pcm/plugin_ops.h"
+#undef PUT32F_END
+#undef PUT32_END
+ __put_end:
+	(void)tmp_float;
+	(void)tmp_double;
+}
+
+static void random_samples(snd_pcm_format_t format, char *buf, size_t samples)
+{
+	size_t i, j, width = snd_pcm_format_physical_width(format) / 8;
+	unsigned int seed = 1;
+	tmp_float_t v;
+
+	for (i = 0; i < samples; i++) {
+		if (format_float(format)) {
+			/* a bit beyond the clipping range, with the limits */
+			switch (test_random(&seed) % 16) {
+			case 0:
+				v.f = 1.0f;
+				break;
+			case 1:
+				v.f = -1.0f;
+				break;
+			default:
+				v.f = ((int)(test_random(&seed) & 0xffffff) - 0x800000) /
+					7000000.0f;
+				break;
+			}
+			if (format_swapped(format))
+				v.i = bswap_32(v.i);
+			memcpy(buf + i * width, &v.i, 4);
+			continue;
+		}
+		for (j = 0; j < width; j++)
+			buf[i * width + j] = test_random(&seed);
+	}
+}
+
+static int open_chain(snd_pcm_t **pcm, const char *config)
+{
+	snd_input_t *input;
+	snd_config_t *top;
+	int err;
+
+	err = ALSA_CHECK(snd_config_top(&top));
+	if (err < 0)
+		return err;
+	err = ALSA_CHECK(snd_input_buffer_open(&input, config, strlen(config)));
+	if (err >= 0) {
+		err = ALSA_CHECK(snd_config_load(top, input));
+		snd_input_close(input);
+		if (err >= 0)
+			err = ALSA_CHECK(snd_pcm_open_lconf(pcm, "test",
+							    SND_PCM_STREAM_PLAYBACK,
+							    0, top));
+	}
+	snd_config_delete(top);
+	return err;
+}
+
+/* write buf through the plugin into the file at path in random chunks */
+static int play(const char *type, const char *path, snd_pcm_format_t format,
+		snd_pcm_format_t sformat, unsigned int channels,
+		snd_pcm_access_t access, const char *buf)
+{
+	size_t width = snd_pcm_format_physical_width(format) / 8;
+	snd_pcm_sframes_t frames, written;
+	unsigned int seed = 2, c;
+	char config[512];
+	void *bufs[4];
+	snd_pcm_t *pcm;
+	int err;
+
+	snprintf(config, sizeof(config),
+		 "pcm.test { type %s slave { pcm { type file file \"%s\" "
+		 "format raw slave.pcm { type null } } format %s } }",
+		 type, path, snd_pcm_format_name(sformat));
+	err = open_chain(&pcm, config);
+	if (err < 0)
+		return err;
+	err = ALSA_CHECK(snd_pcm_set_params(pcm, format, access, channels,
+					    48000, 1, 100000));
+	for (written = 0; err >= 0 && written < TEST_FRAMES; written += frames) {
+		frames = test_random(&seed) % 200 + 1;
+		if (frames > TEST_FRAMES - written)
+			frames = TEST_FRAMES - written;
+		if (access == SND_PCM_ACCESS_RW_NONINTERLEAVED) {
+			for (c = 0; c < channels; c++)
+				bufs[c] = (void *)(buf + (c * TEST_FRAMES + written) * width);
+			frames = snd_pcm_writen(pcm, bufs, frames);
+		} else {
+			frames = snd_pcm_writei(pcm, buf + written * channels * width,
+						frames);
+		}
+		if (frames < 0)
+			err = ALSA_CHECK(frames);
+	}
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_drain(pcm));
+	snd_pcm_close(pcm);
+	return err;
+}
+
+static void test_conversion(snd_pcm_format_t format, snd_pcm_format_t sformat,
+			    snd_pcm_access_t access)
+{
+	const char *type = format_float(format) || format_float(sformat) ?
+		"lfloat" : "linear";
+	size_t width = snd_pcm_format_physical_width(format) / 8;
+	size_t swidth = snd_pcm_format_physical_width(sformat) / 8;
+	unsigned int channels = access == SND_PCM_ACCESS_RW_NONINTERLEAVED ? 3 : 2;
+	size_t i, size, samples = TEST_FRAMES * channels;
+	unsigned int errors = 0;
+	char path[32], expected[8], *buf, *out = NULL;
+	long len;
+	FILE *f;
+	int fd;
+
+	buf = malloc(samples * width);
+	TEST_CHECK(buf != NULL);
+	if (!buf)
+		return;
+	random_samples(format, buf, samples);
+	strcpy(path, "/tmp/alsa-lib-test-XXXXXX");
+	fd = mkstemp(path);
+	TEST_CHECK(fd >= 0);
+	if (fd < 0)
+		goto __free;
+	close(fd);
+	if (play(type, path, format, sformat, channels, access, buf) < 0)
+		goto __unlink;
+
+	f = fopen(path, "rb");
+	size = 0;
+	if (f && fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0) {
+		rewind(f);
+		out = malloc(len);
+		if (out)
+			size = fread(out, 1, len, f);
+	}
+	if (f)
+		fclose(f);
+	TEST_CHECK(size == samples * swidth);
+	if (size != samples * swidth)
+		goto __unlink;
+	for (i = 0; i < samples; i++) {
+		/* the file holds interleaved frames */
+		size_t src = access == SND_PCM_ACCESS_RW_NONINTERLEAVED ?
+			(i % channels) * TEST_FRAMES + i / channels : i;
+
+		ref_put(sformat, expected, ref_get(format, buf + src * width));
+		if (memcmp(out + i * swidth, expected, swidth))
+			errors++;
+	}
+	if (errors)
+		fprintf(stderr, "%s %s -> %s%s: %u samples differ\n", type,
+			snd_pcm_format_name(format), snd_pcm_format_name(sformat),
+			access == SND_PCM_ACCESS_RW_NONINTERLEAVED ?
+			" non-interleaved" : "", errors);
+	TEST_CHECK(errors == 0);
+ __unlink:
+	unlink(path);
+ __free:
+	free(buf);
+	free(out);
+}
+
+static const snd_pcm_format_t formats[] = {
+	SND_PCM_FORMAT_S16_LE, SND_PCM_FORMAT_S16_BE,
+	SND_PCM_FORMAT_S32_LE, SND_PCM_FORMAT_S32_BE,
+	SND_PCM_FORMAT_S24_3LE, SND_PCM_FORMAT_S24_3BE,
+	SND_PCM_FORMAT_FLOAT_LE, SND_PCM_FORMAT_FLOAT_BE,
+};
+
+int main(void)
+{
+	unsigned int i, j, n = sizeof(formats) / sizeof(formats[0]);
+
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			if (i == j || (format_float(formats[i]) && format_float(formats[j])))
+				continue;
+			test_conversion(formats[i], formats[j],
+					SND_PCM_ACCESS_RW_INTERLEAVED);
+			test_conversion(formats[i], formats[j],
+					SND_PCM_ACCESS_RW_NONINTERLEAVED);
+		}
+	}
+	return TEST_EXIT_CODE();
+}
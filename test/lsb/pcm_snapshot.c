@@ -0,0 +1,170 @@
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "test.h"
+
+/*
+ * With $LIBASOUND_THREAD_SAFE=2 the status queries of a thread other
+ * than the transferring one may return the avail published up to a
+ * period ago.  The calls moving the position or changing the state must
+ * drop it: after each of them the other thread has to see the new avail
+ * at once.  The period is long, so that the published values stay fresh
+ * during the whole test.
+ */
+
+#define RATE		48000
+#define PERIOD		RATE		/* a second */
+#define WRITTEN		1000
+
+static const char config[] = "pcm.test { type null }";
+
+static snd_pcm_t *pcm;
+static snd_pcm_uframes_t buffer_size;
+
+static int open_null(void)
+{
+	snd_input_t *input;
+	snd_config_t *top;
+	int err;
+
+	err = ALSA_CHECK(snd_config_top(&top));
+	if (err < 0)
+		return err;
+	err = ALSA_CHECK(snd_input_buffer_open(&input, config, strlen(config)));
+	if (err >= 0) {
+		err = ALSA_CHECK(snd_config_load(top, input));
+		snd_input_close(input);
+		if (err >= 0)
+			err = ALSA_CHECK(snd_pcm_open_lconf(&pcm, "test",
+							    SND_PCM_STREAM_PLAYBACK,
+							    0, top));
+	}
+	snd_config_delete(top);
+	return err;
+}
+
+/* the stream stays prepared until it is started explicitly */
+static int setup(void)
+{
+	snd_pcm_hw_params_t *hw;
+	snd_pcm_sw_params_t *sw;
+	snd_pcm_uframes_t boundary;
+	int err;
+
+	snd_pcm_hw_params_alloca(&hw);
+	snd_pcm_sw_params_alloca(&sw);
+	err = ALSA_CHECK(snd_pcm_hw_params_any(pcm, hw));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_hw_params_set_access(pcm, hw,
+						SND_PCM_ACCESS_MMAP_INTERLEAVED));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_hw_params_set_format(pcm, hw,
+						SND_PCM_FORMAT_S16_LE));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_hw_params_set_channels(pcm, hw, 2));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_hw_params_set_rate(pcm, hw, RATE, 0));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_hw_params_set_period_size(pcm, hw,
+								    PERIOD, 0));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_hw_params_set_periods(pcm, hw, 4, 0));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_hw_params(pcm, hw));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_hw_params_get_buffer_size(hw, &buffer_size));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_sw_params_current(pcm, sw));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_sw_params_get_boundary(sw, &boundary));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_sw_params_set_start_threshold(pcm, sw,
+								       boundary));
+	if (err >= 0)
+		err = ALSA_CHECK(snd_pcm_sw_params(pcm, sw));
+	return err;
+}
+
+struct query {
+	snd_pcm_sframes_t avail_update;
+	snd_pcm_sframes_t avail;
+};
+
+static void *query_thread(void *arg)
+{
+	struct query *q = arg;
+
+	q->avail_update = snd_pcm_avail_update(pcm);
+	q->avail = snd_pcm_avail(pcm);
+	return NULL;
+}
+
+/* the avail as seen by another thread than the writer */
+static void query(const char *what, snd_pcm_sframes_t expected)
+{
+	struct query q = { -1, -1 };
+	pthread_t thread;
+
+	TEST_CHECK(pthread_create(&thread, NULL, query_thread, &q) == 0);
+	pthread_join(thread, NULL);
+	if (q.avail_update != expected || q.avail != expected) {
+		fprintf(stderr, "%s: avail %ld, %ld instead of %ld\n", what,
+			(long)q.avail_update, (long)q.avail, (long)expected);
+		any_test_failed = 1;
+	}
+}
+
+/*
+ * a fresh stream with WRITTEN frames committed and the avail published,
+ * the null PCM moves its hw_ptr on the writes but not on the commits
+ */
+static void restart(void)
+{
+	const snd_pcm_channel_area_t *areas;
+	snd_pcm_uframes_t offset, frames = WRITTEN;
+
+	ALSA_CHECK(snd_pcm_drop(pcm));
+	ALSA_CHECK(snd_pcm_prepare(pcm));
+	ALSA_CHECK(snd_pcm_mmap_begin(pcm, &areas, &offset, &frames));
+	TEST_CHECK(frames == WRITTEN);
+	TEST_CHECK(snd_pcm_mmap_commit(pcm, offset, frames) == WRITTEN);
+	query("commit", buffer_size - WRITTEN);
+}
+
+int main(void)
+{
+	setenv("LIBASOUND_THREAD_SAFE", "2", 1);
+#ifndef THREAD_SAFE_API
+	return 77;
+#endif
+	if (open_null() < 0)
+		return TEST_EXIT_CODE();
+	if (setup() < 0)
+		goto __close;
+
+	restart();
+	TEST_CHECK(snd_pcm_rewind(pcm, 300) == 300);
+	query("rewind", buffer_size - WRITTEN + 300);
+
+	restart();
+	TEST_CHECK(snd_pcm_forward(pcm, 300) == 300);
+	query("forward", buffer_size - WRITTEN - 300);
+
+	restart();
+	ALSA_CHECK(snd_pcm_reset(pcm));
+	query("reset", buffer_size);
+
+	restart();
+	ALSA_CHECK(snd_pcm_drop(pcm));
+	ALSA_CHECK(snd_pcm_prepare(pcm));
+	query("prepare", buffer_size);
+
+	restart();
+	ALSA_CHECK(snd_pcm_start(pcm));
+	query("start", buffer_size);
+
+ __close:
+	snd_pcm_close(pcm);
+	return TEST_EXIT_CODE();
+}
@@ -0,0 +1,281 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "../../src/pcm/pcm_softvol_scale.h"
+
+/*
+ * Runs the softvol gain kernels and the volume ramp without a sound card.
+ * Every format is scaled with random gains and compared with
+ *   out = clip((in * gain) >> 16)
+ * in both the contiguous and the strided loops.  The ramp must move
+ * linearly from the applied gain to the new one, in any chunking of the
+ * transfers, and a change during a ramp must continue from where it is.
+ */
+
+#define SAMPLES		1000
+#define STRIDE		3	/* samples per strided step */
+
+static unsigned int seed = 1;
+
+static unsigned int test_random(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+struct format {
+	snd_pcm_format_t format;
+	unsigned int width;	/* bytes */
+	long long min, max;
+};
+
+static const struct format formats[] = {
+	{ SND_PCM_FORMAT_S16_LE, 2, -0x8000, 0x7fff },
+	{ SND_PCM_FORMAT_S16_BE, 2, -0x8000, 0x7fff },
+	{ SND_PCM_FORMAT_S24_LE, 4, -0x800000, 0x7fffff },
+	{ SND_PCM_FORMAT_S24_3LE, 3, -0x800000, 0x7fffff },
+	{ SND_PCM_FORMAT_S32_LE, 4, -0x80000000LL, 0x7fffffff },
+	{ SND_PCM_FORMAT_S32_BE, 4, -0x80000000LL, 0x7fffffff },
+	{ SND_PCM_FORMAT_FLOAT_LE, 4, 0, 0 },
+	{ SND_PCM_FORMAT_FLOAT_BE, 4, 0, 0 },
+};
+
+static long long get_int(const struct format *f, const unsigned char *p)
+{
+	int le = snd_pcm_format_little_endian(f->format) == 1;
+	unsigned int i, v = 0;
+
+	for (i = 0; i < f->width; i++)
+		v |= (unsigned int)p[le ? i : f->width - 1 - i] << (i * 8);
+	if (f->format == SND_PCM_FORMAT_S24_LE)
+		v &= 0xffffff;
+	/* sign extend the used bits */
+	if (f->max == 0x7fff)
+		return (int16_t)v;
+	if (f->max == 0x7fffff)
+		return (int32_t)(v << 8) >> 8;
+	return (int32_t)v;
+}
+
+static float get_float(const struct format *f, const unsigned char *p)
+{
+	union {
+		float f;
+		uint32_t i;
+	} v;
+
+	v.i = get_int(f, p);
+	return v.f;
+}
+
+static void set_random(const struct format *f, unsigned char *p)
+{
+	union {
+		float f;
+		uint32_t i;
+	} v;
+	unsigned int i;
+
+	if (f->format == SND_PCM_FORMAT_FLOAT_LE ||
+	    f->format == SND_PCM_FORMAT_FLOAT_BE) {
+		v.f = ((int)(test_random() & 0xffff) - 0x8000) / 32768.0f;
+		if (snd_pcm_format_little_endian(f->format) != 1)
+			v.i = bswap_32(v.i);
+		memcpy(p, &v.i, 4);
+		return;
+	}
+	for (i = 0; i < f->width; i++)
+		p[i] = test_random();
+	/* S24_LE uses the lower 24 bits only */
+	if (f->format == SND_PCM_FORMAT_S24_LE)
+		p[3] = p[2] & 0x80 ? 0xff : 0;
+}
+
+/* the gains of the softvol table: mute, unity, attenuation and boost */
+static unsigned int random_gain(int boost)
+{
+	switch (test_random() % 4) {
+	case 0:
+		return 0;
+	case 1:
+		return softvol_gain(0xffff);
+	case 2:
+		return test_random() % SOFTVOL_UNITY;
+	default:
+		return boost ? SOFTVOL_UNITY + test_random() % (4 * SOFTVOL_UNITY) :
+			test_random() % SOFTVOL_UNITY;
+	}
+}
+
+static unsigned int check_scaled(const struct format *f,
+				 const unsigned char *src, const unsigned char *dst,
+				 unsigned int step, const unsigned int *gains)
+{
+	unsigned int i, errors = 0;
+	long long v;
+
+	for (i = 0; i < SAMPLES; i++) {
+		const unsigned char *s = src + i * step, *d = dst + i * step;
+
+		if (!f->max) {
+			float r = get_float(f, s) * (gains[i] / 65536.0f);
+
+			if (get_float(f, d) != r)
+				errors++;
+			continue;
+		}
+		v = (get_int(f, s) * gains[i]) >> 16;
+		if (v > f->max)
+			v = f->max;
+		else if (v < f->min)
+			v = f->min;
+		if (get_int(f, d) != v)
+			errors++;
+		/* the unused byte of S24_LE is the sign */
+		if (f->format == SND_PCM_FORMAT_S24_LE && d[3] != (d[2] & 0x80 ? 0xff : 0))
+			errors++;
+	}
+	return errors;
+}
+
+static void test_scale(const struct format *f, int boost)
+{
+	unsigned int step = f->width * STRIDE, errors;
+	unsigned int gains[SAMPLES], i;
+	unsigned char *src, *dst;
+
+	src = calloc(SAMPLES, step);
+	dst = calloc(SAMPLES, step);
+	TEST_CHECK(src && dst);
+	if (!src || !dst)
+		goto __free;
+	for (i = 0; i < SAMPLES; i++) {
+		gains[i] = random_gain(boost);
+		set_random(f, src + i * f->width);
+	}
+	/* contiguous, in place like the plugin does it */
+	memcpy(dst, src, SAMPLES * f->width);
+	softvol_scale(f->format, (char *)dst, f->width, (const char *)dst,
+		      f->width, gains, SAMPLES, boost);
+	errors = check_scaled(f, src, dst, f->width, gains);
+	/* strided */
+	for (i = SAMPLES; i-- > 0; )
+		memmove(src + i * step, src + i * f->width, f->width);
+	softvol_scale(f->format, (char *)dst, step, (const char *)src, step,
+		      gains, SAMPLES, boost);
+	errors += check_scaled(f, src, dst, step, gains);
+	if (errors)
+		fprintf(stderr, "%s%s: %u samples differ\n",
+			snd_pcm_format_name(f->format), boost ? " boost" : "",
+			errors);
+	TEST_CHECK(errors == 0);
+ __free:
+	free(src);
+	free(dst);
+}
+
+#define RAMP_LEN	1000
+
+static void ramp_setup(snd_pcm_softvol_ramp_t *ramp, const unsigned int *vol)
+{
+	memset(ramp, 0, sizeof(*ramp));
+	ramp->len = RAMP_LEN;
+	softvol_ramp_start(ramp, vol);
+}
+
+/* the gains of slots 0..2 for each frame, transferred in the given chunks */
+static void ramp_run(snd_pcm_softvol_ramp_t *ramp, unsigned int frames,
+		     unsigned int chunk, unsigned int *gains)
+{
+	static const unsigned int slots[3] = { 0, 1, 2 };
+	unsigned int done, n;
+
+	for (done = 0; done < frames; done += n) {
+		n = chunk ? chunk : test_random() % 300 + 1;
+		if (n > frames - done)
+			n = frames - done;
+		softvol_ramp_gains(ramp, slots, 3, 0, n, gains + done * 3);
+		if (softvol_ramp_running(ramp))
+			softvol_ramp_advance(ramp, n);
+	}
+}
+
+static void test_ramp(void)
+{
+	static const unsigned int vol0[3] = { 0, SOFTVOL_UNITY, 0x8000 };
+	static const unsigned int vol1[3] = { SOFTVOL_UNITY, 0, 0x20000 };
+	static const unsigned int vol2[3] = { 0x4000, 0x4000, 0x4000 };
+	unsigned int g1[(RAMP_LEN + 100) * 3], g2[(RAMP_LEN + 100) * 3];
+	snd_pcm_softvol_ramp_t ramp;
+	unsigned int i, slot, mid;
+
+	/* the first volume after the setup applies at once */
+	ramp_setup(&ramp, vol0);
+	TEST_CHECK(!softvol_ramp_running(&ramp));
+	for (slot = 0; slot < 3; slot++)
+		TEST_CHECK(softvol_ramp_gain(&ramp, slot, 0) == vol0[slot]);
+
+	/* the same volume again starts nothing */
+	softvol_ramp_start(&ramp, vol0);
+	TEST_CHECK(!softvol_ramp_running(&ramp));
+
+	/* a linear ramp to vol1 over RAMP_LEN frames, then vol1 */
+	softvol_ramp_start(&ramp, vol1);
+	TEST_CHECK(softvol_ramp_running(&ramp));
+	ramp_run(&ramp, RAMP_LEN + 100, 1, g1);
+	TEST_CHECK(!softvol_ramp_running(&ramp));
+	for (i = 0; i < RAMP_LEN + 100; i++) {
+		for (slot = 0; slot < 3; slot++) {
+			long long from = vol0[slot], to = vol1[slot];
+			long long expected = i >= RAMP_LEN ? to :
+				from + (to - from) * i / RAMP_LEN;
+
+			TEST_CHECK(g1[i * 3 + slot] == expected);
+		}
+	}
+
+	/* any chunking gives the same gains */
+	ramp_setup(&ramp, vol0);
+	softvol_ramp_start(&ramp, vol1);
+	ramp_run(&ramp, RAMP_LEN + 100, 0, g2);
+	TEST_CHECK(!memcmp(g1, g2, sizeof(g1)));
+
+	/* a change in the middle continues from the gain reached */
+	ramp_setup(&ramp, vol0);
+	softvol_ramp_start(&ramp, vol1);
+	mid = RAMP_LEN / 3;
+	ramp_run(&ramp, mid, 0, g2);
+	softvol_ramp_start(&ramp, vol2);
+	for (slot = 0; slot < 3; slot++)
+		TEST_CHECK(softvol_ramp_gain(&ramp, slot, 0) == g1[mid * 3 + slot]);
+	ramp_run(&ramp, RAMP_LEN, 0, g2);
+	for (i = 0; i < RAMP_LEN; i++) {
+		for (slot = 0; slot < 3; slot++) {
+			long long from = g1[mid * 3 + slot], to = vol2[slot];
+
+			TEST_CHECK(g2[i * 3 + slot] == from + (to - from) * i / RAMP_LEN);
+		}
+	}
+	for (slot = 0; slot < 3; slot++)
+		TEST_CHECK(softvol_ramp_gain(&ramp, slot, 0) == vol2[slot]);
+
+	/* without the ramp option a change applies at once */
+	memset(&ramp, 0, sizeof(ramp));
+	softvol_ramp_start(&ramp, vol0);
+	softvol_ramp_start(&ramp, vol1);
+	TEST_CHECK(!softvol_ramp_running(&ramp));
+	for (slot = 0; slot < 3; slot++)
+		TEST_CHECK(softvol_ramp_gain(&ramp, slot, 0) == vol1[slot]);
+}
+
+int main(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+		test_scale(&formats[i], 0);
+		test_scale(&formats[i], 1);
+	}
+	test_ramp();
+	return TEST_EXIT_CODE();
+}